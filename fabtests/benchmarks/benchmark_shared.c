@@ -33,10 +33,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <strings.h>
 
 #include <rdma/fi_errno.h>
+#include <rdma/fi_atomic.h>
 
 #include "shared.h"
+#include "hmem.h"
 #include "benchmark_shared.h"
 
 /* when the -j option is set, user supplied inject_size must be honored,
@@ -531,3 +535,457 @@ int bandwidth_rma(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
 		show_perf(NULL, opts.transfer_size, opts.iterations, &start, &end, 1);
 	return 0;
 }
+
+/* Atomic benchmarks.  The server only provides the target buffer and
+ * drives progress; all operations are issued by the client.  With
+ * more than one initiator, the client opens additional endpoints on the
+ * same domain and every operation hits the same target word.
+ */
+struct ft_atomic_bench_op {
+	const char *name;
+	enum ft_atomic_opcodes opcode;
+	enum fi_op op;
+};
+
+static struct ft_atomic_bench_op atomic_bench_ops[] = {
+	{ "write", FT_ATOMIC_BASE, FI_ATOMIC_WRITE },
+	{ "sum", FT_ATOMIC_BASE, FI_SUM },
+	{ "fadd", FT_ATOMIC_FETCH, FI_SUM },
+	{ "cswap", FT_ATOMIC_COMPARE, FI_CSWAP },
+};
+
+static const char *atomic_bench_datatypes[OFI_DATATYPE_CNT] = {
+	[FI_INT8] = "int8",
+	[FI_UINT8] = "uint8",
+	[FI_INT16] = "int16",
+	[FI_UINT16] = "uint16",
+	[FI_INT32] = "int32",
+	[FI_UINT32] = "uint32",
+	[FI_INT64] = "int64",
+	[FI_UINT64] = "uint64",
+	[FI_FLOAT] = "float",
+	[FI_DOUBLE] = "double",
+	[FI_FLOAT_COMPLEX] = "float_complex",
+	[FI_DOUBLE_COMPLEX] = "double_complex",
+	[FI_LONG_DOUBLE] = "long_double",
+	[FI_LONG_DOUBLE_COMPLEX] = "long_double_complex",
+	[FI_INT128] = "int128",
+	[FI_UINT128] = "uint128",
+};
+
+static int atomic_bench_op = -1;
+static int atomic_bench_datatype = FI_UINT64;
+static size_t atomic_bench_count;
+static int atomic_initiators = 1;
+
+static struct fid_ep **atomic_eps;
+static void *atomic_result, *atomic_compare;
+static struct fid_mr *atomic_result_mr, *atomic_compare_mr;
+
+int ft_parse_atomic_benchmark_opts(int op, char *optarg)
+{
+	size_t i;
+
+	switch (op) {
+	case 'o':
+		if (!strcasecmp(optarg, "all")) {
+			atomic_bench_op = -1;
+			break;
+		}
+		for (i = 0; i < ARRAY_SIZE(atomic_bench_ops); i++) {
+			if (!strcasecmp(optarg, atomic_bench_ops[i].name))
+				break;
+		}
+		if (i == ARRAY_SIZE(atomic_bench_ops)) {
+			FT_ERR("Unknown atomic op %s", optarg);
+			return -FI_EINVAL;
+		}
+		atomic_bench_op = (int) i;
+		break;
+	case 'z':
+		if (!strcasecmp(optarg, "all")) {
+			atomic_bench_datatype = -1;
+			break;
+		}
+		for (i = 0; i < OFI_DATATYPE_CNT; i++) {
+			if (atomic_bench_datatypes[i] &&
+			    !strcasecmp(optarg, atomic_bench_datatypes[i]))
+				break;
+		}
+		if (i == OFI_DATATYPE_CNT) {
+			FT_ERR("Unknown atomic datatype %s", optarg);
+			return -FI_EINVAL;
+		}
+		atomic_bench_datatype = (int) i;
+		break;
+	case 'n':
+		atomic_bench_count = strtoul(optarg, NULL, 0);
+		if (!atomic_bench_count ||
+		    atomic_bench_count > FT_ATOMIC_MAX_COUNT) {
+			FT_ERR("Atomic count must be 1-%d", FT_ATOMIC_MAX_COUNT);
+			return -FI_EINVAL;
+		}
+		break;
+	case 'T':
+		atomic_initiators = atoi(optarg);
+		if (atomic_initiators < 1) {
+			FT_ERR("Number of initiators must be at least 1");
+			return -FI_EINVAL;
+		}
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
+void ft_atomic_benchmark_usage(void)
+{
+	FT_PRINT_OPTS_USAGE("-o <op>", "atomic op: all|write|sum|fadd|cswap "
+			    "(default: all)");
+	FT_PRINT_OPTS_USAGE("-z <datatype>", "atomic datatype: all|int8|uint8|"
+			    "int16|uint16|int32|uint32|int64|uint64|");
+	FT_PRINT_OPTS_USAGE("", "int128|uint128|float|double|float_complex|"
+			    "double_complex|long_double|long_double_complex "
+			    "(default: uint64)");
+	FT_PRINT_OPTS_USAGE("-n <count>", "elements per atomic "
+			    "(default: 1, 4, 16 and 64)");
+	FT_PRINT_OPTS_USAGE("-T <initiators>", "client endpoints issuing "
+			    "atomics to a single target word (default: 1, "
+			    "each window slot targets its own word)");
+}
+
+int ft_atomic_alloc_res(void)
+{
+	size_t size;
+	int i, ret;
+
+	size = FT_ATOMIC_MAX_COUNT * FT_ATOMIC_MAX_DT_SIZE * opts.window_size;
+	ret = ft_hmem_alloc(opts.iface, opts.device, &atomic_result, size);
+	if (ret)
+		return ret;
+
+	ret = ft_hmem_alloc(opts.iface, opts.device, &atomic_compare, size);
+	if (ret)
+		return ret;
+
+	ret = ft_hmem_memset(opts.iface, opts.device, atomic_compare, 0, size);
+	if (ret)
+		return ret;
+
+	ret = ft_reg_mr(fi, atomic_result, size, ft_info_to_mr_access(fi),
+			FT_MR_KEY + 1, opts.iface, opts.device,
+			&atomic_result_mr, NULL);
+	if (ret)
+		return ret;
+
+	ret = ft_reg_mr(fi, atomic_compare, size, ft_info_to_mr_access(fi),
+			FT_MR_KEY + 2, opts.iface, opts.device,
+			&atomic_compare_mr, NULL);
+	if (ret)
+		return ret;
+
+	atomic_eps = calloc(atomic_initiators, sizeof(*atomic_eps));
+	if (!atomic_eps)
+		return -FI_ENOMEM;
+
+	atomic_eps[0] = ep;
+	if (!opts.dst_addr)
+		return 0;
+
+	for (i = 1; i < atomic_initiators; i++) {
+		ret = fi_endpoint(domain, fi, &atomic_eps[i], NULL);
+		if (ret) {
+			FT_PRINTERR("fi_endpoint", ret);
+			return ret;
+		}
+
+		ret = ft_enable_ep(atomic_eps[i], eq, av, txcq, rxcq, txcntr,
+				   rxcntr, rma_cntr);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+void ft_atomic_free_res(void)
+{
+	int i;
+
+	if (atomic_eps) {
+		for (i = 1; i < atomic_initiators; i++)
+			FT_CLOSE_FID(atomic_eps[i]);
+		free(atomic_eps);
+		atomic_eps = NULL;
+	}
+	FT_CLOSE_FID(atomic_result_mr);
+	FT_CLOSE_FID(atomic_compare_mr);
+	if (atomic_result) {
+		ft_hmem_free(opts.iface, atomic_result);
+		atomic_result = NULL;
+	}
+	if (atomic_compare) {
+		ft_hmem_free(opts.iface, atomic_compare);
+		atomic_compare = NULL;
+	}
+}
+
+static ssize_t post_atomic(struct ft_atomic_bench_op *bench_op,
+			   enum fi_datatype datatype, size_t count,
+			   struct fi_rma_iov *remote, int slot, int initiator,
+			   uint64_t flags)
+{
+	size_t op_size = count * datatype_to_size(datatype);
+	struct fi_ioc iov, cmp_iov, res_iov;
+	struct fi_rma_ioc rma_iov;
+	struct fi_msg_atomic msg;
+	void *cmp_desc, *res_desc;
+	int target_slot;
+	ssize_t ret;
+
+	iov.addr = tx_buf + FT_ATOMIC_TARGET_RESV + slot * op_size;
+	iov.count = count;
+	cmp_iov.addr = (char *) atomic_compare + slot * op_size;
+	cmp_iov.count = count;
+	cmp_desc = fi_mr_desc(atomic_compare_mr);
+	res_iov.addr = (char *) atomic_result + slot * op_size;
+	res_iov.count = count;
+	res_desc = fi_mr_desc(atomic_result_mr);
+
+	/* Contended operations all target the first slot */
+	target_slot = atomic_initiators > 1 ? 0 : slot;
+	rma_iov.addr = remote->addr + FT_ATOMIC_TARGET_RESV +
+		       target_slot * op_size;
+	rma_iov.count = count;
+	rma_iov.key = remote->key;
+
+	msg.msg_iov = &iov;
+	msg.desc = &mr_desc;
+	msg.iov_count = 1;
+	msg.addr = remote_fi_addr;
+	msg.rma_iov = &rma_iov;
+	msg.rma_iov_count = 1;
+	msg.datatype = datatype;
+	msg.op = bench_op->op;
+	msg.context = &tx_ctx_arr[slot].context;
+	msg.data = 0;
+
+	while (1) {
+		switch (bench_op->opcode) {
+		case FT_ATOMIC_BASE:
+			ret = fi_atomicmsg(atomic_eps[initiator], &msg, flags);
+			break;
+		case FT_ATOMIC_FETCH:
+			ret = fi_fetch_atomicmsg(atomic_eps[initiator], &msg,
+						 &res_iov, &res_desc, 1, flags);
+			break;
+		default:
+			ret = fi_compare_atomicmsg(atomic_eps[initiator], &msg,
+						   &cmp_iov, &cmp_desc, 1,
+						   &res_iov, &res_desc, 1,
+						   flags);
+			break;
+		}
+		if (ret != -FI_EAGAIN)
+			break;
+
+		ret = ft_progress(txcq, tx_seq, &tx_cq_cntr);
+		if (ret)
+			return ret;
+	}
+
+	if (ret) {
+		FT_PRINTERR("fi_atomicmsg", ret);
+		return ret;
+	}
+	tx_seq++;
+	return 0;
+}
+
+static int check_bench_op(struct ft_atomic_bench_op *bench_op,
+			  enum fi_datatype datatype, size_t *max_count)
+{
+	switch (bench_op->opcode) {
+	case FT_ATOMIC_BASE:
+		return check_base_atomic_op(ep, bench_op->op, datatype,
+					    max_count);
+	case FT_ATOMIC_FETCH:
+		return check_fetch_atomic_op(ep, bench_op->op, datatype,
+					     max_count);
+	default:
+		return check_compare_atomic_op(ep, bench_op->op, datatype,
+					       max_count);
+	}
+}
+
+static int atomic_pingpong_test(struct ft_atomic_bench_op *bench_op,
+				enum fi_datatype datatype, size_t count,
+				struct fi_rma_iov *remote)
+{
+	int ret, i;
+
+	for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
+		if (i == opts.warmup_iterations)
+			ft_start();
+
+		ret = post_atomic(bench_op, datatype, count, remote, 0,
+				  i % atomic_initiators, 0);
+		if (ret)
+			return ret;
+
+		ret = ft_get_tx_comp(tx_seq);
+		if (ret)
+			return ret;
+	}
+	ft_stop();
+	return 0;
+}
+
+static int atomic_bw_test(struct ft_atomic_bench_op *bench_op,
+			  enum fi_datatype datatype, size_t count,
+			  struct fi_rma_iov *remote)
+{
+	int ret, i, j;
+	int flags = 0;
+
+	for (i = j = 0; i < opts.iterations + opts.warmup_iterations; i++) {
+		if (i == opts.warmup_iterations)
+			ft_start();
+
+		if (opts.use_fi_more)
+			flags = set_fi_more_flag(i, j, flags);
+		ret = post_atomic(bench_op, datatype, count, remote, j,
+				  i % atomic_initiators, flags);
+		if (ret)
+			return ret;
+
+		if (++j == opts.window_size) {
+			ret = ft_get_tx_comp(tx_seq);
+			if (ret)
+				return ret;
+			j = 0;
+		}
+	}
+	ret = ft_get_tx_comp(tx_seq);
+	if (ret)
+		return ret;
+	ft_stop();
+	return 0;
+}
+
+static int run_atomic_test(struct ft_atomic_bench_op *bench_op,
+			   enum fi_datatype datatype, size_t count,
+			   struct fi_rma_iov *remote, bool bw)
+{
+	char name[FT_STR_LEN];
+	int ret;
+
+	opts.transfer_size = count * datatype_to_size(datatype);
+	if (!(opts.options & FT_OPT_ITER))
+		opts.iterations = size_to_count(opts.transfer_size);
+
+	ret = ft_sync();
+	if (ret)
+		return ret;
+
+	if (opts.dst_addr) {
+		ret = bw ? atomic_bw_test(bench_op, datatype, count, remote) :
+			   atomic_pingpong_test(bench_op, datatype, count,
+						remote);
+		if (ret)
+			return ret;
+	}
+
+	ret = ft_sync();
+	if (ret)
+		return ret;
+
+	/* The target is passive, so only the initiator has timings */
+	if (!opts.dst_addr)
+		return 0;
+
+	snprintf(name, sizeof(name), "%s_%s%s", bench_op->name,
+		 atomic_bench_datatypes[datatype], bw ? "" : "_lat");
+	if (opts.machr)
+		show_perf_mr(opts.transfer_size, opts.iterations, &start, &end,
+			     1, opts.argc, opts.argv);
+	else
+		show_perf(name, opts.transfer_size, opts.iterations, &start,
+			  &end, 1);
+	return 0;
+}
+
+static int run_atomic_datatype(struct ft_atomic_bench_op *bench_op,
+			       enum fi_datatype datatype,
+			       struct fi_rma_iov *remote, bool bw)
+{
+	size_t count, max_count;
+	int ret;
+
+	ret = check_bench_op(bench_op, datatype, &max_count);
+	if (ret == -FI_ENOSYS || ret == -FI_EOPNOTSUPP) {
+		if (atomic_bench_datatype >= 0)
+			fprintf(stderr, "Provider doesn't support %s on %s\n",
+				bench_op->name,
+				atomic_bench_datatypes[datatype]);
+		return 0;
+	} else if (ret) {
+		return ret;
+	}
+
+	if (atomic_bench_count) {
+		if (atomic_bench_count > max_count) {
+			fprintf(stderr, "Provider supports at most %zu "
+				"%s elements per atomic\n", max_count,
+				atomic_bench_datatypes[datatype]);
+			return 0;
+		}
+		return run_atomic_test(bench_op, datatype, atomic_bench_count,
+				       remote, bw);
+	}
+
+	for (count = 1; count <= MIN(max_count, FT_ATOMIC_MAX_COUNT);
+	     count *= 4) {
+		ret = run_atomic_test(bench_op, datatype, count, remote, bw);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int run_atomic_benchmark(struct fi_rma_iov *remote, bool bw)
+{
+	size_t i;
+	int datatype, ret;
+
+	if (opts.window_size > fi->tx_attr->size)
+		opts.window_size = (int) fi->tx_attr->size;
+
+	for (i = 0; i < ARRAY_SIZE(atomic_bench_ops); i++) {
+		if (atomic_bench_op >= 0 && i != (size_t) atomic_bench_op)
+			continue;
+
+		for (datatype = 0; datatype < OFI_DATATYPE_CNT; datatype++) {
+			if (!atomic_bench_datatypes[datatype] ||
+			    (atomic_bench_datatype >= 0 &&
+			     datatype != atomic_bench_datatype))
+				continue;
+
+			ret = run_atomic_datatype(&atomic_bench_ops[i],
+						  datatype, remote, bw);
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+int pingpong_atomic(struct fi_rma_iov *remote)
+{
+	return run_atomic_benchmark(remote, false);
+}
+
+int bandwidth_atomic(struct fi_rma_iov *remote)
+{
+	return run_atomic_benchmark(remote, true);
+}
@@ -43,6 +43,15 @@ extern "C" {
 #define BENCHMARK_OPTS "vkj:W:"
 #define FT_BENCHMARK_MAX_MSG_SIZE (test_size[TEST_CNT - 1].size)
 
+#define ATOMIC_BENCHMARK_OPTS "o:z:n:T:"
+#define FT_ATOMIC_MAX_COUNT	64
+#define FT_ATOMIC_MAX_DT_SIZE	32
+/* Keeps the target slots clear of, and aligned past, the ft_sync() area */
+#define FT_ATOMIC_TARGET_RESV	64
+/* Transfer size used to allocate buffers for a window of atomics */
+#define FT_ATOMIC_BUF_SIZE \
+	(FT_ATOMIC_MAX_COUNT * FT_ATOMIC_MAX_DT_SIZE + FT_ATOMIC_TARGET_RESV)
+
 void ft_parse_benchmark_opts(int op, char *optarg);
 void ft_benchmark_usage(void);
 int pingpong(void);
@@ -50,6 +59,13 @@ int bandwidth(void);
 int pingpong_rma(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote);
 int bandwidth_rma(enum ft_rma_opcodes op, struct fi_rma_iov *remote);
 
+int ft_parse_atomic_benchmark_opts(int op, char *optarg);
+void ft_atomic_benchmark_usage(void);
+int ft_atomic_alloc_res(void);
+void ft_atomic_free_res(void);
+int pingpong_atomic(struct fi_rma_iov *remote);
+int bandwidth_atomic(struct fi_rma_iov *remote);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Measures the cost of reading an empty CQ as the number of endpoints
+ * bound to it grows.  Every endpoint has a receive posted but no traffic,
+ * so providers that progress every bound endpoint on each read show a
+ * latency that scales linearly with the endpoint count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <inttypes.h>
+
+#include <rdma/fi_errno.h>
+
+#include "shared.h"
+
+static int max_eps = 1024;
+static int reads = 10000;
+
+static struct fi_info *ep_info;
+static struct fid_cq *read_cq;
+static struct fid_av *ep_av;
+static struct fid_ep **eps;
+static struct fi_context *rx_ctxs;
+static int ep_cnt;
+static char *rx_region;
+static struct fid_mr *rx_region_mr;
+static void *rx_region_desc;
+
+static void free_res(void)
+{
+	FT_CLOSEV_FID(eps, ep_cnt);
+	FT_CLOSE_FID(rx_region_mr);
+	FT_CLOSE_FID(ep_av);
+	FT_CLOSE_FID(read_cq);
+	free(eps);
+	free(rx_ctxs);
+	free(rx_region);
+	if (ep_info)
+		fi_freeinfo(ep_info);
+}
+
+static int init_local(void)
+{
+	struct fi_cq_attr cq_attr = {0};
+	struct fi_av_attr av_attr = {0};
+	int ret;
+
+	ret = ft_init();
+	if (ret)
+		return ret;
+
+	ret = ft_getinfo(hints, &fi);
+	if (ret)
+		return ret;
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		return ret;
+
+	cq_attr.format = FI_CQ_FORMAT_CONTEXT;
+	cq_attr.wait_obj = FI_WAIT_NONE;
+	cq_attr.size = max_eps;
+	ret = fi_cq_open(domain, &cq_attr, &read_cq, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_cq_open", ret);
+		return ret;
+	}
+
+	av_attr.type = fi->domain_attr->av_type;
+	ret = fi_av_open(domain, &av_attr, &ep_av, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_av_open", ret);
+		return ret;
+	}
+
+	ret = ft_get_extra_ep_info(&ep_info);
+	if (ret)
+		return ret;
+
+	eps = calloc(max_eps, sizeof(*eps));
+	rx_ctxs = calloc(max_eps, sizeof(*rx_ctxs));
+	rx_region = calloc(max_eps, opts.transfer_size);
+	if (!eps || !rx_ctxs || !rx_region)
+		return -FI_ENOMEM;
+
+	return ft_reg_mr(fi, rx_region, max_eps * opts.transfer_size,
+			 FI_RECV, FT_MR_KEY, FI_HMEM_SYSTEM, 0, &rx_region_mr,
+			 &rx_region_desc);
+}
+
+static int add_ep(void)
+{
+	struct fid_ep *new_ep;
+	int ret;
+
+	ret = fi_endpoint(domain, ep_info, &new_ep, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_endpoint", ret);
+		return ret;
+	}
+	eps[ep_cnt++] = new_ep;
+
+	ret = ft_enable_ep(new_ep, NULL, ep_av, read_cq, read_cq, NULL, NULL,
+			   NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_recv(new_ep, rx_region + (ep_cnt - 1) * opts.transfer_size,
+		      opts.transfer_size, rx_region_desc, FI_ADDR_UNSPEC,
+		      &rx_ctxs[ep_cnt - 1]);
+	if (ret)
+		FT_PRINTERR("fi_recv", ret);
+	return ret;
+}
+
+static int time_reads(void)
+{
+	struct fi_cq_entry entry;
+	int i, ret;
+
+	ft_start();
+	for (i = 0; i < reads; i++) {
+		ret = fi_cq_read(read_cq, &entry, 1);
+		if (ret != -FI_EAGAIN) {
+			FT_ERR("Unexpected result reading an empty CQ: %d",
+			       ret);
+			return ret < 0 ? ret : -FI_EOTHER;
+		}
+	}
+	ft_stop();
+	return 0;
+}
+
+static void show_reads(void)
+{
+	char name[FT_STR_LEN];
+	double ns_per_read;
+
+	ns_per_read = (double) get_elapsed(&start, &end, NANO) / reads;
+	if (opts.json) {
+		snprintf(name, sizeof(name), "eps%d", ep_cnt);
+		show_json("cq_read", NULL, name, 0,
+			  "\"endpoints\": %d, \"reads\": %d, "
+			  "\"ns_per_read\": %f", ep_cnt, reads, ns_per_read);
+		return;
+	}
+
+	printf("%-10d %10d %14.2f\n", ep_cnt, reads, ns_per_read);
+}
+
+static int run(void)
+{
+	int target, ret;
+
+	ret = init_local();
+	if (ret)
+		return ret;
+
+	if (!opts.json)
+		printf("%-10s %10s %14s\n", "endpoints", "reads",
+		       "ns/read");
+
+	for (target = 1; ; target = MIN(target * 4, max_eps)) {
+		while (ep_cnt < target) {
+			ret = add_ep();
+			if (ret)
+				return ret;
+		}
+
+		ret = time_reads();
+		if (ret)
+			return ret;
+		show_reads();
+
+		if (target == max_eps)
+			break;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt_long(argc, argv, "N:r:h" INFO_OPTS, long_opts,
+				 &lopt_idx)) != -1) {
+		switch (op) {
+		default:
+			if (!ft_parse_long_opts(op, optarg))
+				continue;
+			ft_parseinfo(op, optarg, hints, &opts);
+			break;
+		case 'N':
+			max_eps = atoi(optarg);
+			if (max_eps < 1) {
+				FT_ERR("At least one endpoint is required");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'r':
+			reads = atoi(optarg);
+			if (reads < 1) {
+				FT_ERR("At least one read is required");
+				return EXIT_FAILURE;
+			}
+			break;
+		case '?':
+		case 'h':
+			ft_usage(argv[0], "Empty CQ read cost versus the number "
+				 "of bound endpoints.");
+			FT_PRINT_OPTS_USAGE("-N <endpoints>", "maximum number "
+					    "of endpoints (default: 1024)");
+			FT_PRINT_OPTS_USAGE("-r <reads>", "CQ reads timed per "
+					    "step (default: 10000)");
+			ft_longopts_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	opts.transfer_size = 64;
+	if (!hints->ep_attr->type)
+		hints->ep_attr->type = FI_EP_RDM;
+	if (hints->ep_attr->type == FI_EP_MSG) {
+		FT_ERR("Connectionless endpoints are required");
+		return EXIT_FAILURE;
+	}
+	hints->caps = FI_MSG;
+	hints->mode = FI_CONTEXT;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+
+	ret = run();
+
+	free_res();
+	ft_free_res();
+	return ft_exit_code(ret);
+}
@@ -0,0 +1,466 @@
+/*
+ * Copyright (c) Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Records the memory and file descriptor footprint of a provider as
+ * endpoints, address vector entries and posted receives are added.  One
+ * JSON object is printed per step, so that per-peer, per-endpoint and
+ * per-buffer costs can be derived and compared across runs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_cm.h>
+
+#include "shared.h"
+
+#define FP_AV_BATCH	1024
+#define FP_STR_SUFFIX	24
+
+static int max_eps = 64;
+static size_t max_av = 100000;
+static size_t max_rx;
+static int connect_peer;
+
+static struct fi_info *ep_info;
+static struct fid_ep **eps;
+static int ep_cnt;
+static char *rx_region;
+static struct fid_mr *rx_region_mr;
+static struct fi_context *rx_ctxs;
+static struct timespec step_start;
+
+static int count_fds(void)
+{
+	int cnt = -1;
+#ifdef __linux__
+	struct dirent *entry;
+	DIR *dir;
+
+	dir = opendir("/proc/self/fd");
+	if (!dir)
+		return -1;
+
+	/* Do not count the descriptor used to read the directory */
+	for (cnt = -1; (entry = readdir(dir)); ) {
+		if (entry->d_name[0] != '.')
+			cnt++;
+	}
+	closedir(dir);
+#endif
+	return cnt;
+}
+
+/* usec is the time spent since the previous step */
+static void report(const char *phase, size_t count)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	printf("{\"provider\": \"%s\", \"phase\": \"%s\", \"count\": %zu, "
+	       "\"usec\": %" PRId64 ", \"rss_kb\": %ld, \"shmem_kb\": %ld, "
+	       "\"fds\": %d}\n",
+	       fi ? fi->fabric_attr->prov_name : "none", phase, count,
+	       get_elapsed(&step_start, &now, MICRO),
+	       ft_read_status_kb("VmRSS"), ft_read_status_kb("RssShmem"),
+	       count_fds());
+	fflush(stdout);
+	clock_gettime(CLOCK_MONOTONIC, &step_start);
+}
+
+static int init_local(void)
+{
+	int ret;
+
+	ret = ft_init();
+	if (ret)
+		return ret;
+
+	ret = ft_getinfo(hints, &fi);
+	if (ret)
+		return ret;
+	report("getinfo", 1);
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		return ret;
+
+	ret = ft_alloc_active_res(fi);
+	if (ret)
+		return ret;
+
+	ret = ft_enable_ep_recv();
+	if (ret)
+		return ret;
+	report("open", 1);
+	return 0;
+}
+
+static int open_ep(struct fid_ep **new_ep)
+{
+	int ret;
+
+	if (!ep_info) {
+		ret = ft_get_extra_ep_info(&ep_info);
+		if (ret)
+			return ret;
+	}
+
+	ret = fi_endpoint(domain, ep_info, new_ep, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_endpoint", ret);
+		return ret;
+	}
+
+	return ft_enable_ep(*new_ep, eq, av, txcq, rxcq, txcntr, rxcntr,
+			    rma_cntr);
+}
+
+static int run_ep_steps(void)
+{
+	int target, ret;
+
+	eps = calloc(max_eps, sizeof(*eps));
+	if (!eps)
+		return -FI_ENOMEM;
+
+	eps[0] = ep;
+	for (ep_cnt = 1, target = 2; ep_cnt < max_eps;
+	     target = MIN(target * 2, max_eps)) {
+		for (; ep_cnt < target; ep_cnt++) {
+			ret = open_ep(&eps[ep_cnt]);
+			if (ret)
+				return ret;
+
+			/* The first message establishes the connection */
+			if (connect_peer) {
+				ret = ft_tx(eps[ep_cnt], remote_fi_addr,
+					    opts.transfer_size, &tx_ctx);
+				if (ret)
+					return ret;
+			}
+		}
+		report(connect_peer ? "ep_connect" : "ep_open", ep_cnt);
+	}
+	return 0;
+}
+
+static int run_accept_steps(void)
+{
+	int cnt, target, ret;
+
+	for (cnt = 1, target = 2; cnt < max_eps;
+	     target = MIN(target * 2, max_eps)) {
+		for (; cnt < target; cnt++) {
+			ret = ft_rx(ep, opts.transfer_size);
+			if (ret)
+				return ret;
+		}
+		report("ep_accept", cnt);
+	}
+	return 0;
+}
+
+static int gen_addrs(const char *name, size_t namelen, size_t first,
+		     size_t cnt, char *out)
+{
+	struct sockaddr_in6 *sin6;
+	struct sockaddr_in *sin;
+	uint32_t id;
+	size_t i;
+
+	for (i = 0; i < cnt; i++) {
+		id = (uint32_t) (first + i + 1);
+		switch (fi->addr_format) {
+		case FI_SOCKADDR:
+		case FI_SOCKADDR_IN:
+		case FI_SOCKADDR_IN6:
+			memcpy(out, name, namelen);
+			if (((struct sockaddr *) out)->sa_family == AF_INET) {
+				sin = (struct sockaddr_in *) out;
+				sin->sin_addr.s_addr =
+					htonl(0x0a000000 | (id & 0xffffff));
+			} else if (((struct sockaddr *) out)->sa_family ==
+				   AF_INET6) {
+				sin6 = (struct sockaddr_in6 *) out;
+				sin6->sin6_addr.s6_addr[0] = 0xfd;
+				memcpy(&sin6->sin6_addr.s6_addr[12], &id,
+				       sizeof(id));
+			} else {
+				return -FI_ENOSYS;
+			}
+			out += namelen;
+			break;
+		case FI_ADDR_STR:
+			out += sprintf(out, "%s-%" PRIu32, name, id) + 1;
+			break;
+		default:
+			return -FI_ENOSYS;
+		}
+	}
+	return 0;
+}
+
+static int run_av_steps(void)
+{
+	char name[FT_MAX_CTRL_MSG] = {0};
+	size_t namelen = sizeof(name) - FP_STR_SUFFIX;
+	size_t inserted = 0, target, cnt;
+	fi_addr_t *fi_addrs;
+	char *addrs;
+	int ret;
+
+	ret = fi_getname(&ep->fid, name, &namelen);
+	if (ret) {
+		FT_PRINTERR("fi_getname", ret);
+		return ret;
+	}
+
+	addrs = malloc(FP_AV_BATCH * (namelen + FP_STR_SUFFIX));
+	fi_addrs = calloc(FP_AV_BATCH, sizeof(*fi_addrs));
+	if (!addrs || !fi_addrs) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	for (target = 1; inserted < max_av;
+	     target = MIN(target * 10, max_av)) {
+		while (inserted < target) {
+			cnt = MIN(target - inserted, FP_AV_BATCH);
+			ret = gen_addrs(name, namelen, inserted, cnt, addrs);
+			if (ret) {
+				fprintf(stderr, "Unsupported address format "
+					"%s, skipping AV steps\n",
+					fi_tostr(&fi->addr_format,
+						 FI_TYPE_ADDR_FORMAT));
+				ret = 0;
+				goto out;
+			}
+
+			ret = fi_av_insert(av, addrs, cnt, fi_addrs, 0, NULL);
+			if (ret < 0) {
+				FT_PRINTERR("fi_av_insert", ret);
+				goto out;
+			}
+			inserted += ret;
+			if ((size_t) ret < cnt)
+				break;
+		}
+		report("av_insert", inserted);
+
+		if (inserted < target) {
+			fprintf(stderr, "AV full after %zu entries\n",
+				inserted);
+			break;
+		}
+	}
+	ret = 0;
+out:
+	free(addrs);
+	free(fi_addrs);
+	return ret;
+}
+
+static int run_rx_steps(void)
+{
+	size_t size = opts.transfer_size, posted = 0, target;
+	void *desc;
+	int ret;
+
+	if (!max_rx)
+		max_rx = fi->rx_attr->size;
+
+	rx_region = malloc(max_rx * size);
+	rx_ctxs = calloc(max_rx, sizeof(*rx_ctxs));
+	if (!rx_region || !rx_ctxs)
+		return -FI_ENOMEM;
+
+	ret = ft_reg_mr(fi, rx_region, max_rx * size,
+			ft_info_to_mr_access(fi), FT_MR_KEY + 1,
+			FI_HMEM_SYSTEM, 0, &rx_region_mr, &desc);
+	if (ret)
+		return ret;
+
+	for (target = 1; posted < max_rx; target = MIN(target * 4, max_rx)) {
+		for (; posted < target; posted++) {
+			ret = fi_recv(ep, rx_region + posted * size, size,
+				      desc, FI_ADDR_UNSPEC, &rx_ctxs[posted]);
+			if (ret == -FI_EAGAIN)
+				break;
+			if (ret) {
+				FT_PRINTERR("fi_recv", ret);
+				return ret;
+			}
+		}
+		report("rx_posted", posted);
+
+		if (posted < target) {
+			fprintf(stderr, "Receive queue full after %zu "
+				"buffers\n", posted);
+			break;
+		}
+	}
+	return 0;
+}
+
+static void free_res(void)
+{
+	int i;
+
+	if (eps) {
+		for (i = 1; i < ep_cnt; i++)
+			FT_CLOSE_FID(eps[i]);
+		free(eps);
+	}
+	if (ep_info)
+		fi_freeinfo(ep_info);
+	FT_CLOSE_FID(rx_region_mr);
+	free(rx_region);
+	free(rx_ctxs);
+}
+
+static int run(void)
+{
+	int ret;
+
+	clock_gettime(CLOCK_MONOTONIC, &step_start);
+	report("baseline", 0);
+
+	if (connect_peer) {
+		ret = ft_init_fabric();
+		if (ret)
+			return ret;
+		report("init", 1);
+
+		ret = opts.dst_addr ? run_ep_steps() : run_accept_steps();
+		if (ret)
+			return ret;
+
+		ret = ft_finalize();
+		if (ret)
+			return ret;
+	} else {
+		ret = init_local();
+		if (ret)
+			return ret;
+
+		ret = run_ep_steps();
+		if (ret)
+			return ret;
+	}
+
+	ret = run_av_steps();
+	if (ret)
+		return ret;
+
+	return run_rx_steps();
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt_long(argc, argv, "hA:N:r:x" CS_OPTS INFO_OPTS,
+				 long_opts, &lopt_idx)) != -1) {
+		switch (op) {
+		default:
+			if (!ft_parse_long_opts(op, optarg))
+				continue;
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'A':
+			max_av = strtoul(optarg, NULL, 0);
+			break;
+		case 'N':
+			max_eps = atoi(optarg);
+			if (max_eps < 1) {
+				FT_ERR("At least one endpoint is required");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'r':
+			max_rx = strtoul(optarg, NULL, 0);
+			break;
+		case 'x':
+			connect_peer = 1;
+			break;
+		case '?':
+		case 'h':
+			ft_csusage(argv[0], "Memory and fd footprint of "
+				   "endpoints, AV entries and posted receives.");
+			FT_PRINT_OPTS_USAGE("-A <entries>", "maximum number of "
+					    "synthetic AV entries (default: "
+					    "100000)");
+			FT_PRINT_OPTS_USAGE("-N <endpoints>", "maximum number "
+					    "of endpoints (default: 64)");
+			FT_PRINT_OPTS_USAGE("-r <depth>", "maximum number of "
+					    "posted receives (default: rx size)");
+			FT_PRINT_OPTS_USAGE("-x", "connect every endpoint to a "
+					    "peer also started with -x");
+			ft_longopts_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	if (!(opts.options & FT_OPT_SIZE)) {
+		opts.options |= FT_OPT_SIZE;
+		opts.transfer_size = 64;
+	}
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG;
+	hints->mode = FI_CONTEXT;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->addr_format = opts.address_format;
+
+	ret = run();
+
+	free_res();
+	ft_free_res();
+	return ft_exit_code(ret);
+}
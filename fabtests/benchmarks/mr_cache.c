@@ -0,0 +1,815 @@
+/*
+ * Copyright (c) Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Measures the cost of fi_mr_reg and fi_close as seen by an application
+ * reusing buffers in different patterns, and the cost that memory
+ * monitors add to munmap of a registered region.  Provider cache
+ * counters are not exported, so a registration is counted as a likely
+ * cache hit when it completes within a fraction of the cost of a
+ * registration that cannot hit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <rdma/fi_errno.h>
+
+#include "shared.h"
+
+/* A registration is a likely hit when it costs at most 20% of a miss */
+#define MC_HIT_PERCENT	20
+#define MC_MAX_OPS	(1 << 20)
+#define MC_MR_KEY	(FT_TX_MR_KEY + 1)
+
+enum mc_pattern {
+	MC_UNIQUE,
+	MC_REUSE,
+	MC_RANDOM,
+	MC_REPLAY,
+	MC_MUNMAP,
+	MC_PATTERN_MAX,
+};
+
+enum mc_page {
+	MC_UNTOUCHED,
+	MC_TOUCHED,
+	MC_PAGE_MAX,
+};
+
+static const char *pattern_str[] = {
+	[MC_UNIQUE] = "unique",
+	[MC_REUSE] = "reuse",
+	[MC_RANDOM] = "random",
+	[MC_REPLAY] = "replay",
+	[MC_MUNMAP] = "munmap",
+};
+
+static const char *page_str[] = {
+	[MC_UNTOUCHED] = "untouched",
+	[MC_TOUCHED] = "touched",
+};
+
+struct mc_buf {
+	void *addr;
+	size_t size;
+	int registered;
+};
+
+/* Trace entries with a size of 0 unmap the buffer */
+struct mc_op {
+	int id;
+	size_t size;
+};
+
+struct mc_stats {
+	uint64_t *reg;
+	uint64_t *close;
+	int cnt;
+	int reused;
+};
+
+static int working_set = 16;
+static int pattern_mask = (1 << MC_UNIQUE) | (1 << MC_REUSE) |
+			  (1 << MC_RANDOM) | (1 << MC_MUNMAP);
+static int page_mask = (1 << MC_UNTOUCHED) | (1 << MC_TOUCHED);
+static char *trace_file;
+static char *monitors;
+static const char *monitor = "default";
+static size_t page_size;
+
+static struct mc_buf *bufs;
+static int buf_cnt;
+static struct mc_op *trace_ops;
+static int trace_cnt;
+static int trace_regs;
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+static uint64_t percentile(uint64_t *v, int n, int pct)
+{
+	return n ? v[(n - 1) * pct / 100] : 0;
+}
+
+static int stats_alloc(struct mc_stats *stats, int cnt)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->reg = calloc(cnt, sizeof(*stats->reg));
+	stats->close = calloc(cnt, sizeof(*stats->close));
+	if (!stats->reg || !stats->close)
+		return -FI_ENOMEM;
+	return 0;
+}
+
+static void stats_free(struct mc_stats *stats)
+{
+	free(stats->reg);
+	free(stats->close);
+}
+
+static int map_buf(struct mc_buf *buf, size_t size, int touch)
+{
+	buf->size = size;
+	buf->registered = 0;
+	buf->addr = mmap(NULL, (size + page_size - 1) & ~(page_size - 1),
+			 PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+			 -1, 0);
+	if (buf->addr == MAP_FAILED) {
+		buf->addr = NULL;
+		FT_PRINTERR("mmap", -errno);
+		return -errno;
+	}
+
+	if (touch)
+		memset(buf->addr, 0xa5, size);
+	return 0;
+}
+
+static uint64_t unmap_buf(struct mc_buf *buf)
+{
+	uint64_t start;
+
+	if (!buf->addr)
+		return 0;
+
+	start = ft_gettime_ns();
+	munmap(buf->addr, (buf->size + page_size - 1) & ~(page_size - 1));
+	buf->addr = NULL;
+	return ft_gettime_ns() - start;
+}
+
+static int reg_buf(struct mc_buf *buf, struct mc_stats *stats)
+{
+	struct fid_mr *reg_mr = NULL;
+	uint64_t start, reg_end;
+	int ret;
+
+	start = ft_gettime_ns();
+	ret = ft_reg_mr(fi, buf->addr, buf->size, ft_info_to_mr_access(fi),
+			MC_MR_KEY, FI_HMEM_SYSTEM, 0, &reg_mr, NULL);
+	reg_end = ft_gettime_ns();
+	if (ret) {
+		FT_PRINTERR("ft_reg_mr", ret);
+		FT_CLOSE_FID(reg_mr);
+		return ret;
+	}
+
+	ret = fi_close(&reg_mr->fid);
+	if (ret) {
+		FT_PRINTERR("fi_close", ret);
+		return ret;
+	}
+
+	stats->reg[stats->cnt] = reg_end - start;
+	stats->close[stats->cnt] = ft_gettime_ns() - reg_end;
+	stats->cnt++;
+	if (buf->registered)
+		stats->reused++;
+	buf->registered = 1;
+	return 0;
+}
+
+static int run_unique(size_t size, int touch, int iters,
+		      struct mc_stats *stats)
+{
+	int i, ret;
+
+	for (i = 0; i < iters; i++) {
+		ret = map_buf(&bufs[0], size, touch);
+		if (ret)
+			return ret;
+
+		ret = reg_buf(&bufs[0], stats);
+		unmap_buf(&bufs[0]);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int run_reuse(size_t size, int touch, int iters,
+		     struct mc_stats *stats)
+{
+	int i, ret;
+
+	ret = map_buf(&bufs[0], size, touch);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < iters && !ret; i++)
+		ret = reg_buf(&bufs[0], stats);
+
+	unmap_buf(&bufs[0]);
+	return ret;
+}
+
+static int run_random(size_t size, int touch, int iters,
+		      struct mc_stats *stats)
+{
+	unsigned int seed = 1;
+	int i, ret = 0;
+
+	for (i = 0; i < working_set && !ret; i++)
+		ret = map_buf(&bufs[i], size, touch);
+
+	for (i = 0; i < iters && !ret; i++)
+		ret = reg_buf(&bufs[rand_r(&seed) % working_set], stats);
+
+	for (i = 0; i < working_set; i++)
+		unmap_buf(&bufs[i]);
+	return ret;
+}
+
+static int run_replay(int touch, struct mc_stats *stats)
+{
+	struct mc_buf *buf;
+	int i, ret = 0;
+
+	for (i = 0; i < trace_cnt && !ret; i++) {
+		buf = &bufs[trace_ops[i].id];
+		if (!trace_ops[i].size) {
+			unmap_buf(buf);
+			continue;
+		}
+
+		if (buf->addr && buf->size != trace_ops[i].size)
+			unmap_buf(buf);
+		if (!buf->addr) {
+			ret = map_buf(buf, trace_ops[i].size, touch);
+			if (ret)
+				break;
+		}
+		ret = reg_buf(buf, stats);
+	}
+
+	for (i = 0; i < buf_cnt; i++)
+		unmap_buf(&bufs[i]);
+	return ret;
+}
+
+static int count_hits(struct mc_stats *stats, uint64_t miss_ns)
+{
+	int i, hits = 0;
+
+	for (i = 0; i < stats->cnt; i++) {
+		if (stats->reg[i] * 100 <= miss_ns * MC_HIT_PERCENT)
+			hits++;
+	}
+	return hits;
+}
+
+/* miss_ns is 0 if no miss latency is known for this size and page state */
+static void show_reg(enum mc_pattern pattern, enum mc_page page,
+		     size_t size, const char *size_name,
+		     struct mc_stats *stats, uint64_t miss_ns)
+{
+	char hit_str[16] = "-";
+	char name[FT_MAX_CTRL_MSG];
+	int n = stats->cnt;
+
+	if (!n)
+		return;
+
+	if (miss_ns)
+		snprintf(hit_str, sizeof(hit_str), "%d",
+			 count_hits(stats, miss_ns) * 100 / n);
+
+	qsort(stats->reg, n, sizeof(*stats->reg), cmp_u64);
+	qsort(stats->close, n, sizeof(*stats->close), cmp_u64);
+
+	if (opts.json) {
+		snprintf(name, sizeof(name), "%s_%s_%s", monitor,
+			 pattern_str[pattern], page_str[page]);
+		show_json("mr_cache", NULL, name, size,
+			  "\"iterations\": %d, \"reg_p50_ns\": %" PRIu64
+			  ", \"reg_p99_ns\": %" PRIu64 ", \"close_p50_ns\": %"
+			  PRIu64 ", \"close_p99_ns\": %" PRIu64
+			  ", \"reuse_pct\": %d, \"hit_pct\": %s",
+			  n, percentile(stats->reg, n, 50),
+			  percentile(stats->reg, n, 99),
+			  percentile(stats->close, n, 50),
+			  percentile(stats->close, n, 99),
+			  stats->reused * 100 / n, miss_ns ? hit_str : "null");
+		return;
+	}
+
+	printf("%-10s %-12s %-8s %-10s %-8s %7d %9" PRIu64 " %9" PRIu64
+	       " %9" PRIu64 " %9" PRIu64 " %6d %6s\n",
+	       monitor, fi->fabric_attr->prov_name, pattern_str[pattern],
+	       page_str[page], size_name, n, percentile(stats->reg, n, 50),
+	       percentile(stats->reg, n, 99), percentile(stats->close, n, 50),
+	       percentile(stats->close, n, 99), stats->reused * 100 / n,
+	       hit_str);
+}
+
+static int run_pattern(enum mc_pattern pattern, size_t size, int touch,
+		       int iters, struct mc_stats *stats)
+{
+	int ret;
+
+	ret = stats_alloc(stats, pattern == MC_REPLAY ? trace_regs : iters);
+	if (ret)
+		return ret;
+
+	switch (pattern) {
+	case MC_UNIQUE:
+		return run_unique(size, touch, iters, stats);
+	case MC_REUSE:
+		return run_reuse(size, touch, iters, stats);
+	case MC_RANDOM:
+		return run_random(size, touch, iters, stats);
+	case MC_REPLAY:
+		return run_replay(touch, stats);
+	default:
+		return -FI_EINVAL;
+	}
+}
+
+static int run_size(size_t size, const char *size_name, int iters)
+{
+	struct mc_stats stats[MC_REPLAY] = {0};
+	uint64_t miss_ns;
+	int i, page, ret = 0;
+
+	for (page = 0; page < MC_PAGE_MAX && !ret; page++) {
+		if (!(page_mask & (1 << page)))
+			continue;
+
+		for (i = 0; i < MC_REPLAY && !ret; i++) {
+			if (pattern_mask & (1 << i))
+				ret = run_pattern(i, size, page, iters,
+						  &stats[i]);
+		}
+
+		if (!ret) {
+			/* The unique pattern never reuses an address */
+			miss_ns = 0;
+			if (stats[MC_UNIQUE].cnt) {
+				qsort(stats[MC_UNIQUE].reg,
+				      stats[MC_UNIQUE].cnt, sizeof(uint64_t),
+				      cmp_u64);
+				miss_ns = percentile(stats[MC_UNIQUE].reg,
+						     stats[MC_UNIQUE].cnt, 50);
+			}
+
+			for (i = 0; i < MC_REPLAY; i++)
+				show_reg(i, page, size, size_name, &stats[i],
+					 miss_ns);
+		}
+
+		for (i = 0; i < MC_REPLAY; i++) {
+			stats_free(&stats[i]);
+			memset(&stats[i], 0, sizeof(stats[i]));
+		}
+	}
+	return ret;
+}
+
+static int run_trace(void)
+{
+	struct mc_stats stats = {0};
+	int page, ret = 0;
+
+	for (page = 0; page < MC_PAGE_MAX && !ret; page++) {
+		if (!(page_mask & (1 << page)))
+			continue;
+
+		ret = run_pattern(MC_REPLAY, 0, page, 0, &stats);
+		if (!ret)
+			show_reg(MC_REPLAY, page, 0, "trace", &stats, 0);
+		stats_free(&stats);
+		memset(&stats, 0, sizeof(stats));
+	}
+	return ret;
+}
+
+/*
+ * A mapping that was registered is unmapped together with a mapping of
+ * the same size that never was, the difference between the two is the
+ * cost added by the memory monitor to invalidate cached registrations.
+ */
+static int run_munmap(size_t size, const char *size_name, int iters)
+{
+	struct mc_stats stats = {0};
+	uint64_t *plain, *reg, plain_p50, reg_p50;
+	char name[FT_MAX_CTRL_MSG];
+	int i, page, ret = 0;
+
+	plain = calloc(iters, sizeof(*plain));
+	reg = calloc(iters, sizeof(*reg));
+	if (!plain || !reg) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	for (page = 0; page < MC_PAGE_MAX && !ret; page++) {
+		if (!(page_mask & (1 << page)))
+			continue;
+
+		ret = stats_alloc(&stats, iters);
+		for (i = 0; i < iters && !ret; i++) {
+			ret = map_buf(&bufs[0], size, page);
+			if (ret)
+				break;
+
+			ret = map_buf(&bufs[1], size, page);
+			if (!ret)
+				ret = reg_buf(&bufs[0], &stats);
+			reg[i] = unmap_buf(&bufs[0]);
+			plain[i] = unmap_buf(&bufs[1]);
+		}
+		stats_free(&stats);
+		if (ret)
+			break;
+
+		qsort(plain, iters, sizeof(*plain), cmp_u64);
+		qsort(reg, iters, sizeof(*reg), cmp_u64);
+		plain_p50 = percentile(plain, iters, 50);
+		reg_p50 = percentile(reg, iters, 50);
+		if (opts.json) {
+			snprintf(name, sizeof(name), "%s_%s_%s", monitor,
+				 pattern_str[MC_MUNMAP], page_str[page]);
+			show_json("mr_cache", NULL, name, size,
+				  "\"iterations\": %d, \"plain_p50_ns\": %"
+				  PRIu64 ", \"plain_p99_ns\": %" PRIu64
+				  ", \"reg_p50_ns\": %" PRIu64
+				  ", \"reg_p99_ns\": %" PRIu64
+				  ", \"delta_p50_ns\": %" PRId64,
+				  iters, plain_p50,
+				  percentile(plain, iters, 99), reg_p50,
+				  percentile(reg, iters, 99),
+				  (int64_t) (reg_p50 - plain_p50));
+			continue;
+		}
+
+		printf("%-10s %-12s %-10s %-8s %7d %9" PRIu64 " %9" PRIu64
+		       " %9" PRIu64 " %9" PRIu64 " %9" PRId64 "\n",
+		       monitor, fi->fabric_attr->prov_name, page_str[page],
+		       size_name, iters, plain_p50,
+		       percentile(plain, iters, 99), reg_p50,
+		       percentile(reg, iters, 99),
+		       (int64_t) (reg_p50 - plain_p50));
+	}
+out:
+	free(plain);
+	free(reg);
+	return ret;
+}
+
+static int for_each_size(int (*func)(size_t, const char *, int))
+{
+	char size_name[FT_STR_LEN];
+	int i, ret = 0;
+
+	if (opts.options & FT_OPT_SIZE)
+		return func(opts.transfer_size,
+			    size_str(size_name, opts.transfer_size),
+			    opts.iterations);
+
+	for (i = 0; i < TEST_CNT && !ret; i++) {
+		if (!ft_use_size(i, opts.sizes_enabled))
+			continue;
+
+		if (!(opts.options & FT_OPT_ITER))
+			opts.iterations = size_to_count(test_size[i].size);
+
+		ret = func(test_size[i].size,
+			   size_str(size_name, test_size[i].size),
+			   opts.iterations);
+	}
+	return ret;
+}
+
+/*
+ * Trace lines are "<buffer id> <bytes>" to register a buffer, remapping
+ * it if the size changed, or "<buffer id> free" to unmap it.  Lines
+ * starting with '#' are ignored.
+ */
+static int read_trace(void)
+{
+	char line[256], arg[32];
+	struct mc_op *op;
+	FILE *f;
+	int ret = 0;
+
+	f = fopen(trace_file, "r");
+	if (!f) {
+		FT_ERR("Unable to open trace file %s", trace_file);
+		return -errno;
+	}
+
+	trace_ops = calloc(MC_MAX_OPS, sizeof(*trace_ops));
+	if (!trace_ops) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		if (trace_cnt == MC_MAX_OPS) {
+			FT_ERR("Trace exceeds %d operations", MC_MAX_OPS);
+			ret = -FI_E2BIG;
+			goto out;
+		}
+
+		op = &trace_ops[trace_cnt];
+		if (sscanf(line, "%d %31s", &op->id, arg) != 2 || op->id < 0) {
+			FT_ERR("Invalid trace line: %s", line);
+			ret = -FI_EINVAL;
+			goto out;
+		}
+
+		if (strcmp(arg, "free")) {
+			op->size = strtoul(arg, NULL, 0);
+			if (!op->size) {
+				FT_ERR("Invalid trace size: %s", line);
+				ret = -FI_EINVAL;
+				goto out;
+			}
+			trace_regs++;
+		}
+		buf_cnt = MAX(buf_cnt, op->id + 1);
+		trace_cnt++;
+	}
+
+	if (!trace_regs) {
+		FT_ERR("Trace file %s has no registrations", trace_file);
+		ret = -FI_EINVAL;
+	}
+out:
+	fclose(f);
+	return ret;
+}
+
+static int parse_patterns(char *str)
+{
+	char *tok, *save;
+	int i;
+
+	pattern_mask = 0;
+	for (tok = strtok_r(str, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		for (i = 0; i < MC_PATTERN_MAX; i++) {
+			if (!strcmp(tok, pattern_str[i]))
+				break;
+		}
+		if (i == MC_PATTERN_MAX) {
+			FT_ERR("Unknown pattern %s", tok);
+			return -FI_EINVAL;
+		}
+		pattern_mask |= 1 << i;
+	}
+	return 0;
+}
+
+static int init_local(void)
+{
+	int ret;
+
+	ret = ft_init();
+	if (ret)
+		return ret;
+
+	ret = ft_getinfo(hints, &fi);
+	if (ret)
+		return ret;
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		return ret;
+
+	ret = ft_alloc_active_res(fi);
+	if (ret)
+		return ret;
+
+	return ft_enable_ep_recv();
+}
+
+static int run(void)
+{
+	int ret;
+
+	ret = init_local();
+	if (ret)
+		return ret;
+
+	buf_cnt = MAX(buf_cnt, MAX(working_set, 2));
+	bufs = calloc(buf_cnt, sizeof(*bufs));
+	if (!bufs)
+		return -FI_ENOMEM;
+
+	if (!opts.json && (pattern_mask & ((1 << MC_MUNMAP) - 1)))
+		printf("%-10s %-12s %-8s %-10s %-8s %7s %9s %9s %9s %9s %6s "
+		       "%6s\n", "monitor", "provider", "pattern", "pages",
+		       "size", "iters", "reg_p50", "reg_p99", "close_p50",
+		       "close_p99", "reuse%", "hit%");
+
+	if (pattern_mask & ((1 << MC_REPLAY) - 1)) {
+		ret = for_each_size(run_size);
+		if (ret)
+			goto out;
+	}
+
+	if (pattern_mask & (1 << MC_REPLAY)) {
+		ret = run_trace();
+		if (ret)
+			goto out;
+	}
+
+	if (pattern_mask & (1 << MC_MUNMAP)) {
+		if (!opts.json)
+			printf("%-10s %-12s %-10s %-8s %7s %9s %9s %9s %9s "
+			       "%9s\n", "monitor", "provider", "pages", "size",
+			       "iters", "plain_p50", "plain_p99", "reg_p50",
+			       "reg_p99", "delta_p50");
+		ret = for_each_size(run_munmap);
+	}
+out:
+	free(bufs);
+	return ret;
+}
+
+/*
+ * The memory monitor is selected when the library is initialized, so
+ * each monitor in the list is run in a child forked before any libfabric
+ * call is made.
+ */
+static int run_monitors(void)
+{
+	char *tok, *save;
+	int status, ret, fail = 0;
+	pid_t pid;
+
+	for (tok = strtok_r(monitors, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		fflush(stdout);
+		pid = fork();
+		if (pid < 0) {
+			FT_PRINTERR("fork", -errno);
+			return -errno;
+		}
+
+		if (!pid) {
+			setenv("FI_MR_CACHE_MONITOR", tok, 1);
+			monitor = tok;
+			ret = run();
+			ft_free_res();
+			fflush(stdout);
+			_exit(ft_exit_code(ret));
+		}
+
+		if (waitpid(pid, &status, 0) < 0) {
+			FT_PRINTERR("waitpid", -errno);
+			return -errno;
+		}
+
+		if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+			fprintf(stderr, "%s: registration test failed\n", tok);
+			fail = -FI_EOTHER;
+		}
+	}
+	return fail;
+}
+
+int main(int argc, char **argv)
+{
+	char *env;
+	int op, ret;
+
+	opts = INIT_OPTS;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt_long(argc, argv, "hu:N:r:y:g:" INFO_OPTS
+				 CS_OPTS, long_opts, &lopt_idx)) != -1) {
+		switch (op) {
+		default:
+			if (!ft_parse_long_opts(op, optarg))
+				continue;
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'u':
+			if (parse_patterns(optarg))
+				return EXIT_FAILURE;
+			break;
+		case 'N':
+			working_set = atoi(optarg);
+			if (working_set < 1) {
+				FT_ERR("Working set must hold at least one "
+				       "buffer");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'r':
+			trace_file = optarg;
+			break;
+		case 'y':
+			monitors = optarg;
+			break;
+		case 'g':
+			if (!strcmp(optarg, "untouched")) {
+				page_mask = 1 << MC_UNTOUCHED;
+			} else if (!strcmp(optarg, "touched")) {
+				page_mask = 1 << MC_TOUCHED;
+			} else {
+				FT_ERR("Unknown page state %s", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case '?':
+		case 'h':
+			ft_csusage(argv[0], "Memory registration and "
+				   "registration cache cost.");
+			FT_PRINT_OPTS_USAGE("-u <pattern,...>", "buffer reuse "
+					    "patterns: unique, reuse, random, "
+					    "replay, munmap (default: unique,"
+					    "reuse,random,munmap)");
+			FT_PRINT_OPTS_USAGE("-N <buffers>", "working set of the "
+					    "random pattern (default: 16)");
+			FT_PRINT_OPTS_USAGE("-r <file>", "trace of "
+					    "'<id> <bytes>' and '<id> free' "
+					    "lines to replay");
+			FT_PRINT_OPTS_USAGE("-y <monitor,...>", "run once per "
+					    "FI_MR_CACHE_MONITOR value, e.g. "
+					    "memhooks,uffd");
+			FT_PRINT_OPTS_USAGE("-g <state>", "only register "
+					    "'untouched' or 'touched' pages");
+			ft_longopts_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (trace_file) {
+		ret = read_trace();
+		if (ret)
+			goto out;
+		pattern_mask |= 1 << MC_REPLAY;
+	} else if (pattern_mask & (1 << MC_REPLAY)) {
+		FT_ERR("The replay pattern requires a trace file (-r)");
+		ret = -FI_EINVAL;
+		goto out;
+	}
+
+	page_size = sysconf(_SC_PAGESIZE);
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG | FI_RMA;
+	hints->mode = FI_CONTEXT;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->addr_format = opts.address_format;
+
+	if (monitors) {
+		ret = run_monitors();
+	} else {
+		env = getenv("FI_MR_CACHE_MONITOR");
+		if (env)
+			monitor = env;
+		ret = run();
+	}
+out:
+	free(trace_ops);
+	ft_free_res();
+	return ft_exit_code(ret);
+}
@@ -0,0 +1,577 @@
+/*
+ * Copyright (c) Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*
+ * Tag matching stress test.  Every iteration the client sends a window of
+ * tagged messages from one or more endpoints.  The server pre-posts only
+ * part of the matching receives, so the remaining messages arrive
+ * unexpected and are matched when their receives are posted later.  An
+ * optional set of receives that never match is kept at the head of the
+ * posted queue to lengthen the posted-queue search.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <inttypes.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_tagged.h>
+
+#include "shared.h"
+#include "hmem.h"
+#include "benchmark_shared.h"
+
+/* Tags stay above the sequence numbers used by ft_sync and ft_finalize */
+#define MT_TAG_SHIFT	48
+#define MT_TAG_DATA	(1ULL << MT_TAG_SHIFT)
+#define MT_TAG_MARKER	(2ULL << MT_TAG_SHIFT)
+#define MT_TAG_GO	(3ULL << MT_TAG_SHIFT)
+#define MT_TAG_DUMMY	(4ULL << MT_TAG_SHIFT)
+#define MT_TAG_MASK	(MT_TAG_DATA - 1)
+
+#define MT_STALL_MS	100
+
+static int unexp_pct = 50;
+static int posted_depth;
+static int wildcard;
+static int senders = 1;
+
+static struct fid_ep **send_eps;
+static char *mt_buf;
+static struct fid_mr *mt_mr;
+static void *mt_desc;
+static struct fi_context *mt_ctx;
+
+/* Completion counts, split by kind */
+static uint64_t data_done, marker_done, go_done, tx_done;
+static int stalls;
+
+static int progress_rx(void)
+{
+	struct fi_cq_tagged_entry comp[16];
+	int i, ret;
+
+	ret = fi_cq_read(rxcq, comp, ARRAY_SIZE(comp));
+	if (ret == -FI_EAGAIN)
+		return 0;
+	if (ret == -FI_EAVAIL)
+		return ft_cq_readerr(rxcq);
+	if (ret < 0) {
+		FT_PRINTERR("fi_cq_read", ret);
+		return ret;
+	}
+
+	for (i = 0; i < ret; i++) {
+		switch (comp[i].tag & ~MT_TAG_MASK) {
+		case MT_TAG_DATA:
+			data_done++;
+			break;
+		case MT_TAG_MARKER:
+			marker_done++;
+			break;
+		case MT_TAG_GO:
+			go_done++;
+			break;
+		default:
+			/* The peer may already be in ft_finalize */
+			if (comp[i].op_context == &rx_ctx) {
+				rx_cq_cntr++;
+				break;
+			}
+			FT_ERR("Unexpected tag 0x%" PRIx64, comp[i].tag);
+			return -FI_EOTHER;
+		}
+	}
+	return 0;
+}
+
+static int progress_tx(void)
+{
+	struct fi_cq_tagged_entry comp[16];
+	int ret;
+
+	ret = fi_cq_read(txcq, comp, ARRAY_SIZE(comp));
+	if (ret == -FI_EAGAIN)
+		return 0;
+	if (ret == -FI_EAVAIL)
+		return ft_cq_readerr(txcq);
+	if (ret < 0) {
+		FT_PRINTERR("fi_cq_read", ret);
+		return ret;
+	}
+
+	tx_done += ret;
+	return 0;
+}
+
+static int progress(void)
+{
+	int ret;
+
+	ret = progress_rx();
+	return ret ? ret : progress_tx();
+}
+
+static int wait_count(uint64_t *cnt, uint64_t total)
+{
+	int ret;
+
+	while (*cnt < total) {
+		ret = progress();
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+/*
+ * Wait for the end of iteration markers.  A provider may stop reading
+ * from a peer once its unexpected message limit is reached, which would
+ * hold back the marker as well.  Treat a receive side that stays idle as
+ * such a stall and let the caller post the remaining receives.
+ */
+static int wait_markers(uint64_t total)
+{
+	uint64_t last = data_done + marker_done, idle_start;
+	int ret;
+
+	idle_start = ft_gettime_ms();
+	while (marker_done < total) {
+		ret = progress();
+		if (ret)
+			return ret;
+
+		if (data_done + marker_done != last) {
+			last = data_done + marker_done;
+			idle_start = ft_gettime_ms();
+		} else if (ft_gettime_ms() - idle_start > MT_STALL_MS) {
+			stalls++;
+			break;
+		}
+	}
+	return 0;
+}
+
+static int post_trecv(void *buf, size_t len, uint64_t tag, uint64_t ignore,
+		      void *ctx)
+{
+	int ret;
+
+	do {
+		ret = fi_trecv(ep, buf, len, mt_desc, FI_ADDR_UNSPEC, tag,
+			       ignore, ctx);
+		if (ret == -FI_EAGAIN && progress())
+			return -FI_EOTHER;
+	} while (ret == -FI_EAGAIN);
+
+	if (ret)
+		FT_PRINTERR("fi_trecv", ret);
+	return ret;
+}
+
+static int post_tsend(struct fid_ep *tx_ep, size_t len, uint64_t tag,
+		      void *ctx)
+{
+	int ret;
+
+	do {
+		ret = fi_tsend(tx_ep, tx_buf, len, mr_desc, remote_fi_addr,
+			       tag, ctx);
+		if (ret == -FI_EAGAIN && progress())
+			return -FI_EOTHER;
+	} while (ret == -FI_EAGAIN);
+
+	if (ret)
+		FT_PRINTERR("fi_tsend", ret);
+	return ret;
+}
+
+/* Data message k of an iteration, in the order the client sends them */
+static int post_data_recv(int k)
+{
+	size_t size = opts.transfer_size;
+
+	return post_trecv(mt_buf + k * size, size,
+			  wildcard ? MT_TAG_DATA : MT_TAG_DATA | k,
+			  wildcard ? MT_TAG_MASK : 0, &mt_ctx[k]);
+}
+
+static int alloc_res(void)
+{
+	int msgs = opts.window_size * senders;
+	int i, ret;
+
+	mt_ctx = calloc(msgs + senders + posted_depth + 1, sizeof(*mt_ctx));
+	send_eps = calloc(senders, sizeof(*send_eps));
+	if (!mt_ctx || !send_eps)
+		return -FI_ENOMEM;
+
+	send_eps[0] = ep;
+	if (!opts.dst_addr) {
+		/* Room for one iteration of data plus one shared dummy slot */
+		mt_buf = calloc(msgs + 1, opts.transfer_size);
+		if (!mt_buf)
+			return -FI_ENOMEM;
+
+		return ft_reg_mr(fi, mt_buf, (msgs + 1) * opts.transfer_size,
+				 ft_info_to_mr_access(fi), FT_MR_KEY + 1,
+				 FI_HMEM_SYSTEM, 0, &mt_mr, &mt_desc);
+	}
+
+	for (i = 1; i < senders; i++) {
+		ret = fi_endpoint(domain, fi, &send_eps[i], NULL);
+		if (ret) {
+			FT_PRINTERR("fi_endpoint", ret);
+			return ret;
+		}
+
+		ret = ft_enable_ep(send_eps[i], eq, av, txcq, rxcq, txcntr,
+				   rxcntr, rma_cntr);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+/*
+ * Some providers only queue unexpected messages from peers in the AV,
+ * so the server inserts the address of every extra sender.
+ */
+static int exchange_sender_addrs(void)
+{
+	char name[FT_MAX_CTRL_MSG];
+	size_t len;
+	fi_addr_t addr;
+	int i, ret;
+
+	for (i = 1; i < senders; i++) {
+		if (opts.dst_addr) {
+			len = sizeof(name);
+			ret = fi_getname(&send_eps[i]->fid, name, &len);
+			if (ret) {
+				FT_PRINTERR("fi_getname", ret);
+				return ret;
+			}
+
+			ret = ft_hmem_copy_to(opts.iface, opts.device,
+					      tx_buf + ft_tx_prefix_size(),
+					      name, len);
+			if (ret)
+				return ret;
+
+			ret = (int) ft_tx(ep, remote_fi_addr, len, &tx_ctx);
+		} else {
+			ret = ft_get_rx_comp(rx_seq);
+			if (ret)
+				return ret;
+
+			ret = ft_hmem_copy_from(opts.iface, opts.device, name,
+						rx_buf + ft_rx_prefix_size(),
+						sizeof(name));
+			if (ret)
+				return ret;
+
+			ret = ft_av_insert(av, name, 1, &addr, 0, NULL);
+			if (ret)
+				return ret;
+
+			ret = (int) ft_post_rx(ep, rx_size, &rx_ctx);
+		}
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static void free_res(void)
+{
+	int i;
+
+	if (send_eps) {
+		for (i = 1; i < senders; i++)
+			FT_CLOSE_FID(send_eps[i]);
+		free(send_eps);
+	}
+	FT_CLOSE_FID(mt_mr);
+	free(mt_buf);
+	free(mt_ctx);
+}
+
+static int run_server(void)
+{
+	int msgs = opts.window_size * senders;
+	int expected = msgs - msgs * unexp_pct / 100;
+	int iters = opts.iterations + opts.warmup_iterations;
+	struct fi_context *marker_ctx = &mt_ctx[msgs];
+	struct fi_context *go_ctx = &marker_ctx[senders];
+	struct fi_context *dummy_ctx = &go_ctx[1];
+	char *dummy_buf = mt_buf + msgs * opts.transfer_size;
+	long rss_start;
+	char name[FT_MAX_CTRL_MSG];
+	int i, k, s, ret;
+
+	for (i = 0; i < posted_depth; i++) {
+		ret = post_trecv(dummy_buf, opts.transfer_size,
+				 MT_TAG_DUMMY | i, 0, &dummy_ctx[i]);
+		if (ret)
+			return ret;
+	}
+
+	rss_start = ft_read_status_kb("VmRSS");
+	for (i = 0; i < iters; i++) {
+		if (i == opts.warmup_iterations) {
+			stalls = 0;
+			ft_start();
+		}
+
+		for (k = 0; k < expected; k++) {
+			ret = post_data_recv(k);
+			if (ret)
+				return ret;
+		}
+
+		for (s = 0; s < senders; s++) {
+			ret = post_trecv(NULL, 0, MT_TAG_MARKER | s, 0,
+					 &marker_ctx[s]);
+			if (ret)
+				return ret;
+		}
+
+		ret = post_tsend(ep, 0, MT_TAG_GO, go_ctx);
+		if (ret)
+			return ret;
+
+		/*
+		 * Messages from a sender are delivered in order, so once
+		 * all markers are in, every remaining message is queued as
+		 * unexpected.
+		 */
+		ret = wait_markers((uint64_t) (i + 1) * senders);
+		if (ret)
+			return ret;
+
+		for (k = expected; k < msgs; k++) {
+			ret = post_data_recv(k);
+			if (ret)
+				return ret;
+		}
+
+		ret = wait_count(&data_done, (uint64_t) (i + 1) * msgs);
+		if (ret)
+			return ret;
+
+		ret = wait_count(&marker_done, (uint64_t) (i + 1) * senders);
+		if (ret)
+			return ret;
+
+		ret = wait_count(&tx_done, i + 1);
+		if (ret)
+			return ret;
+	}
+	ft_stop();
+
+	snprintf(name, sizeof(name), "%s_unexp%d_depth%d_senders%d",
+		 wildcard ? "wild" : "exact", unexp_pct, posted_depth,
+		 senders);
+	show_perf(name, opts.transfer_size, opts.iterations, &start, &end,
+		  msgs);
+	if (opts.json)
+		show_json("matching", NULL, name, opts.transfer_size,
+			  "\"rss_start_kb\": %ld, \"rss_peak_kb\": %ld, "
+			  "\"stalled_iters\": %d", rss_start,
+			  ft_read_status_kb("VmHWM"), stalls);
+	else
+		printf("rss_start_kb %ld rss_peak_kb %ld stalled_iters %d\n",
+		       rss_start, ft_read_status_kb("VmHWM"), stalls);
+	return 0;
+}
+
+static int run_client(void)
+{
+	int msgs = opts.window_size * senders;
+	int iters = opts.iterations + opts.warmup_iterations;
+	struct fi_context *marker_ctx = &mt_ctx[msgs];
+	struct fi_context *go_ctx = &marker_ctx[senders];
+	int i, j, k, s, ret;
+
+	ret = post_trecv(NULL, 0, MT_TAG_GO, 0, go_ctx);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < iters; i++) {
+		ret = wait_count(&go_done, i + 1);
+		if (ret)
+			return ret;
+
+		if (i + 1 < iters) {
+			ret = post_trecv(NULL, 0, MT_TAG_GO, 0, go_ctx);
+			if (ret)
+				return ret;
+		}
+
+		for (j = 0; j < opts.window_size; j++) {
+			for (s = 0; s < senders; s++) {
+				k = j * senders + s;
+				ret = post_tsend(send_eps[s],
+						 opts.transfer_size,
+						 MT_TAG_DATA | k, &mt_ctx[k]);
+				if (ret)
+					return ret;
+			}
+		}
+
+		for (s = 0; s < senders; s++) {
+			ret = post_tsend(send_eps[s], 0, MT_TAG_MARKER | s,
+					 &marker_ctx[s]);
+			if (ret)
+				return ret;
+		}
+
+		ret = wait_count(&tx_done,
+				 (uint64_t) (i + 1) * (msgs + senders));
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int run(void)
+{
+	int ret;
+
+	ret = ft_init_fabric();
+	if (ret)
+		return ret;
+
+	ret = alloc_res();
+	if (ret)
+		return ret;
+
+	ret = exchange_sender_addrs();
+	if (ret)
+		return ret;
+
+	ret = ft_sync();
+	if (ret)
+		return ret;
+
+	ret = opts.dst_addr ? run_client() : run_server();
+	if (ret)
+		return ret;
+
+	return ft_finalize();
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.options |= FT_OPT_SIZE;
+	opts.transfer_size = 64;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_TAGGED;
+	hints->mode = FI_CONTEXT;
+	hints->tx_attr->msg_order = FI_ORDER_SAS;
+	hints->rx_attr->msg_order = FI_ORDER_SAS;
+	hints->domain_attr->resource_mgmt = FI_RM_ENABLED;
+	hints->domain_attr->threading = FI_THREAD_DOMAIN;
+	hints->addr_format = opts.address_format;
+
+	while ((op = getopt_long(argc, argv, "U:N:GT:h" CS_OPTS INFO_OPTS
+				 BENCHMARK_OPTS, long_opts,
+				 &lopt_idx)) != -1) {
+		switch (op) {
+		default:
+			if (!ft_parse_long_opts(op, optarg))
+				continue;
+			ft_parse_benchmark_opts(op, optarg);
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'U':
+			unexp_pct = atoi(optarg);
+			if (unexp_pct < 0 || unexp_pct > 100) {
+				FT_ERR("Unexpected percentage must be 0-100");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'N':
+			posted_depth = atoi(optarg);
+			break;
+		case 'G':
+			wildcard = 1;
+			break;
+		case 'T':
+			senders = atoi(optarg);
+			if (senders < 1) {
+				FT_ERR("At least one sender is required");
+				return EXIT_FAILURE;
+			}
+			break;
+		case '?':
+		case 'h':
+			ft_csusage(argv[0], "Tag matching and unexpected "
+				   "message stress test.");
+			FT_PRINT_OPTS_USAGE("-U <percent>", "share of messages "
+					    "arriving unexpected (default: 50)");
+			FT_PRINT_OPTS_USAGE("-N <depth>", "non-matching "
+					    "receives kept at the head of the "
+					    "posted queue (default: 0)");
+			FT_PRINT_OPTS_USAGE("-G", "post wildcard receives "
+					    "instead of exact tag matches");
+			FT_PRINT_OPTS_USAGE("-T <senders>", "client endpoints "
+					    "sending to the server (default: 1)");
+			ft_benchmark_usage();
+			ft_longopts_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	opts.av_size = senders;
+
+	ret = run();
+
+	free_res();
+	ft_free_res();
+	return ft_exit_code(ret);
+}
@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*
+ * Communication/computation overlap test, following the post-work-wait
+ * method of the Sandia COMB suite.  For every message size, each side
+ * times a window of non-blocking transfers on its own (comm), a calibrated
+ * compute loop on its own (work), and then posts the window, computes and
+ * only afterwards waits for the transfers to complete (total).  The
+ * computation may be interrupted every -T microseconds by a fi_cq_read
+ * "test" call, which is what lets a provider relying on the application
+ * for progress move the transfers forward.
+ *
+ * overlap: share of the communication time hidden by the computation,
+ *          (comm + work - total) / comm
+ * avail:   share of the iteration left to the application for computing,
+ *          work / total
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <inttypes.h>
+
+#include <rdma/fi_errno.h>
+
+#include "shared.h"
+#include "benchmark_shared.h"
+
+#define OV_UNIT_STEPS	64
+#define OV_CAL_NS	(20 * 1000 * 1000)
+#define OV_WORK_REPS	8
+#define OV_CAL_ROUNDS	4
+
+static int work_pct = 100;
+static uint64_t test_us;
+static double units_per_ns;
+static volatile uint64_t work_sink;
+
+static void work(uint64_t units)
+{
+	uint64_t x = work_sink;
+	uint64_t i;
+
+	for (i = 0; i < units * OV_UNIT_STEPS; i++)
+		x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+	work_sink = x;
+}
+
+static void calibrate(void)
+{
+	uint64_t units = 1024, start, elapsed;
+
+	do {
+		units *= 2;
+		start = ft_gettime_ns();
+		work(units);
+		elapsed = ft_gettime_ns() - start;
+	} while (elapsed < OV_CAL_NS);
+
+	units_per_ns = (double) units / elapsed;
+}
+
+static uint64_t ns_to_units(uint64_t ns)
+{
+	uint64_t units = (uint64_t) (ns * units_per_ns);
+
+	return units ? units : 1;
+}
+
+static uint64_t time_work(uint64_t units)
+{
+	uint64_t start;
+	int i;
+
+	start = ft_gettime_ns();
+	for (i = 0; i < OV_WORK_REPS; i++)
+		work(units);
+	return (ft_gettime_ns() - start) / OV_WORK_REPS;
+}
+
+/* Refine the initial estimate, as the rate may change with the load */
+static uint64_t work_units(uint64_t target_ns, uint64_t *work_ns)
+{
+	uint64_t units = ns_to_units(target_ns);
+	int i;
+
+	for (i = 0; i < OV_CAL_ROUNDS; i++) {
+		*work_ns = time_work(units);
+		if (!*work_ns || (*work_ns > target_ns * 95 / 100 &&
+				  *work_ns < target_ns * 105 / 100))
+			break;
+
+		units = MAX(units * target_ns / *work_ns, 1);
+	}
+	return units;
+}
+
+static int test(void)
+{
+	return opts.dst_addr ? ft_progress(txcq, 0, &tx_cq_cntr) :
+			       ft_progress(rxcq, 0, &rx_cq_cntr);
+}
+
+static int compute(uint64_t units, uint64_t test_units)
+{
+	uint64_t n;
+	int ret;
+
+	while (units) {
+		n = test_units ? MIN(units, test_units) : units;
+		work(n);
+		units -= n;
+
+		if (test_units && units) {
+			ret = test();
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+static int post_window(void)
+{
+	int j, ret;
+
+	for (j = 0; j < opts.window_size; j++) {
+		if (opts.dst_addr)
+			ret = ft_post_tx_buf(ep, remote_fi_addr,
+					     opts.transfer_size, NO_CQ_DATA,
+					     &tx_ctx_arr[j].context,
+					     tx_ctx_arr[j].buf,
+					     tx_ctx_arr[j].desc, 0);
+		else
+			ret = ft_post_rx_buf(ep, opts.transfer_size,
+					     &rx_ctx_arr[j].context,
+					     rx_ctx_arr[j].buf,
+					     rx_ctx_arr[j].desc, ft_tag);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+/*
+ * rx_seq is always one ahead, as in the bw tests.  The test calls may
+ * already have reaped the peer's next sync message into that extra buffer.
+ */
+static int wait_window(void)
+{
+	if (opts.dst_addr)
+		return ft_get_tx_comp(tx_seq);
+
+	return rx_cq_cntr >= rx_seq - 1 ? 0 : ft_get_rx_comp(rx_seq - 1);
+}
+
+static int run_iter(uint64_t units, uint64_t test_units, uint64_t *total_ns,
+		    uint64_t *wait_ns)
+{
+	uint64_t start, done, end;
+	int ret;
+
+	ret = ft_sync();
+	if (ret)
+		return ret;
+
+	start = ft_gettime_ns();
+	ret = post_window();
+	if (ret)
+		return ret;
+
+	if (units) {
+		ret = compute(units, test_units);
+		if (ret)
+			return ret;
+	}
+
+	done = ft_gettime_ns();
+	ret = wait_window();
+	if (ret)
+		return ret;
+
+	end = ft_gettime_ns();
+	*total_ns += end - start;
+	*wait_ns += end - done;
+	return 0;
+}
+
+static void show_overlap(int iters, uint64_t comm_ns, uint64_t work_ns,
+			 uint64_t total_ns, uint64_t wait_ns)
+{
+	static int header = 1;
+	char str[FT_STR_LEN];
+	double overlap, avail;
+
+	overlap = comm_ns ? 100.0 * ((double) comm_ns + work_ns - total_ns) /
+		  comm_ns : 100.0;
+	overlap = MIN(MAX(overlap, 0.0), 100.0);
+	avail = total_ns ? MIN(100.0 * work_ns / total_ns, 100.0) : 100.0;
+
+	if (opts.json) {
+		show_json("overlap", NULL,
+			  opts.dst_addr ? "sender" : "receiver",
+			  opts.transfer_size,
+			  "\"iterations\": %d, \"window\": %d, "
+			  "\"work_pct\": %d, \"test_usec\": %" PRIu64 ", "
+			  "\"comm_usec\": %f, \"work_usec\": %f, "
+			  "\"total_usec\": %f, \"wait_usec\": %f, "
+			  "\"overlap\": %f, \"avail\": %f",
+			  iters, opts.window_size, work_pct, test_us,
+			  comm_ns / 1000.0, work_ns / 1000.0,
+			  total_ns / 1000.0, wait_ns / 1000.0, overlap, avail);
+		return;
+	}
+
+	if (header) {
+		printf("%s: window %d, work %d%% of comm, ",
+		       opts.dst_addr ? "sender" : "receiver",
+		       opts.window_size, work_pct);
+		if (test_us)
+			printf("test every %" PRIu64 " us\n", test_us);
+		else
+			printf("no test calls\n");
+
+		printf("%-8s%-8s%10s%10s%10s%10s%10s%10s\n", "bytes", "iters",
+		       "comm_us", "work_us", "total_us", "wait_us",
+		       "overlap%", "avail%");
+		header = 0;
+	}
+
+	printf("%-8s", size_str(str, opts.transfer_size));
+	printf("%-8s", cnt_str(str, iters));
+	printf("%10.2f%10.2f%10.2f%10.2f%10.1f%10.1f\n",
+	       comm_ns / 1000.0, work_ns / 1000.0, total_ns / 1000.0,
+	       wait_ns / 1000.0, overlap, avail);
+}
+
+static int overlap(void)
+{
+	uint64_t comm_ns = 0, work_ns, total_ns = 0, wait_ns = 0;
+	uint64_t units, test_units;
+	int i, iters, ret;
+
+	/* As in the bw tests, iterations count transfers */
+	iters = MAX(opts.iterations / opts.window_size, 1);
+
+	for (i = 0; i < opts.warmup_iterations; i++) {
+		ret = run_iter(0, 0, &comm_ns, &wait_ns);
+		if (ret)
+			return ret;
+	}
+
+	comm_ns = wait_ns = 0;
+	for (i = 0; i < iters; i++) {
+		ret = run_iter(0, 0, &comm_ns, &wait_ns);
+		if (ret)
+			return ret;
+	}
+	comm_ns /= iters;
+
+	if (work_pct) {
+		units = work_units(comm_ns * work_pct / 100, &work_ns);
+		test_units = test_us ? ns_to_units(test_us * 1000) : 0;
+	} else {
+		units = test_units = work_ns = 0;
+	}
+
+	wait_ns = 0;
+	for (i = 0; i < iters; i++) {
+		ret = run_iter(units, test_units, &total_ns, &wait_ns);
+		if (ret)
+			return ret;
+	}
+
+	show_overlap(iters, comm_ns, work_ns, total_ns / iters,
+		     wait_ns / iters);
+	return 0;
+}
+
+static int run(void)
+{
+	int i, ret;
+
+	ret = ft_init_fabric();
+	if (ret)
+		return ret;
+
+	calibrate();
+
+	if (!(opts.options & FT_OPT_SIZE)) {
+		for (i = 0; i < TEST_CNT; i++) {
+			if (!ft_use_size(i, opts.sizes_enabled))
+				continue;
+			opts.transfer_size = test_size[i].size;
+			init_test(&opts, test_name, sizeof(test_name));
+			ret = overlap();
+			if (ret)
+				return ret;
+		}
+	} else {
+		init_test(&opts, test_name, sizeof(test_name));
+		ret = overlap();
+		if (ret)
+			return ret;
+	}
+
+	return ft_finalize();
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.options |= FT_OPT_BW;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt_long(argc, argv, "T:L:h" CS_OPTS INFO_OPTS
+				 BENCHMARK_OPTS, long_opts,
+				 &lopt_idx)) != -1) {
+		switch (op) {
+		default:
+			if (!ft_parse_long_opts(op, optarg))
+				continue;
+			ft_parse_benchmark_opts(op, optarg);
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'T':
+			test_us = strtoull(optarg, NULL, 10);
+			break;
+		case 'L':
+			work_pct = atoi(optarg);
+			if (work_pct < 0) {
+				FT_ERR("Work length must not be negative");
+				return EXIT_FAILURE;
+			}
+			break;
+		case '?':
+		case 'h':
+			ft_csusage(argv[0], "Communication/computation overlap "
+				   "test for RDM endpoints.");
+			FT_PRINT_OPTS_USAGE("-T <usec>", "call fi_cq_read every "
+					    "usec of computation (default: 0, "
+					    "never)");
+			FT_PRINT_OPTS_USAGE("-L <percent>", "length of the "
+					    "computation relative to the "
+					    "transfer time (default: 100)");
+			ft_benchmark_usage();
+			ft_longopts_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->domain_attr->resource_mgmt = FI_RM_ENABLED;
+	hints->caps = FI_MSG;
+	hints->mode |= FI_CONTEXT;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->domain_attr->threading = FI_THREAD_DOMAIN;
+	hints->addr_format = opts.address_format;
+
+	ret = run();
+
+	ft_free_res();
+	return ft_exit_code(ret);
+}
@@ -0,0 +1,620 @@
+/*
+ * Copyright (c) Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*
+ * Times every resource initialization step a short-lived job pays for,
+ * from process start to the first completed message.  Each provider is
+ * measured cold, by re-executing this binary for every repetition, and
+ * warm, by repeating the setup steps in an already initialized process.
+ * The cold runs include the dynamic loading of libfabric and of the
+ * provider DSOs together with the parsing of all FI_* variables, which
+ * are reported as the "exec" and "ini" phases.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_cm.h>
+
+#include "shared.h"
+
+enum {
+	PH_EXEC,
+	PH_INI,
+	PH_GETINFO,
+	PH_FABRIC,
+	PH_DOMAIN,
+	PH_EP,
+	PH_AV,
+	PH_MR,
+	PH_FIRST_MSG,
+	PH_MAX,
+};
+
+static const char *phase_str[PH_MAX] = {
+	[PH_EXEC] = "exec",
+	[PH_INI] = "ini",
+	[PH_GETINFO] = "getinfo",
+	[PH_FABRIC] = "fabric",
+	[PH_DOMAIN] = "domain",
+	[PH_EP] = "endpoint",
+	[PH_AV] = "av_insert",
+	[PH_MR] = "mr_reg",
+	[PH_FIRST_MSG] = "first_msg",
+};
+
+#define SU_MSG_SIZE	64
+#define SU_TIMEOUT_MS	5000
+
+static int cold_reps = 10;
+static int warm_reps = 100;
+static uint64_t child_start_ns;
+static char **child_argv;
+static int child_argc;
+
+struct su_stats {
+	int cnt;
+	uint64_t *usec[PH_MAX];
+};
+
+static void mark(uint64_t *start, uint64_t *usec)
+{
+	uint64_t now = ft_gettime_ns();
+
+	*usec = (now - *start) / 1000;
+	*start = now;
+}
+
+static int wait_comp(int cnt)
+{
+	struct fi_cq_err_entry err_entry;
+	struct fi_cq_entry entry;
+	uint64_t end;
+	int ret;
+
+	end = ft_gettime_ms() + SU_TIMEOUT_MS;
+	while (cnt) {
+		ret = fi_cq_read(txcq, &entry, 1);
+		if (ret > 0) {
+			cnt--;
+		} else if (ret == -FI_EAVAIL) {
+			fi_cq_readerr(txcq, &err_entry, 0);
+			FT_CQ_ERR(txcq, err_entry, NULL, 0);
+			return -err_entry.err;
+		} else if (ret != -FI_EAGAIN) {
+			FT_PRINTERR("fi_cq_read", ret);
+			return ret;
+		} else if (ft_gettime_ms() > end) {
+			FT_ERR("Timed out waiting for first message");
+			return -FI_ETIMEDOUT;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Open every resource needed to send one message to ourselves, timing
+ * each step.  The endpoint talks to its own address, so no peer process
+ * is required and the first message includes any connection setup done
+ * by the provider.
+ */
+static int setup_once(uint64_t *usec)
+{
+	struct fi_context ctx[2];
+	struct fi_cq_attr cq_attr = {0};
+	struct fi_av_attr av_attr = {0};
+	char name[FT_MAX_CTRL_MSG];
+	size_t namelen = sizeof(name);
+	fi_addr_t self_addr;
+	void *desc = NULL;
+	char *msg_buf = NULL;
+	uint64_t start;
+	int ret;
+
+	start = ft_gettime_ns();
+	ret = fi_getinfo(FT_FIVERSION, NULL, NULL, 0, hints, &fi);
+	if (ret) {
+		FT_PRINTERR("fi_getinfo", ret);
+		return ret;
+	}
+	mark(&start, &usec[PH_GETINFO]);
+
+	ret = fi_fabric(fi->fabric_attr, &fabric, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_fabric", ret);
+		goto out;
+	}
+	mark(&start, &usec[PH_FABRIC]);
+
+	ret = fi_domain(fabric, fi, &domain, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_domain", ret);
+		goto out;
+	}
+	mark(&start, &usec[PH_DOMAIN]);
+
+	cq_attr.format = FI_CQ_FORMAT_CONTEXT;
+	cq_attr.wait_obj = FI_WAIT_NONE;
+	ret = fi_cq_open(domain, &cq_attr, &txcq, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_cq_open", ret);
+		goto out;
+	}
+
+	av_attr.type = fi->domain_attr->av_type;
+	av_attr.count = 1;
+	ret = fi_av_open(domain, &av_attr, &av, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_av_open", ret);
+		goto out;
+	}
+
+	ret = fi_endpoint(domain, fi, &ep, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_endpoint", ret);
+		goto out;
+	}
+
+	ret = ft_enable_ep(ep, NULL, av, txcq, txcq, NULL, NULL, NULL);
+	if (ret)
+		goto out;
+	mark(&start, &usec[PH_EP]);
+
+	ret = fi_getname(&ep->fid, name, &namelen);
+	if (ret) {
+		FT_PRINTERR("fi_getname", ret);
+		goto out;
+	}
+
+	ret = fi_av_insert(av, name, 1, &self_addr, 0, NULL);
+	if (ret != 1) {
+		FT_PRINTERR("fi_av_insert", ret);
+		ret = ret < 0 ? ret : -FI_EINVAL;
+		goto out;
+	}
+	mark(&start, &usec[PH_AV]);
+
+	msg_buf = calloc(2, SU_MSG_SIZE);
+	if (!msg_buf) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	ret = ft_reg_mr(fi, msg_buf, 2 * SU_MSG_SIZE, ft_info_to_mr_access(fi),
+			FT_MR_KEY, FI_HMEM_SYSTEM, 0, &mr, &desc);
+	if (ret)
+		goto out;
+	mark(&start, &usec[PH_MR]);
+
+	ret = fi_recv(ep, msg_buf + SU_MSG_SIZE, SU_MSG_SIZE, desc,
+		      FI_ADDR_UNSPEC, &ctx[1]);
+	if (ret) {
+		FT_PRINTERR("fi_recv", ret);
+		goto out;
+	}
+
+	do {
+		ret = fi_send(ep, msg_buf, SU_MSG_SIZE, desc, self_addr,
+			      &ctx[0]);
+		if (ret == -FI_EAGAIN)
+			(void) fi_cq_read(txcq, NULL, 0);
+	} while (ret == -FI_EAGAIN);
+	if (ret) {
+		FT_PRINTERR("fi_send", ret);
+		goto out;
+	}
+
+	ret = wait_comp(2);
+	if (ret)
+		goto out;
+	mark(&start, &usec[PH_FIRST_MSG]);
+
+out:
+	ft_close_fids();
+	free(msg_buf);
+	fi_freeinfo(fi);
+	fi = NULL;
+	return ret;
+}
+
+static int child_run(void)
+{
+	uint64_t usec[PH_MAX] = {0};
+	struct fi_param *params;
+	uint64_t start;
+	int i, cnt, ret;
+
+	/* Dynamic loading of libfabric itself happens before main */
+	start = child_start_ns;
+	mark(&start, &usec[PH_EXEC]);
+
+	/* Loads provider DSOs and reads every FI_* variable */
+	ret = fi_getparams(&params, &cnt);
+	if (ret) {
+		FT_PRINTERR("fi_getparams", ret);
+		return ret;
+	}
+	fi_freeparams(params);
+	mark(&start, &usec[PH_INI]);
+
+	ret = setup_once(usec);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < PH_MAX; i++)
+		printf("%" PRIu64 "%c", usec[i], i == PH_MAX - 1 ? '\n' : ' ');
+	return 0;
+}
+
+static int stats_alloc(struct su_stats *stats, int reps)
+{
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+	for (i = 0; i < PH_MAX; i++) {
+		stats->usec[i] = calloc(reps, sizeof(*stats->usec[i]));
+		if (!stats->usec[i])
+			return -FI_ENOMEM;
+	}
+	return 0;
+}
+
+static void stats_free(struct su_stats *stats)
+{
+	int i;
+
+	for (i = 0; i < PH_MAX; i++)
+		free(stats->usec[i]);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+static void show_stats(const char *prov, const char *mode,
+		       struct su_stats *stats, int first_phase)
+{
+	char name[FT_STR_LEN];
+	uint64_t *v, sum;
+	int i, j, n = stats->cnt;
+
+	if (!n) {
+		if (opts.json)
+			return;
+		printf("%-20s %-5s %-10s %6d\n", prov, mode, "-", 0);
+		return;
+	}
+
+	for (i = first_phase; i < PH_MAX; i++) {
+		v = stats->usec[i];
+		qsort(v, n, sizeof(*v), cmp_u64);
+		for (j = 0, sum = 0; j < n; j++)
+			sum += v[j];
+
+		if (opts.json) {
+			snprintf(name, sizeof(name), "%s_%s", mode,
+				 phase_str[i]);
+			show_json("startup", prov, name, 0,
+				  "\"reps\": %d, \"min_usec\": %" PRIu64
+				  ", \"p50_usec\": %" PRIu64 ", \"p99_usec\": %"
+				  PRIu64 ", \"max_usec\": %" PRIu64
+				  ", \"mean_usec\": %" PRIu64,
+				  n, v[0], v[(n - 1) / 2], v[(n - 1) * 99 / 100],
+				  v[n - 1], sum / n);
+			continue;
+		}
+
+		printf("%-20s %-5s %-10s %6d %10" PRIu64 " %10" PRIu64
+		       " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+		       prov, mode, phase_str[i], n, v[0], v[(n - 1) / 2],
+		       v[(n - 1) * 99 / 100], v[n - 1], sum / n);
+	}
+}
+
+static int run_cold_once(const char *prov, uint64_t *usec)
+{
+	char start_arg[32];
+	int fds[2], status, i, ret = 0;
+	FILE *out;
+	pid_t pid;
+
+	if (pipe(fds))
+		return -errno;
+
+	/* Options were copied at startup, fill in the provider and time */
+	snprintf(start_arg, sizeof(start_arg), "%" PRIu64, ft_gettime_ns());
+	child_argv[child_argc - 3] = (char *) prov;
+	child_argv[child_argc - 1] = start_arg;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0) {
+		ret = -errno;
+		close(fds[0]);
+		close(fds[1]);
+		return ret;
+	}
+
+	if (!pid) {
+		close(fds[0]);
+		if (dup2(fds[1], STDOUT_FILENO) < 0)
+			_exit(EXIT_FAILURE);
+		execvp(child_argv[0], child_argv);
+		perror("execvp");
+		_exit(EXIT_FAILURE);
+	}
+
+	close(fds[1]);
+	out = fdopen(fds[0], "r");
+	if (!out) {
+		ret = -errno;
+		close(fds[0]);
+	} else {
+		for (i = 0; i < PH_MAX; i++) {
+			if (fscanf(out, "%" SCNu64, &usec[i]) != 1) {
+				ret = -FI_EOTHER;
+				break;
+			}
+		}
+		fclose(out);
+	}
+
+	if (waitpid(pid, &status, 0) < 0)
+		return -errno;
+	if (!WIFEXITED(status) || WEXITSTATUS(status))
+		return -FI_EOTHER;
+	return ret;
+}
+
+static void stats_add(struct su_stats *stats, uint64_t *usec)
+{
+	int i;
+
+	for (i = 0; i < PH_MAX; i++)
+		stats->usec[i][stats->cnt] = usec[i];
+	stats->cnt++;
+}
+
+static int set_prov_hint(const char *prov)
+{
+	free(hints->fabric_attr->prov_name);
+	hints->fabric_attr->prov_name = strdup(prov);
+	return hints->fabric_attr->prov_name ? 0 : -FI_ENOMEM;
+}
+
+static int run_prov(const char *prov)
+{
+	uint64_t usec[PH_MAX];
+	struct su_stats stats;
+	int i, ret;
+
+	ret = stats_alloc(&stats, MAX(cold_reps, warm_reps));
+	if (ret)
+		goto out;
+
+	for (i = 0; i < cold_reps; i++) {
+		memset(usec, 0, sizeof(usec));
+		ret = run_cold_once(prov, usec);
+		if (ret)
+			goto out;
+		stats_add(&stats, usec);
+	}
+	show_stats(prov, "cold", &stats, PH_EXEC);
+
+	ret = set_prov_hint(prov);
+	if (ret)
+		goto out;
+
+	/* The first pass in this process is not warm yet, discard it */
+	stats.cnt = 0;
+	for (i = -1; i < warm_reps; i++) {
+		memset(usec, 0, sizeof(usec));
+		ret = setup_once(usec);
+		if (ret)
+			goto out;
+		if (i >= 0)
+			stats_add(&stats, usec);
+	}
+	show_stats(prov, "warm", &stats, PH_GETINFO);
+
+out:
+	stats_free(&stats);
+	return ret;
+}
+
+/* Collect the name of every provider that matches the hints */
+static int get_provs(char ***provs, int *cnt)
+{
+	struct fi_info *list, *cur;
+	int i, ret;
+
+	*cnt = 0;
+	ret = fi_getinfo(FT_FIVERSION, NULL, NULL, 0, hints, &list);
+	if (ret) {
+		FT_PRINTERR("fi_getinfo", ret);
+		return ret;
+	}
+
+	for (cur = list; cur; cur = cur->next)
+		(*cnt)++;
+
+	*provs = calloc(*cnt, sizeof(**provs));
+	if (!*provs) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	for (cur = list, *cnt = 0; cur; cur = cur->next) {
+		for (i = 0; i < *cnt; i++) {
+			if (!strcmp((*provs)[i], cur->fabric_attr->prov_name))
+				break;
+		}
+		if (i < *cnt)
+			continue;
+
+		(*provs)[i] = strdup(cur->fabric_attr->prov_name);
+		if (!(*provs)[i]) {
+			ret = -FI_ENOMEM;
+			goto out;
+		}
+		(*cnt)++;
+	}
+out:
+	fi_freeinfo(list);
+	return ret;
+}
+
+static int run(void)
+{
+	char **provs = NULL;
+	int i, cnt, ret, fail = 0;
+
+	ret = get_provs(&provs, &cnt);
+	if (ret)
+		goto out;
+
+	if (!opts.json)
+		printf("%-20s %-5s %-10s %6s %10s %10s %10s %10s %10s\n",
+		       "provider", "mode", "phase", "reps", "min(us)",
+		       "p50(us)", "p99(us)", "max(us)", "mean(us)");
+	for (i = 0; i < cnt; i++) {
+		ret = run_prov(provs[i]);
+		if (ret) {
+			fprintf(stderr, "%s: startup test failed: %s\n",
+				provs[i], fi_strerror(-ret));
+			fail = ret;
+		}
+	}
+	ret = fail;
+out:
+	for (i = 0; provs && i < cnt; i++)
+		free(provs[i]);
+	free(provs);
+	return ret;
+}
+
+/*
+ * Children are started with the parent's options followed by
+ * "-p <provider> -X <start time>", the last two values are filled in
+ * for every run.
+ */
+static int alloc_child_argv(int argc, char **argv)
+{
+	int i;
+
+	child_argv = calloc(argc + 5, sizeof(*child_argv));
+	if (!child_argv)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < argc; i++)
+		child_argv[i] = argv[i];
+	child_argv[i++] = "-p";
+	child_argv[i++] = NULL;
+	child_argv[i++] = "-X";
+	child_argv[i++] = NULL;
+	child_argc = i;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	ret = alloc_child_argv(argc, argv);
+	if (ret)
+		return EXIT_FAILURE;
+
+	while ((op = getopt_long(argc, argv, "c:w:X:h" INFO_OPTS,
+				 long_opts, &lopt_idx)) != -1) {
+		switch (op) {
+		default:
+			if (!ft_parse_long_opts(op, optarg))
+				continue;
+			ft_parseinfo(op, optarg, hints, &opts);
+			break;
+		case 'c':
+			cold_reps = atoi(optarg);
+			break;
+		case 'w':
+			warm_reps = atoi(optarg);
+			break;
+		case 'X':
+			child_start_ns = strtoull(optarg, NULL, 0);
+			break;
+		case '?':
+		case 'h':
+			ft_usage(argv[0], "Resource initialization startup "
+				 "benchmark.");
+			FT_PRINT_OPTS_USAGE("-c <reps>", "number of cold runs, "
+					    "each in a new process (default: 10)");
+			FT_PRINT_OPTS_USAGE("-w <reps>", "number of warm runs "
+					    "(default: 100)");
+			ft_longopts_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (cold_reps < 0 || warm_reps < 0) {
+		FT_ERR("Repetition counts must not be negative");
+		return EXIT_FAILURE;
+	}
+
+	if (!hints->ep_attr->type)
+		hints->ep_attr->type = FI_EP_RDM;
+	if (hints->ep_attr->type == FI_EP_MSG) {
+		FT_ERR("Connectionless endpoints are required");
+		return EXIT_FAILURE;
+	}
+	hints->caps = FI_MSG;
+	hints->mode = FI_CONTEXT;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+
+	ret = child_start_ns ? child_run() : run();
+
+	free(child_argv);
+	ft_free_res();
+	return ft_exit_code(ret);
+}
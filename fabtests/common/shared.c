@@ -38,6 +38,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <sched.h>
+#include <stdarg.h>
 #include <sys/wait.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -3161,6 +3162,63 @@ int ft_finalize(void)
 	return ft_finalize_ep(ep);
 }
 
+/*
+ * Returns an info for opening endpoints beside the one opened with fi.
+ * The first endpoint may be bound to a fixed port or name.  Socket
+ * addresses are reused with an ephemeral port, any other format is
+ * queried again without a node or service so that the provider picks a
+ * distinct default name for every additional endpoint.
+ */
+int ft_get_extra_ep_info(struct fi_info **info)
+{
+	struct fi_info *list, *cur;
+	int ret;
+
+	switch (fi->src_addr ? ft_sa_family(fi->src_addr) : AF_UNSPEC) {
+	case AF_INET:
+	case AF_INET6:
+		if (fi->addr_format != FI_SOCKADDR &&
+		    fi->addr_format != FI_SOCKADDR_IN &&
+		    fi->addr_format != FI_SOCKADDR_IN6)
+			break;
+
+		*info = fi_dupinfo(fi);
+		if (!*info)
+			return -FI_ENOMEM;
+		if (ft_sa_family((*info)->src_addr) == AF_INET)
+			((struct sockaddr_in *) (*info)->src_addr)->sin_port = 0;
+		else
+			((struct sockaddr_in6 *) (*info)->src_addr)->sin6_port = 0;
+		return 0;
+	default:
+		break;
+	}
+
+	ret = fi_getinfo(FT_FIVERSION, NULL, NULL, 0, hints, &list);
+	if (ret) {
+		FT_PRINTERR("fi_getinfo", ret);
+		return ret;
+	}
+
+	for (cur = list; cur; cur = cur->next) {
+		if (!strcmp(cur->fabric_attr->prov_name,
+			    fi->fabric_attr->prov_name) &&
+		    !strcmp(cur->domain_attr->name, fi->domain_attr->name))
+			break;
+	}
+
+	if (cur) {
+		*info = fi_dupinfo(cur);
+		ret = *info ? 0 : -FI_ENOMEM;
+	} else {
+		FT_ERR("No matching info for additional endpoints");
+		ret = -FI_ENODATA;
+	}
+
+	fi_freeinfo(list);
+	return ret;
+}
+
 int64_t get_elapsed(const struct timespec *b, const struct timespec *a,
 		    enum precision p)
 {
@@ -3171,6 +3229,180 @@ int64_t get_elapsed(const struct timespec *b, const struct timespec *a,
 	return elapsed / p;
 }
 
+/* Returns a kB value of /proc/self/status, such as VmRSS, or -1 */
+long ft_read_status_kb(const char *key)
+{
+	long val = -1;
+#ifdef __linux__
+	char line[256];
+	size_t len = strlen(key);
+	FILE *f;
+
+	f = fopen("/proc/self/status", "r");
+	if (!f)
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (!strncmp(line, key, len) && line[len] == ':') {
+			val = strtol(line + len + 1, NULL, 10);
+			break;
+		}
+	}
+	fclose(f);
+#endif
+	return val;
+}
+
+static void ft_json_str(const char *str)
+{
+	putchar('"');
+	for (; str && *str; str++) {
+		if (*str == '"' || *str == '\\')
+			printf("\\%c", *str);
+		else if ((unsigned char) *str < 0x20)
+			printf("\\u%04x", *str);
+		else
+			putchar(*str);
+	}
+	putchar('"');
+}
+
+static void ft_json_kv(const char *key, const char *val)
+{
+	printf(", \"%s\": ", key);
+	ft_json_str(val);
+}
+
+static const char *ft_test_name(void)
+{
+	const char *name;
+
+	if (!opts.argc)
+		return "";
+
+	name = strrchr(opts.argv[0], '/');
+	return name ? name + 1 : opts.argv[0];
+}
+
+/*
+ * Records what is needed to tell whether two result sets are comparable:
+ * the host, the library and provider versions, the attributes of the
+ * selected provider and any FI_ variable in the environment.
+ */
+static void show_perf_json_env(void)
+{
+	char buf[256];
+	char **env;
+	uint32_t version = fi_version();
+	int i, first = 1;
+
+	printf("{\"type\": \"env\"");
+	ft_json_kv("test", ft_test_name());
+	printf(", \"argv\": [");
+	for (i = 0; i < opts.argc; i++) {
+		printf(i ? ", " : "");
+		ft_json_str(opts.argv[i]);
+	}
+	printf("]");
+
+	if (gethostname(buf, sizeof(buf)))
+		snprintf(buf, sizeof(buf), "unknown");
+	ft_json_kv("host", buf);
+	ft_os_version(buf, sizeof(buf));
+	ft_json_kv("os", buf);
+	printf(", \"libfabric\": \"%d.%d\", \"api\": \"%d.%d\"",
+	       FI_MAJOR(version), FI_MINOR(version),
+	       FI_MAJOR(FT_FIVERSION), FI_MINOR(FT_FIVERSION));
+
+	if (fi) {
+		ft_json_kv("provider", fi->fabric_attr->prov_name);
+		printf(", \"prov_version\": \"%d.%d\"",
+		       FI_MAJOR(fi->fabric_attr->prov_version),
+		       FI_MINOR(fi->fabric_attr->prov_version));
+		ft_json_kv("fabric", fi->fabric_attr->name);
+		ft_json_kv("domain", fi->domain_attr->name);
+		ft_json_kv("ep_type", fi_tostr(&fi->ep_attr->type,
+					       FI_TYPE_EP_TYPE));
+		ft_json_kv("caps", fi_tostr(&fi->caps, FI_TYPE_CAPS));
+		ft_json_kv("mr_mode", fi_tostr(&fi->domain_attr->mr_mode,
+					       FI_TYPE_MR_MODE));
+		ft_json_kv("threading", fi_tostr(&fi->domain_attr->threading,
+						 FI_TYPE_THREADING));
+		ft_json_kv("progress",
+			   fi_tostr(&fi->domain_attr->data_progress,
+				    FI_TYPE_PROGRESS));
+		printf(", \"max_msg_size\": %zu, \"inject_size\": %zu, "
+		       "\"tx_size\": %zu, \"rx_size\": %zu",
+		       fi->ep_attr->max_msg_size, fi->tx_attr->inject_size,
+		       fi->tx_attr->size, fi->rx_attr->size);
+	}
+
+	printf(", \"fi_env\": {");
+	for (env = ft_environ(); env && *env; env++) {
+		if (strncmp(*env, "FI_", 3) || !strchr(*env, '='))
+			continue;
+
+		snprintf(buf, sizeof(buf), "%.*s",
+			 (int) (strchr(*env, '=') - *env), *env);
+		printf(first ? "" : ", ");
+		ft_json_str(buf);
+		printf(": ");
+		ft_json_str(strchr(*env, '=') + 1);
+		first = 0;
+	}
+	printf("}}\n");
+}
+
+/*
+ * Prints one record of the given type, preceded by the env record the
+ * first time.  fmt gives the fields that follow the common ones, as
+ * "\"key\": value" pairs separated by commas.  prov defaults to the
+ * provider in use.
+ */
+void show_json(const char *type, const char *prov, const char *name,
+	       size_t size, const char *fmt, ...)
+{
+	static int header = 1;
+	va_list args;
+
+	if (header) {
+		show_perf_json_env();
+		header = 0;
+	}
+
+	if (!prov)
+		prov = fi ? fi->fabric_attr->prov_name : "";
+
+	printf("{\"type\": ");
+	ft_json_str(type);
+	ft_json_kv("test", ft_test_name());
+	ft_json_kv("provider", prov);
+	ft_json_kv("name", name ? name : "");
+	printf(", \"size\": %zu, ", size);
+
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+	printf("}\n");
+	fflush(stdout);
+}
+
+static void show_perf_json(char *name, size_t tsize, int iters,
+			   int64_t elapsed, int xfers_per_iter)
+{
+	long long bytes = (long long) iters * tsize * xfers_per_iter;
+	double usec_per_xfer = (double) elapsed / iters / xfers_per_iter;
+
+	/* JSON has no inf or nan, too short a run reports rates of 0 */
+	show_json("perf", NULL, name, tsize,
+		  "\"iterations\": %d, \"xfers_per_iter\": %d, "
+		  "\"bytes\": %lld, \"usec\": %" PRId64 ", \"mbps\": %f, "
+		  "\"usec_per_xfer\": %f, \"mxfers_per_sec\": %f",
+		  iters, xfers_per_iter, bytes, elapsed,
+		  elapsed ? bytes / (1.0 * elapsed) : 0.0, usec_per_xfer,
+		  elapsed ? 1.0 / usec_per_xfer : 0.0);
+}
+
 void show_perf(char *name, size_t tsize, int iters, struct timespec *start,
 		struct timespec *end, int xfers_per_iter)
 {
@@ -3180,6 +3412,11 @@ void show_perf(char *name, size_t tsize, int iters, struct timespec *start,
 	long long bytes = (long long) iters * tsize * xfers_per_iter;
 	float usec_per_xfer;
 
+	if (opts.json) {
+		show_perf_json(name, tsize, iters, elapsed, xfers_per_iter);
+		return;
+	}
+
 	if (name) {
 		if (header) {
 			printf("%-50s%-8s%-8s%-8s%8s %10s%13s%13s\n",
@@ -3221,6 +3458,11 @@ void show_perf_mr(size_t tsize, int iters, struct timespec *start,
 	int i;
 	float usec_per_xfer;
 
+	if (opts.json) {
+		show_perf_json(NULL, tsize, iters, elapsed, xfers_per_iter);
+		return;
+	}
+
 	if (header) {
 		printf("---\n");
 
@@ -4215,6 +4457,9 @@ void ft_longopts_usage()
 		"maximum untagged message size");
 	FT_PRINT_OPTS_USAGE("--use-fi-more",
 		"Run tests with FI_MORE");
+	FT_PRINT_OPTS_USAGE("--json",
+		"Print performance results and the test environment\n"
+		"as one JSON object per line.");
 }
 
 int debug_assert;
@@ -4228,6 +4473,7 @@ struct option long_opts[] = {
 	{"control-progress", required_argument, NULL, LONG_OPT_CONTROL_PROGRESS},
 	{"max-msg-size", required_argument, NULL, LONG_OPT_MAX_MSG_SIZE},
 	{"use-fi-more", no_argument, NULL, LONG_OPT_USE_FI_MORE},
+	{"json", no_argument, NULL, LONG_OPT_JSON},
 	{NULL, 0, NULL, 0},
 };
 
@@ -4271,6 +4517,9 @@ int ft_parse_long_opts(int op, char *optarg)
 	case LONG_OPT_USE_FI_MORE:
 		opts.use_fi_more = 1;
 		return 0;
+	case LONG_OPT_JSON:
+		opts.json = 1;
+		return 0;
 	default:
 		return EXIT_FAILURE;
 	}
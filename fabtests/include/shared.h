@@ -196,6 +196,7 @@ struct ft_opts {
 	int options;
 	enum ft_comp_method comp_method;
 	int machr;
+	int json;
 	enum ft_rma_opcodes rma_op;
 	enum ft_cqdata_opcodes cqdata_op;
 	char *oob_port;
@@ -620,8 +621,12 @@ int ft_poll_fd(int fd, int timeout);
 
 int64_t get_elapsed(const struct timespec *b, const struct timespec *a,
 		enum precision p);
+long ft_read_status_kb(const char *key);
+int ft_get_extra_ep_info(struct fi_info **info);
 void show_perf(char *name, size_t tsize, int iters, struct timespec *start,
 		struct timespec *end, int xfers_per_iter);
+void show_json(const char *type, const char *prov, const char *name,
+	       size_t size, const char *fmt, ...);
 void show_perf_mr(size_t tsize, int iters, struct timespec *start,
 		struct timespec *end, int xfers_per_iter, int argc, char *argv[]);
 void ft_parse_opts_range(char *optarg);
@@ -650,6 +655,7 @@ enum {
 	LONG_OPT_CONTROL_PROGRESS,
 	LONG_OPT_MAX_MSG_SIZE,
 	LONG_OPT_USE_FI_MORE,
+	LONG_OPT_JSON,
 };
 
 extern int debug_assert;
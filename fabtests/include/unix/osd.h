@@ -37,6 +37,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/utsname.h>
 
 #ifndef SOCKET
 #define SOCKET int
@@ -66,6 +67,24 @@ static inline int ft_close_fd(int fd)
 	return close(fd);
 }
 
+static inline void ft_os_version(char *buf, size_t len)
+{
+	struct utsname name;
+
+	if (uname(&name))
+		snprintf(buf, len, "unknown");
+	else
+		snprintf(buf, len, "%s %s %s", name.sysname, name.release,
+			 name.machine);
+}
+
+static inline char **ft_environ(void)
+{
+	extern char **environ;
+
+	return environ;
+}
+
 static inline ssize_t ofi_recv_socket(SOCKET fd, void *buf, size_t count,
 				      int flags)
 {
@@ -701,6 +701,16 @@ static inline int ft_startup(void)
 	return ret;
 }
 
+static inline void ft_os_version(char *buf, size_t len)
+{
+	snprintf(buf, len, "Windows");
+}
+
+static inline char **ft_environ(void)
+{
+	return _environ;
+}
+
 /*
  * The windows API limits socket send/recv transfers to INT_MAX.
  * For nonblocking, stream sockets, we limit send/recv calls to that
@@ -276,6 +276,163 @@ static int sum_all_reduce_test_run(enum fi_collective_op coll_op, enum fi_op op,
 	return -FI_ENOEQ;
 }
 
+static int wait_for_any_comp(void **ctx)
+{
+	struct fi_cq_err_entry comp = { 0 };
+	int err;
+
+	do {
+		err = fi_cq_read(txcq, &comp, 1);
+		if (err < 0 && err != -EAGAIN)
+			return err;
+
+		if (err > 0 && comp.op_context)
+			break;
+
+		err = fi_cq_read(rxcq, &comp, 1);
+		if (err < 0 && err != -EAGAIN)
+			return err;
+
+		if (err > 0 && comp.op_context)
+			break;
+	} while (1);
+
+	*ctx = comp.op_context;
+	return FI_SUCCESS;
+}
+
+static int post_overlap_all_reduce(uint64_t *data, uint64_t *result,
+				   struct fi_context2 *ctx)
+{
+	int err;
+
+	*result = 0;
+	err = fi_allreduce(ep, data, 1, NULL, result, NULL, coll_addr,
+			   FI_UINT64, FI_SUM, 0, ctx);
+	if (err)
+		FT_PRINTERR("collective allreduce failed - fi_allreduce", err);
+
+	return err;
+}
+
+/*
+ * Runs opts.iterations allreduces twice on the same communicator: once
+ * waiting for each one before issuing the next, then keeping up to
+ * opts.window_size of them outstanding.  Every result is verified, so
+ * this also checks that concurrent collectives are matched correctly.
+ */
+static int overlap_all_reduce_test_run(enum fi_collective_op coll_op,
+		enum fi_op op, enum fi_datatype datatype)
+{
+	struct fi_context2 *ctx;
+	uint64_t *result;
+	uint64_t expect_result = 0;
+	uint64_t data;
+	const uint64_t base_data_value = 1234;
+	uint64_t start, serial_ns, overlap_ns;
+	size_t window, posted, completed, i;
+	void *comp_ctx;
+	int err = FI_SUCCESS;
+
+	assert(coll_op == FI_ALLREDUCE);
+	assert(op == FI_SUM);
+	assert(datatype == FI_UINT64);
+
+	if (!is_my_rank_participating())
+		return FI_SUCCESS;
+
+	window = MIN(opts.window_size, opts.iterations);
+	if (!window)
+		return FI_SUCCESS;
+
+	result = calloc(window, sizeof(*result));
+	ctx = calloc(window, sizeof(*ctx));
+	if (!result || !ctx) {
+		err = -FI_ENOMEM;
+		goto out;
+	}
+
+	data = base_data_value + pm_job.my_rank;
+	for (i = av_set_attr.start_addr;
+	     i <= av_set_attr.end_addr;
+	     i += av_set_attr.stride) {
+		expect_result += base_data_value + i;
+	}
+
+	coll_addr = fi_mc_addr(coll_mc);
+
+	start = ft_gettime_ns();
+	for (i = 0; i < opts.iterations; i++) {
+		err = post_overlap_all_reduce(&data, &result[0], &ctx[0]);
+		if (err)
+			goto out;
+
+		err = wait_for_comp(&ctx[0]);
+		if (err)
+			goto out;
+
+		if (result[0] != expect_result) {
+			FT_DEBUG("allreduce failed; expect: %ld, actual: %ld",
+				 expect_result, result[0]);
+			err = -FI_ENOEQ;
+			goto out;
+		}
+	}
+	serial_ns = ft_gettime_ns() - start;
+
+	pm_barrier();
+
+	start = ft_gettime_ns();
+	for (posted = 0; posted < window; posted++) {
+		err = post_overlap_all_reduce(&data, &result[posted],
+					      &ctx[posted]);
+		if (err)
+			goto out;
+	}
+
+	for (completed = 0; completed < opts.iterations; completed++) {
+		err = wait_for_any_comp(&comp_ctx);
+		if (err)
+			goto out;
+
+		i = (struct fi_context2 *) comp_ctx - ctx;
+		if (i >= window) {
+			FT_DEBUG("unexpected completion context %p", comp_ctx);
+			err = -FI_EOTHER;
+			goto out;
+		}
+
+		if (result[i] != expect_result) {
+			FT_DEBUG("allreduce %zu failed; expect: %ld, "
+				 "actual: %ld", i, expect_result, result[i]);
+			err = -FI_ENOEQ;
+			goto out;
+		}
+
+		if (posted < opts.iterations) {
+			err = post_overlap_all_reduce(&data, &result[i],
+						      &ctx[i]);
+			if (err)
+				goto out;
+			posted++;
+		}
+	}
+	overlap_ns = ft_gettime_ns() - start;
+
+	if ((opts.options & FT_OPT_PERF) && pm_job.my_rank == 0) {
+		printf("allreduce x%d: serial %.2f us/op, %zu outstanding "
+		       "%.2f us/op, speedup %.2f\n", opts.iterations,
+		       serial_ns / 1000.0 / opts.iterations, window,
+		       overlap_ns / 1000.0 / opts.iterations,
+		       overlap_ns ? (double) serial_ns / overlap_ns : 0.0);
+	}
+
+out:
+	free(ctx);
+	free(result);
+	return err;
+}
+
 static int all_gather_test_run(enum fi_collective_op coll_op, enum fi_op op,
 		enum fi_datatype datatype)
 {
@@ -487,6 +644,15 @@ struct coll_test tests[] = {
 		.op = FI_SUM,
 		.datatype = FI_UINT64,
 	},
+	{
+		.name = "overlap_all_reduce_test",
+		.setup = coll_setup,
+		.run = overlap_all_reduce_test_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_ALLREDUCE,
+		.op = FI_SUM,
+		.datatype = FI_UINT64,
+	},
 	{
 		.name = "all_gather_test",
 		.setup = coll_setup,
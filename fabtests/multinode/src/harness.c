@@ -321,7 +321,7 @@ int main(int argc, char **argv)
 	if (!hints)
 		return EXIT_FAILURE;
 
-	while ((c = getopt(argc, argv, "n:x:z:Ths:I:" INFO_OPTS)) != -1) {
+	while ((c = getopt(argc, argv, "n:x:z:Ths:I:W:" INFO_OPTS)) != -1) {
 		switch (c) {
 		default:
 			ft_parse_addr_opts(c, optarg, &opts);
@@ -331,6 +331,9 @@ int main(int argc, char **argv)
 			opts.options |= FT_OPT_ITER;
 			opts.iterations = atoi(optarg);
 			break;
+		case 'W':
+			opts.window_size = atoi(optarg);
+			break;
 		case 'n':
 			pm_job.num_ranks = atoi(optarg);
 			break;
@@ -358,6 +361,8 @@ int main(int argc, char **argv)
 			FT_PRINT_OPTS_USAGE("-x <xfer_mode>", "msg or rma "
 					    "message mode");
 			FT_PRINT_OPTS_USAGE("-I <iters>", "number of iterations");
+			FT_PRINT_OPTS_USAGE("-W <window>", "number of outstanding "
+					    "collectives in overlap tests");
 			FT_PRINT_OPTS_USAGE("-T", "pass to enable performance "
 					    "timing mode");
 			FT_PRINT_OPTS_USAGE("-z <pattern>", "full_mesh, ring, "
@@ -0,0 +1,349 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: BSD-2-Clause OR GPL-2.0-only
+
+"""
+Compare fabtests benchmark results from two libfabric builds.
+
+Benchmarks started with --json print one "env" record describing the host,
+library and provider, followed by one "perf" record per message size, or
+the records of their own type for fi_rdm_overlap, fi_startup,
+fi_mr_cache and fi_cq_read_scaling.  The run command starts a
+client/server benchmark, or with --local a single process benchmark,
+repeatedly against a baseline and a test build, alternating between the
+two so that drift on the machine affects both equally, and saves the
+client records of every trial.  The
+compare command reports the mean and confidence interval of every result
+and flags changes that are both statistically significant (Welch's t-test)
+and larger than a threshold.  It exits with 1 if any regression is found.
+
+Examples:
+    perfcompare.py run --baseline-lib /opt/ofi-old/lib \\
+        --test-lib /opt/ofi-new/lib --trials 10 --out results \\
+        -- fi_rdm_pingpong -p tcp -s 127.0.0.1
+    perfcompare.py compare results/baseline.json results/test.json
+"""
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+import time
+
+# Two-sided critical values of Student's t distribution for df 1-30,
+# followed by df 40, 60 and 120.
+T_TABLE = {
+    0.90: [6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860, 1.833,
+           1.812, 1.796, 1.782, 1.771, 1.761, 1.753, 1.746, 1.740, 1.734,
+           1.729, 1.725, 1.721, 1.717, 1.714, 1.711, 1.708, 1.706, 1.703,
+           1.701, 1.699, 1.697, 1.684, 1.671, 1.658],
+    0.95: [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+           2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101,
+           2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052,
+           2.048, 2.045, 2.042, 2.021, 2.000, 1.980],
+    0.99: [63.657, 9.925, 5.841, 4.604, 4.032, 3.707, 3.499, 3.355, 3.250,
+           3.169, 3.106, 3.055, 3.012, 2.977, 2.947, 2.921, 2.898, 2.878,
+           2.861, 2.845, 2.831, 2.819, 2.807, 2.797, 2.787, 2.779, 2.771,
+           2.763, 2.756, 2.750, 2.704, 2.660, 2.617],
+}
+T_TABLE_DF = list(range(1, 31)) + [40, 60, 120]
+
+# env fields that are expected to differ between the two builds
+ENV_IGNORE = ("type", "argv", "libfabric", "prov_version")
+
+# field compared for each record type other than "perf", whether higher is
+# better and its unit
+RECORD_METRICS = {
+    "overlap": ("overlap", True, "%"),
+    "startup": ("p50_usec", False, "usec"),
+    "mr_cache": ("reg_p50_ns", False, "nsec"),
+    "cq_read": ("ns_per_read", False, "nsec"),
+}
+
+
+def t_critical(confidence, df):
+    '''
+        critical value for the given degrees of freedom, rounded down to
+        the nearest entry in the table to stay conservative
+    '''
+    if df < 1:
+        return math.inf
+    for i in reversed(range(len(T_TABLE_DF))):
+        if df >= T_TABLE_DF[i]:
+            return T_TABLE[confidence][i]
+
+
+def mean_stdev(values):
+    n = len(values)
+    mean = sum(values) / n
+    if n < 2:
+        return mean, 0.0
+    var = sum((v - mean) ** 2 for v in values) / (n - 1)
+    return mean, math.sqrt(var)
+
+
+def confidence_interval(values, confidence):
+    mean, stdev = mean_stdev(values)
+    if len(values) < 2:
+        return mean, math.inf
+    return mean, t_critical(confidence, len(values) - 1) * stdev / \
+        math.sqrt(len(values))
+
+
+def welch_significant(a, b, confidence):
+    '''
+        True if the means of a and b differ at the given confidence
+    '''
+    if len(a) < 2 or len(b) < 2:
+        return False
+
+    mean_a, sd_a = mean_stdev(a)
+    mean_b, sd_b = mean_stdev(b)
+    var_a = sd_a ** 2 / len(a)
+    var_b = sd_b ** 2 / len(b)
+    se = math.sqrt(var_a + var_b)
+    if se == 0:
+        return mean_a != mean_b
+
+    df = (var_a + var_b) ** 2 / \
+        ((var_a ** 2 / (len(a) - 1) if var_a else 0) +
+         (var_b ** 2 / (len(b) - 1) if var_b else 0))
+    return abs(mean_a - mean_b) / se > t_critical(confidence, math.floor(df))
+
+
+def load_results(path):
+    '''
+        returns the env records and a dict mapping (type, test, provider,
+        name, size) to the list of records of every trial
+    '''
+    envs = []
+    perf = {}
+    with open(path) as fd:
+        for line in fd:
+            line = line.strip()
+            if not line.startswith("{"):
+                continue
+            try:
+                rec = json.loads(line)
+            except ValueError:
+                continue
+
+            if rec.get("type") == "env":
+                envs.append(rec)
+            elif rec.get("type") == "perf" or \
+                    rec.get("type") in RECORD_METRICS:
+                key = (rec["type"], rec["test"], rec["provider"],
+                       rec["name"], rec["size"])
+                perf.setdefault(key, []).append(rec)
+    return envs, perf
+
+
+def check_envs(base_envs, test_envs):
+    '''
+        warn about differences that make results incomparable
+    '''
+    if not base_envs or not test_envs:
+        return
+
+    base, test = base_envs[0], test_envs[0]
+    for key in sorted(set(base) | set(test)):
+        if key in ENV_IGNORE or base.get(key) == test.get(key):
+            continue
+        print("warning: %s differs: %s vs %s" %
+              (key, base.get(key), test.get(key)), file=sys.stderr)
+
+
+def metric_for(rtype, test, metric):
+    '''
+        returns the record field to compare, whether higher is better and
+        its unit
+    '''
+    if rtype in RECORD_METRICS:
+        return RECORD_METRICS[rtype]
+    if metric == "auto":
+        metric = "bandwidth" if "_bw" in test else "latency"
+    if metric == "bandwidth":
+        return "mbps", True, "MB/s"
+    return "usec_per_xfer", False, "usec"
+
+
+def size_str(size):
+    for shift, suffix in ((30, "g"), (20, "m"), (10, "k")):
+        if size >= (1 << shift) and not size % (1 << shift):
+            return "%d%s" % (size >> shift, suffix)
+    return str(size)
+
+
+def compare(args):
+    base_envs, base = load_results(args.baseline)
+    test_envs, test = load_results(args.test)
+    check_envs(base_envs, test_envs)
+
+    regressions = 0
+    print("%-22s %-12s %-8s %-4s %-6s %20s %20s %8s  %s" %
+          ("test", "provider", "size", "n", "metric", "baseline",
+           "test", "change", "result"))
+    for key in sorted(set(base) & set(test)):
+        field, higher_better, unit = metric_for(key[0], key[1],
+                                                args.metric)
+        a = [rec[field] for rec in base[key]]
+        b = [rec[field] for rec in test[key]]
+        mean_a, ci_a = confidence_interval(a, args.confidence)
+        mean_b, ci_b = confidence_interval(b, args.confidence)
+        change = (mean_b - mean_a) * 100.0 / mean_a if mean_a else 0.0
+
+        result = ""
+        if welch_significant(a, b, args.confidence) and \
+                abs(change) >= args.threshold:
+            worse = (change < 0) if higher_better else (change > 0)
+            result = "REGRESSION" if worse else "improvement"
+            regressions += worse
+
+        name = key[1] + ("/" + key[3] if key[3] else "")
+        print("%-22s %-12s %-8s %-4d %-6s %11.3f+-%-7.3f %11.3f+-%-7.3f "
+              "%+7.1f%%  %s" %
+              (name, key[2], size_str(key[4]), min(len(a), len(b)),
+               unit, mean_a, ci_a,
+               mean_b, ci_b, change, result))
+
+    for key in sorted(set(base) ^ set(test)):
+        print("warning: %s %s size %d only in %s" %
+              (key[1] + ("/" + key[3] if key[3] else ""), key[2], key[4],
+               "baseline" if key in base else "test"), file=sys.stderr)
+
+    print("%d regression(s) at %d%% confidence, threshold %.1f%%" %
+          (regressions, args.confidence * 100, args.threshold))
+    return 1 if regressions else 0
+
+
+def run_trial(args, lib, out):
+    env = dict(os.environ)
+    env["LD_LIBRARY_PATH"] = lib + (":" + env["LD_LIBRARY_PATH"]
+                                    if env.get("LD_LIBRARY_PATH") else "")
+    cmd = args.command + ["--json"]
+
+    if args.local:
+        try:
+            client = subprocess.run(cmd, env=env, stdout=subprocess.PIPE,
+                                    text=True, timeout=args.timeout)
+        except subprocess.TimeoutExpired:
+            print("error: trial timed out: %s" % " ".join(cmd),
+                  file=sys.stderr)
+            return 1
+
+        if client.returncode:
+            print("error: %s exited with %d" % (" ".join(cmd),
+                  client.returncode), file=sys.stderr)
+            return 1
+
+        out.write(client.stdout)
+        out.flush()
+        return 0
+
+    server = subprocess.Popen(cmd, env=env, stdout=subprocess.DEVNULL)
+    time.sleep(args.server_delay)
+    try:
+        client = subprocess.run(cmd + [args.host], env=env,
+                                stdout=subprocess.PIPE, text=True,
+                                timeout=args.timeout)
+        server.wait(timeout=args.timeout)
+    except subprocess.TimeoutExpired:
+        server.kill()
+        server.wait()
+        print("error: trial timed out: %s" % " ".join(cmd), file=sys.stderr)
+        return 1
+
+    if client.returncode or server.returncode:
+        print("error: %s exited with %d/%d" % (" ".join(cmd),
+              client.returncode, server.returncode), file=sys.stderr)
+        return 1
+
+    out.write(client.stdout)
+    out.flush()
+    return 0
+
+
+def run(args):
+    if args.command and args.command[0] == "--":
+        args.command = args.command[1:]
+    if not args.command:
+        print("error: no benchmark command given", file=sys.stderr)
+        return 2
+
+    os.makedirs(args.out, exist_ok=True)
+    args.baseline = os.path.join(args.out, "baseline.json")
+    args.test = os.path.join(args.out, "test.json")
+    builds = [("baseline", args.baseline_lib), ("test", args.test_lib)]
+
+    with open(args.baseline, "w") as base_fd, \
+            open(args.test, "w") as test_fd:
+        files = {"baseline": base_fd, "test": test_fd}
+        for trial in range(args.trials):
+            # alternate the order so that neither build always runs first
+            order = builds if trial % 2 == 0 else builds[::-1]
+            for label, lib in order:
+                print("trial %d/%d: %s" % (trial + 1, args.trials, label),
+                      file=sys.stderr)
+                if run_trial(args, lib, files[label]):
+                    return 2
+
+    return compare(args)
+
+
+def add_compare_args(parser):
+    parser.add_argument("--confidence", type=float, default=0.95,
+                        choices=sorted(T_TABLE.keys()),
+                        help="confidence level (default: 0.95)")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="smallest change in percent reported as a "
+                        "regression (default: 5)")
+    parser.add_argument("--metric", default="auto",
+                        choices=["auto", "latency", "bandwidth"],
+                        help="value to compare, auto picks bandwidth for "
+                        "*_bw tests (default: auto)")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawTextHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    cmp_parser = sub.add_parser("compare", help="compare two result files")
+    cmp_parser.add_argument("baseline", help="baseline results")
+    cmp_parser.add_argument("test", help="test results")
+    add_compare_args(cmp_parser)
+
+    run_parser = sub.add_parser("run", help="run trials against two builds "
+                                "and compare them")
+    run_parser.add_argument("--baseline-lib", required=True,
+                            help="directory with the baseline libfabric")
+    run_parser.add_argument("--test-lib", required=True,
+                            help="directory with the libfabric under test")
+    run_parser.add_argument("--trials", type=int, default=10,
+                            help="runs per build (default: 10)")
+    run_parser.add_argument("--out", default="perfcompare",
+                            help="directory for the results "
+                            "(default: perfcompare)")
+    run_parser.add_argument("--host", default="127.0.0.1",
+                            help="address the client connects to "
+                            "(default: 127.0.0.1)")
+    run_parser.add_argument("--local", action="store_true",
+                            help="run the benchmark as a single process, "
+                            "without a server")
+    run_parser.add_argument("--server-delay", type=float, default=1.0,
+                            help="seconds to wait for the server to start "
+                            "(default: 1)")
+    run_parser.add_argument("--timeout", type=float, default=600,
+                            help="seconds before a trial is abandoned "
+                            "(default: 600)")
+    add_compare_args(run_parser)
+    run_parser.add_argument("command", nargs=argparse.REMAINDER,
+                            help="benchmark command line, after --")
+
+    args = parser.parse_args()
+    return run(args) if args.cmd == "run" else compare(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
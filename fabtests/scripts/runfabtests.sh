@@ -164,6 +164,13 @@ short_tests=(
 	"fi_rma_bw -e rdm -o writedata -I 5 -U"
 	"fi_rdm_atomic -I 5 -o all"
 	"fi_rdm_atomic -I 5 -o all -U"
+	"fi_rdm_atomic_pingpong -I 5"
+	"fi_rdm_atomic_bw -I 5"
+	"fi_rdm_atomic_bw -I 5 -T 4"
+	"fi_rdm_matching -I 5"
+	"fi_rdm_matching -I 5 -U 100 -N 16 -G -T 4"
+	"fi_rdm_overlap -I 5 -W 4"
+	"fi_rdm_overlap -I 5 -W 4 -T 10"
 	"fi_rdm_cntr_pingpong -I 5"
 	"fi_multi_recv -e rdm -I 5"
 	"fi_multi_recv -e msg -I 5"
@@ -428,6 +428,8 @@ uint8_t ofi_lsb(uint64_t num);
 
 extern size_t ofi_universe_size;
 extern int ofi_av_remove_cleanup;
+extern size_t ofi_cq_progress_budget;
+extern size_t ofi_cq_progress_sweep;
 extern char *ofi_offload_coll_prov_name;
 extern int ofi_prefer_sysconfig;
 
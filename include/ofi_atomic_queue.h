@@ -86,6 +86,7 @@
  *     . if the entry is a no-op it will be released and another entry
  *       will be fetched off the queue.
  *  . Call _release() after reader is done with the entry
+ *  . Call _isempty() to check for a committed entry without reading it
  */
 
 #ifdef __cplusplus
@@ -185,6 +186,16 @@ static inline void name ## _release(struct name *aq,		\
 			      pos + aq->size,			\
 			      memory_order_release);		\
 }								\
+static inline bool name ## _isempty(struct name *aq)		\
+{								\
+	struct name ## _entry *ce;				\
+	int64_t pos;						\
+	pos = ofi_atomic_load_explicit64(&aq->read_pos,		\
+			memory_order_relaxed);			\
+	ce = &aq->entry[pos & aq->size_mask];			\
+	return ofi_atomic_load_explicit64(&ce->seq,		\
+			memory_order_acquire) != pos + 1;	\
+}								\
 static inline int name ## _head(struct name *aq,		\
 		entrytype **buf, int64_t *pos)			\
 {								\
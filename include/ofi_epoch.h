@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _OFI_EPOCH_H_
+#define _OFI_EPOCH_H_
+
+#include "config.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <ofi_atom.h>
+#include <ofi_list.h>
+#include <ofi_lock.h>
+#include <ofi_mb.h>
+#include <ofi_mem.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Epoch based reclamation
+ *
+ * Lets readers walk a shared structure without taking the lock that
+ * writers use to modify it.  Readers bracket each access with
+ * ofi_epoch_enter() / ofi_epoch_exit() on a record they registered with
+ * the epoch.  Writers unlink an object under their own lock, then hand it
+ * to ofi_epoch_retire() instead of freeing it.  The object is released
+ * once the global epoch has advanced twice, at which point no reader can
+ * still hold a reference to it.  The epoch advances when every reader is
+ * either outside a read section or has observed the current epoch.
+ *
+ * Records are single threaded: each reader thread needs its own.  Read
+ * sections may nest on the same record, but must not block on the writer
+ * side of the same epoch, since that prevents reclamation indefinitely.
+ *
+ * Deferred free callbacks run in whichever thread calls ofi_epoch_retire()
+ * or ofi_epoch_reclaim(), outside of any read section.  Writers that
+ * serialize on a lock must hold it around those calls if the callbacks
+ * touch state protected by it, e.g. a non thread safe ofi_bufpool.
+ */
+
+#define OFI_EPOCH_LIMBO_CNT	3
+#define OFI_EPOCH_RECLAIM_THRESHOLD 64
+
+struct ofi_epoch_defer;
+typedef void (*ofi_epoch_free_fn)(struct ofi_epoch_defer *defer);
+
+struct ofi_epoch_defer {
+	struct slist_entry	entry;
+	ofi_epoch_free_fn	free_fn;
+};
+
+struct ofi_epoch_record {
+	struct dlist_entry	entry;
+	/* (epoch << 1) | 1 while inside a read section, 0 outside */
+	ofi_atomic64_t		state;
+	int			nest;
+};
+
+struct ofi_epoch {
+	ofi_atomic64_t		global;
+	ofi_mutex_t		lock;
+	struct dlist_entry	records;
+	/* objects retired in epoch e are kept in limbo[e % 3] */
+	struct slist		limbo[OFI_EPOCH_LIMBO_CNT];
+	struct slist		buf_limbo[OFI_EPOCH_LIMBO_CNT];
+	size_t			limbo_cnt[OFI_EPOCH_LIMBO_CNT];
+};
+
+int ofi_epoch_init(struct ofi_epoch *epoch);
+/* Releases everything still retired; no reader may be active */
+void ofi_epoch_close(struct ofi_epoch *epoch);
+
+void ofi_epoch_register(struct ofi_epoch *epoch,
+			struct ofi_epoch_record *record);
+void ofi_epoch_deregister(struct ofi_epoch *epoch,
+			  struct ofi_epoch_record *record);
+
+void ofi_epoch_retire(struct ofi_epoch *epoch, struct ofi_epoch_defer *defer,
+		      ofi_epoch_free_fn free_fn);
+/* Retire a buffer allocated with ofi_buf_alloc() or ofi_ibuf_alloc() */
+void ofi_epoch_retire_buf(struct ofi_epoch *epoch, void *buf);
+
+/* Tries to advance the epoch and releases what became safe to free.
+ * Returns the number of objects still waiting.
+ */
+size_t ofi_epoch_reclaim(struct ofi_epoch *epoch);
+/* Waits until everything retired before the call has been released */
+void ofi_epoch_synchronize(struct ofi_epoch *epoch);
+
+static inline void ofi_epoch_enter(struct ofi_epoch *epoch,
+				   struct ofi_epoch_record *record)
+{
+	int64_t global;
+
+	if (record->nest++)
+		return;
+
+	global = ofi_atomic_load_explicit64(&epoch->global,
+					    memory_order_relaxed);
+	ofi_atomic_store_explicit64(&record->state, (global << 1) | 1,
+				    memory_order_relaxed);
+	/* order the state update before any read of the protected data */
+	ofi_mb();
+}
+
+static inline void ofi_epoch_exit(struct ofi_epoch *epoch,
+				  struct ofi_epoch_record *record)
+{
+	assert(record->nest > 0);
+	if (--record->nest)
+		return;
+
+	ofi_atomic_store_explicit64(&record->state, 0, memory_order_release);
+}
+
+/* Lets a long running reader that holds no references move to the
+ * current epoch without leaving its read section.
+ */
+static inline void ofi_epoch_quiescent(struct ofi_epoch *epoch,
+				       struct ofi_epoch_record *record)
+{
+	int nest = record->nest;
+
+	assert(nest > 0);
+	record->nest = 1;
+	ofi_epoch_exit(epoch, record);
+	ofi_epoch_enter(epoch, record);
+	record->nest = nest;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OFI_EPOCH_H_ */
@@ -108,8 +108,30 @@ struct hook_prov_ctx {
 	 * invoked. */
 	int 			(*ini_fid[HOOK_FI_CLASS_MAX])(struct fid *fid);
 	int 			(*fini_fid[HOOK_FI_CLASS_MAX])(struct fid *fid);
+	/*
+	 * Mask of HOOK_PASSTHRU() fid classes that the hooking provider never
+	 * observes.  Opening one of these returns the hooked provider's object
+	 * directly, so its data path runs without any hook indirection.  The
+	 * ini/fini calls are not invoked for pass-through objects.  Providers
+	 * are called through the fid they hand out, so this is done per fid
+	 * class rather than per op.  Only CQs and counters are supported.
+	 */
+	uint64_t		passthru;
 };
 
+#define HOOK_PASSTHRU(fclass)	(1ULL << (fclass))
+
+static inline int hook_is_passthru(const struct hook_prov_ctx *prov_ctx,
+				   size_t fclass)
+{
+	return fclass < HOOK_FI_CLASS_MAX &&
+	       (prov_ctx->passthru & HOOK_PASSTHRU(fclass));
+}
+
+/* Translates a fid bound to or polled with a hook object, which may be a
+ * pass-through object that belongs to the hooked provider. */
+struct fid *hook_bfid_to_hfid(struct hook_prov_ctx *prov_ctx, struct fid *bfid);
+
 /*
  * TODO
  * comment from GitHub PR #5052:
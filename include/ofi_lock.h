@@ -192,6 +192,11 @@ static inline int ofi_spin_held_op(ofi_spin_t *lock)
 	return ofi_spin_held(lock);
 }
 
+static inline int ofi_spin_trylock_op(ofi_spin_t *lock)
+{
+	return ofi_spin_trylock(lock);
+}
+
 #define ofi_mutex_t_ pthread_mutex_t
 #define ofi_mutex_init_(lock) pthread_mutex_init(lock, NULL)
 #define ofi_mutex_destroy_(lock) pthread_mutex_destroy(lock)
@@ -329,6 +334,17 @@ static inline int ofi_mutex_held_op(ofi_mutex_t *lock)
 	return ofi_mutex_held(lock);
 }
 
+static inline int ofi_mutex_trylock_op(ofi_mutex_t *lock)
+{
+	return ofi_mutex_trylock(lock);
+}
+
+static inline int ofi_mutex_trylock_noop(ofi_mutex_t *lock)
+{
+	ofi_mutex_lock_noop(lock);
+	return 0;
+}
+
 static inline void ofi_nolock_lock_op(void *nolock)
 {
 	(void) nolock;
@@ -339,6 +355,12 @@ static inline void ofi_nolock_unlock_op(void *nolock)
 	(void) nolock;
 }
 
+static inline int ofi_nolock_trylock_op(void *nolock)
+{
+	(void) nolock;
+	return 0;
+}
+
 /* No way to verify, so return true to pass all asserts.
  * User should provide their own checks higher-up.
  */
@@ -361,6 +383,7 @@ enum ofi_lock_type {
 
 typedef int  (*ofi_genlock_lockheld_t)(void *baselock);
 typedef void (*ofi_genlock_lockop_t)(void *baselock);
+typedef int  (*ofi_genlock_trylock_t)(void *baselock);
 
 struct ofi_genlock {
 	enum ofi_lock_type	lock_type;
@@ -373,6 +396,7 @@ struct ofi_genlock {
 	ofi_genlock_lockheld_t	held;
 	ofi_genlock_lockop_t	lock;
 	ofi_genlock_lockop_t	unlock;
+	ofi_genlock_trylock_t	trylock;
 };
 
 int ofi_genlock_init(struct ofi_genlock *lock,
@@ -394,6 +418,12 @@ static inline void ofi_genlock_unlock(struct ofi_genlock *lock)
 	lock->unlock(&lock->base);
 }
 
+/* Returns 0 if the lock was acquired */
+static inline int ofi_genlock_trylock(struct ofi_genlock *lock)
+{
+	return lock->trylock(&lock->base);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _OFI_TOPO_H_
+#define _OFI_TOPO_H_
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Hardware topology, read from /sys/devices/system/{cpu,node} the first
+ * time it is queried and cached afterwards.  NUMA nodes and L3 domains
+ * are returned as small integers; an L3 domain is identified by the
+ * lowest numbered CPU sharing that cache.  Queries return a negative
+ * value when the information is not available, which is always the case
+ * on platforms other than Linux.
+ */
+
+void ofi_topo_init(void);
+void ofi_topo_fini(void);
+
+int ofi_topo_cpu_cnt(void);
+int ofi_topo_node_cnt(void);
+int ofi_topo_cpu_node(int cpu);
+int ofi_topo_cpu_l3(int cpu);
+
+/* Placement of the calling thread at the time of the call */
+int ofi_topo_current_cpu(void);
+int ofi_topo_current_node(void);
+int ofi_topo_current_l3(void);
+
+/* NUMA node of a network or RDMA interface, e.g. "eth0" or "mlx5_0" */
+int ofi_topo_iface_node(const char *name);
+/* Index of the first interface on the caller's NUMA node, or else 0 */
+int ofi_topo_nearest_iface(const char * const *names, int cnt);
+
+/*
+ * CPU allocator for helper threads.  Returns the least used CPU of the
+ * given NUMA node (any node if node < 0, or if the node has no usable
+ * CPU) among those the process may run on, preferring higher numbered
+ * CPUs, which applications tend to use last.  Every successful
+ * allocation must be released with ofi_topo_free_cpu().
+ */
+int ofi_topo_alloc_cpu(int node);
+void ofi_topo_free_cpu(int cpu);
+/* Binds the calling thread to the given CPU */
+int ofi_topo_bind_cpu(int cpu);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OFI_TOPO_H_ */
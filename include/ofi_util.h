@@ -84,6 +84,11 @@ extern "C" {
 #define UTIL_FLAG_ERROR		(1ULL << 60)
 #define UTIL_FLAG_AUX		(1ULL << 61)
 
+/* EP reports pending work through ofi_ep_set_active() or a progress fd,
+ * so that ofi_cq_progress() may skip it while it is idle
+ */
+#define OFI_EP_PROGRESS_HINT	(1ULL << 59)
+
 /* Indicates that an EP has been bound to a counter */
 #define OFI_CNTR_ENABLED	(1ULL << 61)
 
@@ -215,6 +220,7 @@ struct util_domain {
 	enum fi_threading	threading;
 	enum fi_progress	data_progress;
 	enum fi_progress	control_progress;
+	struct util_progress	*progress;
 };
 
 int ofi_domain_init(struct fid_fabric *fabric_fid, const struct fi_info *info,
@@ -303,6 +309,7 @@ struct util_ep {
 	uint64_t		caps;
 	uint64_t		flags;
 	ofi_ep_progress_func	progress;
+	ofi_atomic32_t		active;
 	struct ofi_genlock	lock;
 
 	struct ofi_bitmask	*coll_cid_mask;
@@ -320,6 +327,26 @@ int ofi_endpoint_init(struct fid_domain *domain, const struct util_prov *util_pr
 
 int ofi_endpoint_close(struct util_ep *util_ep);
 
+/*
+ * Providers that can tell when an endpoint has work pending call
+ * ofi_ep_progress_hint() once at init time.  Work that arrives on an fd
+ * is reported by registering the fd with ofi_cq_add_progress_fd(), which
+ * lets a CQ read find the readable endpoints with a single poll.  Other
+ * work is reported with ofi_ep_set_active().  The active state is cleared
+ * before ep->progress is invoked, so progress must set it again if work
+ * remains outstanding that its fd does not report.
+ */
+static inline void ofi_ep_set_active(struct util_ep *ep)
+{
+	ofi_atomic_set32(&ep->active, 1);
+}
+
+static inline void ofi_ep_progress_hint(struct util_ep *ep)
+{
+	ep->flags |= OFI_EP_PROGRESS_HINT;
+	ofi_ep_set_active(ep);
+}
+
 static inline int
 ofi_ep_fid_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
 {
@@ -512,6 +539,9 @@ struct util_cq {
 	int			internal_wait;
 	ofi_atomic32_t		wakeup;
 	ofi_cq_progress_func	progress;
+	size_t			progress_cnt;
+	/* fds of hinted endpoints, polled to find the active ones */
+	ofi_epoll_t		progress_fds;
 
 	struct fid_peer_cq	*peer_cq;
 
@@ -533,6 +563,8 @@ int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
 int ofi_check_bind_cq_flags(struct util_ep *ep, struct util_cq *cq,
 			    uint64_t flags);
 void ofi_cq_progress(struct util_cq *cq);
+int ofi_cq_add_progress_fd(struct util_cq *cq, int fd, struct util_ep *ep);
+void ofi_cq_del_progress_fd(struct util_cq *cq, int fd);
 int ofi_cq_cleanup(struct util_cq *cq);
 int ofi_cq_control(struct fid *fid, int command, void *arg);
 
@@ -831,6 +863,84 @@ static inline void ofi_ep_peer_rx_cntr_incerr(struct util_ep *ep, uint8_t op)
 		cntr->peer_cntr->owner_ops->incerr(cntr->peer_cntr);
 }
 
+/*
+ * Progress service
+ *
+ * Runs one or more threads that drive progress for providers which only
+ * implement manual progress, so they can support FI_PROGRESS_AUTO.  Each
+ * registered object supplies a lock and a progress function that is
+ * invoked with that lock held.  Progress threads only trylock the object,
+ * backing off while an application thread is driving progress on it.
+ * Idle threads spin, then yield, then block on the registered wait fds
+ * and a doorbell.  Providers ring the doorbell with ofi_progress_signal()
+ * when they queue work that no wait fd reports, and return -FI_EAGAIN
+ * from wait_try while such work is outstanding.  A wait fd registered
+ * without wait_try only reports readiness; once it wakes the thread with
+ * nothing to progress, it is ignored until the doorbell rings.
+ */
+typedef int (*ofi_progress_func)(struct fid *fid);
+
+struct util_progress_entry {
+	struct dlist_entry	entry;
+	struct fid		*fid;
+	struct ofi_genlock	*lock;
+	ofi_progress_func	progress;
+	int			fd;
+	ofi_wait_try_func	wait_try;
+	void			*arg;
+	/* fd is in the poll set, and fired since the last progress pass */
+	bool			armed;
+	bool			woken;
+};
+
+struct util_progress;
+
+struct util_progress_thread {
+	struct util_progress	*progress;
+	pthread_t		thread;
+	ofi_mutex_t		lock;
+	struct dlist_entry	entry_list;
+	size_t			entry_cnt;
+	ofi_epoll_t		epoll;
+	struct fd_signal	signal;
+	bool			running;
+	/* CPU allocated from the topology service, or -1 */
+	int			cpu;
+};
+
+struct util_progress {
+	const struct fi_provider *prov;
+	struct util_progress_thread *threads;
+	size_t			thread_cnt;
+	bool			started;
+};
+
+struct ofi_progress_params {
+	size_t			thread_cnt;
+	size_t			spin_cnt;
+	size_t			yield_cnt;
+	int			timeout;
+	char			*affinity;
+};
+
+extern struct ofi_progress_params ofi_progress_params;
+
+void ofi_progress_init_params(void);
+int ofi_progress_init(struct util_progress *progress,
+		      const struct fi_provider *prov);
+void ofi_progress_close(struct util_progress *progress);
+int ofi_progress_start(struct util_progress *progress);
+void ofi_progress_stop(struct util_progress *progress);
+int ofi_progress_add(struct util_progress *progress, struct fid *fid,
+		     struct ofi_genlock *lock, ofi_progress_func func,
+		     int fd, ofi_wait_try_func wait_try, void *arg);
+void ofi_progress_del(struct util_progress *progress, struct fid *fid);
+void ofi_progress_signal(struct util_progress *progress);
+
+/* Started for domains opened with FI_PROGRESS_AUTO data progress */
+int ofi_domain_start_progress(struct util_domain *domain);
+void ofi_domain_stop_progress(struct util_domain *domain);
+
 /*
  * AV / addressing
  */
@@ -1043,6 +1153,16 @@ int fi_poll_create(struct fid_domain *domain, struct fi_poll_attr *attr,
 /*
  * EQ
  */
+
+/* Events with up to OFI_EQ_INLINE_SIZE bytes of data are stored in entries
+ * preallocated with the EQ.  Larger events, such as CM events carrying
+ * large connection data, and events written while all preallocated entries
+ * are queued are allocated individually.
+ */
+#define OFI_EQ_INLINE_SIZE	64
+#define OFI_EQ_DEF_PREALLOC	256
+#define OFI_EQ_MAX_PREALLOC	4096
+
 struct util_eq {
 	struct fid_eq		eq_fid;
 	struct util_fabric	*fabric;
@@ -1052,6 +1172,10 @@ struct util_eq {
 	const struct fi_provider *prov;
 
 	struct slist		list;
+	void			*event_buf;
+	struct slist		free_events;
+	/* events handed out by read_batch and not yet released */
+	struct slist		*batch;
 	/* This contains error data that are read by user and need to
 	 * be freed in subsequent fi_eq_readerr call against the EQ */
 	void			*saved_err_data;
@@ -1063,9 +1187,31 @@ struct util_event {
 	ssize_t			size;
 	int			event;
 	int			err;
+	/* set once a batched event was consumed or its fid was closed */
+	int			removed;
+	int			prealloc;
 	uint8_t			data[]; /* offset should be 8-byte aligned */
 };
 
+/* Lets a provider layered over another consume all queued, non-error events
+ * of the core EQ with a single lock acquisition, without copying them.
+ * read moves up to count events to the tail of batch and returns the number
+ * moved, -FI_EAVAIL if an error event is at the head of the EQ, or
+ * -FI_EAGAIN if it is empty or another batch is outstanding.  Events in the
+ * batch are util_event entries and remain owned by the EQ until passed to
+ * release.  Events whose fid is closed while they are in the batch are
+ * marked removed and must be skipped.  The caller marks each event removed
+ * before consuming it, so that closing a fid later in the batch does not
+ * match or release the data of events already handled.
+ */
+#define OFI_OPS_EQ_BATCH "ofix_eq_batch_v1"
+
+struct ofi_ops_eq_batch {
+	size_t	size;
+	ssize_t	(*read)(struct fid_eq *eq, struct slist *batch, size_t count);
+	void	(*release)(struct fid_eq *eq, struct slist *batch);
+};
+
 int ofi_eq_create(struct fid_fabric *fabric, struct fi_eq_attr *attr,
 		 struct fid_eq **eq_fid, void *context);
 int ofi_eq_init(struct fid_fabric *fabric_fid, struct fi_eq_attr *attr,
@@ -1082,6 +1228,11 @@ ssize_t ofi_eq_sread(struct fid_eq *eq_fid, uint32_t *event, void *buf,
 		     size_t len, int timeout, uint64_t flags);
 ssize_t ofi_eq_readerr(struct fid_eq *eq_fid, struct fi_eq_err_entry *buf,
 		       uint64_t flags);
+ssize_t ofi_eq_read_batch(struct fid_eq *eq_fid, struct slist *batch,
+			  size_t count);
+void ofi_eq_release_batch(struct fid_eq *eq_fid, struct slist *batch);
+int ofi_eq_ops_open(struct fid *fid, const char *name, uint64_t flags,
+		    void **ops, void *context);
 ssize_t ofi_eq_write(struct fid_eq *eq_fid, uint32_t event,
 		     const void *buf, size_t len, uint64_t flags);
 const char *ofi_eq_strerror(struct fid_eq *eq_fid, int prov_errno,
@@ -67,6 +67,10 @@
 #define COLL_TX_OP_FLAGS (0)
 #define COLL_RX_OP_FLAGS (0)
 
+/* tag = source rank << 32 | group ID << 16 | sequence number */
+#define COLL_TAG_RANK_SHIFT 32
+#define COLL_ID_GROUP_SHIFT 16
+
 enum {
 	COLL_RX_SIZE = 65536,
 	COLL_TX_SIZE = 16384,
@@ -33,13 +33,21 @@
 #include "coll.h"
 #include "ofi_coll.h"
 
+/*
+ * Every collective gets its own ID when it is issued: the group ID of the
+ * communicator combined with a per-communicator sequence number.  All
+ * members issue collectives on a communicator in the same order, so they
+ * agree on the ID without exchanging it.  Tags carry the ID together with
+ * the source rank, which lets any number of collectives on the same
+ * communicator be in flight at once with receives matched to the right one.
+ */
 static uint64_t coll_form_tag(uint32_t coll_id, uint32_t rank)
 {
 	uint64_t tag;
 	uint64_t src_rank = rank;
 
 	tag = coll_id;
-	tag |= (src_rank << 32);
+	tag |= (src_rank << COLL_TAG_RANK_SHIFT);
 
 	return tag;
 }
@@ -47,7 +55,7 @@ static uint64_t coll_form_tag(uint32_t coll_id, uint32_t rank)
 static uint32_t coll_get_next_id(struct util_coll_mc *coll_mc)
 {
 	uint32_t cid = coll_mc->group_id;
-	return cid << 16 | coll_mc->seq++;
+	return cid << COLL_ID_GROUP_SHIFT | coll_mc->seq++;
 }
 
 static struct util_coll_operation *
@@ -149,10 +157,14 @@ static void coll_log_work(struct util_coll_operation *coll_op)
 #endif
 }
 
+/*
+ * Queues every waiting item of the collective that is not held back by a
+ * fence.  Fences only order work within one collective; other collectives
+ * on the same endpoint progress independently.
+ */
 static void coll_progress_work(struct util_ep *util_ep,
 		   	       struct util_coll_operation *coll_op)
 {
-	struct util_coll_work_item *next_ready = NULL;
 	struct util_coll_work_item *cur_item = NULL;
 	struct util_coll_work_item *prev_item = NULL;
 	struct dlist_entry *tmp = NULL;
@@ -212,17 +224,12 @@ static void coll_progress_work(struct util_ep *util_ep,
 
 		FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
 		       "Ready item: %p \n", cur_item);
-		next_ready = cur_item;
-		break;
-	}
-
-	if (!next_ready)
-		return;
+		coll_log_work(coll_op);
 
-	coll_log_work(coll_op);
-
-	next_ready->state = UTIL_COLL_PROCESSING;
-	slist_insert_tail(&next_ready->ready_entry, &util_ep->coll_ready_queue);
+		cur_item->state = UTIL_COLL_PROCESSING;
+		slist_insert_tail(&cur_item->ready_entry,
+				  &util_ep->coll_ready_queue);
+	}
 }
 
 static void coll_bind_work(struct util_coll_operation *coll_op,
@@ -844,8 +851,11 @@ void coll_ep_progress(struct util_ep *util_ep)
 						 struct util_coll_xfer_item,
 						 hdr);
 			ret = coll_process_xfer_item(xfer_item);
-			if (ret)
+			if (ret && ret == -FI_EAGAIN) {
+				slist_insert_tail(&work_item->ready_entry,
+						  &util_ep->coll_ready_queue);
 				goto out;
+			}
 			break;
 
 		case UTIL_COLL_REDUCE:
@@ -446,6 +446,7 @@ struct hook_prov_ctx hook_dmabuf_peer_mem_ctx = {
 		.fabric = hook_dmabuf_peer_mem_fabric,
 		.cleanup = NULL,
 	},
+	.passthru = HOOK_PASSTHRU(FI_CLASS_CQ) | HOOK_PASSTHRU(FI_CLASS_CNTR),
 };
 
 HOOK_DMABUF_PEER_MEM_INI
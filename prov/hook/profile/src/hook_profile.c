@@ -873,6 +873,7 @@ struct hook_prov_ctx hook_profile_ctx = {
 		.fabric = hook_profile_fabric,
 		.cleanup = NULL,
 	},
+	.passthru = HOOK_PASSTHRU(FI_CLASS_CNTR),
 };
 
 
@@ -135,6 +135,14 @@ struct fid *hook_to_hfid(const struct fid *fid)
 	}
 }
 
+struct fid *hook_bfid_to_hfid(struct hook_prov_ctx *prov_ctx, struct fid *bfid)
+{
+	if (hook_is_passthru(prov_ctx, bfid->fclass))
+		return bfid;
+
+	return hook_to_hfid(bfid);
+}
+
 struct fid_wait *hook_to_hwait(const struct fid_wait *wait)
 {
 	return container_of(wait, struct hook_wait, wait)->hwait;
@@ -146,8 +154,11 @@ int hook_bind(struct fid *fid, struct fid *bfid, uint64_t flags)
 	struct fid *hfid, *hbfid;
 
 	hfid = hook_to_hfid(fid);
-	hbfid = hook_to_hfid(bfid);
-	if (!hfid || !hbfid)
+	if (!hfid)
+		return -FI_EINVAL;
+
+	hbfid = hook_bfid_to_hfid(hook_to_prov_ctx(fid), bfid);
+	if (!hbfid)
 		return -FI_EINVAL;
 
 	return hfid->ops->bind(hfid, hbfid, flags);
@@ -270,6 +281,7 @@ struct hook_prov_ctx hook_noop_ctx = {
 		.fabric = hook_noop_fabric,
 		.cleanup = NULL,
 	},
+	.passthru = HOOK_PASSTHRU(FI_CLASS_CQ) | HOOK_PASSTHRU(FI_CLASS_CNTR),
 };
 
 HOOK_NOOP_INI
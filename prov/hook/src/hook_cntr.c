@@ -102,6 +102,13 @@ int hook_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
 	struct fi_cntr_attr hattr;
 	int ret;
 
+	hattr = *attr;
+	if (attr->wait_obj == FI_WAIT_SET)
+		hattr.wait_set = hook_to_hwait(attr->wait_set);
+
+	if (hook_is_passthru(dom->fabric->prov_ctx, FI_CLASS_CNTR))
+		return fi_cntr_open(dom->hdomain, &hattr, cntr, context);
+
 	mycntr = calloc(1, sizeof *mycntr);
 	if (!mycntr)
 		return -FI_ENOMEM;
@@ -112,10 +119,6 @@ int hook_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
 	mycntr->cntr.fid.ops = &hook_fid_ops;
 	mycntr->cntr.ops = &hook_cntr_ops;
 
-	hattr = *attr;
-	if (attr->wait_obj == FI_WAIT_SET)
-		hattr.wait_set = hook_to_hwait(attr->wait_set);
-
 	ret = fi_cntr_open(dom->hdomain, &hattr, &mycntr->hcntr,
 			   &mycntr->cntr.fid);
 	if (ret)
@@ -132,9 +132,18 @@ int hook_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 		 struct fid_cq **cq, void *context)
 {
 	struct hook_domain *dom = container_of(domain, struct hook_domain, domain);
+	struct fi_cq_attr hattr;
 	struct hook_cq *mycq;
 	int ret;
 
+	if (hook_is_passthru(dom->fabric->prov_ctx, FI_CLASS_CQ)) {
+		hattr = *attr;
+		if (attr->wait_obj == FI_WAIT_SET)
+			hattr.wait_set = hook_to_hwait(attr->wait_set);
+
+		return fi_cq_open(dom->hdomain, &hattr, cq, context);
+	}
+
 	mycq = calloc(1, sizeof *mycq);
 	if (!mycq)
 		return -FI_ENOMEM;
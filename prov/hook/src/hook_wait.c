@@ -54,7 +54,9 @@ static int hook_poll_add(struct fid_poll *pollset, struct fid *event_fid,
 {
 	struct hook_poll *poll = container_of(pollset, struct hook_poll, poll);
 
-	return ofi_poll_add(poll->hpoll, hook_to_hfid(event_fid), flags);
+	return ofi_poll_add(poll->hpoll,
+			    hook_bfid_to_hfid(poll->domain->fabric->prov_ctx,
+					      event_fid), flags);
 }
 
 static int hook_poll_del(struct fid_poll *pollset, struct fid *event_fid,
@@ -62,7 +64,9 @@ static int hook_poll_del(struct fid_poll *pollset, struct fid *event_fid,
 {
 	struct hook_poll *poll = container_of(pollset, struct hook_poll, poll);
 
-	return ofi_poll_del(poll->hpoll, hook_to_hfid(event_fid), flags);
+	return ofi_poll_del(poll->hpoll,
+			    hook_bfid_to_hfid(poll->domain->fabric->prov_ctx,
+					      event_fid), flags);
 }
 
 static struct fi_ops_poll hook_poll_ops = {
@@ -105,7 +109,7 @@ int hook_trywait(struct fid_fabric *fabric, struct fid **fids, int count)
 	int i, ret;
 
 	for (i = 0; i < count; i++) {
-		hfid = hook_to_hfid(fids[i]);
+		hfid = hook_bfid_to_hfid(fab->prov_ctx, fids[i]);
 		if (!hfid)
 			return -FI_EINVAL;
 
@@ -82,6 +82,7 @@ int psm3_diags(void)
 	int ret = 0;
 	ret |= psmi_test_epid_table(2048);
 	ret |= psmi_test_memcpy((memcpy_fn_t) psm3_memcpyo, "psm3_memcpyo");
+	ret |= psm3_ips_crc_diags();
 	/* ret |= psmi_test_memcpy((memcpy_fn_t) psm3_mq_mtucpy, "psm3_mq_mtucpy"); */
 
 	if (ret)
@@ -489,6 +489,7 @@ extern uint32_t psm3_cpu_model;
  * Diagnostics, all in psm_diags.c
  */
 int psm3_diags(void);
+int psm3_ips_crc_diags(void);	/* ptl_ips/ips_crc32.c */
 
 /*
  * Multiple Endpoints
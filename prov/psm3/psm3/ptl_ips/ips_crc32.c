@@ -42,16 +42,27 @@
  * factor of two increase in speed on a Power PC G4 (PPC7455) using gcc -O3.
  */
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 #include "psm_user.h"
 #include "psm2_hal.h"
 #include "ips_proto.h"
 #include "ips_proto_internal.h"
 
-/* Table of CRCs of all 8-bit messages. */
-static uint32_t crc_table[256];
+/* Table of CRCs of all 8-bit messages, followed by the tables for
+ * advancing a CRC over 1..7 more zero bytes (slicing-by-8).
+ */
+static uint32_t crc_table[8][256];
+
+typedef uint32_t (*crc_calculate_fn_t)(uint32_t len, const uint8_t *data,
+					uint32_t crc);
 
-/* Flag: has the table been computed? Initially false. */
-static int crc_table_computed;
+static uint32_t crc_calculate_init(uint32_t len, const uint8_t *data,
+				   uint32_t crc);
+
+/* Selected implementation, chosen on first use */
+static crc_calculate_fn_t crc_calculate = crc_calculate_init;
 
 /* Make the table for a fast CRC. */
 static void make_crc_table(void)
@@ -67,9 +78,15 @@ static void make_crc_table(void)
 			else
 				c = c >> 1;
 		}
-		crc_table[n] = c;
+		crc_table[0][n] = c;
+	}
+	for (n = 0; n < 256; n++) {
+		c = crc_table[0][n];
+		for (k = 1; k < 8; k++) {
+			c = crc_table[0][c & 0xff] ^ (c >> 8);
+			crc_table[k][n] = c;
+		}
 	}
-	crc_table_computed = 1;
 }
 
 /* Update a running CRC with the bytes buf[0..len-1]--the CRC
@@ -78,21 +95,184 @@ static void make_crc_table(void)
  * crc() routine below)).
  */
 
-static uint32_t psm3_ips_crc_calculate(uint32_t len, uint8_t *data,
-					uint32_t crc)
+static uint32_t crc_calculate_bytewise(uint32_t len, const uint8_t *data,
+				       uint32_t crc)
 {
 	uint32_t c = crc;
 	uint32_t n;
 
-	if (!crc_table_computed) {
-		make_crc_table();
-	}
 	for (n = 0; n < len; n++) {
-		c = crc_table[(c ^ data[n]) & 0xff] ^ (c >> 8);
+		c = crc_table[0][(c ^ data[n]) & 0xff] ^ (c >> 8);
 	}
 	return c;
 }
 
+/* Same as above, 8 bytes per step with one table lookup per byte */
+static uint32_t crc_calculate_slice8(uint32_t len, const uint8_t *data,
+				     uint32_t crc)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	uint32_t c = crc;
+	uint64_t w;
+
+	while (len && ((uintptr_t) data & 7)) {
+		c = crc_table[0][(c ^ *data++) & 0xff] ^ (c >> 8);
+		len--;
+	}
+	while (len >= 8) {
+		w = *(const uint64_t *) data ^ c;
+		c = crc_table[7][w & 0xff] ^
+		    crc_table[6][(w >> 8) & 0xff] ^
+		    crc_table[5][(w >> 16) & 0xff] ^
+		    crc_table[4][(w >> 24) & 0xff] ^
+		    crc_table[3][(w >> 32) & 0xff] ^
+		    crc_table[2][(w >> 40) & 0xff] ^
+		    crc_table[1][(w >> 48) & 0xff] ^
+		    crc_table[0][w >> 56];
+		data += 8;
+		len -= 8;
+	}
+	return crc_calculate_bytewise(len, data, c);
+#else
+	return crc_calculate_bytewise(len, data, crc);
+#endif
+}
+
+#if defined(__x86_64__)
+/* Fold 64 then 16 bytes at a time with carry-less multiplies and
+ * Barrett-reduce the remaining 128 bits, as described in Intel's
+ * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+ * Instruction".  The constants are the bit-reflected ones for the
+ * 0xedb88320 polynomial given at the end of that paper.
+ */
+__attribute__((target("sse4.1,pclmul")))
+static uint32_t crc_calculate_pclmul(uint32_t len, const uint8_t *data,
+				     uint32_t crc)
+{
+	static const uint64_t k1k2[2] __attribute__((aligned(16))) =
+		{ 0x0154442bd4ULL, 0x01c6e41596ULL };
+	static const uint64_t k3k4[2] __attribute__((aligned(16))) =
+		{ 0x01751997d0ULL, 0x00ccaa009eULL };
+	static const uint64_t k5k0[2] __attribute__((aligned(16))) =
+		{ 0x0163cd6124ULL, 0x0000000000ULL };
+	static const uint64_t poly[2] __attribute__((aligned(16))) =
+		{ 0x01db710641ULL, 0x01f7011641ULL };
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	if (len < 64)
+		return crc_calculate_slice8(len, data, crc);
+
+	x1 = _mm_loadu_si128((const __m128i *) (data + 0x00));
+	x2 = _mm_loadu_si128((const __m128i *) (data + 0x10));
+	x3 = _mm_loadu_si128((const __m128i *) (data + 0x20));
+	x4 = _mm_loadu_si128((const __m128i *) (data + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int) crc));
+	x0 = _mm_load_si128((const __m128i *) k1k2);
+	data += 64;
+	len -= 64;
+
+	while (len >= 64) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+			_mm_loadu_si128((const __m128i *) (data + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+			_mm_loadu_si128((const __m128i *) (data + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+			_mm_loadu_si128((const __m128i *) (data + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+			_mm_loadu_si128((const __m128i *) (data + 0x30)));
+		data += 64;
+		len -= 64;
+	}
+
+	/* fold the four lanes into one */
+	x0 = _mm_load_si128((const __m128i *) k3k4);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	while (len >= 16) {
+		x2 = _mm_loadu_si128((const __m128i *) data);
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+		data += 16;
+		len -= 16;
+	}
+
+	/* fold 128 bits to 64 bits */
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x0 = _mm_loadl_epi64((const __m128i *) k5k0);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	/* Barrett reduction to 32 bits */
+	x0 = _mm_load_si128((const __m128i *) poly);
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return crc_calculate_slice8(len, data, (uint32_t) _mm_extract_epi32(x1, 1));
+}
+
+static int crc_have_pclmul(void)
+{
+	return __builtin_cpu_supports("pclmul") &&
+		__builtin_cpu_supports("sse4.1");
+}
+#endif /* __x86_64__ */
+
+static const struct {
+	const char *name;
+	crc_calculate_fn_t fn;
+	int (*supported)(void);
+} crc_impls[] = {
+	/* in order of preference */
+#if defined(__x86_64__)
+	{ "pclmul", crc_calculate_pclmul, crc_have_pclmul },
+#endif
+	{ "slice8", crc_calculate_slice8, NULL },
+	{ "bytewise", crc_calculate_bytewise, NULL },
+};
+
+static uint32_t crc_calculate_init(uint32_t len, const uint8_t *data,
+				   uint32_t crc)
+{
+	int i;
+
+	make_crc_table();
+	for (i = 0; crc_impls[i].supported && !crc_impls[i].supported(); i++)
+		;
+	_HFI_DBG("Using %s CRC32 for packet checksums\n", crc_impls[i].name);
+	crc_calculate = crc_impls[i].fn;
+	return crc_calculate(len, data, crc);
+}
+
+static uint32_t psm3_ips_crc_calculate(uint32_t len, uint8_t *data,
+					uint32_t crc)
+{
+	return crc_calculate(len, data, crc);
+}
+
 // calculate checksum for a PSM packet, including header and payload and
 // any padding words
 uint32_t psm3_ips_cksum_calculate(struct ips_message_header *p_hdr,
@@ -111,3 +291,78 @@ uint32_t psm3_ips_cksum_calculate(struct ips_message_header *p_hdr,
 	}
 	return cksum;
 }
+
+/*
+ * Check every supported implementation against the bytewise one for all
+ * lengths up to 1k at every alignment, then report the throughput of each
+ * over a range of packet sizes.  Run from psm3_diags().
+ */
+#define CRC_DIAGS_MAX_LEN	1024
+#define CRC_DIAGS_BENCH_BYTES	(256 * 1024 * 1024)
+
+int psm3_ips_crc_diags(void)
+{
+	static const uint32_t bench_sizes[] = { 64, 1024, 8192, 65536 };
+	uint8_t *buf;
+	uint64_t start, nsecs;
+	uint32_t len, align, crc, ref, iter, niters;
+	int i, j, ret = 0;
+
+	buf = psmi_malloc(PSMI_EP_NONE, UNDEFINED, 65536 + 16);
+	if (!buf)
+		return 1;
+
+	make_crc_table();
+	for (len = 0; len < 65536 + 16; len++)
+		buf[len] = (uint8_t) (len * 131 + (len >> 8));
+
+	/* the standard CRC-32 check value */
+	if (~crc_calculate_bytewise(9, (const uint8_t *) "123456789",
+				    0xffffffff) != 0xcbf43926) {
+		_HFI_ERROR("bytewise CRC32 check value mismatch\n");
+		ret = 1;
+	}
+
+	for (i = 0; i < PSMI_HOWMANY(crc_impls); i++) {
+		if (crc_impls[i].supported && !crc_impls[i].supported()) {
+			_HFI_INFO("CRC32 %s: not supported\n",
+				  crc_impls[i].name);
+			continue;
+		}
+
+		for (len = 0; len <= CRC_DIAGS_MAX_LEN; len++) {
+			for (align = 0; align < 16; align++) {
+				ref = crc_calculate_bytewise(len, buf + align,
+							     0xffffffff);
+				crc = crc_impls[i].fn(len, buf + align,
+						      0xffffffff);
+				if (crc != ref) {
+					_HFI_ERROR("CRC32 %s: len %u align %u: "
+						   "got 0x%08x instead of 0x%08x\n",
+						   crc_impls[i].name, len, align,
+						   crc, ref);
+					ret = 1;
+				}
+			}
+		}
+
+		for (j = 0; j < PSMI_HOWMANY(bench_sizes); j++) {
+			niters = CRC_DIAGS_BENCH_BYTES / bench_sizes[j];
+			if (crc_impls[i].fn == crc_calculate_bytewise)
+				niters /= 8;
+			crc = 0xffffffff;
+			start = get_cycles();
+			for (iter = 0; iter < niters; iter++)
+				crc = crc_impls[i].fn(bench_sizes[j], buf, crc);
+			nsecs = cycles_to_nanosecs(get_cycles() - start);
+			_HFI_INFO("CRC32 %s: %u bytes: %.2f MB/s (0x%08x)\n",
+				  crc_impls[i].name, bench_sizes[j],
+				  nsecs ? (double) niters * bench_sizes[j] *
+					  1000.0 / nsecs : 0.0, crc);
+		}
+	}
+
+	psmi_free(buf);
+	_HFI_INFO("%s: %s\n", __func__, ret ? "FAILED" : "PASSED");
+	return ret;
+}
@@ -58,6 +58,8 @@ static int rxd_domain_close(fid_t fid)
 
 	rxd_domain = container_of(fid, struct rxd_domain, util_domain.domain_fid.fid);
 
+	ofi_domain_stop_progress(&rxd_domain->util_domain);
+
 	ret = fi_close(&rxd_domain->dg_domain->fid);
 	if (ret)
 		return ret;
@@ -148,12 +150,20 @@ int rxd_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 	if (ret)
 		goto err4;
 
+	if (info->domain_attr->data_progress == FI_PROGRESS_AUTO) {
+		ret = ofi_domain_start_progress(&rxd_domain->util_domain);
+		if (ret)
+			goto err5;
+	}
+
 	*domain = &rxd_domain->util_domain.domain_fid;
 	(*domain)->fid.ops = &rxd_domain_fi_ops;
 	(*domain)->ops = &rxd_domain_ops;
 	(*domain)->mr = &rxd_mr_ops;
 	fi_freeinfo(dg_info);
 	return 0;
+err5:
+	ofi_mr_map_close(&rxd_domain->mr_map);
 err4:
 	if (ofi_domain_close(&rxd_domain->util_domain))
 		FI_WARN(&rxd_prov, FI_LOG_DOMAIN,
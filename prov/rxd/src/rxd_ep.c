@@ -656,6 +656,13 @@ static void rxd_cleanup_unexp_msg_list(struct dlist_entry *list)
 	}
 }
 
+static int rxd_ep_auto_progress(struct fid *fid);
+
+static struct util_progress *rxd_ep_progress_svc(struct rxd_ep *ep)
+{
+	return ep->util_ep.domain->progress;
+}
+
 static int rxd_ep_close(struct fid *fid)
 {
 	int ret;
@@ -666,6 +673,10 @@ static int rxd_ep_close(struct fid *fid)
 
 	ep = container_of(fid, struct rxd_ep, util_ep.ep_fid.fid);
 
+	if (rxd_ep_progress_svc(ep))
+		ofi_progress_del(rxd_ep_progress_svc(ep),
+				 &ep->util_ep.ep_fid.fid);
+
 	dlist_foreach_container(&ep->active_peers, struct rxd_peer, peer, entry)
 		rxd_close_peer(ep, peer);
 	dlist_foreach_container(&ep->rts_sent_list, struct rxd_peer, peer, entry)
@@ -734,7 +745,7 @@ static int rxd_dg_cq_open(struct rxd_ep *rxd_ep, enum fi_wait_obj wait_obj)
 	if (ret)
 		return ret;
 
-	if (wait_obj == FI_WAIT_FD && (!rxd_ep->dg_cq_fd)) {
+	if (wait_obj == FI_WAIT_FD && rxd_ep->dg_cq_fd < 0) {
 		ret = fi_control(&rxd_ep->dg_cq->fid, FI_GETWAIT,
 				 &rxd_ep->dg_cq_fd);
 		if (ret) {
@@ -779,7 +790,9 @@ static int rxd_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
 			return ret;
 
 		if (!ep->dg_cq) {
-			ret = rxd_dg_cq_open(ep, cq->wait ? FI_WAIT_FD : FI_WAIT_NONE);
+			ret = rxd_dg_cq_open(ep, cq->wait ||
+					     rxd_ep_progress_svc(ep) ?
+					     FI_WAIT_FD : FI_WAIT_NONE);
 			if (ret)
 				return ret;
 		}
@@ -799,8 +812,10 @@ static int rxd_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
 			return ret;
 
 		if (!ep->dg_cq) {
-			ret = rxd_dg_cq_open(ep, cntr->wait ? FI_WAIT_FD : FI_WAIT_NONE);
-		} else if (!ep->dg_cq_fd && cntr->wait) {
+			ret = rxd_dg_cq_open(ep, cntr->wait ||
+					     rxd_ep_progress_svc(ep) ?
+					     FI_WAIT_FD : FI_WAIT_NONE);
+		} else if (ep->dg_cq_fd < 0 && cntr->wait) {
 			/* Reopen CQ with WAIT fd set */
 			ret = fi_close(&ep->dg_cq->fid);
 			if (ret) {
@@ -839,6 +854,13 @@ static int rxd_ep_control(struct fid *fid, int command, void *arg)
 	case FI_ENABLE:
 		ep = container_of(fid, struct rxd_ep, util_ep.ep_fid.fid);
 		ret = rxd_ep_enable(ep);
+		if (!ret && rxd_ep_progress_svc(ep))
+			ret = ofi_progress_add(rxd_ep_progress_svc(ep),
+					       &ep->util_ep.ep_fid.fid,
+					       &ep->util_ep.lock,
+					       rxd_ep_auto_progress,
+					       ep->dg_cq_fd,
+					       rxd_ep_trywait, ep);
 		break;
 	default:
 		ret = -FI_ENOSYS;
@@ -946,18 +968,15 @@ static void rxd_progress_pkt_list(struct rxd_ep *ep, struct rxd_peer *peer)
 				 MIN(ep->next_retry, peer->retry_cnt);
 }
 
-void rxd_ep_progress(struct util_ep *util_ep)
+static int rxd_ep_progress_locked(struct rxd_ep *ep)
 {
 	struct rxd_peer *peer;
 	struct fi_cq_msg_entry cq_entry;
 	struct dlist_entry *tmp;
-	struct rxd_ep *ep;
 	ssize_t ret;
 	int i;
 
-	ep = container_of(util_ep, struct rxd_ep, util_ep);
-
-	ofi_genlock_lock(&ep->util_ep.lock);
+	assert(ofi_genlock_held(&ep->util_ep.lock));
 	for(ret = 1, i = 0;
 	    ret > 0 && (!rxd_env.spin_count || i < rxd_env.spin_count);
 	    i++) {
@@ -992,9 +1011,29 @@ void rxd_ep_progress(struct util_ep *util_ep)
 	}
 
 out:
+	return i;
+}
+
+void rxd_ep_progress(struct util_ep *util_ep)
+{
+	struct rxd_ep *ep;
+
+	ep = container_of(util_ep, struct rxd_ep, util_ep);
+
+	ofi_genlock_lock(&ep->util_ep.lock);
+	(void) rxd_ep_progress_locked(ep);
 	ofi_genlock_unlock(&ep->util_ep.lock);
 }
 
+/* Called by the domain progress thread with the endpoint lock held */
+static int rxd_ep_auto_progress(struct fid *fid)
+{
+	struct rxd_ep *ep;
+
+	ep = container_of(fid, struct rxd_ep, util_ep.ep_fid.fid);
+	return rxd_ep_progress_locked(ep);
+}
+
 static int rxd_buf_region_alloc_fn(struct ofi_bufpool_region *region)
 {
 	struct rxd_buf_pool *pool = region->pool->attr.context;
@@ -1192,6 +1231,7 @@ int rxd_endpoint(struct fid_domain *domain, struct fi_info *info,
 	if (!rxd_ep)
 		return -FI_ENOMEM;
 
+	rxd_ep->dg_cq_fd = -1;
 	rxd_domain = container_of(domain, struct rxd_domain,
 				  util_domain.domain_fid);
 
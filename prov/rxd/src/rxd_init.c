@@ -104,6 +104,8 @@ int rxd_info_to_rxd(uint32_t version, const struct fi_info *core_info,
 	*info->rx_attr = *rxd_info.rx_attr;
 	*info->ep_attr = *rxd_info.ep_attr;
 	*info->domain_attr = *rxd_info.domain_attr;
+	/* Auto progress runs a progress thread and must be requested */
+	info->domain_attr->data_progress = FI_PROGRESS_MANUAL;
 	info->domain_attr->caps = ofi_pick_core_flags(rxd_info.domain_attr->caps,
 						core_info->domain_attr->caps,
 						FI_LOCAL_COMM | FI_REMOTE_COMM);
@@ -119,8 +121,20 @@ static int rxd_getinfo(uint32_t version, const char *node, const char *service,
 			uint64_t flags, const struct fi_info *hints,
 			struct fi_info **info)
 {
-	return ofix_getinfo(version, node, service, flags, &rxd_util_prov,
-			    hints, rxd_info_to_core, rxd_info_to_rxd, info);
+	struct fi_info *cur;
+	int ret;
+
+	ret = ofix_getinfo(version, node, service, flags, &rxd_util_prov,
+			   hints, rxd_info_to_core, rxd_info_to_rxd, info);
+	if (ret)
+		return ret;
+
+	/* The progress thread shares the endpoints with the app */
+	for (cur = *info; cur; cur = cur->next) {
+		if (cur->domain_attr->data_progress == FI_PROGRESS_AUTO)
+			cur->domain_attr->threading = FI_THREAD_SAFE;
+	}
+	return 0;
 }
 
 static void rxd_fini(void)
@@ -85,7 +85,7 @@ union rxm_cm_data {
 		uint8_t op_version;
 		uint16_t port;
 		uint8_t flow_ctrl;
-		uint8_t padding;
+		uint8_t eager_ring;
 		uint32_t eager_limit;
 		uint32_t rx_size; /* used? */
 		uint64_t client_conn_id;
@@ -95,7 +95,8 @@ union rxm_cm_data {
 		uint64_t server_conn_id;
 		uint32_t rx_size; /* used? */
 		uint8_t flow_ctrl;
-		uint8_t align_pad[3];
+		uint8_t eager_ring;
+		uint8_t align_pad[2];
 	} accept;
 
 	struct _reject {
@@ -121,6 +122,9 @@ static inline uint32_t rxm_peer_pid(uint64_t conn_id)
 
 extern size_t rxm_buffer_size;
 extern size_t rxm_packet_size;
+extern size_t rxm_atomic_batch_size;
+extern size_t rxm_eager_ring_size;
+extern size_t rxm_eager_ring_msg_size;
 
 #define RXM_SAR_TX_ERROR	UINT64_MAX
 #define RXM_SAR_RX_INIT		UINT64_MAX
@@ -196,6 +200,7 @@ enum {
 	RXM_MSG_SRX_SIZE = 4096,
 	RXM_RX_SIZE = 65536,
 	RXM_TX_SIZE = 16384,
+	RXM_CM_BATCH_SIZE = 64,
 };
 
 extern size_t rxm_msg_tx_size;
@@ -223,6 +228,41 @@ enum {
 	RXM_CONN_INDEXED = BIT(0),
 };
 
+/* Ring exposed to the peer of a connection for small eager messages.  The
+ * peer RMA writes each message into the next slot, passing the connection
+ * index and slot sequence number as remote CQ data.  Slots are released in
+ * order, and the release count is returned to the peer in the messages we
+ * write into its ring, or in a rxm_ctrl_ring_credit message.
+ */
+struct rxm_eager_ring {
+	char *buf;
+	struct fid_mr *mr;
+	uint32_t slot_cnt;
+	uint32_t slot_size;
+	uint32_t released;
+	uint32_t credited;
+
+	/* Writes that completed while no rx buffer was available.  Their
+	 * slots, and any later messages from the peer, are held until
+	 * progress can deliver them in order.
+	 */
+	struct rxm_conn *conn;
+	uint32_t pending;
+	struct dlist_entry pending_entry;
+	struct dlist_entry deferred_list;
+};
+
+/* Peer's ring, as described by its rxm_ctrl_ring_setup message */
+struct rxm_eager_ring_peer {
+	uint64_t addr;
+	uint64_t key;
+	/* 0 until the peer has exposed a ring */
+	uint32_t slot_cnt;
+	uint32_t slot_size;
+	uint32_t tail;
+	uint32_t released;
+};
+
 /* Each local rxm ep will have at most 1 connection to a single
  * remote rxm ep.  A local rxm ep may not be connected to all
  * remote rxm ep's.
@@ -243,12 +283,19 @@ struct rxm_conn {
 	uint8_t flags;
 	uint8_t flow_ctrl;
 	uint8_t peer_flow_ctrl;
+	uint8_t peer_eager_ring;
+
+	struct rxm_eager_ring *rx_ring;
+	struct rxm_eager_ring_peer tx_ring;
 
 	struct dlist_entry deferred_entry;
 	struct dlist_entry deferred_tx_queue;
 	struct dlist_entry deferred_sar_msgs;
 	struct dlist_entry deferred_sar_segments;
 	struct dlist_entry loopback_entry;
+
+	/* Atomic requests posted with FI_MORE, not yet sent */
+	struct rxm_tx_buf *atomic_batch;
 };
 
 void rxm_freeall_conns(struct rxm_ep *ep);
@@ -351,6 +398,22 @@ struct rxm_atomic_resp_hdr {
 	char data[];
 };
 
+/* A rxm_ctrl_atomic_batch request carries a sequence of entries, each
+ * padded to 8 bytes, which the target executes in order.  The response
+ * carries one rxm_atomic_resp_hdr per entry, also padded to 8 bytes.
+ */
+struct rxm_atomic_batch_entry {
+	uint8_t op;
+	uint8_t atomic_op;
+	uint8_t datatype;
+	uint8_t resv;
+	uint32_t len;
+	struct fi_rma_ioc rma_ioc;
+	char data[];
+};
+
+#define RXM_ATOMIC_BATCH_ALIGN 8
+
 /*
  * Macros to generate enums and associated string values
  * e.g.
@@ -408,7 +471,10 @@ enum {
 	rxm_ctrl_atomic_resp,
 	rxm_ctrl_credit,
 	rxm_ctrl_rndv_wr_data,
-	rxm_ctrl_rndv_wr_done
+	rxm_ctrl_rndv_wr_done,
+	rxm_ctrl_atomic_batch,
+	rxm_ctrl_ring_setup,
+	rxm_ctrl_ring_credit
 };
 
 struct rxm_pkt {
@@ -482,6 +548,9 @@ struct rxm_rx_buf {
 	uint64_t comp_flags;
 	struct fi_recv_context recv_context;
 	bool repost;
+	/* Payload is read in place from conn->rx_ring slot ring_seq */
+	bool ring;
+	uint32_t ring_seq;
 
 	/* Used for large messages */
 	struct dlist_entry rndv_wait_entry;
@@ -509,6 +578,12 @@ struct rxm_tx_buf {
 			uint8_t count;
 		} rma;
 		struct rxm_iov atomic_result;
+		struct {
+			struct dlist_entry ops;
+			struct dlist_entry entry;
+			struct rxm_conn *conn;
+			uint32_t cnt;
+		} atomic_batch;
 	};
 
 	struct {
@@ -525,6 +600,15 @@ struct rxm_tx_buf {
 	struct rxm_pkt pkt;
 };
 
+/* Tracks one application atomic carried in a batch */
+struct rxm_atomic_op {
+	struct dlist_entry entry;
+	void *app_context;
+	uint64_t flags;
+	uint8_t op;
+	struct rxm_iov result;
+};
+
 struct rxm_coll_buf {
 	/* Must stay at top */
 	struct rxm_buf hdr;
@@ -678,9 +762,10 @@ struct rxm_ep {
 	struct dlist_entry	loopback_list;
 	union ofi_sock_ip	addr;
 
-	pthread_t		cm_thread;
 	struct fid_pep 		*msg_pep;
 	struct fid_eq 		*msg_eq;
+	/* NULL if the core EQ does not support batched reads */
+	struct ofi_ops_eq_batch	*msg_eq_batch;
 	struct fid_ep 		*msg_srx;
 	struct fid_ep		*util_coll_ep;
 	struct fid_ep		*offload_coll_ep;
@@ -698,8 +783,10 @@ struct rxm_ep {
 
 	bool			msg_mr_local;
 	bool			rdm_mr_local;
-	bool			do_progress;
 	bool			enable_direct_send;
+	/* Peers may use eager rings, and whether we expose one to them */
+	bool			eager_ring;
+	bool			expose_eager_ring;
 
 	size_t			min_multi_recv_size;
 	size_t			buffered_min;
@@ -711,6 +798,7 @@ struct rxm_ep {
 	size_t			tx_credit;
 
 	struct ofi_bufpool	*rx_pool;
+	struct dlist_entry	ring_pending_list;
 	struct ofi_bufpool	*tx_pool;
 	struct ofi_bufpool	*coll_pool;
 	struct rxm_pkt		*inject_pkt;
@@ -722,13 +810,15 @@ struct rxm_ep {
 	struct rxm_recv_queue	trecv_queue;
 	struct ofi_bufpool	*multi_recv_pool;
 
+	struct ofi_bufpool	*atomic_op_pool;
+	struct dlist_entry	atomic_batch_list;
+
 	struct rxm_eager_ops	*eager_ops;
 	struct rxm_rndv_ops	*rndv_ops;
 };
 
 int rxm_start_listen(struct rxm_ep *ep);
-void rxm_stop_listen(struct rxm_ep *ep);
-void rxm_conn_progress(struct rxm_ep *ep);
+int rxm_conn_progress(struct rxm_ep *ep);
 
 
 extern struct fi_provider rxm_prov;
@@ -777,6 +867,34 @@ void rxm_finish_coll_eager_send(struct rxm_ep *rxm_ep,
 				struct rxm_tx_buf *tx_eager_buf);
 
 int rxm_prepost_recv(struct rxm_ep *rxm_ep, struct fid_ep *rx_ep);
+ssize_t rxm_atomic_batch_flush(struct rxm_conn *conn);
+void rxm_atomic_batch_flush_all(struct rxm_ep *ep);
+void rxm_atomic_batch_complete(struct rxm_ep *ep, struct rxm_tx_buf *tx_buf,
+			       struct rxm_rx_buf *rx_buf, int err);
+
+void rxm_eager_ring_init(struct rxm_ep *ep);
+void rxm_eager_ring_open(struct rxm_conn *conn);
+void rxm_eager_ring_close(struct rxm_conn *conn);
+ssize_t rxm_eager_ring_write(struct rxm_conn *conn, struct rxm_pkt *pkt,
+			     size_t pkt_size, void *desc, void *context);
+void rxm_eager_ring_release(struct rxm_rx_buf *rx_buf);
+void rxm_eager_ring_copy(struct rxm_rx_buf *rx_buf);
+ssize_t rxm_eager_ring_recv(struct rxm_ep *ep, struct fi_cq_data_entry *comp,
+			    struct rxm_rx_buf **rx_buf);
+struct rxm_rx_buf *rxm_eager_ring_next(struct rxm_eager_ring *ring);
+bool rxm_eager_ring_defer(struct rxm_rx_buf *rx_buf);
+void rxm_eager_ring_progress(struct rxm_ep *ep);
+ssize_t rxm_handle_ring_setup(struct rxm_ep *ep, struct rxm_rx_buf *rx_buf);
+ssize_t rxm_handle_ring_credit(struct rxm_ep *ep, struct rxm_rx_buf *rx_buf);
+
+static inline bool
+rxm_eager_ring_avail(struct rxm_conn *conn, size_t pkt_size)
+{
+	struct rxm_eager_ring_peer *ring = &conn->tx_ring;
+
+	return pkt_size <= ring->slot_size &&
+	       ring->tail - ring->released < ring->slot_cnt;
+}
 
 int rxm_ep_query_atomic(struct fid_domain *domain, enum fi_datatype datatype,
 			enum fi_op op, struct fi_atomic_attr *attr,
@@ -974,7 +1092,9 @@ void rxm_av_remove_handler(struct util_ep *util_ep,
 static inline void
 rxm_free_rx_buf(struct rxm_rx_buf *rx_buf)
 {
-	if (rx_buf->data != rx_buf->pkt.data) {
+	if (rx_buf->ring) {
+		rxm_eager_ring_release(rx_buf);
+	} else if (rx_buf->data != rx_buf->pkt.data) {
 		free(rx_buf->data);
 		rx_buf->data = &rx_buf->pkt.data;
 	}
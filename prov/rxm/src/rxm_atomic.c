@@ -87,6 +87,192 @@ rxm_ep_send_atomic_req(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	return ret;
 }
 
+/* Sending a batch does not drive progress, so that it is safe to call
+ * while progressing the endpoint.
+ */
+ssize_t rxm_atomic_batch_flush(struct rxm_conn *conn)
+{
+	struct rxm_tx_buf *tx_buf = conn->atomic_batch;
+	struct rxm_ep *ep = conn->ep;
+	size_t len;
+	ssize_t ret;
+
+	assert(tx_buf);
+	conn->atomic_batch = NULL;
+	dlist_remove(&tx_buf->atomic_batch.entry);
+
+	tx_buf->hdr.state = RXM_ATOMIC_RESP_WAIT;
+	len = sizeof(struct rxm_pkt) + tx_buf->pkt.hdr.size;
+	if (len <= ep->inject_limit)
+		ret = fi_inject(conn->msg_ep, &tx_buf->pkt, len, 0);
+	else
+		ret = fi_send(conn->msg_ep, &tx_buf->pkt, len,
+			      tx_buf->hdr.desc, 0, tx_buf);
+
+	if (ret == -FI_EAGAIN) {
+		conn->atomic_batch = tx_buf;
+		dlist_insert_head(&tx_buf->atomic_batch.entry,
+				  &ep->atomic_batch_list);
+	} else if (ret) {
+		FI_WARN(&rxm_prov, FI_LOG_EP_DATA, "unable to send atomic "
+			"batch msg_id: 0x%" PRIx64 "\n",
+			tx_buf->pkt.ctrl_hdr.msg_id);
+		rxm_atomic_batch_complete(ep, tx_buf, NULL, (int) ret);
+	} else {
+		FI_DBG(&rxm_prov, FI_LOG_EP_DATA, "sent atomic batch: "
+		       "count: %" PRIu32 " msg_id: 0x%" PRIx64 "\n",
+		       tx_buf->atomic_batch.cnt, tx_buf->pkt.ctrl_hdr.msg_id);
+	}
+	return ret;
+}
+
+void rxm_atomic_batch_flush_all(struct rxm_ep *ep)
+{
+	struct rxm_tx_buf *tx_buf;
+	struct dlist_entry *tmp;
+
+	dlist_foreach_container_safe(&ep->atomic_batch_list,
+				     struct rxm_tx_buf, tx_buf,
+				     atomic_batch.entry, tmp) {
+		if (rxm_atomic_batch_flush(tx_buf->atomic_batch.conn) ==
+		    -FI_EAGAIN)
+			break;
+	}
+}
+
+/* Atomics issued with FI_MORE, and the atomic that closes such a
+ * sequence, are packed into a single request per connection.  Only
+ * host memory, single target region requests are batched.
+ */
+static bool
+rxm_atomic_batchable(struct rxm_conn *conn, const struct fi_msg_atomic *msg,
+		     uint64_t flags, enum fi_hmem_iface buf_iface,
+		     enum fi_hmem_iface cmp_iface, struct fi_ioc *resultv,
+		     void **result_desc, size_t result_count)
+{
+	struct iovec res_iov[RXM_IOV_LIMIT];
+	uint64_t device;
+
+	if (!rxm_atomic_batch_size ||
+	    (!(flags & FI_MORE) && !conn->atomic_batch) ||
+	    msg->rma_iov_count != 1 || buf_iface != FI_HMEM_SYSTEM ||
+	    cmp_iface != FI_HMEM_SYSTEM)
+		return false;
+
+	if (!resultv)
+		return true;
+
+	ofi_ioc_to_iov(resultv, res_iov, result_count,
+		       ofi_datatype_size(msg->datatype));
+	return rxm_iov_desc_to_hmem_iface_dev(res_iov, result_desc,
+					      result_count, &device) ==
+	       FI_HMEM_SYSTEM;
+}
+
+static ssize_t
+rxm_atomic_batch_add(struct rxm_ep *ep, struct rxm_conn *conn,
+		     const struct fi_msg_atomic *msg,
+		     const struct iovec *buf_iov, size_t buf_len,
+		     const struct iovec *cmp_iov, size_t cmp_count,
+		     size_t cmp_len, struct fi_ioc *resultv,
+		     void **result_desc, size_t result_count,
+		     uint8_t op, uint64_t flags)
+{
+	struct rxm_atomic_batch_entry *entry;
+	struct rxm_atomic_op *atomic_op;
+	struct rxm_tx_buf *tx_buf;
+	size_t datatype_sz = ofi_datatype_size(msg->datatype);
+	size_t entry_len, resp_len;
+	ssize_t ret;
+	int i;
+
+	entry_len = ofi_get_aligned_size(sizeof(*entry) + buf_len + cmp_len,
+					 RXM_ATOMIC_BATCH_ALIGN);
+	resp_len = sizeof(struct rxm_atomic_resp_hdr);
+	if (op != ofi_op_atomic)
+		resp_len += msg->rma_iov[0].count * datatype_sz;
+	resp_len = ofi_get_aligned_size(resp_len, RXM_ATOMIC_BATCH_ALIGN);
+
+	tx_buf = conn->atomic_batch;
+	if (tx_buf && (tx_buf->atomic_batch.cnt >= rxm_atomic_batch_size ||
+	    tx_buf->pkt.hdr.size + entry_len > rxm_buffer_size ||
+	    tx_buf->pkt.ctrl_hdr.ctrl_data + resp_len > rxm_buffer_size)) {
+		ret = rxm_atomic_batch_flush(conn);
+		if (ret == -FI_EAGAIN)
+			return ret;
+		tx_buf = NULL;
+	}
+
+	if (tx_buf && !ep->tx_credit)
+		return -FI_EAGAIN;
+
+	atomic_op = ofi_buf_alloc(ep->atomic_op_pool);
+	if (!atomic_op)
+		return -FI_EAGAIN;
+
+	if (!tx_buf) {
+		tx_buf = rxm_get_tx_buf(ep);
+		if (!tx_buf) {
+			ofi_buf_free(atomic_op);
+			return -FI_EAGAIN;
+		}
+
+		rxm_ep_format_tx_buf_pkt(conn, 0, ofi_op_atomic, 0, 0, 0,
+					 &tx_buf->pkt);
+		tx_buf->pkt.ctrl_hdr.type = rxm_ctrl_atomic_batch;
+		tx_buf->pkt.ctrl_hdr.msg_id = ofi_buf_index(tx_buf);
+		/* Space needed for the response */
+		tx_buf->pkt.ctrl_hdr.ctrl_data = 0;
+		tx_buf->pkt.hdr.atomic.datatype = 0;
+		tx_buf->pkt.hdr.atomic.op = 0;
+		tx_buf->pkt.hdr.atomic.ioc_count = 0;
+		tx_buf->app_context = NULL;
+		tx_buf->flags = 0;
+		dlist_init(&tx_buf->atomic_batch.ops);
+		tx_buf->atomic_batch.conn = conn;
+		tx_buf->atomic_batch.cnt = 0;
+		dlist_insert_tail(&tx_buf->atomic_batch.entry,
+				  &ep->atomic_batch_list);
+		conn->atomic_batch = tx_buf;
+	} else {
+		ep->tx_credit--;
+	}
+
+	entry = (struct rxm_atomic_batch_entry *)
+		(tx_buf->pkt.data + tx_buf->pkt.hdr.size);
+	entry->op = op;
+	entry->atomic_op = (uint8_t) msg->op;
+	entry->datatype = (uint8_t) msg->datatype;
+	entry->resv = 0;
+	entry->len = (uint32_t) (buf_len + cmp_len);
+	entry->rma_ioc = msg->rma_iov[0];
+	ofi_copy_from_iov(entry->data, buf_len, buf_iov, msg->iov_count, 0);
+	if (cmp_len)
+		ofi_copy_from_iov(entry->data + buf_len, cmp_len, cmp_iov,
+				  cmp_count, 0);
+
+	tx_buf->pkt.hdr.size += entry_len;
+	tx_buf->pkt.ctrl_hdr.ctrl_data += resp_len;
+	tx_buf->atomic_batch.cnt++;
+
+	atomic_op->app_context = msg->context;
+	atomic_op->flags = flags;
+	atomic_op->op = op;
+	atomic_op->result.count = (uint8_t) result_count;
+	if (resultv) {
+		ofi_ioc_to_iov(resultv, atomic_op->result.iov, result_count,
+			       datatype_sz);
+		for (i = 0; result_desc && i < result_count; i++)
+			atomic_op->result.desc[i] = result_desc[i];
+	}
+	dlist_insert_tail(&atomic_op->entry, &tx_buf->atomic_batch.ops);
+
+	/* The batch is retried from progress if it cannot be sent now */
+	if (!(flags & FI_MORE))
+		(void) rxm_atomic_batch_flush(conn);
+	return 0;
+}
+
 static ssize_t
 rxm_ep_atomic_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		const struct fi_msg_atomic *msg, const struct fi_ioc *comparev,
@@ -152,6 +338,21 @@ rxm_ep_atomic_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		return -FI_EINVAL;
 	}
 
+	if (rxm_atomic_batchable(rxm_conn, msg, flags, buf_iface, cmp_iface,
+				 resultv, result_desc, result_iov_count)) {
+		return rxm_atomic_batch_add(rxm_ep, rxm_conn, msg, buf_iov,
+					    buf_len, cmp_iov,
+					    compare_iov_count, cmp_len,
+					    resultv, result_desc,
+					    result_iov_count, op, flags);
+	}
+
+	if (rxm_conn->atomic_batch) {
+		ret = rxm_atomic_batch_flush(rxm_conn);
+		if (ret == -FI_EAGAIN)
+			return ret;
+	}
+
 	tx_buf = rxm_get_tx_buf(rxm_ep);
 	if (!tx_buf)
 		return -FI_EAGAIN;
@@ -193,6 +394,23 @@ rxm_ep_atomic_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	return ret;
 }
 
+/* Unlike rxm_get_conn, keep an open atomic batch for the peer so that
+ * the request can be appended to it.
+ */
+static ssize_t
+rxm_get_atomic_conn(struct rxm_ep *ep, fi_addr_t addr,
+		    struct rxm_conn **conn)
+{
+	struct util_peer_addr **peer;
+
+	peer = ofi_av_addr_context(ep->util_ep.av, addr);
+	*conn = ofi_idm_lookup(&ep->conn_idx_map, (*peer)->index);
+	if (*conn && (*conn)->atomic_batch)
+		return 0;
+
+	return rxm_get_conn(ep, addr, conn);
+}
+
 static ssize_t
 rxm_ep_generic_atomic_writemsg(struct rxm_ep *rxm_ep, const struct fi_msg_atomic *msg,
 			       uint64_t flags)
@@ -201,7 +419,7 @@ rxm_ep_generic_atomic_writemsg(struct rxm_ep *rxm_ep, const struct fi_msg_atomic
 	ssize_t ret;
 
 	ofi_genlock_lock(&rxm_ep->util_ep.lock);
-	ret = rxm_get_conn(rxm_ep, msg->addr, &rxm_conn);
+	ret = rxm_get_atomic_conn(rxm_ep, msg->addr, &rxm_conn);
 	if (ret)
 		goto unlock;
 
@@ -311,7 +529,7 @@ rxm_ep_generic_atomic_readwritemsg(struct rxm_ep *rxm_ep,
 	ssize_t ret;
 
 	ofi_genlock_lock(&rxm_ep->util_ep.lock);
-	ret = rxm_get_conn(rxm_ep, msg->addr, &rxm_conn);
+	ret = rxm_get_atomic_conn(rxm_ep, msg->addr, &rxm_conn);
 	if (ret)
 		goto unlock;
 
@@ -404,7 +622,7 @@ rxm_ep_generic_atomic_compwritemsg(struct rxm_ep *rxm_ep,
 	ssize_t ret;
 
 	ofi_genlock_lock(&rxm_ep->util_ep.lock);
-	ret = rxm_get_conn(rxm_ep, msg->addr, &rxm_conn);
+	ret = rxm_get_atomic_conn(rxm_ep, msg->addr, &rxm_conn);
 	if (ret)
 		goto unlock;
 
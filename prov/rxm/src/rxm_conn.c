@@ -33,15 +33,12 @@
 
 #include <stdlib.h>
 #include <string.h>
-#include <poll.h>
 
 #include <ofi.h>
 #include <ofi_util.h>
 #include "rxm.h"
 
 
-static void *rxm_cm_progress(void *arg);
-static void *rxm_cm_atomic_progress(void *arg);
 static void rxm_flush_msg_cq(struct rxm_ep *rxm_ep);
 
 
@@ -59,11 +56,20 @@ static void rxm_close_conn(struct rxm_conn *conn)
 {
 	struct rxm_deferred_tx_entry *tx_entry;
 	struct rxm_recv_entry *rx_entry;
+	struct rxm_tx_buf *tx_buf;
 	struct rxm_rx_buf *buf;
 
 	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "closing conn %p\n", conn);
 
 	assert(ofi_genlock_held(&conn->ep->util_ep.lock));
+	if (conn->atomic_batch) {
+		tx_buf = conn->atomic_batch;
+		conn->atomic_batch = NULL;
+		dlist_remove(&tx_buf->atomic_batch.entry);
+		rxm_atomic_batch_complete(conn->ep, tx_buf, NULL,
+					  -FI_ECANCELED);
+	}
+
 	/* All deferred transfers are internally generated */
 	while (!dlist_empty(&conn->deferred_tx_queue)) {
 		tx_entry = container_of(conn->deferred_tx_queue.next,
@@ -86,6 +92,7 @@ static void rxm_close_conn(struct rxm_conn *conn)
 		rxm_recv_entry_release(rx_entry);
 	}
 	fi_close(&conn->msg_ep->fid);
+	rxm_eager_ring_close(conn);
 	rxm_flush_msg_cq(conn->ep);
 	dlist_remove_init(&conn->loopback_entry);
 	conn->msg_ep = NULL;
@@ -251,6 +258,7 @@ static int rxm_init_connect_data(struct rxm_conn *conn,
 	cm_data->connect.flow_ctrl = conn->flow_ctrl ?
 						RXM_CM_FLOW_CTRL_PEER_ON :
 						RXM_CM_FLOW_CTRL_PEER_OFF;
+	cm_data->connect.eager_ring = conn->ep->eager_ring;
 
 	ret = fi_getopt(&conn->ep->msg_pep->fid, FI_OPT_ENDPOINT,
 			FI_OPT_CM_DATA_SIZE, &cm_data_size, &opt_size);
@@ -405,6 +413,10 @@ rxm_alloc_conn(struct rxm_ep *ep, struct util_peer_addr *peer)
 	conn->state = RXM_CM_IDLE;
 	conn->remote_index = -1;
 	conn->flags = 0;
+	conn->atomic_batch = NULL;
+	conn->peer_eager_ring = 0;
+	conn->rx_ring = NULL;
+	memset(&conn->tx_ring, 0, sizeof(conn->tx_ring));
 	dlist_init(&conn->deferred_entry);
 	dlist_init(&conn->deferred_tx_queue);
 	dlist_init(&conn->deferred_sar_msgs);
@@ -455,6 +467,11 @@ ssize_t rxm_get_conn(struct rxm_ep *ep, fi_addr_t addr, struct rxm_conn **conn)
 		return -FI_ENOMEM;
 
 	if ((*conn)->state == RXM_CM_CONNECTED) {
+		/* Keep batched atomics ordered ahead of this transfer */
+		if ((*conn)->atomic_batch &&
+		    rxm_atomic_batch_flush(*conn) == -FI_EAGAIN)
+			return -FI_EAGAIN;
+
 		if (!dlist_empty(&(*conn)->deferred_tx_queue)) {
 			rxm_ep_do_progress(&ep->util_ep);
 			if (!dlist_empty(&(*conn)->deferred_tx_queue))
@@ -512,6 +529,7 @@ void rxm_process_connect(struct rxm_eq_cm_entry *cm_entry)
 		conn->remote_pid = rxm_peer_pid(cm_entry->data.accept.
 						server_conn_id);
 		rxm_set_peer_flow_ctrl(conn, cm_entry->data.accept.flow_ctrl);
+		conn->peer_eager_ring = cm_entry->data.accept.eager_ring;
 	}
 
 	if (conn->flow_ctrl & conn->peer_flow_ctrl) {
@@ -524,6 +542,7 @@ void rxm_process_connect(struct rxm_eq_cm_entry *cm_entry)
 	conn->ep->connecting_cnt--;
 	assert(conn->ep->connecting_cnt >= 0);
 	conn->state = RXM_CM_CONNECTED;
+	rxm_eager_ring_open(conn);
 }
 
 /* For simultaneous connection requests, if the peer won the coin
@@ -631,9 +650,9 @@ rxm_accept_connreq(struct rxm_conn *conn, struct rxm_eq_cm_entry *cm_entry)
 	cm_data.accept.rx_size = (uint32_t) cm_entry->info->rx_attr->size;
 	cm_data.accept.flow_ctrl = conn->flow_ctrl ? RXM_CM_FLOW_CTRL_PEER_ON :
 						     RXM_CM_FLOW_CTRL_PEER_OFF;
+	cm_data.accept.eager_ring = conn->ep->eager_ring;
 	cm_data.accept.align_pad[0] = 0;
 	cm_data.accept.align_pad[1] = 0;
-	cm_data.accept.align_pad[2] = 0;
 
 	ret = fi_accept(conn->msg_ep, &cm_data.accept, sizeof(cm_data.accept));
 	if (ret)
@@ -729,6 +748,7 @@ rxm_process_connreq(struct rxm_ep *ep, struct rxm_eq_cm_entry *cm_entry)
 		goto free;
 
 	rxm_set_peer_flow_ctrl(conn, cm_entry->data.connect.flow_ctrl);
+	conn->peer_eager_ring = cm_entry->data.connect.eager_ring;
 
 	ret = rxm_accept_connreq(conn, cm_entry);
 	if (ret)
@@ -836,49 +856,74 @@ rxm_handle_event(struct rxm_ep *ep, uint32_t event,
 	}
 }
 
-void rxm_conn_progress(struct rxm_ep *ep)
+/* Handles queued CM events in batches, which takes the core EQ lock (and
+ * drives its progress) once per batch instead of once per event.  Handling
+ * an event may close msg endpoints with events later in the batch; the core
+ * EQ marks those removed.  Each event is marked removed before it is
+ * handled, as handling may free its data (e.g. the info of a CONNREQ) and
+ * a later close must not look at it again.
+ */
+static int rxm_conn_progress_batch(struct rxm_ep *ep)
 {
-	struct rxm_eq_cm_entry cm_entry;
-	uint32_t event;
+	struct slist_entry *item;
+	struct util_event *event;
+	struct slist batch;
 	ssize_t ret;
+	int cnt = 0;
 
 	assert(ofi_genlock_held(&ep->util_ep.lock));
 	do {
-		ret = fi_eq_read(ep->msg_eq, &event, &cm_entry,
-				 sizeof(cm_entry), 0);
+		slist_init(&batch);
+		ret = ep->msg_eq_batch->read(ep->msg_eq, &batch,
+					     RXM_CM_BATCH_SIZE);
 		if (ret > 0) {
-			rxm_handle_event(ep, event, &cm_entry, ret);
+			for (item = batch.head; item; item = item->next) {
+				event = container_of(item, struct util_event,
+						     entry);
+				if (event->removed)
+					continue;
+
+				event->removed = 1;
+				rxm_handle_event(ep, event->event,
+					(struct rxm_eq_cm_entry *) event->data,
+					event->size);
+				cnt++;
+			}
+			ep->msg_eq_batch->release(ep->msg_eq, &batch);
 		} else if (ret == -FI_EAVAIL) {
 			rxm_handle_error(ep);
+			cnt++;
 			ret = 1;
 		}
 	} while (ret > 0);
+	return cnt;
 }
 
-void rxm_stop_listen(struct rxm_ep *ep)
+/* Returns the number of CM events handled. */
+int rxm_conn_progress(struct rxm_ep *ep)
 {
-	struct fi_eq_entry entry = {0};
-	ssize_t size_ret;
-	int ret;
-
-	FI_INFO(&rxm_prov, FI_LOG_EP_CTRL, "stopping CM thread\n");
-	if (!ep->cm_thread)
-		return;
-
-	ofi_genlock_lock(&ep->util_ep.lock);
-	ep->do_progress = false;
-	ofi_genlock_unlock(&ep->util_ep.lock);
+	struct rxm_eq_cm_entry cm_entry;
+	uint32_t event;
+	ssize_t ret;
+	int cnt = 0;
 
-	size_ret = fi_eq_write(ep->msg_eq, FI_NOTIFY, &entry, sizeof(entry), 0);
-	if (size_ret != sizeof(entry)) {
-		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL, "Unable to signal\n");
-		return;
-	}
+	assert(ofi_genlock_held(&ep->util_ep.lock));
+	if (ep->msg_eq_batch)
+		return rxm_conn_progress_batch(ep);
 
-	ret = pthread_join(ep->cm_thread, NULL);
-	if (ret) {
-		RXM_WARN_ERR(FI_LOG_EP_CTRL, "pthread_join", -ret);
-	}
+	do {
+		ret = fi_eq_read(ep->msg_eq, &event, &cm_entry,
+				 sizeof(cm_entry), 0);
+		if (ret > 0) {
+			rxm_handle_event(ep, event, &cm_entry, ret);
+			cnt++;
+		} else if (ret == -FI_EAVAIL) {
+			rxm_handle_error(ep);
+			cnt++;
+			ret = 1;
+		}
+	} while (ret > 0);
+	return cnt;
 }
 
 static void rxm_flush_msg_cq(struct rxm_ep *ep)
@@ -905,102 +950,6 @@ static void rxm_flush_msg_cq(struct rxm_ep *ep)
 	} while (ret > 0);
 }
 
-static void *rxm_cm_progress(void *arg)
-{
-	struct rxm_ep *ep = container_of(arg, struct rxm_ep, util_ep);
-	struct rxm_eq_cm_entry cm_entry;
-	uint32_t event;
-	ssize_t ret;
-
-	FI_INFO(&rxm_prov, FI_LOG_EP_CTRL, "Starting auto-progress thread\n");
-
-	ofi_genlock_lock(&ep->util_ep.lock);
-	while (ep->do_progress) {
-		ofi_genlock_unlock(&ep->util_ep.lock);
-
-		/* We must retrieve any event after we acquire the ep lock.
-		 * Otherwise, we could obtain an event for a msg ep that
-		 * another thread could be closing.  If we try to process that
-		 * event, we can access freed memory.  So, we use FI_PEEK here
-		 * to wait until an event is ready, then read any event after
-		 * we hold the ep lock.  Because closing an ep will free any
-		 * events queued on the eq, the event we find here may be gone
-		 * by the time we call read below.  This is what we want as it
-		 * avoids processing the stale event.
-		 */
-		ret = fi_eq_sread(ep->msg_eq, &event, &cm_entry,
-				  sizeof(cm_entry), -1, FI_PEEK);
-
-		ofi_genlock_lock(&ep->util_ep.lock);
-		if (ret > 0) {
-			ret = fi_eq_read(ep->msg_eq, &event, &cm_entry,
-					 sizeof(cm_entry), 0);
-		}
-		if (ret > 0) {
-			rxm_handle_event(ep, event, &cm_entry, ret);
-		} else if (ret == -FI_EAVAIL) {
-			rxm_handle_error(ep);
-		} else if (ret && ret != -FI_EAGAIN) {
-			RXM_WARN_ERR(FI_LOG_EP_CTRL, "fi_eq_read", ret);
-			break;
-		}
-	}
-	ofi_genlock_unlock(&ep->util_ep.lock);
-
-	FI_INFO(&rxm_prov, FI_LOG_EP_CTRL, "Stopping auto-progress thread\n");
-	return NULL;
-}
-
-static void *rxm_cm_atomic_progress(void *arg)
-{
-	struct rxm_ep *ep = container_of(arg, struct rxm_ep, util_ep);
-	struct rxm_fabric *fabric;
-	struct fid *fids[2] = {
-		&ep->msg_eq->fid,
-		&ep->msg_cq->fid,
-	};
-	struct pollfd fds[2] = {
-		{.events = POLLIN},
-		{.events = POLLIN},
-	};
-	int ret;
-
-	fabric = container_of(ep->util_ep.domain->fabric,
-			      struct rxm_fabric, util_fabric);
-	ret = fi_control(&ep->msg_eq->fid, FI_GETWAIT, &fds[0].fd);
-	if (ret) {
-		RXM_WARN_ERR(FI_LOG_EP_CTRL, "fi_control", ret);
-		return NULL;
-	}
-
-	ret = fi_control(&ep->msg_cq->fid, FI_GETWAIT, &fds[1].fd);
-	if (ret) {
-		RXM_WARN_ERR(FI_LOG_EP_CTRL, "fi_control", ret);
-		return NULL;
-	}
-
-	FI_INFO(&rxm_prov, FI_LOG_EP_CTRL, "Starting auto-progress thread\n");
-	ofi_genlock_lock(&ep->util_ep.lock);
-	while (ep->do_progress) {
-		ofi_genlock_unlock(&ep->util_ep.lock);
-		ret = fi_trywait(fabric->msg_fabric, fids, 2);
-
-		if (!ret) {
-			ret = poll(fds, 2, -1);
-			if (ret == -1) {
-				RXM_WARN_ERR(FI_LOG_EP_CTRL, "poll", -errno);
-			}
-		}
-		ep->util_ep.progress(&ep->util_ep);
-		ofi_genlock_lock(&ep->util_ep.lock);
-		rxm_conn_progress(ep);
-	}
-	ofi_genlock_unlock(&ep->util_ep.lock);
-
-	FI_INFO(&rxm_prov, FI_LOG_EP_CTRL, "Stopping auto progress thread\n");
-	return NULL;
-}
-
 int rxm_start_listen(struct rxm_ep *ep)
 {
 	size_t addr_len;
@@ -1035,20 +984,6 @@ int rxm_start_listen(struct rxm_ep *ep)
 
 	ep->msg_info->src_addrlen = addr_len;
 	ofi_addr_set_port(ep->msg_info->src_addr, 0);
-
-	if (ep->util_ep.domain->data_progress == FI_PROGRESS_AUTO ||
-	    force_auto_progress) {
-
-		assert(ep->util_ep.domain->threading == FI_THREAD_SAFE);
-		ep->do_progress = true;
-		ret = pthread_create(&ep->cm_thread, 0,
-				     ep->rxm_info->caps & FI_ATOMIC ?
-				     rxm_cm_atomic_progress : rxm_cm_progress, ep);
-		if (ret) {
-			RXM_WARN_ERR(FI_LOG_EP_CTRL, "pthread_create", -ret);
-			return -ret;
-		}
-	}
 	return 0;
 }
 
@@ -91,6 +91,11 @@ static void rxm_replace_rx_buf(struct rxm_rx_buf *rx_buf)
 	struct rxm_rx_buf *new_rx_buf;
 	int ret;
 
+	if (rx_buf->ring) {
+		rxm_eager_ring_copy(rx_buf);
+		return;
+	}
+
 	new_rx_buf = rxm_rx_buf_alloc(rx_buf->ep, rx_buf->rx_ep);
 	if (!new_rx_buf)
 		return;
@@ -1008,17 +1013,15 @@ static void rxm_format_atomic_resp_pkt_hdr(struct rxm_conn *rxm_conn,
 	tx_buf->pkt.hdr.atomic.ioc_count = 0;
 }
 
-static ssize_t rxm_atomic_send_resp(struct rxm_ep *rxm_ep,
+static ssize_t rxm_atomic_post_resp(struct rxm_ep *rxm_ep,
 				    struct rxm_rx_buf *rx_buf,
 				    struct rxm_tx_buf *resp_buf,
-				    ssize_t result_len, uint32_t status)
+				    size_t data_len)
 {
 	struct rxm_deferred_tx_entry *def_tx_entry;
-	struct rxm_atomic_resp_hdr *atomic_hdr;
 	ssize_t ret;
-	size_t data_len, tot_len;
+	size_t tot_len;
 
-	data_len = result_len + sizeof(struct rxm_atomic_resp_hdr);
 	tot_len = data_len + sizeof(struct rxm_pkt);
 
 	resp_buf->hdr.state = RXM_ATOMIC_RESP_SENT;
@@ -1028,9 +1031,6 @@ static ssize_t rxm_atomic_send_resp(struct rxm_ep *rxm_ep,
 				       rx_buf->pkt.hdr.atomic.op);
 	resp_buf->pkt.ctrl_hdr.conn_id = rx_buf->conn->remote_index;
 	resp_buf->pkt.ctrl_hdr.msg_id = rx_buf->pkt.ctrl_hdr.msg_id;
-	atomic_hdr = (struct rxm_atomic_resp_hdr *) resp_buf->pkt.data;
-	atomic_hdr->status = htonl(status);
-	atomic_hdr->result_len = htonl((uint32_t) result_len);
 
 	if (tot_len < rxm_ep->inject_limit) {
 		ret = fi_inject(rx_buf->conn->msg_ep, &resp_buf->pkt,
@@ -1066,6 +1066,22 @@ static ssize_t rxm_atomic_send_resp(struct rxm_ep *rxm_ep,
 	return ret;
 }
 
+static ssize_t rxm_atomic_send_resp(struct rxm_ep *rxm_ep,
+				    struct rxm_rx_buf *rx_buf,
+				    struct rxm_tx_buf *resp_buf,
+				    ssize_t result_len, uint32_t status)
+{
+	struct rxm_atomic_resp_hdr *atomic_hdr;
+
+	atomic_hdr = (struct rxm_atomic_resp_hdr *) resp_buf->pkt.data;
+	atomic_hdr->status = htonl(status);
+	atomic_hdr->result_len = htonl((uint32_t) result_len);
+
+	return rxm_atomic_post_resp(rxm_ep, rx_buf, resp_buf,
+				    result_len +
+				    sizeof(struct rxm_atomic_resp_hdr));
+}
+
 static void rxm_do_atomic(uint8_t op, void *dst, void *src, void *cmp,
 			  void *res, size_t count, enum fi_datatype datatype,
 			  enum fi_op amo_op)
@@ -1231,6 +1247,271 @@ static ssize_t rxm_handle_atomic_req(struct rxm_ep *rxm_ep,
 				    result_len, FI_SUCCESS);
 }
 
+static void
+rxm_atomic_op_finish(struct rxm_ep *ep, struct rxm_atomic_op *atomic_op,
+		     int err)
+{
+	int cntr_idx;
+
+	cntr_idx = (atomic_op->op == ofi_op_atomic) ? CNTR_WR : CNTR_RD;
+	if (err) {
+		rxm_cq_write_error(ep->util_ep.tx_cq,
+				   ep->util_ep.cntrs[cntr_idx],
+				   atomic_op->app_context, err);
+		return;
+	}
+
+	if (!(atomic_op->flags & FI_INJECT))
+		rxm_cq_write_tx_comp(ep, ofi_tx_cq_flags(atomic_op->op),
+				     atomic_op->app_context, atomic_op->flags);
+	ofi_ep_cntr_inc(&ep->util_ep, cntr_idx);
+}
+
+/* Completes every atomic carried by a batch, either from the response
+ * received in rx_buf or with the given error.
+ */
+void rxm_atomic_batch_complete(struct rxm_ep *ep, struct rxm_tx_buf *tx_buf,
+			       struct rxm_rx_buf *rx_buf, int err)
+{
+	struct rxm_atomic_resp_hdr *resp_hdr = NULL;
+	struct rxm_atomic_op *atomic_op;
+	char *resp_end = NULL;
+	uint32_t result_len;
+	size_t len;
+	int status;
+
+	if (rx_buf) {
+		resp_hdr = (struct rxm_atomic_resp_hdr *) rx_buf->pkt.data;
+		resp_end = rx_buf->pkt.data + rx_buf->pkt.hdr.size;
+
+		/* A lone error header means the target rejected the batch */
+		if (!err && rx_buf->pkt.hdr.size == sizeof(*resp_hdr) &&
+		    resp_hdr->status)
+			err = (int) ntohl(resp_hdr->status);
+	}
+
+	while (!dlist_empty(&tx_buf->atomic_batch.ops)) {
+		dlist_pop_front(&tx_buf->atomic_batch.ops, struct rxm_atomic_op,
+				atomic_op, entry);
+		status = err;
+		if (!status && (!resp_hdr ||
+		    (char *) (resp_hdr + 1) > resp_end)) {
+			FI_WARN(&rxm_prov, FI_LOG_CQ,
+				"truncated atomic batch response\n");
+			status = -FI_EIO;
+		} else if (!status) {
+			status = (int) ntohl(resp_hdr->status);
+			result_len = ntohl(resp_hdr->result_len);
+			len = ofi_total_iov_len(atomic_op->result.iov,
+						atomic_op->result.count);
+			if (!status && result_len != len) {
+				FI_WARN(&rxm_prov, FI_LOG_CQ,
+					"result size mismatch\n");
+				status = -FI_EIO;
+			}
+			if (!status)
+				ofi_copy_to_iov(atomic_op->result.iov,
+						atomic_op->result.count, 0,
+						resp_hdr->data, len);
+			resp_hdr = (struct rxm_atomic_resp_hdr *)
+				   ((char *) resp_hdr + ofi_get_aligned_size(
+				    sizeof(*resp_hdr) + result_len,
+				    RXM_ATOMIC_BATCH_ALIGN));
+		}
+
+		rxm_atomic_op_finish(ep, atomic_op, status);
+		ofi_buf_free(atomic_op);
+	}
+
+	/* The batch buffer holds one tx credit, each added atomic another */
+	ep->tx_credit += tx_buf->atomic_batch.cnt - 1;
+	rxm_free_tx_buf(ep, tx_buf);
+	if (rx_buf)
+		rxm_free_rx_buf(rx_buf);
+}
+
+static bool rxm_atomic_batch_op_valid(uint8_t op, enum fi_op amo_op,
+				      enum fi_datatype datatype)
+{
+	if (datatype >= OFI_DATATYPE_CNT)
+		return false;
+
+	switch (op) {
+	case ofi_op_atomic:
+		return ofi_atomic_iswrite_op(amo_op) &&
+		       ofi_atomic_write_handlers[amo_op][datatype];
+	case ofi_op_atomic_fetch:
+		return ofi_atomic_isreadwrite_op(amo_op) &&
+		       ofi_atomic_readwrite_handlers[amo_op][datatype];
+	case ofi_op_atomic_compare:
+		return ofi_atomic_isswap_op(amo_op) &&
+		       ofi_atomic_swap_handlers[amo_op - OFI_SWAP_OP_START]
+					       [datatype];
+	default:
+		return false;
+	}
+}
+
+/* Checks every entry of a received batch before any of them is executed:
+ * the entries must tile the packet exactly, name a supported operation,
+ * carry exactly the operand data their count requires, and their results
+ * must fit in a single response buffer.
+ */
+static bool rxm_atomic_batch_valid(struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_atomic_batch_entry *entry;
+	char *req, *req_end;
+	size_t datatype_sz, amo_op_size, data_len, resp_len = 0;
+
+	req = rx_buf->pkt.data;
+	req_end = req + rx_buf->pkt.hdr.size;
+	if (req == req_end)
+		return false;
+
+	while (req < req_end) {
+		entry = (struct rxm_atomic_batch_entry *) req;
+		if ((size_t) (req_end - req) < sizeof(*entry) ||
+		    entry->len > (size_t) (req_end - req) - sizeof(*entry))
+			return false;
+
+		if (!rxm_atomic_batch_op_valid(entry->op, entry->atomic_op,
+					       entry->datatype))
+			return false;
+
+		datatype_sz = ofi_datatype_size(entry->datatype);
+		if (!datatype_sz || !entry->rma_ioc.count ||
+		    entry->rma_ioc.count > rxm_buffer_size / datatype_sz)
+			return false;
+
+		amo_op_size = entry->rma_ioc.count * datatype_sz;
+		if (entry->op == ofi_op_atomic_compare)
+			data_len = 2 * amo_op_size;
+		else if (entry->atomic_op == FI_ATOMIC_READ)
+			data_len = 0;
+		else
+			data_len = amo_op_size;
+		if (entry->len != data_len)
+			return false;
+
+		resp_len += ofi_get_aligned_size(
+				sizeof(struct rxm_atomic_resp_hdr) +
+				(entry->op == ofi_op_atomic ? 0 : amo_op_size),
+				RXM_ATOMIC_BATCH_ALIGN);
+		if (resp_len > rxm_buffer_size)
+			return false;
+
+		req += ofi_get_aligned_size(sizeof(*entry) + entry->len,
+					    RXM_ATOMIC_BATCH_ALIGN);
+	}
+
+	return req == req_end;
+}
+
+/* Each batch entry is applied independently and reports its own status,
+ * mirroring what separate requests would have returned.  A malformed
+ * batch is rejected as a whole with a single error header.
+ */
+static ssize_t rxm_handle_atomic_batch_req(struct rxm_ep *rxm_ep,
+					   struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_domain *domain = container_of(rxm_ep->util_ep.domain,
+					 struct rxm_domain, util_domain);
+	struct rxm_atomic_batch_entry *entry;
+	struct rxm_atomic_resp_hdr *resp_hdr;
+	struct rxm_tx_buf *resp_buf;
+	struct rxm_mr *mr;
+	char *req, *req_end, *resp;
+	size_t datatype_sz, amo_op_size, result_len, entry_len;
+	void *dst_buf, *cmp_buf;
+	ssize_t ret;
+
+	if (rx_buf->ep->msg_srx)
+		rx_buf->conn = ofi_idm_at(&rx_buf->ep->conn_idx_map,
+					  (int) rx_buf->pkt.ctrl_hdr.conn_id);
+	if (!rx_buf->conn)
+		return -FI_EOTHER;
+
+	resp_buf = ofi_buf_alloc(rxm_ep->tx_pool);
+	if (!resp_buf) {
+		FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+			"Unable to allocate for atomic response\n");
+		return -FI_ENOMEM;
+	}
+
+	resp_buf->pkt.ctrl_hdr.type = rxm_ctrl_atomic;
+	if (!rxm_atomic_batch_valid(rx_buf)) {
+		FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+			"malformed atomic batch, rejecting all entries\n");
+		return rxm_atomic_send_resp(rxm_ep, rx_buf, resp_buf, 0,
+					    (uint32_t) -FI_EINVAL);
+	}
+
+	req = rx_buf->pkt.data;
+	req_end = req + rx_buf->pkt.hdr.size;
+	resp = resp_buf->pkt.data;
+
+	while (req < req_end) {
+		entry = (struct rxm_atomic_batch_entry *) req;
+		entry_len = ofi_get_aligned_size(sizeof(*entry) + entry->len,
+						 RXM_ATOMIC_BATCH_ALIGN);
+		datatype_sz = ofi_datatype_size(entry->datatype);
+		amo_op_size = entry->rma_ioc.count * datatype_sz;
+		result_len = entry->op == ofi_op_atomic ? 0 : amo_op_size;
+		resp_hdr = (struct rxm_atomic_resp_hdr *) resp;
+
+		ret = ofi_mr_verify(&domain->util_domain.mr_map, amo_op_size,
+				    (uintptr_t *) &entry->rma_ioc.addr,
+				    entry->rma_ioc.key,
+				    ofi_rx_mr_reg_flags(entry->op,
+							entry->atomic_op));
+		if (ret) {
+			FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+				"Atomic RMA MR verify error %ld\n", ret);
+			ret = -FI_EACCES;
+			goto next;
+		}
+
+		mr = rxm_mr_get_map_entry(domain, entry->rma_ioc.key);
+		dst_buf = (void *) (uintptr_t) entry->rma_ioc.addr;
+		cmp_buf = entry->op == ofi_op_atomic_compare ?
+			  entry->data + amo_op_size : NULL;
+		if (mr->iface != FI_HMEM_SYSTEM) {
+			ret = rxm_do_device_mem_atomic(mr, entry->op, dst_buf,
+						       entry->data, cmp_buf,
+						       resp_hdr->data,
+						       entry->rma_ioc.count,
+						       entry->datatype,
+						       entry->atomic_op,
+						       amo_op_size);
+			if (ret) {
+				FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+					"Atomic operation failed %ld\n", ret);
+				goto next;
+			}
+		} else {
+			rxm_do_atomic(entry->op, dst_buf, entry->data, cmp_buf,
+				      resp_hdr->data, entry->rma_ioc.count,
+				      entry->datatype, entry->atomic_op);
+		}
+
+		if (entry->op == ofi_op_atomic)
+			ofi_ep_cntr_inc(&rxm_ep->util_ep, CNTR_REM_WR);
+		else
+			ofi_ep_cntr_inc(&rxm_ep->util_ep, CNTR_REM_RD);
+next:
+		if (ret)
+			result_len = 0;
+		resp_hdr->status = htonl((uint32_t) ret);
+		resp_hdr->result_len = htonl((uint32_t) result_len);
+		resp += ofi_get_aligned_size(sizeof(*resp_hdr) + result_len,
+					     RXM_ATOMIC_BATCH_ALIGN);
+		req += entry_len;
+	}
+
+	return rxm_atomic_post_resp(rxm_ep, rx_buf, resp_buf,
+				    resp - resp_buf->pkt.data);
+}
+
 static ssize_t rxm_handle_atomic_resp(struct rxm_ep *rxm_ep,
 				      struct rxm_rx_buf *rx_buf)
 {
@@ -1250,6 +1531,11 @@ static ssize_t rxm_handle_atomic_resp(struct rxm_ep *rxm_ep,
 	       " msg_id: 0x%" PRIx64 "\n", rx_buf->pkt.hdr.op,
 	       rx_buf->pkt.ctrl_hdr.msg_id);
 
+	if (tx_buf->pkt.ctrl_hdr.type == rxm_ctrl_atomic_batch) {
+		rxm_atomic_batch_complete(rxm_ep, tx_buf, rx_buf, 0);
+		return 0;
+	}
+
 	iface = rxm_iov_desc_to_hmem_iface_dev(tx_buf->atomic_result.iov,
 					       tx_buf->atomic_result.desc,
 					       tx_buf->atomic_result.count,
@@ -1345,6 +1631,94 @@ void rxm_finish_coll_eager_send(struct rxm_ep *rxm_ep,
 	}
 }
 
+static ssize_t rxm_handle_rx_comp(struct rxm_ep *rxm_ep,
+				  struct rxm_rx_buf *rx_buf)
+{
+	assert((rx_buf->pkt.hdr.version == OFI_OP_VERSION) &&
+	       (rx_buf->pkt.ctrl_hdr.version == RXM_CTRL_VERSION));
+
+	switch (rx_buf->pkt.ctrl_hdr.type) {
+	case rxm_ctrl_eager:
+	case rxm_ctrl_rndv_req:
+		return rxm_handle_recv_comp(rx_buf);
+	case rxm_ctrl_rndv_rd_done:
+		rxm_rndv_handle_rd_done(rxm_ep, rx_buf);
+		return 0;
+	case rxm_ctrl_rndv_wr_done:
+		return rxm_rndv_handle_wr_done(rxm_ep, rx_buf);
+	case rxm_ctrl_rndv_wr_data:
+		return rxm_rndv_handle_wr_data(rx_buf);
+	case rxm_ctrl_seg:
+		return rxm_sar_handle_segment(rx_buf);
+	case rxm_ctrl_atomic:
+		return rxm_handle_atomic_req(rxm_ep, rx_buf);
+	case rxm_ctrl_atomic_resp:
+		return rxm_handle_atomic_resp(rxm_ep, rx_buf);
+	case rxm_ctrl_atomic_batch:
+		return rxm_handle_atomic_batch_req(rxm_ep, rx_buf);
+	case rxm_ctrl_credit:
+		return rxm_handle_credit(rxm_ep, rx_buf);
+	case rxm_ctrl_ring_setup:
+		return rxm_handle_ring_setup(rxm_ep, rx_buf);
+	case rxm_ctrl_ring_credit:
+		return rxm_handle_ring_credit(rxm_ep, rx_buf);
+	default:
+		FI_WARN(&rxm_prov, FI_LOG_CQ, "Unknown message type\n");
+		assert(0);
+		return -FI_EINVAL;
+	}
+}
+
+/* Remote writes only target eager rings when those are exposed */
+static ssize_t rxm_handle_ring_comp(struct rxm_ep *rxm_ep,
+				    struct fi_cq_data_entry *comp)
+{
+	struct rxm_rx_buf *rx_buf;
+	ssize_t ret;
+
+	if (comp->op_context)
+		rxm_free_rx_buf(comp->op_context);
+
+	ret = rxm_eager_ring_recv(rxm_ep, comp, &rx_buf);
+	if (ret || !rx_buf)
+		return ret;
+
+	return rxm_handle_rx_comp(rxm_ep, rx_buf);
+}
+
+/* Deliver eager ring messages, and the messages queued behind them, that
+ * were held back for lack of rx buffers.
+ */
+void rxm_eager_ring_progress(struct rxm_ep *ep)
+{
+	struct rxm_eager_ring *ring;
+	struct rxm_rx_buf *rx_buf;
+	ssize_t ret;
+
+	while (!dlist_empty(&ep->ring_pending_list)) {
+		ring = container_of(ep->ring_pending_list.next,
+				    struct rxm_eager_ring, pending_entry);
+		while (ring->pending) {
+			rx_buf = rxm_eager_ring_next(ring);
+			if (!rx_buf)
+				return;
+
+			ret = rxm_handle_rx_comp(ep, rx_buf);
+			if (ret)
+				rxm_cq_write_error_all(ep, (int) ret);
+		}
+
+		dlist_remove(&ring->pending_entry);
+		while (!dlist_empty(&ring->deferred_list)) {
+			dlist_pop_front(&ring->deferred_list, struct rxm_rx_buf,
+					rx_buf, repost_entry);
+			ret = rxm_handle_rx_comp(ep, rx_buf);
+			if (ret)
+				rxm_cq_write_error_all(ep, (int) ret);
+		}
+	}
+}
+
 ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 {
 	struct rxm_rx_buf *rx_buf;
@@ -1353,6 +1727,9 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 	/* Remote write events may not consume a posted recv so op context
 	 * and hence state would be NULL */
 	if (comp->flags & FI_REMOTE_WRITE) {
+		if (rxm_ep->expose_eager_ring)
+			return rxm_handle_ring_comp(rxm_ep, comp);
+
 		rxm_handle_remote_write(rxm_ep, (struct fi_cq_data_entry *) comp);
 		return 0;
 	}
@@ -1378,33 +1755,9 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 	case RXM_RX:
 		rx_buf = comp->op_context;
 		assert(!(comp->flags & FI_REMOTE_READ));
-		assert((rx_buf->pkt.hdr.version == OFI_OP_VERSION) &&
-		       (rx_buf->pkt.ctrl_hdr.version == RXM_CTRL_VERSION));
-
-		switch (rx_buf->pkt.ctrl_hdr.type) {
-		case rxm_ctrl_eager:
-		case rxm_ctrl_rndv_req:
-			return rxm_handle_recv_comp(rx_buf);
-		case rxm_ctrl_rndv_rd_done:
-			rxm_rndv_handle_rd_done(rxm_ep, rx_buf);
+		if (rxm_ep->expose_eager_ring && rxm_eager_ring_defer(rx_buf))
 			return 0;
-		case rxm_ctrl_rndv_wr_done:
-			return rxm_rndv_handle_wr_done(rxm_ep, rx_buf);
-		case rxm_ctrl_rndv_wr_data:
-			return rxm_rndv_handle_wr_data(rx_buf);
-		case rxm_ctrl_seg:
-			return rxm_sar_handle_segment(rx_buf);
-		case rxm_ctrl_atomic:
-			return rxm_handle_atomic_req(rxm_ep, rx_buf);
-		case rxm_ctrl_atomic_resp:
-			return rxm_handle_atomic_resp(rxm_ep, rx_buf);
-		case rxm_ctrl_credit:
-			return rxm_handle_credit(rxm_ep, rx_buf);
-		default:
-			FI_WARN(&rxm_prov, FI_LOG_CQ, "Unknown message type\n");
-			assert(0);
-			return -FI_EINVAL;
-		}
+		return rxm_handle_rx_comp(rxm_ep, rx_buf);
 	case RXM_SAR_TX:
 		tx_buf = comp->op_context;
 		assert(comp->flags & FI_SEND);
@@ -1563,10 +1916,17 @@ void rxm_handle_comp_error(struct rxm_ep *rxm_ep)
 	cntr = rxm_ep->util_ep.cntrs[CNTR_TX];
 
 	switch (RXM_GET_PROTO_STATE(err_entry.op_context)) {
+	case RXM_ATOMIC_RESP_WAIT:
+		tx_buf = err_entry.op_context;
+		if (tx_buf->pkt.ctrl_hdr.type == rxm_ctrl_atomic_batch) {
+			rxm_atomic_batch_complete(rxm_ep, tx_buf, NULL,
+						  -err_entry.err);
+			return;
+		}
+		/* fall through */
 	case RXM_TX:
 	case RXM_RNDV_TX:
 	case RXM_RNDV_WRITE_DONE_SENT:
-	case RXM_ATOMIC_RESP_WAIT:
 		tx_buf = err_entry.op_context;
 		err_entry.op_context = tx_buf->app_context;
 		err_entry.flags = ofi_tx_cq_flags(tx_buf->pkt.hdr.op);
@@ -1852,6 +2212,12 @@ void rxm_ep_do_progress(struct util_ep *util_ep)
 			rxm_ep_progress_deferred_queue(rxm_ep, rxm_conn);
 		}
 	}
+
+	if (!dlist_empty(&rxm_ep->atomic_batch_list))
+		rxm_atomic_batch_flush_all(rxm_ep);
+
+	if (!dlist_empty(&rxm_ep->ring_pending_list))
+		rxm_eager_ring_progress(rxm_ep);
 }
 
 void rxm_ep_progress(struct util_ep *util_ep)
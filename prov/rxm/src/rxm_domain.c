@@ -900,6 +900,13 @@ int rxm_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 		goto err3;
 	}
 
+	if (info->domain_attr->data_progress == FI_PROGRESS_AUTO ||
+	    force_auto_progress) {
+		ret = ofi_domain_start_progress(&rxm_domain->util_domain);
+		if (ret)
+			goto err4;
+	}
+
 	if (info->caps & FI_COLLECTIVE) {
 		if (!rxm_fabric->util_coll_fabric) {
 			FI_WARN(&rxm_prov, FI_LOG_DOMAIN,
@@ -158,6 +158,7 @@ static void rxm_init_rx_buf(struct ofi_bufpool_region *region, void *buf)
 			   fi_mr_desc((struct fid_mr *) region->context) : NULL;
 	rx_buf->ep = ep;
 	rx_buf->data = &rx_buf->pkt.data;
+	rx_buf->ring = false;
 }
 
 static void rxm_init_tx_buf(struct ofi_bufpool_region *region, void *buf)
@@ -287,8 +288,21 @@ static int rxm_ep_create_pools(struct rxm_ep *rxm_ep)
 			"Unable to create peer xfer context pool\n");
 		goto free_tx_pool;
 	}
+
+	ret = ofi_bufpool_create(&rxm_ep->atomic_op_pool,
+				 sizeof(struct rxm_atomic_op), 16, 0, 64,
+				 OFI_BUFPOOL_NO_TRACK);
+	if (ret) {
+		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL,
+			"Unable to create atomic batch pool\n");
+		goto free_coll_pool;
+	}
 	return 0;
 
+free_coll_pool:
+	ofi_bufpool_destroy(rxm_ep->coll_pool);
+	rxm_ep->coll_pool = NULL;
+
 free_tx_pool:
 	ofi_bufpool_destroy(rxm_ep->tx_pool);
 
@@ -366,6 +380,10 @@ static void rxm_ep_txrx_res_close(struct rxm_ep *ep)
 		ofi_bufpool_destroy(ep->coll_pool);
 		ep->coll_pool = NULL;
 	}
+	if (ep->atomic_op_pool) {
+		ofi_bufpool_destroy(ep->atomic_op_pool);
+		ep->atomic_op_pool = NULL;
+	}
 }
 
 static int rxm_setname(fid_t fid, void *addr, size_t addrlen)
@@ -1182,6 +1200,18 @@ static int rxm_listener_close(struct rxm_ep *ep)
 	return 0;
 }
 
+static void rxm_ep_stop_progress(struct rxm_ep *ep)
+{
+	struct util_progress *progress = ep->util_ep.domain->progress;
+
+	if (!progress)
+		return;
+
+	ofi_progress_del(progress, &ep->msg_eq->fid);
+	if (ep->msg_cq)
+		ofi_progress_del(progress, &ep->msg_cq->fid);
+}
+
 static int rxm_ep_close(struct fid *fid)
 {
 	struct rxm_ep *ep;
@@ -1189,10 +1219,10 @@ static int rxm_ep_close(struct fid *fid)
 
 	ep = container_of(fid, struct rxm_ep, util_ep.ep_fid.fid);
 
-	/* Stop listener thread to halt event processing before closing all
+	/* Stop auto progress to halt event processing before closing all
 	 * connections.
 	 */
-	rxm_stop_listen(ep);
+	rxm_ep_stop_progress(ep);
 	rxm_freeall_conns(ep);
 	ret = rxm_listener_close(ep);
 	if (ret)
@@ -1275,6 +1305,62 @@ static int rxm_ep_trywait_eq(void *arg)
 	return fi_trywait(rxm_fabric->msg_fabric, fids, 1);
 }
 
+/* Called by the domain progress thread with the ep lock held */
+static int rxm_ep_auto_progress_eq(struct fid *fid)
+{
+	struct rxm_ep *ep = fid->context;
+
+	return rxm_conn_progress(ep);
+}
+
+/* Completions left on the msg CQ keep rxm_ep_trywait_cq from blocking */
+static int rxm_ep_auto_progress_cq(struct fid *fid)
+{
+	struct rxm_ep *ep = fid->context;
+
+	ep->util_ep.progress(&ep->util_ep);
+	return 0;
+}
+
+/*
+ * The msg EQ reports connection events, which are handled under the ep
+ * lock.  Atomics are emulated by rxm itself, so their responses are only
+ * generated when the msg CQ is progressed as well.
+ */
+static int rxm_ep_start_progress(struct rxm_ep *ep)
+{
+	struct util_progress *progress = ep->util_ep.domain->progress;
+	int fd, ret;
+
+	ret = fi_control(&ep->msg_eq->fid, FI_GETWAIT, &fd);
+	if (ret) {
+		RXM_WARN_ERR(FI_LOG_EP_CTRL, "fi_control", ret);
+		return ret;
+	}
+
+	ret = ofi_progress_add(progress, &ep->msg_eq->fid, &ep->util_ep.lock,
+			       rxm_ep_auto_progress_eq, fd, rxm_ep_trywait_eq,
+			       &ep->msg_eq->fid);
+	if (ret || !(ep->rxm_info->caps & FI_ATOMIC))
+		return ret;
+
+	ret = fi_control(&ep->msg_cq->fid, FI_GETWAIT, &fd);
+	if (ret) {
+		RXM_WARN_ERR(FI_LOG_EP_CTRL, "fi_control", ret);
+		goto err;
+	}
+
+	ret = ofi_progress_add(progress, &ep->msg_cq->fid, NULL,
+			       rxm_ep_auto_progress_cq, fd, rxm_ep_trywait_cq,
+			       &ep->msg_cq->fid);
+	if (ret)
+		goto err;
+	return 0;
+err:
+	ofi_progress_del(progress, &ep->msg_eq->fid);
+	return ret;
+}
+
 static int rxm_ep_wait_fd_add(struct rxm_ep *rxm_ep, struct util_wait *wait)
 {
 	int ret;
@@ -1293,7 +1379,8 @@ static int rxm_ep_wait_fd_add(struct rxm_ep *rxm_ep, struct util_wait *wait)
 static bool rxm_needs_atomic_progress(const struct fi_info *info)
 {
 	return (info->caps & FI_ATOMIC) && info->domain_attr &&
-		info->domain_attr->data_progress == FI_PROGRESS_AUTO;
+		(info->domain_attr->data_progress == FI_PROGRESS_AUTO ||
+		 force_auto_progress);
 }
 
 static int rxm_msg_cq_fd_needed(struct rxm_ep *rxm_ep)
@@ -1456,6 +1543,7 @@ static void rxm_ep_settings_init(struct rxm_ep *rxm_ep)
 	rxm_ep->buffered_limit = rxm_buffer_size;
 
 	rxm_config_direct_send(rxm_ep);
+	rxm_eager_ring_init(rxm_ep);
 	rxm_ep_init_proto(rxm_ep);
 
  	FI_INFO(&rxm_prov, FI_LOG_CORE,
@@ -1488,9 +1576,11 @@ static int rxm_ep_txrx_res_open(struct rxm_ep *rxm_ep)
 
 	return FI_SUCCESS;
 err:
+	ofi_bufpool_destroy(rxm_ep->atomic_op_pool);
 	ofi_bufpool_destroy(rxm_ep->coll_pool);
 	ofi_bufpool_destroy(rxm_ep->rx_pool);
 	ofi_bufpool_destroy(rxm_ep->tx_pool);
+	rxm_ep->atomic_op_pool = NULL;
 	rxm_ep->coll_pool = NULL;
 	rxm_ep->rx_pool = NULL;
 	rxm_ep->tx_pool = NULL;
@@ -1537,13 +1627,6 @@ static int rxm_ep_ctrl(struct fid *fid, int command, void *arg)
 		if (ret)
 			return ret;
 
-		/* Ensure atomics progress thread isn't started at this point.
-		 * The progress thread should be started only after MSG CQ is
-		 * opened to keep it simple (avoids progressing only MSG EQ first
-		 * and then progressing both MSG EQ and MSG CQ once the latter
-		 * is opened) */
-		assert(!(ep->rxm_info->caps & FI_ATOMIC) || !ep->cm_thread);
-
 		ret = rxm_ep_msg_cq_open(ep);
 		if (ret)
 			return ret;
@@ -1572,6 +1655,13 @@ static int rxm_ep_ctrl(struct fid *fid, int command, void *arg)
 		if (ret)
 			goto err;
 
+		/* Started only once the msg CQ is open, so atomics are
+		 * progressed from their first event */
+		if (ep->util_ep.domain->progress) {
+			ret = rxm_ep_start_progress(ep);
+			if (ret)
+				goto err;
+		}
 		break;
 	default:
 		return -FI_ENOSYS;
@@ -1683,6 +1773,10 @@ static int rxm_listener_open(struct rxm_ep *rxm_ep)
 		return ret;
 	}
 
+	if (fi_open_ops(&rxm_ep->msg_eq->fid, OFI_OPS_EQ_BATCH, 0,
+			(void **) &rxm_ep->msg_eq_batch, NULL))
+		rxm_ep->msg_eq_batch = NULL;
+
 	ret = fi_passive_ep(rxm_fabric->msg_fabric, rxm_ep->msg_info,
 			    &rxm_ep->msg_pep, rxm_ep);
 	if (ret) {
@@ -1920,6 +2014,8 @@ int rxm_endpoint(struct fid_domain *domain, struct fi_info *info,
 	else
 		rxm_ep->rndv_ops = &rxm_rndv_ops_read;
 	dlist_init(&rxm_ep->rndv_wait_list);
+	dlist_init(&rxm_ep->atomic_batch_list);
+	dlist_init(&rxm_ep->ring_pending_list);
 
 	if (rxm_passthru_info(info)) {
 		(*ep_fid)->msg = &rxm_msg_thru_ops;
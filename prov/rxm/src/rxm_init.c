@@ -54,6 +54,9 @@ size_t rxm_def_tx_size = 2048;
 
 size_t rxm_buffer_size = 16384;
 size_t rxm_packet_size;
+size_t rxm_atomic_batch_size = 64;
+size_t rxm_eager_ring_size = 64;
+size_t rxm_eager_ring_msg_size = 1024;
 
 int rxm_passthru = 0; /* disable by default, need to analyze performance */
 int force_auto_progress;
@@ -411,6 +414,13 @@ static void rxm_init_infos(void)
 
 	rxm_packet_size = sizeof(struct rxm_pkt) + rxm_buffer_size;
 
+	fi_param_get_size_t(&rxm_prov, "atomic_batch_size",
+			    &rxm_atomic_batch_size);
+	fi_param_get_size_t(&rxm_prov, "eager_ring_size",
+			    &rxm_eager_ring_size);
+	fi_param_get_size_t(&rxm_prov, "eager_ring_msg_size",
+			    &rxm_eager_ring_msg_size);
+
 	fi_param_get_size_t(&rxm_prov, "tx_size", &tx_size);
 	fi_param_get_size_t(&rxm_prov, "rx_size", &rx_size);
 	if (tx_size)
@@ -620,6 +630,25 @@ RXM_INI
 			"typically used as the eager message size. "
 			"(default %zu)", rxm_buffer_size);
 
+	fi_param_define(&rxm_prov, "atomic_batch_size", FI_PARAM_SIZE_T,
+			"Maximum number of atomic operations to the same peer "
+			"that are packed into a single message when posted "
+			"with FI_MORE.  Set to 0 to send each atomic "
+			"separately. (default %zu)", rxm_atomic_batch_size);
+
+	fi_param_define(&rxm_prov, "eager_ring_size", FI_PARAM_SIZE_T,
+			"Number of slots in the ring that each connection "
+			"exposes to its peer for RMA writing small eager "
+			"messages, when the MSG provider supports 8 bytes of "
+			"remote CQ data and the application does not request "
+			"remote RMA write access.  Set to 0 to disable. "
+			"(default %zu)", rxm_eager_ring_size);
+
+	fi_param_define(&rxm_prov, "eager_ring_msg_size", FI_PARAM_SIZE_T,
+			"Largest message that is written into an eager ring "
+			"slot.  Limited by the eager size. (default %zu)",
+			rxm_eager_ring_msg_size);
+
 	fi_param_define(&rxm_prov, "comp_per_progress", FI_PARAM_INT,
 			"Defines the maximum number of MSG provider CQ entries "
 			"(default: 1) that would be read per progress "
@@ -568,8 +568,12 @@ rxm_emulate_inject(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 				 &tx_buf->pkt);
 	memcpy(tx_buf->pkt.data, buf, len);
 
-	ret = fi_send(rxm_conn->msg_ep, &tx_buf->pkt, pkt_size,
-		      tx_buf->hdr.desc, 0, tx_buf);
+	if (rxm_eager_ring_avail(rxm_conn, pkt_size))
+		ret = rxm_eager_ring_write(rxm_conn, &tx_buf->pkt, pkt_size,
+					   tx_buf->hdr.desc, tx_buf);
+	else
+		ret = fi_send(rxm_conn->msg_ep, &tx_buf->pkt, pkt_size,
+			      tx_buf->hdr.desc, 0, tx_buf);
 	if (ret) {
 		if (ret == -FI_EAGAIN)
 			rxm_ep_do_progress(&rxm_ep->util_ep);
@@ -592,7 +596,12 @@ rxm_inject_send(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	if (pkt_size <= rxm_ep->inject_limit && !rxm_ep->util_ep.cntrs[CNTR_TX]) {
 		inject_pkt->hdr.size = len;
 		memcpy(inject_pkt->data, buf, len);
-		ret = fi_inject(rxm_conn->msg_ep, inject_pkt, pkt_size, 0);
+		if (rxm_eager_ring_avail(rxm_conn, pkt_size))
+			ret = rxm_eager_ring_write(rxm_conn, inject_pkt,
+						   pkt_size, NULL, NULL);
+		else
+			ret = fi_inject(rxm_conn->msg_ep, inject_pkt,
+					pkt_size, 0);
 	} else {
 		ret = rxm_emulate_inject(rxm_ep, rxm_conn, buf, len,
 					 pkt_size, inject_pkt->hdr.data,
@@ -661,7 +670,9 @@ rxm_send_eager(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	eager_buf->app_context = context;
 	eager_buf->flags = flags;
 
-	if (rxm_use_direct_send(rxm_ep, count, flags)) {
+	/* Messages written into the peer's eager ring are always copied */
+	if (rxm_use_direct_send(rxm_ep, count, flags) &&
+	    !rxm_eager_ring_avail(rxm_conn, total_len)) {
 		rxm_ep_format_tx_buf_pkt(rxm_conn, data_len, op, data, tag,
 					 flags, &eager_buf->pkt);
 
@@ -674,8 +685,15 @@ rxm_send_eager(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 					     eager_buf->pkt.hdr.size, iov,
 					     count, 0);
 		assert((size_t) ret == eager_buf->pkt.hdr.size);
-		ret = fi_send(rxm_conn->msg_ep, &eager_buf->pkt, total_len,
-			      eager_buf->hdr.desc, 0, eager_buf);
+		if (rxm_eager_ring_avail(rxm_conn, total_len))
+			ret = rxm_eager_ring_write(rxm_conn, &eager_buf->pkt,
+						   total_len,
+						   eager_buf->hdr.desc,
+						   eager_buf);
+		else
+			ret = fi_send(rxm_conn->msg_ep, &eager_buf->pkt,
+				      total_len, eager_buf->hdr.desc, 0,
+				      eager_buf);
 	}
 
 	if (ret) {
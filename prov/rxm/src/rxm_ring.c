@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "rxm.h"
+
+/*
+ * Eager rings
+ *
+ * Small eager messages may be RMA written directly into a ring of slots
+ * that the receiving side of a connection exposes, rather than being sent
+ * into a posted receive buffer.  The remote CQ data of each write carries
+ * the index of the connection at the receiver and the sequence number of
+ * the slot, which lets the receiver match the message straight out of the
+ * slot.  The receiver releases slots in sequence order and reports the
+ * release count back to the writer, piggybacked on its own ring writes or
+ * in a rxm_ctrl_ring_credit message.  When the ring is full, the writer
+ * falls back to regular sends, which are ordered with the ring writes on
+ * the same MSG endpoint.
+ *
+ * Because every remote write completion is taken to be a ring write, rings
+ * are only exposed when the application cannot be the target of RMA writes.
+ */
+
+void rxm_eager_ring_init(struct rxm_ep *ep)
+{
+	uint64_t caps = ep->rxm_info->caps;
+	bool rma_target;
+
+	ep->eager_ring = rxm_eager_ring_size && rxm_eager_ring_msg_size &&
+			 (ep->msg_info->domain_attr->cq_data_size >=
+			  sizeof(uint64_t));
+
+	rma_target = (caps & FI_RMA) &&
+		     ((caps & FI_REMOTE_WRITE) ||
+		      !(caps & (FI_READ | FI_WRITE | FI_REMOTE_READ)));
+	ep->expose_eager_ring = ep->eager_ring && !rma_target &&
+				!(ep->rxm_info->mode & OFI_BUFFERED_RECV);
+}
+
+static struct rxm_tx_buf *
+rxm_eager_ring_ctrl_buf(struct rxm_conn *conn, uint8_t type)
+{
+	struct rxm_tx_buf *tx_buf;
+
+	tx_buf = ofi_buf_alloc(conn->ep->tx_pool);
+	if (!tx_buf) {
+		FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+			"Ran out of buffers for eager ring control message\n");
+		return NULL;
+	}
+
+	tx_buf->hdr.state = RXM_CREDIT_TX;
+	rxm_ep_format_tx_buf_pkt(conn, 0, ofi_op_msg, 0, 0, 0, &tx_buf->pkt);
+	tx_buf->pkt.ctrl_hdr.type = type;
+	tx_buf->pkt.ctrl_hdr.msg_id = ofi_buf_index(tx_buf);
+	return tx_buf;
+}
+
+static ssize_t
+rxm_eager_ring_post_ctrl(struct rxm_conn *conn, struct rxm_tx_buf *tx_buf)
+{
+	struct rxm_deferred_tx_entry *def_tx_entry;
+	struct iovec iov;
+	struct fi_msg msg;
+	ssize_t ret;
+
+	if (dlist_empty(&conn->deferred_tx_queue)) {
+		iov.iov_base = &tx_buf->pkt;
+		iov.iov_len = sizeof(struct rxm_pkt);
+		msg.msg_iov = &iov;
+		msg.iov_count = 1;
+		msg.context = tx_buf;
+		msg.desc = &tx_buf->hdr.desc;
+		msg.addr = 0;
+		msg.data = 0;
+
+		ret = fi_sendmsg(conn->msg_ep, &msg, OFI_PRIORITY);
+		if (ret != -FI_EAGAIN)
+			goto out;
+	}
+
+	def_tx_entry = rxm_ep_alloc_deferred_tx_entry(conn->ep, conn,
+						RXM_DEFERRED_TX_CREDIT_SEND);
+	if (!def_tx_entry) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	def_tx_entry->credit_msg.tx_buf = tx_buf;
+	rxm_queue_deferred_tx(def_tx_entry, OFI_LIST_TAIL);
+	return 0;
+out:
+	if (ret) {
+		RXM_WARN_ERR(FI_LOG_EP_DATA, "eager ring control message", ret);
+		ofi_buf_free(tx_buf);
+	}
+	return ret;
+}
+
+static void rxm_eager_ring_send_credit(struct rxm_conn *conn)
+{
+	struct rxm_eager_ring *ring = conn->rx_ring;
+	struct rxm_tx_buf *tx_buf;
+
+	tx_buf = rxm_eager_ring_ctrl_buf(conn, rxm_ctrl_ring_credit);
+	if (!tx_buf)
+		return;
+
+	tx_buf->pkt.ctrl_hdr.ctrl_data = ring->released;
+	if (!rxm_eager_ring_post_ctrl(conn, tx_buf))
+		ring->credited = ring->released;
+}
+
+static void rxm_eager_ring_free(struct rxm_eager_ring *ring)
+{
+	if (ring->mr)
+		fi_close(&ring->mr->fid);
+	ofi_freealign(ring->buf);
+	free(ring);
+}
+
+/* Called once the connection is established.  Failures are not fatal:
+ * the peer keeps sending into posted receive buffers.
+ */
+void rxm_eager_ring_open(struct rxm_conn *conn)
+{
+	struct rxm_ep *ep = conn->ep;
+	struct rxm_domain *domain;
+	struct rxm_eager_ring *ring;
+	struct rxm_tx_buf *tx_buf;
+	size_t msg_size;
+	int ret;
+
+	if (!ep->expose_eager_ring || !conn->peer_eager_ring)
+		return;
+
+	/* Both halves of a loopback connection share a connection index,
+	 * which the remote CQ data of a ring write cannot tell apart.
+	 */
+	if (!ofi_addr_cmp(&rxm_prov, &conn->peer->addr.sa, &ep->addr.sa))
+		return;
+
+	assert(!conn->rx_ring);
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return;
+
+	msg_size = MIN(rxm_eager_ring_msg_size, ep->eager_limit);
+	ring->slot_size = (uint32_t) ofi_get_aligned_size(
+				sizeof(struct rxm_pkt) + msg_size, 64);
+	ring->slot_cnt = (uint32_t) rxm_eager_ring_size;
+	ring->conn = conn;
+	dlist_init(&ring->deferred_list);
+
+	ret = ofi_memalign((void **) &ring->buf, 64,
+			   (size_t) ring->slot_cnt * ring->slot_size);
+	if (ret) {
+		ring->buf = NULL;
+		goto free;
+	}
+
+	domain = container_of(ep->util_ep.domain, struct rxm_domain,
+			      util_domain);
+	ret = rxm_msg_mr_reg_internal(domain, ring->buf,
+				      (size_t) ring->slot_cnt * ring->slot_size,
+				      FI_REMOTE_WRITE, 0, &ring->mr);
+	if (ret) {
+		RXM_WARN_ERR(FI_LOG_EP_CTRL, "eager ring registration", ret);
+		ring->mr = NULL;
+		goto free;
+	}
+
+	tx_buf = rxm_eager_ring_ctrl_buf(conn, rxm_ctrl_ring_setup);
+	if (!tx_buf)
+		goto free;
+
+	tx_buf->pkt.hdr.data = RXM_MR_VIRT_ADDR(ep->msg_info) ?
+			       (uintptr_t) ring->buf : 0;
+	tx_buf->pkt.hdr.size = ring->slot_size;
+	tx_buf->pkt.ctrl_hdr.rx_key = fi_mr_key(ring->mr);
+	tx_buf->pkt.ctrl_hdr.seg_no = ring->slot_cnt;
+
+	conn->rx_ring = ring;
+	if (rxm_eager_ring_post_ctrl(conn, tx_buf)) {
+		conn->rx_ring = NULL;
+		goto free;
+	}
+
+	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "exposed eager ring to %p\n", conn);
+	return;
+free:
+	rxm_eager_ring_free(ring);
+}
+
+/* The MSG endpoint must already be closed, so the peer can no longer
+ * write into the ring.
+ */
+void rxm_eager_ring_close(struct rxm_conn *conn)
+{
+	struct rxm_eager_ring *ring = conn->rx_ring;
+	struct rxm_rx_buf *rx_buf;
+
+	memset(&conn->tx_ring, 0, sizeof(conn->tx_ring));
+	if (!ring)
+		return;
+
+	if (ring->pending) {
+		dlist_remove(&ring->pending_entry);
+		while (!dlist_empty(&ring->deferred_list)) {
+			dlist_pop_front(&ring->deferred_list, struct rxm_rx_buf,
+					rx_buf, repost_entry);
+			if (!conn->ep->msg_srx)
+				rx_buf->repost = false;
+			rxm_free_rx_buf(rx_buf);
+		}
+	}
+	rxm_eager_ring_free(ring);
+	conn->rx_ring = NULL;
+}
+
+static void
+rxm_eager_ring_update(struct rxm_eager_ring_peer *ring, uint32_t released)
+{
+	if ((int32_t) (released - ring->released) > 0)
+		ring->released = released;
+}
+
+/* The caller has checked rxm_eager_ring_avail().  A NULL context injects
+ * the packet.
+ */
+ssize_t rxm_eager_ring_write(struct rxm_conn *conn, struct rxm_pkt *pkt,
+			     size_t pkt_size, void *desc, void *context)
+{
+	struct rxm_eager_ring_peer *ring = &conn->tx_ring;
+	uint64_t addr, data;
+	ssize_t ret;
+
+	assert(rxm_eager_ring_avail(conn, pkt_size));
+	pkt->ctrl_hdr.ctrl_data = conn->rx_ring ? conn->rx_ring->released : 0;
+
+	addr = ring->addr + (uint64_t) (ring->tail % ring->slot_cnt) *
+	       ring->slot_size;
+	data = ((uint64_t) conn->remote_index << 32) | ring->tail;
+
+	if (context)
+		ret = fi_writedata(conn->msg_ep, pkt, pkt_size, desc, data, 0,
+				   addr, ring->key, context);
+	else
+		ret = fi_inject_writedata(conn->msg_ep, pkt, pkt_size, data, 0,
+					  addr, ring->key);
+	if (ret)
+		return ret;
+
+	ring->tail++;
+	if (conn->rx_ring)
+		conn->rx_ring->credited = conn->rx_ring->released;
+	return 0;
+}
+
+static void rxm_eager_ring_advance(struct rxm_conn *conn)
+{
+	struct rxm_eager_ring *ring = conn->rx_ring;
+
+	ring->released++;
+	if (ring->released - ring->credited >= ring->slot_cnt / 2)
+		rxm_eager_ring_send_credit(conn);
+}
+
+/* Slots are released in order, since a message is either consumed by its
+ * completion handler or copied out with rxm_eager_ring_copy().
+ */
+void rxm_eager_ring_release(struct rxm_rx_buf *rx_buf)
+{
+	assert(rx_buf->ring && rx_buf->conn->rx_ring);
+	assert(rx_buf->ring_seq == rx_buf->conn->rx_ring->released);
+
+	rx_buf->ring = false;
+	rx_buf->data = rx_buf->pkt.data;
+	rxm_eager_ring_advance(rx_buf->conn);
+}
+
+/* Buffer the message so that its slot can be reused */
+void rxm_eager_ring_copy(struct rxm_rx_buf *rx_buf)
+{
+	memcpy(rx_buf->pkt.data, rx_buf->data, rx_buf->pkt.hdr.size);
+	rxm_eager_ring_release(rx_buf);
+}
+
+static struct rxm_conn *rxm_eager_ring_conn(struct rxm_rx_buf *rx_buf)
+{
+	if (rx_buf->conn)
+		return rx_buf->conn;
+
+	return ofi_idm_at(&rx_buf->ep->conn_idx_map,
+			  (int) rx_buf->pkt.ctrl_hdr.conn_id);
+}
+
+/* Wrap the message in the next unreleased slot in an rx buffer */
+static struct rxm_rx_buf *rxm_eager_ring_get_buf(struct rxm_eager_ring *ring)
+{
+	struct rxm_conn *conn = ring->conn;
+	struct rxm_ep *ep = conn->ep;
+	struct rxm_rx_buf *buf;
+	char *slot;
+
+	buf = ofi_buf_alloc(ep->rx_pool);
+	if (!buf)
+		return NULL;
+
+	slot = ring->buf + (size_t) (ring->released % ring->slot_cnt) *
+	       ring->slot_size;
+
+	buf->hdr.state = RXM_RX;
+	buf->rx_ep = ep->msg_srx ? ep->msg_srx : conn->msg_ep;
+	buf->repost = false;
+	buf->conn = conn;
+	buf->recv_entry = NULL;
+	buf->ring = true;
+	buf->ring_seq = ring->released;
+	memcpy(&buf->pkt, slot, sizeof(buf->pkt));
+	buf->data = slot + sizeof(buf->pkt);
+
+	rxm_eager_ring_update(&conn->tx_ring,
+			      (uint32_t) buf->pkt.ctrl_hdr.ctrl_data);
+	return buf;
+}
+
+/* Returns the next message held back by rxm_eager_ring_recv(), or NULL if
+ * it still cannot be delivered.
+ */
+struct rxm_rx_buf *rxm_eager_ring_next(struct rxm_eager_ring *ring)
+{
+	struct rxm_rx_buf *buf;
+
+	assert(ring->pending);
+	buf = rxm_eager_ring_get_buf(ring);
+	if (buf)
+		ring->pending--;
+	return buf;
+}
+
+/* Messages from a peer must not overtake its ring writes that are held
+ * back.  Returns true if the rx buffer was queued behind them.
+ */
+bool rxm_eager_ring_defer(struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_conn *conn;
+
+	conn = rxm_eager_ring_conn(rx_buf);
+	if (!conn || !conn->rx_ring || !conn->rx_ring->pending)
+		return false;
+
+	dlist_insert_tail(&rx_buf->repost_entry, &conn->rx_ring->deferred_list);
+	return true;
+}
+
+/* The slot of a message is only released once it has been delivered.  If
+ * no rx buffer is available, the message stays in its slot, and is
+ * delivered by rxm_eager_ring_progress().
+ */
+ssize_t rxm_eager_ring_recv(struct rxm_ep *ep, struct fi_cq_data_entry *comp,
+			    struct rxm_rx_buf **rx_buf)
+{
+	struct rxm_eager_ring *ring;
+	struct rxm_conn *conn;
+
+	*rx_buf = NULL;
+	conn = ofi_idm_at(&ep->conn_idx_map, (int) (comp->data >> 32));
+	if (!conn || !conn->rx_ring) {
+		FI_WARN(&rxm_prov, FI_LOG_CQ,
+			"eager ring write for unknown connection\n");
+		return 0;
+	}
+
+	ring = conn->rx_ring;
+	assert((uint32_t) comp->data == ring->released + ring->pending);
+	assert(comp->len >= sizeof(struct rxm_pkt) &&
+	       comp->len <= ring->slot_size);
+
+	if (!ring->pending) {
+		*rx_buf = rxm_eager_ring_get_buf(ring);
+		if (*rx_buf)
+			return 0;
+
+		FI_WARN(&rxm_prov, FI_LOG_CQ, "unable to allocate rx buf for "
+			"eager ring message, deferring delivery\n");
+		dlist_insert_tail(&ring->pending_entry, &ep->ring_pending_list);
+	}
+	ring->pending++;
+	return 0;
+}
+
+ssize_t rxm_handle_ring_setup(struct rxm_ep *ep, struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_eager_ring_peer *ring;
+	struct rxm_conn *conn;
+
+	conn = rxm_eager_ring_conn(rx_buf);
+	if (conn) {
+		ring = &conn->tx_ring;
+		ring->addr = rx_buf->pkt.hdr.data;
+		ring->key = rx_buf->pkt.ctrl_hdr.rx_key;
+		ring->slot_size = (uint32_t) rx_buf->pkt.hdr.size;
+		ring->tail = 0;
+		ring->released = 0;
+		ring->slot_cnt = rx_buf->pkt.ctrl_hdr.seg_no;
+		FI_DBG(&rxm_prov, FI_LOG_EP_CTRL,
+		       "peer exposed eager ring to %p\n", conn);
+	}
+
+	rxm_free_rx_buf(rx_buf);
+	return 0;
+}
+
+ssize_t rxm_handle_ring_credit(struct rxm_ep *ep, struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_conn *conn;
+
+	conn = rxm_eager_ring_conn(rx_buf);
+	if (conn)
+		rxm_eager_ring_update(&conn->tx_ring,
+				      (uint32_t) rx_buf->pkt.ctrl_hdr.ctrl_data);
+
+	rxm_free_rx_buf(rx_buf);
+	return 0;
+}
@@ -78,6 +78,7 @@ struct smr_env {
 	int use_dsa_sar;
 	size_t max_gdrcopy_size;
 	int use_xpmem;
+	size_t mmap_arena_size;
 };
 
 extern struct smr_env smr_env;
@@ -124,6 +125,7 @@ struct smr_tx_entry {
 	size_t		bytes_done;
 	void		*map_ptr;
 	struct smr_ep_name *map_name;
+	struct smr_mmap_buf *map_buf;
 	struct ofi_mr	*mr[SMR_IOV_LIMIT];
 };
 
@@ -150,6 +152,38 @@ struct smr_cmd_ctx {
 
 OFI_DECLARE_FREESTACK(struct smr_tx_entry, smr_tx_fs);
 
+/*
+ * mmap arena: long-lived shm files, one per size class, that are leased
+ * for a single mmap protocol transfer to a peer and reused afterwards.
+ * The receiving side keeps its mappings of a peer's files cached.  File
+ * names are never reused, as each endpoint numbers its files starting
+ * from the time it was opened, so a cached mapping can never be stale.
+ * Both the files an endpoint owns and the peer files it keeps mapped are
+ * bounded by mmap_arena_size.
+ */
+#define SMR_MMAP_MIN_SIZE	(1 << 16)
+
+struct smr_mmap_buf {
+	struct dlist_entry	entry;
+	struct dlist_entry	ep_entry;
+	struct smr_ep_name	*name;
+	uint64_t		msg_id;
+	size_t			size;
+	void			*ptr;
+};
+
+struct smr_mmap_map {
+	struct dlist_entry	entry;
+	char			name[SMR_NAME_MAX];
+	size_t			size;
+	void			*ptr;
+};
+
+static inline size_t smr_mmap_class_size(size_t size)
+{
+	return roundup_power_of_two(MAX(size, SMR_MMAP_MIN_SIZE));
+}
+
 struct smr_fabric {
 	struct util_fabric	util_fabric;
 };
@@ -228,8 +262,17 @@ struct smr_ep {
 	struct smr_tx_fs	*tx_fs;
 	struct dlist_entry	sar_list;
 	struct dlist_entry	ipc_cpy_pend_list;
+	/* all owned files, and the idle ones, most recently used first */
+	struct dlist_entry	mmap_buf_list;
+	struct dlist_entry	mmap_idle_list;
+	size_t			mmap_buf_size;
+	/* peer files mapped locally, most recently used first */
+	struct dlist_entry	mmap_map_list;
+	size_t			mmap_map_size;
 
 	int			ep_idx;
+	/* peers wake the progress thread through it, see smr_signal() */
+	int			signal_sock;
 	enum ofi_shm_p2p_type	p2p_type;
 	struct smr_sock_info	*sock_info;
 	void			*dsa_context;
@@ -248,9 +291,14 @@ static inline int smr_mmap_name(char *shm_name, const char *ep_name,
 				uint64_t msg_id)
 {
 	return snprintf(shm_name, SMR_NAME_MAX - 1, "%s_%ld",
-			ep_name, msg_id);
+			smr_no_prefix(ep_name), msg_id);
 }
 
+int smr_mmap_lease(struct smr_ep *ep, size_t size, struct smr_mmap_buf **buf);
+void smr_mmap_release(struct smr_ep *ep, struct smr_mmap_buf *buf);
+void *smr_mmap_map_peer(struct smr_ep *ep, const char *name, size_t size);
+void smr_mmap_cleanup(struct smr_ep *ep);
+
 int smr_srx_context(struct fid_domain *domain, struct fi_rx_attr *attr,
 		struct fid_ep **rx_ep, void *context);
 
@@ -307,6 +355,16 @@ static inline uint64_t smr_rx_cq_flags(uint32_t op, uint64_t rx_flags,
 }
 
 void smr_ep_progress(struct util_ep *util_ep);
+int smr_ep_auto_progress(struct fid *fid);
+int smr_ep_auto_trywait(void *arg);
+
+/* Wakes the progress thread for transfers that only this process can
+ * advance, which peers will not signal */
+static inline void smr_ep_signal_progress(struct smr_ep *ep)
+{
+	if (ep->util_ep.domain->progress)
+		ofi_progress_signal(ep->util_ep.domain->progress);
+}
 
 static inline bool smr_vma_enabled(struct smr_ep *ep,
 				   struct smr_region *peer_smr)
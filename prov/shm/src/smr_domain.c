@@ -116,6 +116,17 @@ int smr_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 		return ret;
 	}
 
+	if (info->domain_attr->data_progress == FI_PROGRESS_AUTO) {
+		ret = ofi_domain_start_progress(&smr_domain->util_domain);
+		if (ret) {
+			if (smr_domain->ipc_cache)
+				ofi_ipc_cache_destroy(smr_domain->ipc_cache);
+			(void) ofi_domain_close(&smr_domain->util_domain);
+			free(smr_domain);
+			return ret;
+		}
+	}
+
 	*domain = &smr_domain->util_domain.domain_fid;
 	(*domain)->fid.ops = &smr_domain_fi_ops;
 	(*domain)->ops = &smr_domain_ops;
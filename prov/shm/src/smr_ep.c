@@ -207,6 +207,7 @@ static void smr_send_name(struct smr_ep *ep, int64_t id)
 
 	smr_peer_data(ep->region)[id].name_sent = 1;
 	smr_cmd_queue_commit(ce, pos);
+	smr_signal(peer_smr);
 }
 
 int64_t smr_verify_peer(struct smr_ep *ep, fi_addr_t fi_addr)
@@ -331,6 +332,35 @@ static int smr_format_ipc(struct smr_cmd *cmd, void *ptr, size_t len,
 	return FI_SUCCESS;
 }
 
+static int smr_format_mmap_arena(struct smr_ep *ep, struct smr_cmd *cmd,
+		const struct iovec *iov, size_t count, size_t total_len,
+		struct smr_tx_entry *pend, struct smr_resp *resp)
+{
+	struct smr_mmap_buf *buf;
+	int ret;
+
+	ret = smr_mmap_lease(ep, total_len, &buf);
+	if (ret)
+		return ret;
+
+	if (cmd->msg.hdr.op != ofi_op_read_req &&
+	    ofi_copy_from_iov(buf->ptr, total_len, iov, count, 0) != total_len) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL, "copy from iov error\n");
+		smr_mmap_release(ep, buf);
+		return -FI_EIO;
+	}
+
+	cmd->msg.hdr.op_src = smr_src_mmap;
+	cmd->msg.hdr.op_flags |= SMR_MMAP_ARENA;
+	cmd->msg.hdr.msg_id = buf->msg_id;
+	cmd->msg.hdr.src_data = smr_get_offset(ep->region, resp);
+	cmd->msg.hdr.size = total_len;
+	pend->map_ptr = buf->ptr;
+	pend->map_name = NULL;
+	pend->map_buf = buf;
+	return 0;
+}
+
 static int smr_format_mmap(struct smr_ep *ep, struct smr_cmd *cmd,
 		const struct iovec *iov, size_t count, size_t total_len,
 		struct smr_tx_entry *pend, struct smr_resp *resp)
@@ -340,6 +370,11 @@ static int smr_format_mmap(struct smr_ep *ep, struct smr_cmd *cmd,
 	uint64_t msg_id;
 	struct smr_ep_name *map_name;
 
+	ret = smr_format_mmap_arena(ep, cmd, iov, count, total_len, pend,
+				    resp);
+	if (!ret)
+		return 0;
+
 	msg_id = ep->msg_id++;
 	map_name = calloc(1, sizeof(*map_name));
 	if (!map_name) {
@@ -395,6 +430,7 @@ static int smr_format_mmap(struct smr_ep *ep, struct smr_cmd *cmd,
 	cmd->msg.hdr.src_data = smr_get_offset(ep->region, resp);
 	cmd->msg.hdr.size = total_len;
 	pend->map_name = map_name;
+	pend->map_buf = NULL;
 
 	close(fd);
 	return 0;
@@ -791,6 +827,12 @@ static int smr_ep_close(struct fid *fid)
 
 	ep = container_of(fid, struct smr_ep, util_ep.ep_fid.fid);
 
+	if (ep->signal_sock >= 0) {
+		ofi_progress_del(ep->util_ep.domain->progress,
+				 &ep->util_ep.ep_fid.fid);
+		close(ep->signal_sock);
+	}
+
 	if (smr_env.use_dsa_sar)
 		smr_dsa_context_cleanup(ep);
 
@@ -826,6 +868,7 @@ static int smr_ep_close(struct fid *fid)
 		ofi_bufpool_destroy(ep->pend_buf_pool);
 
 	smr_tx_fs_free(ep->tx_fs);
+	smr_mmap_cleanup(ep);
 
 	free((void *)ep->name);
 	free(ep);
@@ -1123,6 +1166,64 @@ static int smr_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
 	return ret;
 }
 
+/*
+ * Peers queue commands without a file descriptor to poll, so the progress
+ * thread also waits on a datagram socket.  Its abstract address is stored
+ * in the region, where senders find it to wake the thread.
+ */
+static int smr_ep_start_progress(struct smr_ep *ep)
+{
+	struct sockaddr_un addr;
+	socklen_t len;
+	int ret;
+
+	ep->signal_sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (ep->signal_sock < 0)
+		return -errno;
+
+	/* binding only the address family autobinds an abstract name */
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (bind(ep->signal_sock, (struct sockaddr *) &addr,
+		 sizeof(addr.sun_family))) {
+		ret = -errno;
+		goto err;
+	}
+
+	len = sizeof(addr);
+	if (getsockname(ep->signal_sock, (struct sockaddr *) &addr, &len)) {
+		ret = -errno;
+		goto err;
+	}
+
+	len -= offsetof(struct sockaddr_un, sun_path);
+	if (len > SMR_SIGNAL_ADDR_MAX) {
+		ret = -FI_EINVAL;
+		goto err;
+	}
+
+	ret = fi_fd_nonblock(ep->signal_sock);
+	if (ret)
+		goto err;
+
+	memcpy(ep->region->signal_addr, addr.sun_path, len);
+	ep->region->signal_addrlen = len;
+
+	ret = ofi_progress_add(ep->util_ep.domain->progress,
+			       &ep->util_ep.ep_fid.fid, NULL,
+			       smr_ep_auto_progress, ep->signal_sock,
+			       smr_ep_auto_trywait, ep);
+	if (ret)
+		goto err;
+	return 0;
+err:
+	FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+		"unable to start auto progress: %s\n", fi_strerror(-ret));
+	close(ep->signal_sock);
+	ep->signal_sock = -1;
+	return ret;
+}
+
 static int smr_ep_ctrl(struct fid *fid, int command, void *arg)
 {
 	struct smr_attr attr;
@@ -1196,6 +1297,8 @@ static int smr_ep_ctrl(struct fid *fid, int command, void *arg)
 		if (ep->region->xpmem_cap_self == SMR_VMA_CAP_ON)
 			ep->p2p_type = FI_SHM_P2P_XPMEM;
 
+		if (ep->util_ep.domain->progress)
+			ret = smr_ep_start_progress(ep);
 		break;
 	default:
 		return -FI_ENOSYS;
@@ -1301,6 +1404,7 @@ int smr_endpoint(struct fid_domain *domain, struct fi_info *info,
 	ep = calloc(1, sizeof(*ep));
 	if (!ep)
 		return -FI_ENOMEM;
+	ep->signal_sock = -1;
 
 	ret = smr_endpoint_name(ep, name, info->src_addr, info->src_addrlen);
 	if (ret)
@@ -1327,6 +1431,10 @@ int smr_endpoint(struct fid_domain *domain, struct fi_info *info,
 
 	dlist_init(&ep->sar_list);
 	dlist_init(&ep->ipc_cpy_pend_list);
+	dlist_init(&ep->mmap_buf_list);
+	dlist_init(&ep->mmap_idle_list);
+	dlist_init(&ep->mmap_map_list);
+	ep->msg_id = ofi_gettime_ns();
 
 	ep->util_ep.ep_fid.fid.ops = &smr_ep_fi_ops;
 	ep->util_ep.ep_fid.ops = &smr_ep_ops;
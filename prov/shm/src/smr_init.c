@@ -46,6 +46,7 @@ struct smr_env smr_env = {
 	.use_dsa_sar = false,
 	.max_gdrcopy_size = 3072,
 	.use_xpmem = false,
+	.mmap_arena_size = 16 * 1024 * 1024,
 };
 
 static void smr_init_env(void)
@@ -56,6 +57,8 @@ static void smr_init_env(void)
 	fi_param_get_bool(&smr_prov, "disable_cma", &smr_env.disable_cma);
 	fi_param_get_bool(&smr_prov, "use_dsa_sar", &smr_env.use_dsa_sar);
 	fi_param_get_bool(&smr_prov, "use_xpmem", &smr_env.use_xpmem);
+	fi_param_get_size_t(&smr_prov, "mmap_arena_size",
+			    &smr_env.mmap_arena_size);
 }
 
 static void smr_resolve_addr(const char *node, const char *service,
@@ -164,6 +167,13 @@ static int smr_getinfo(uint32_t version, const char *node, const char *service,
 				smr_resolve_addr(NULL, NULL, (char **) &cur->src_addr,
 						 &cur->src_addrlen);
 		}
+		/* Auto progress runs a progress thread and must be requested */
+		if (!hints || !hints->domain_attr ||
+		    hints->domain_attr->data_progress != FI_PROGRESS_AUTO)
+			cur->domain_attr->data_progress = FI_PROGRESS_MANUAL;
+		else
+			cur->domain_attr->threading = FI_THREAD_SAFE;
+
 		if (fast_rma) {
 			cur->domain_attr->mr_mode |= FI_MR_VIRT_ADDR;
 			cur->tx_attr->msg_order = FI_ORDER_SAS;
@@ -222,6 +232,10 @@ SHM_INI
 	fi_param_define(&smr_prov, "use_xpmem", FI_PARAM_BOOL,
 			"Enable XPMEM over CMA when possible "
 			"(default: false)");
+	fi_param_define(&smr_prov, "mmap_arena_size", FI_PARAM_SIZE_T,
+			"Max size of the shm files an endpoint keeps for reuse "
+			"by the mmap protocol, and of the peer files it keeps "
+			"mapped. 0 disables reuse (default: 16777216)");
 
 	smr_init_env();
 
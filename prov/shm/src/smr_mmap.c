@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) Intel Corporation. All rights reserved
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include "smr.h"
+
+static struct smr_mmap_buf *smr_mmap_buf_create(struct smr_ep *ep, size_t size)
+{
+	struct smr_mmap_buf *buf;
+	int fd;
+
+	buf = calloc(1, sizeof(*buf));
+	if (!buf)
+		return NULL;
+
+	buf->name = calloc(1, sizeof(*buf->name));
+	if (!buf->name)
+		goto free_buf;
+
+	buf->msg_id = ep->msg_id++;
+	buf->size = size;
+	if (smr_mmap_name(buf->name->name, ep->name, buf->msg_id) < 0) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"generating shm file name failed\n");
+		goto free_name;
+	}
+
+	fd = shm_open(buf->name->name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL, "shm_open error\n");
+		goto free_name;
+	}
+
+	/* Reserve the space now, rather than fault on a full /dev/shm */
+	if (posix_fallocate(fd, 0, size)) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL, "fallocate error\n");
+		goto unlink_close;
+	}
+
+	buf->ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (buf->ptr == MAP_FAILED) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL, "mmap error\n");
+		goto unlink_close;
+	}
+	close(fd);
+
+	pthread_mutex_lock(&ep_list_lock);
+	dlist_insert_tail(&buf->name->entry, &ep_name_list);
+	pthread_mutex_unlock(&ep_list_lock);
+
+	dlist_insert_tail(&buf->ep_entry, &ep->mmap_buf_list);
+	return buf;
+
+unlink_close:
+	shm_unlink(buf->name->name);
+	close(fd);
+free_name:
+	free(buf->name);
+free_buf:
+	free(buf);
+	return NULL;
+}
+
+static void smr_mmap_buf_free(struct smr_mmap_buf *buf)
+{
+	munmap(buf->ptr, buf->size);
+	shm_unlink(buf->name->name);
+
+	pthread_mutex_lock(&ep_list_lock);
+	dlist_remove(&buf->name->entry);
+	pthread_mutex_unlock(&ep_list_lock);
+
+	dlist_remove(&buf->ep_entry);
+	free(buf->name);
+	free(buf);
+}
+
+/*
+ * Lease a file large enough for a transfer of size bytes.  Returns
+ * -FI_ENOSPC if the transfer should use a one-off file instead.
+ */
+int smr_mmap_lease(struct smr_ep *ep, size_t size, struct smr_mmap_buf **buf)
+{
+	struct smr_mmap_buf *idle;
+
+	size = smr_mmap_class_size(size);
+	if (size > smr_env.mmap_arena_size)
+		return -FI_ENOSPC;
+
+	dlist_foreach_container(&ep->mmap_idle_list, struct smr_mmap_buf,
+				idle, entry) {
+		if (idle->size == size) {
+			dlist_remove(&idle->entry);
+			*buf = idle;
+			return FI_SUCCESS;
+		}
+	}
+
+	/* Make room by dropping the least recently used idle files */
+	while (ep->mmap_buf_size + size > smr_env.mmap_arena_size &&
+	       !dlist_empty(&ep->mmap_idle_list)) {
+		idle = container_of(ep->mmap_idle_list.prev,
+				    struct smr_mmap_buf, entry);
+		dlist_remove(&idle->entry);
+		ep->mmap_buf_size -= idle->size;
+		smr_mmap_buf_free(idle);
+	}
+
+	if (ep->mmap_buf_size + size > smr_env.mmap_arena_size)
+		return -FI_ENOSPC;
+
+	*buf = smr_mmap_buf_create(ep, size);
+	if (!*buf)
+		return -FI_ENOMEM;
+
+	ep->mmap_buf_size += size;
+	return FI_SUCCESS;
+}
+
+void smr_mmap_release(struct smr_ep *ep, struct smr_mmap_buf *buf)
+{
+	dlist_insert_head(&buf->entry, &ep->mmap_idle_list);
+}
+
+static void smr_mmap_unmap(struct smr_ep *ep, struct smr_mmap_map *map)
+{
+	dlist_remove(&map->entry);
+	ep->mmap_map_size -= map->size;
+	munmap(map->ptr, map->size);
+	free(map);
+}
+
+/*
+ * Map a file leased by a peer for a transfer of size bytes.  The mapping
+ * stays cached, as the peer reuses the file for later transfers.  Cached
+ * mappings keep the files of peers alive, so they count against the arena
+ * size as well.
+ */
+void *smr_mmap_map_peer(struct smr_ep *ep, const char *name, size_t size)
+{
+	struct smr_mmap_map *map;
+	int fd;
+
+	size = smr_mmap_class_size(size);
+	dlist_foreach_container(&ep->mmap_map_list, struct smr_mmap_map,
+				map, entry) {
+		if (map->size == size && !strcmp(map->name, name)) {
+			dlist_remove(&map->entry);
+			dlist_insert_head(&map->entry, &ep->mmap_map_list);
+			return map->ptr;
+		}
+	}
+
+	while (ep->mmap_map_size + size > smr_env.mmap_arena_size &&
+	       !dlist_empty(&ep->mmap_map_list))
+		smr_mmap_unmap(ep, container_of(ep->mmap_map_list.prev,
+						struct smr_mmap_map, entry));
+
+	map = calloc(1, sizeof(*map));
+	if (!map)
+		return NULL;
+
+	fd = shm_open(name, O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL, "shm_open error\n");
+		goto free;
+	}
+
+	map->ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map->ptr == MAP_FAILED) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL, "mmap error %s\n",
+			strerror(errno));
+		goto free;
+	}
+
+	strncpy(map->name, name, SMR_NAME_MAX - 1);
+	map->size = size;
+	dlist_insert_head(&map->entry, &ep->mmap_map_list);
+	ep->mmap_map_size += size;
+	return map->ptr;
+
+free:
+	free(map);
+	return NULL;
+}
+
+void smr_mmap_cleanup(struct smr_ep *ep)
+{
+	struct smr_mmap_buf *buf;
+	struct smr_mmap_map *map;
+	struct dlist_entry *tmp;
+
+	dlist_foreach_container_safe(&ep->mmap_buf_list, struct smr_mmap_buf,
+				     buf, ep_entry, tmp)
+		smr_mmap_buf_free(buf);
+
+	dlist_foreach_container_safe(&ep->mmap_map_list, struct smr_mmap_map,
+				     map, entry, tmp)
+		smr_mmap_unmap(ep, map);
+}
@@ -123,9 +123,14 @@ static ssize_t smr_generic_sendmsg(struct smr_ep *ep, const struct iovec *iov,
 		goto unlock;
 	}
 	smr_cmd_queue_commit(ce, pos);
+	smr_signal(peer_smr);
 
-	if (proto != smr_src_inline && proto != smr_src_inject)
+	if (proto != smr_src_inline && proto != smr_src_inject) {
+		/* segments are copied as the peer drains them */
+		if (proto == smr_src_sar)
+			smr_ep_signal_progress(ep);
 		goto unlock;
+	}
 
 	ret = smr_complete_tx(ep, context, op, op_flags);
 	if (ret) {
@@ -219,6 +224,7 @@ static ssize_t smr_generic_inject(struct fid_ep *ep_fid, const void *buf,
 		return -FI_EAGAIN;
 	}
 	smr_cmd_queue_commit(ce, pos);
+	smr_signal(peer_smr);
 	ofi_ep_peer_tx_cntr_inc(&ep->util_ep, op);
 
 	return FI_SUCCESS;
@@ -130,7 +130,7 @@ static int smr_progress_resp_entry(struct smr_ep *ep, struct smr_resp *resp,
 		resp->status = SMR_STATUS_SUCCESS;
 		break;
 	case smr_src_mmap:
-		if (!pending->map_name)
+		if (!pending->map_name && !pending->map_buf)
 			break;
 		if (pending->cmd.msg.hdr.op == ofi_op_read_req) {
 			if (!*err) {
@@ -153,7 +153,14 @@ static int smr_progress_resp_entry(struct smr_ep *ep, struct smr_resp *resp,
 					pending->bytes_done = (size_t) hmem_copy_ret;
 				}
 			}
-			munmap(pending->map_ptr, pending->cmd.msg.hdr.size);
+			if (pending->map_name)
+				munmap(pending->map_ptr,
+				       pending->cmd.msg.hdr.size);
+		}
+		if (pending->map_buf) {
+			smr_mmap_release(ep, pending->map_buf);
+			pending->map_buf = NULL;
+			break;
 		}
 		shm_unlink(pending->map_name->name);
 		dlist_remove(&pending->map_name->entry);
@@ -206,11 +213,11 @@ static int smr_progress_resp_entry(struct smr_ep *ep, struct smr_resp *resp,
 	return FI_SUCCESS;
 }
 
-static void smr_progress_resp(struct smr_ep *ep)
+static int smr_progress_resp(struct smr_ep *ep)
 {
 	struct smr_resp *resp;
 	struct smr_tx_entry *pending;
-	int ret;
+	int ret, cnt = 0;
 
 	ofi_genlock_lock(&ep->util_ep.lock);
 	while (!ofi_cirque_isempty(smr_resp_queue(ep->region))) {
@@ -237,8 +244,10 @@ static void smr_progress_resp(struct smr_ep *ep)
 		}
 		ofi_freestack_push(ep->tx_fs, pending);
 		ofi_cirque_discard(smr_resp_queue(ep->region));
+		cnt++;
 	}
 	ofi_genlock_unlock(&ep->util_ep.lock);
+	return cnt;
 }
 
 static int smr_progress_inline(struct smr_cmd *cmd, struct ofi_mr **mr,
@@ -336,6 +345,37 @@ out:
 	return -ret;
 }
 
+static int smr_mmap_copy(struct smr_cmd *cmd, void *mapped_ptr,
+			 struct ofi_mr **mr, struct iovec *iov,
+			 size_t iov_count, size_t *total_len)
+{
+	ssize_t hmem_copy_ret;
+	int ret = 0;
+
+	if (cmd->msg.hdr.op == ofi_op_read_req) {
+		hmem_copy_ret = ofi_copy_from_mr_iov(mapped_ptr,
+					cmd->msg.hdr.size, mr, iov,
+					iov_count, 0);
+	} else {
+		hmem_copy_ret = ofi_copy_to_mr_iov(mr, iov, iov_count, 0,
+					mapped_ptr, cmd->msg.hdr.size);
+	}
+
+	if (hmem_copy_ret < 0) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"mmap copy iov failed with code %d\n",
+			(int)(-hmem_copy_ret));
+		ret = hmem_copy_ret;
+	} else if (hmem_copy_ret != cmd->msg.hdr.size) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"mmap copy iov truncated\n");
+		ret = -FI_ETRUNC;
+	}
+
+	*total_len = hmem_copy_ret;
+	return ret;
+}
+
 static int smr_mmap_peer_copy(struct smr_ep *ep, struct smr_cmd *cmd,
 			      struct ofi_mr **mr, struct iovec *iov,
 			      size_t iov_count, size_t *total_len)
@@ -344,7 +384,6 @@ static int smr_mmap_peer_copy(struct smr_ep *ep, struct smr_cmd *cmd,
 	void *mapped_ptr;
 	int fd, num;
 	int ret = 0;
-	ssize_t hmem_copy_ret;
 
 	num = smr_mmap_name(shm_name,
 			ep->region->map->peers[cmd->msg.hdr.id].peer.name,
@@ -354,6 +393,15 @@ static int smr_mmap_peer_copy(struct smr_ep *ep, struct smr_cmd *cmd,
 		return -errno;
 	}
 
+	if (cmd->msg.hdr.op_flags & SMR_MMAP_ARENA) {
+		mapped_ptr = smr_mmap_map_peer(ep, shm_name, cmd->msg.hdr.size);
+		if (!mapped_ptr)
+			return -FI_ENOMEM;
+
+		return smr_mmap_copy(cmd, mapped_ptr, mr, iov, iov_count,
+				     total_len);
+	}
+
 	fd = shm_open(shm_name, O_RDWR, S_IRUSR | S_IWUSR);
 	if (fd < 0) {
 		FI_WARN(&smr_prov, FI_LOG_AV, "shm_open error\n");
@@ -368,27 +416,7 @@ static int smr_mmap_peer_copy(struct smr_ep *ep, struct smr_cmd *cmd,
 		goto unlink_close;
 	}
 
-	if (cmd->msg.hdr.op == ofi_op_read_req) {
-		hmem_copy_ret = ofi_copy_from_mr_iov(mapped_ptr,
-					cmd->msg.hdr.size, mr, iov,
-					iov_count, 0);
-	} else {
-		hmem_copy_ret = ofi_copy_to_mr_iov(mr, iov, iov_count, 0,
-					mapped_ptr, cmd->msg.hdr.size);
-	}
-
-	if (hmem_copy_ret < 0) {
-		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
-			"mmap copy iov failed with code %d\n",
-			(int)(-hmem_copy_ret));
-		ret = hmem_copy_ret;
-	} else if (hmem_copy_ret != cmd->msg.hdr.size) {
-		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
-			"mmap copy iov truncated\n");
-		ret = -FI_ETRUNC;
-	}
-
-	*total_len = hmem_copy_ret;
+	ret = smr_mmap_copy(cmd, mapped_ptr, mr, iov, iov_count, total_len);
 
 	munmap(mapped_ptr, cmd->msg.hdr.size);
 unlink_close:
@@ -790,6 +818,9 @@ static int smr_start_common(struct smr_ep *ep, struct smr_cmd *cmd,
 		smr_get_peer_srx(ep)->owner_ops->free_entry(rx_entry);
 	}
 
+	if (cmd->msg.hdr.op_src != smr_src_inline &&
+	    cmd->msg.hdr.op_src != smr_src_inject)
+		smr_signal(smr_peer_region(ep->region, cmd->msg.hdr.id));
 	return 0;
 }
 
@@ -853,10 +884,13 @@ int smr_unexp_start(struct fi_peer_rx_entry *rx_entry)
 	int ret;
 
 	if (cmd_ctx->cmd.msg.hdr.op_src == smr_src_sar ||
-	    cmd_ctx->cmd.msg.hdr.op_src == smr_src_inject)
+	    cmd_ctx->cmd.msg.hdr.op_src == smr_src_inject) {
 		ret = smr_copy_saved(cmd_ctx, rx_entry);
-	else
+	} else {
 		ret = smr_start_common(cmd_ctx->ep, &cmd_ctx->cmd, rx_entry);
+		if (cmd_ctx->cmd.msg.hdr.op_src == smr_src_ipc)
+			smr_ep_signal_progress(cmd_ctx->ep);
+	}
 
 	ofi_buf_free(cmd_ctx);
 
@@ -1092,6 +1126,11 @@ static int smr_progress_cmd_rma(struct smr_ep *ep, struct smr_cmd *cmd,
 		err = -FI_EINVAL;
 	}
 
+	if (cmd->msg.hdr.op_src != smr_src_inline &&
+	    (cmd->msg.hdr.op_src != smr_src_inject ||
+	     (cmd->msg.hdr.op == ofi_op_read_req && cmd->msg.hdr.data)))
+		smr_signal(smr_peer_region(ep->region, cmd->msg.hdr.id));
+
 	if (err) {
 		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
 			"error processing rma op\n");
@@ -1175,6 +1214,7 @@ static int smr_progress_cmd_atomic(struct smr_ep *ep, struct smr_cmd *cmd,
 		if (cmd->msg.hdr.op_flags & SMR_RMA_REQ)
 			ofi_wmb();
 		resp->status = -err;
+		smr_signal(peer_smr);
 	}
 
 	if (err) {
@@ -1200,10 +1240,10 @@ out:
 	return err;
 }
 
-static void smr_progress_cmd(struct smr_ep *ep)
+static int smr_progress_cmd(struct smr_ep *ep)
 {
 	struct smr_cmd_entry *ce;
-	int ret = 0;
+	int ret = 0, cnt = 0;
 	int64_t pos;
 
 	/* ep->util_ep.lock is used to serialize the message/tag matching.
@@ -1253,6 +1293,7 @@ static void smr_progress_cmd(struct smr_ep *ep)
 			ret = -FI_EINVAL;
 		}
 		smr_cmd_queue_release(smr_cmd_queue(ep->region), ce, pos);
+		cnt++;
 		if (ret) {
 			if (ret != -FI_EAGAIN) {
 				FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
@@ -1262,6 +1303,7 @@ static void smr_progress_cmd(struct smr_ep *ep)
 		}
 	}
 	ofi_genlock_unlock(&ep->util_ep.lock);
+	return cnt;
 }
 
 void smr_progress_ipc_list(struct smr_ep *ep)
@@ -1320,6 +1362,7 @@ void smr_progress_ipc_list(struct smr_ep *ep)
 		 * buffer is now free to be reused
 		 */
 		resp->status = SMR_STATUS_SUCCESS;
+		smr_signal(peer_smr);
 
 		ofi_mr_cache_delete(domain->ipc_cache, ipc_entry->ipc_entry);
 		ofi_free_async_copy_event(iface, device,
@@ -1441,19 +1484,77 @@ static void smr_progress_sar_list(struct smr_ep *ep)
 	ofi_genlock_unlock(&ep->util_ep.lock);
 }
 
-void smr_ep_progress(struct util_ep *util_ep)
+/* Returns the number of commands and responses handled. */
+static int smr_progress(struct smr_ep *ep)
 {
-	struct smr_ep *ep;
-
-	ep = container_of(util_ep, struct smr_ep, util_ep);
+	int cnt;
 
 	if (smr_env.use_dsa_sar)
 		smr_dsa_progress(ep);
-	smr_progress_resp(ep);
+	cnt = smr_progress_resp(ep);
 	smr_progress_sar_list(ep);
-	smr_progress_cmd(ep);
+	cnt += smr_progress_cmd(ep);
 
 	/* always drive forward the ipc list since the completion is
 	 * independent of any action by the provider */
 	ep->smr_progress_ipc_list(ep);
+	return cnt;
+}
+
+void smr_ep_progress(struct util_ep *util_ep)
+{
+	(void) smr_progress(container_of(util_ep, struct smr_ep, util_ep));
+}
+
+int smr_ep_auto_progress(struct fid *fid)
+{
+	return smr_progress(container_of(fid, struct smr_ep,
+					 util_ep.ep_fid.fid));
+}
+
+/*
+ * Called by the progress thread before it blocks.  Peers signal new
+ * commands and the responses that complete our transfers, but segmented
+ * transfers and device copies are advanced by polling, so the thread
+ * keeps running while any are in flight.
+ */
+static bool smr_ep_busy(struct smr_ep *ep)
+{
+	struct smr_tx_entry *pending;
+	struct smr_resp *resp;
+
+	if (!smr_cmd_queue_isempty(smr_cmd_queue(ep->region)) ||
+	    !dlist_empty(&ep->sar_list) ||
+	    !dlist_empty(&ep->ipc_cpy_pend_list))
+		return true;
+
+	if (ofi_cirque_isempty(smr_resp_queue(ep->region)))
+		return false;
+
+	resp = ofi_cirque_head(smr_resp_queue(ep->region));
+	pending = (struct smr_tx_entry *) resp->msg_id;
+	return resp->status != SMR_STATUS_BUSY ||
+	       pending->cmd.msg.hdr.op_src == smr_src_sar;
+}
+
+int smr_ep_auto_trywait(void *arg)
+{
+	struct smr_ep *ep = arg;
+	char buf[16];
+	int ret = 0;
+
+	while (ofi_recv_socket(ep->signal_sock, buf, sizeof(buf), 0) > 0)
+		;
+
+	if (ofi_genlock_trylock(&ep->util_ep.lock))
+		return -FI_EAGAIN;
+
+	ofi_atomic_set32(&ep->region->signal_wait, 1);
+	ofi_mb();
+	if (smr_ep_busy(ep)) {
+		ofi_atomic_set32(&ep->region->signal_wait, 0);
+		ret = -FI_EAGAIN;
+	}
+	ofi_genlock_unlock(&ep->util_ep.lock);
+	return ret;
 }
@@ -95,6 +95,7 @@ static ssize_t smr_rma_fast(struct smr_ep *ep, struct smr_region *peer_smr,
 			    (op == ofi_op_write) ? ofi_op_write_async :
 			    ofi_op_read_async, op_flags);
 	smr_cmd_queue_commit(ce, pos);
+	smr_signal(peer_smr);
 	return FI_SUCCESS;
 }
 
@@ -184,9 +185,14 @@ static ssize_t smr_generic_rma(struct smr_ep *ep, const struct iovec *iov,
 
 	smr_add_rma_cmd(peer_smr, rma_iov, rma_count, ce);
 	smr_cmd_queue_commit(ce, pos);
+	smr_signal(peer_smr);
 
-	if (proto != smr_src_inline && proto != smr_src_inject)
+	if (proto != smr_src_inline && proto != smr_src_inject) {
+		/* segments are copied as the peer drains them */
+		if (proto == smr_src_sar)
+			smr_ep_signal_progress(ep);
 		goto unlock;
+	}
 
 	ret = smr_complete_tx(ep, context, op, op_flags);
 	if (ret) {
@@ -363,6 +369,7 @@ static ssize_t smr_generic_rma_inject(struct fid_ep *ep_fid, const void *buf,
 	}
 	smr_add_rma_cmd(peer_smr, &rma_iov, 1, ce);
 	smr_cmd_queue_commit(ce, pos);
+	smr_signal(peer_smr);
 
 out:
 	if (!ret)
@@ -38,8 +38,10 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <ofi_mb.h>
 #include <ofi_xpmem.h>
 
 #include "smr_util.h"
@@ -49,6 +51,9 @@ struct dlist_entry ep_name_list;
 DEFINE_LIST(ep_name_list);
 pthread_mutex_t ep_list_lock = PTHREAD_MUTEX_INITIALIZER;
 
+static int smr_signal_sock = -1;
+static pthread_once_t smr_signal_once = PTHREAD_ONCE_INIT;
+
 void smr_cleanup(void)
 {
 	struct smr_ep_name *ep_name;
@@ -59,6 +64,58 @@ void smr_cleanup(void)
 				     ep_name, entry, tmp)
 		free(ep_name);
 	pthread_mutex_unlock(&ep_list_lock);
+
+	if (smr_signal_sock >= 0)
+		close(smr_signal_sock);
+}
+
+static void smr_signal_init(void)
+{
+	int sock;
+
+	sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (sock < 0) {
+		FI_WARN(&smr_prov, FI_LOG_EP_DATA,
+			"unable to create signal socket: %s\n",
+			strerror(errno));
+		return;
+	}
+
+	if (fi_fd_nonblock(sock)) {
+		close(sock);
+		return;
+	}
+	smr_signal_sock = sock;
+}
+
+/*
+ * Wakes the progress thread of a peer after queueing it work.  The fence
+ * orders the queued work before the flag check, pairing with the one the
+ * waiting thread makes between setting the flag and checking its queues.
+ * The first sender that sees the flag clears it, so a burst of commands
+ * costs a single datagram.
+ */
+void smr_signal(struct smr_region *smr)
+{
+	struct sockaddr_un addr;
+	char byte = 0;
+
+	ofi_mb();
+	if (!ofi_atomic_get32(&smr->signal_wait) ||
+	    !ofi_atomic_cas_bool32(&smr->signal_wait, 1, 0))
+		return;
+
+	pthread_once(&smr_signal_once, smr_signal_init);
+	if (smr_signal_sock < 0)
+		return;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, smr->signal_addr, smr->signal_addrlen);
+	(void) sendto(smr_signal_sock, &byte, sizeof(byte), 0,
+		      (struct sockaddr *) &addr,
+		      offsetof(struct sockaddr_un, sun_path) +
+		      smr->signal_addrlen);
 }
 
 static void smr_peer_addr_init(struct smr_addr *peer)
@@ -303,6 +360,8 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 	(*smr)->peer_data_offset = peer_data_offset;
 	(*smr)->name_offset = name_offset;
 	(*smr)->sock_name_offset = sock_name_offset;
+	ofi_atomic_initialize32(&(*smr)->signal_wait, 0);
+	(*smr)->signal_addrlen = 0;
 	(*smr)->max_sar_buf_per_peer = SMR_BUF_BATCH_MAX;
 
 	smr_cmd_queue_init(smr_cmd_queue(*smr), rx_size);
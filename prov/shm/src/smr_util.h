@@ -54,7 +54,7 @@
 extern "C" {
 #endif
 
-#define SMR_VERSION	8
+#define SMR_VERSION	10
 
 #define SMR_FLAG_ATOMIC	(1 << 0)
 #define SMR_FLAG_DEBUG	(1 << 1)
@@ -83,6 +83,7 @@ enum {
 #define SMR_TX_COMPLETION	(1 << 2)
 #define SMR_RX_COMPLETION	(1 << 3)
 #define SMR_MULTI_RECV		(1 << 4)
+#define SMR_MMAP_ARENA		(1 << 5)
 
 /* CMA/XPMEM capability. Generic acronym used:
  * VMA: Virtual Memory Address */
@@ -168,6 +169,7 @@ struct smr_cmd {
 #define SMR_NAME_MAX	256
 #define SMR_PATH_MAX	(SMR_NAME_MAX + sizeof(SMR_DIR))
 #define SMR_SOCK_NAME_MAX sizeof(((struct sockaddr_un *)0)->sun_path)
+#define SMR_SIGNAL_ADDR_MAX	16
 
 struct smr_addr {
 	char		name[SMR_NAME_MAX];
@@ -251,6 +253,12 @@ struct smr_region {
 	size_t		peer_data_offset;
 	size_t		name_offset;
 	size_t		sock_name_offset;
+
+	/* set while the progress thread of the owner waits for commands,
+	 * which senders then wake through the abstract socket address */
+	ofi_atomic32_t	signal_wait;
+	uint8_t		signal_addrlen;
+	char		signal_addr[SMR_SIGNAL_ADDR_MAX];
 };
 
 struct smr_resp {
@@ -367,6 +375,7 @@ struct smr_region *smr_map_get(struct smr_map *map, int64_t id);
 int	smr_create(const struct fi_provider *prov, struct smr_map *map,
 		   const struct smr_attr *attr, struct smr_region *volatile *smr);
 void	smr_free(struct smr_region *smr);
+void	smr_signal(struct smr_region *smr);
 
 #ifdef __cplusplus
 }
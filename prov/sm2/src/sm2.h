@@ -75,7 +75,7 @@
 #define SM2_IOV_LIMIT		4
 #define SM2_PREFIX		"fi_sm2://"
 #define SM2_PREFIX_NS		"fi_ns://"
-#define SM2_VERSION		1
+#define SM2_VERSION		2
 #define SM2_IOV_LIMIT		4
 #define SM2_INJECT_SIZE		(SM2_XFER_ENTRY_SIZE - sizeof(struct sm2_xfer_hdr))
 
@@ -268,6 +268,8 @@ struct sm2_ep {
 	struct fid_ep *srx;
 	struct ofi_bufpool *xfer_ctx_pool;
 	int ep_idx;
+	/* peers wake the progress thread through it, see sm2_signal() */
+	int signal_sock;
 };
 
 static inline struct fid_peer_srx *sm2_get_peer_srx(struct sm2_ep *ep)
@@ -316,7 +318,7 @@ static inline uint64_t sm2_rx_cq_flags(uint32_t op, uint64_t rx_flags,
 
 void sm2_ep_progress(struct util_ep *util_ep);
 
-void sm2_progress_recv(struct sm2_ep *ep);
+int sm2_progress_recv(struct sm2_ep *ep);
 
 int sm2_unexp_start(struct fi_peer_rx_entry *rx_entry);
 
@@ -54,6 +54,7 @@
 #define SM2_MAX_GDRCOPY_SIZE 3072
 /* TODO: Make the number of XFER ENTRY's configurable */
 #define SM2_NUM_XFER_ENTRY_PER_PEER 1024
+#define SM2_SIGNAL_ADDR_MAX	    16
 
 typedef unsigned int sm2_gid_t;
 
@@ -92,11 +93,18 @@ struct sm2_region {
 	/* offsets from start of sm2_region */
 	ptrdiff_t recv_queue_offset;
 	ptrdiff_t freestack_offset;
+
+	/* set while the progress thread of the owner waits for entries,
+	 * which senders then wake through the abstract socket address */
+	ofi_atomic32_t signal_wait;
+	uint8_t signal_addrlen;
+	char signal_addr[SM2_SIGNAL_ADDR_MAX];
 };
 
 size_t sm2_calculate_size_offsets(ptrdiff_t *rq_offset, ptrdiff_t *fs_offset);
 int sm2_create(const struct fi_provider *prov, const struct sm2_attr *attr,
 	       struct sm2_mmap *sm2_mmap, sm2_gid_t *gid);
+void sm2_signal(struct sm2_region *smr);
 
 ssize_t sm2_mmap_cleanup(struct sm2_mmap *map);
 
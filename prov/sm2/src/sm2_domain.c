@@ -114,6 +114,17 @@ int sm2_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 		return ret;
 	}
 
+	if (info->domain_attr->data_progress == FI_PROGRESS_AUTO) {
+		ret = ofi_domain_start_progress(&sm2_domain->util_domain);
+		if (ret) {
+			if (sm2_domain->ipc_cache)
+				ofi_ipc_cache_destroy(sm2_domain->ipc_cache);
+			(void) ofi_domain_close(&sm2_domain->util_domain);
+			free(sm2_domain);
+			return ret;
+		}
+	}
+
 	*domain = &sm2_domain->util_domain.domain_fid;
 	(*domain)->fid.ops = &sm2_domain_fi_ops;
 	(*domain)->ops = &sm2_domain_ops;
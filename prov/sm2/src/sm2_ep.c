@@ -38,6 +38,7 @@
 
 #include "ofi_hmem.h"
 #include "ofi_iov.h"
+#include "ofi_mb.h"
 #include "ofi_mem.h"
 #include "ofi_mr.h"
 #include "sm2.h"
@@ -351,6 +352,12 @@ static int sm2_ep_close(struct fid *fid)
 	struct sm2_ep *ep =
 		container_of(fid, struct sm2_ep, util_ep.ep_fid.fid);
 
+	if (ep->signal_sock >= 0) {
+		ofi_progress_del(ep->util_ep.domain->progress,
+				 &ep->util_ep.ep_fid.fid);
+		close(ep->signal_sock);
+	}
+
 	cleanup_shm_resources(ep);
 
 	if (ep->srx && ep->util_ep.ep_fid.msg != &sm2_no_recv_msg_ops)
@@ -388,6 +395,93 @@ static int sm2_ep_trywait(void *arg)
 	return FI_SUCCESS;
 }
 
+/* Called by the domain progress thread with the endpoint lock held */
+static int sm2_ep_auto_progress(struct fid *fid)
+{
+	return sm2_progress_recv(container_of(fid, struct sm2_ep,
+					      util_ep.ep_fid.fid));
+}
+
+/*
+ * Called by the progress thread before it blocks.  Every entry, including
+ * the returns that complete our sends, arrives on the FIFO, and the
+ * writer signals us if we set the flag before it checks.
+ */
+static int sm2_ep_auto_trywait(void *arg)
+{
+	struct sm2_ep *ep = arg;
+	char buf[16];
+
+	while (ofi_recv_socket(ep->signal_sock, buf, sizeof(buf), 0) > 0)
+		;
+
+	ofi_atomic_set32(&ep->self_region->signal_wait, 1);
+	ofi_mb();
+	if (sm2_fifo_isempty(ep))
+		return FI_SUCCESS;
+
+	ofi_atomic_set32(&ep->self_region->signal_wait, 0);
+	return -FI_EAGAIN;
+}
+
+/*
+ * Peers write to the FIFO without a file descriptor to poll, so the
+ * progress thread also waits on a datagram socket.  Its abstract address
+ * is stored in the region, where writers find it to wake the thread.
+ */
+static int sm2_ep_start_progress(struct sm2_ep *ep)
+{
+	struct sockaddr_un addr;
+	socklen_t len;
+	int ret;
+
+	ep->signal_sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (ep->signal_sock < 0)
+		return -errno;
+
+	/* binding only the address family autobinds an abstract name */
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (bind(ep->signal_sock, (struct sockaddr *) &addr,
+		 sizeof(addr.sun_family))) {
+		ret = -errno;
+		goto err;
+	}
+
+	len = sizeof(addr);
+	if (getsockname(ep->signal_sock, (struct sockaddr *) &addr, &len)) {
+		ret = -errno;
+		goto err;
+	}
+
+	len -= offsetof(struct sockaddr_un, sun_path);
+	if (len > SM2_SIGNAL_ADDR_MAX) {
+		ret = -FI_EINVAL;
+		goto err;
+	}
+
+	ret = fi_fd_nonblock(ep->signal_sock);
+	if (ret)
+		goto err;
+
+	memcpy(ep->self_region->signal_addr, addr.sun_path, len);
+	ep->self_region->signal_addrlen = len;
+
+	ret = ofi_progress_add(ep->util_ep.domain->progress,
+			       &ep->util_ep.ep_fid.fid, &ep->util_ep.lock,
+			       sm2_ep_auto_progress, ep->signal_sock,
+			       sm2_ep_auto_trywait, ep);
+	if (ret)
+		goto err;
+	return 0;
+err:
+	FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
+		"unable to start auto progress: %s\n", fi_strerror(-ret));
+	close(ep->signal_sock);
+	ep->signal_sock = -1;
+	return ret;
+}
+
 static int sm2_ep_bind_cq(struct sm2_ep *ep, struct util_cq *cq, uint64_t flags)
 {
 	int ret;
@@ -569,6 +663,8 @@ static int sm2_ep_ctrl(struct fid *fid, int command, void *arg)
 			ep->util_ep.ep_fid.tagged = &sm2_no_recv_tag_ops;
 		}
 
+		if (ep->util_ep.domain->progress)
+			ret = sm2_ep_start_progress(ep);
 		break;
 	default:
 		return -FI_ENOSYS;
@@ -616,6 +712,7 @@ int sm2_endpoint(struct fid_domain *domain, struct fi_info *info,
 	ep = calloc(1, sizeof(*ep));
 	if (!ep)
 		return -FI_ENOMEM;
+	ep->signal_sock = -1;
 
 	ret = sm2_endpoint_name(ep, name, info->src_addr, info->src_addrlen);
 
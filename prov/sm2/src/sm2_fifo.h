@@ -191,6 +191,13 @@ static inline void sm2_fifo_write(struct sm2_ep *ep, sm2_gid_t peer_gid,
 	}
 
 	atomic_wmb();
+	sm2_signal(peer_region);
+}
+
+static inline bool sm2_fifo_isempty(struct sm2_ep *ep)
+{
+	/* writers swap the tail before they link the entry */
+	return sm2_recv_queue(ep->self_region)->tail == SM2_FIFO_FREE;
 }
 
 /* Read, Dequeue */
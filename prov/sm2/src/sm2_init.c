@@ -31,11 +31,14 @@
  * SOFTWARE.
  */
 
+#include <sys/socket.h>
+
 #include <rdma/fi_errno.h>
 
 #include "sm2.h"
 #include "sm2_fifo.h"
 #include <ofi_hmem.h>
+#include <ofi_mb.h>
 #include <ofi_prov.h>
 
 size_t sm2_calculate_size_offsets(ptrdiff_t *rq_offset, ptrdiff_t *fs_offset)
@@ -93,6 +96,8 @@ int sm2_create(const struct fi_provider *prov, const struct sm2_attr *attr,
 	smr->flags = attr->flags;
 	smr->recv_queue_offset = recv_queue_offset;
 	smr->freestack_offset = freestack_offset;
+	ofi_atomic_initialize32(&smr->signal_wait, 0);
+	smr->signal_addrlen = 0;
 
 	sm2_fifo_init(sm2_recv_queue(smr));
 	smr_freestack_init(sm2_freestack(smr), SM2_NUM_XFER_ENTRY_PER_PEER,
@@ -119,6 +124,58 @@ remove:
 	return ret;
 }
 
+static int sm2_signal_sock = -1;
+static pthread_once_t sm2_signal_once = PTHREAD_ONCE_INIT;
+
+static void sm2_signal_init(void)
+{
+	int sock;
+
+	sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (sock < 0) {
+		FI_WARN(&sm2_prov, FI_LOG_EP_DATA,
+			"unable to create signal socket: %s\n",
+			strerror(errno));
+		return;
+	}
+
+	if (fi_fd_nonblock(sock)) {
+		close(sock);
+		return;
+	}
+	sm2_signal_sock = sock;
+}
+
+/*
+ * Wakes the progress thread of a peer after writing to its FIFO.  The
+ * fence orders the write before the flag check, pairing with the one the
+ * waiting thread makes between setting the flag and checking its FIFO.
+ * The first writer that sees the flag clears it, so a burst of entries
+ * costs a single datagram.
+ */
+void sm2_signal(struct sm2_region *smr)
+{
+	struct sockaddr_un addr;
+	char byte = 0;
+
+	ofi_mb();
+	if (!ofi_atomic_get32(&smr->signal_wait) ||
+	    !ofi_atomic_cas_bool32(&smr->signal_wait, 1, 0))
+		return;
+
+	pthread_once(&sm2_signal_once, sm2_signal_init);
+	if (sm2_signal_sock < 0)
+		return;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, smr->signal_addr, smr->signal_addrlen);
+	(void) sendto(sm2_signal_sock, &byte, sizeof(byte), 0,
+		      (struct sockaddr *) &addr,
+		      offsetof(struct sockaddr_un, sun_path) +
+		      smr->signal_addrlen);
+}
+
 /*
  * Convert strings node + service into a single string addr
  */
@@ -227,13 +284,21 @@ static int sm2_getinfo(uint32_t version, const char *node, const char *service,
 						 (char **) &cur->src_addr,
 						 &cur->src_addrlen);
 		}
+
+		/* Auto progress runs a progress thread and must be requested */
+		if (!hints || !hints->domain_attr ||
+		    hints->domain_attr->data_progress != FI_PROGRESS_AUTO)
+			cur->domain_attr->data_progress = FI_PROGRESS_MANUAL;
+		else
+			cur->domain_attr->threading = FI_THREAD_SAFE;
 	}
 	return 0;
 }
 
 static void sm2_fini(void)
 {
-	/* no-op */
+	if (sm2_signal_sock >= 0)
+		close(sm2_signal_sock);
 }
 
 struct fi_provider sm2_prov = {
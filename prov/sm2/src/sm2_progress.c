@@ -760,7 +760,7 @@ static inline void sm2_progress_return(struct sm2_ep *ep,
 	smr_freestack_push(sm2_freestack(ep->self_region), xfer_entry);
 }
 
-void sm2_progress_recv(struct sm2_ep *ep)
+int sm2_progress_recv(struct sm2_ep *ep)
 {
 	struct sm2_xfer_entry *xfer_entry;
 	int ret = 0, i;
@@ -801,6 +801,7 @@ void sm2_progress_recv(struct sm2_ep *ep)
 			break;
 		}
 	}
+	return i;
 }
 
 void sm2_ep_progress(struct util_ep *util_ep)
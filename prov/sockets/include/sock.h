@@ -77,6 +77,7 @@
 #define SOCK_EP_MAX_TX_CNT (16)
 #define SOCK_EP_MAX_RX_CNT (16)
 #define SOCK_EP_MAX_IOV_LIMIT (8)
+#define SOCK_RX_HASH_SIZE (256)
 #define SOCK_EP_TX_SZ (256)
 #define SOCK_EP_RX_SZ (256)
 #define SOCK_EP_MIN_MULTI_RECV (64)
@@ -620,6 +621,10 @@ struct sock_rx_entry {
 	struct dlist_entry entry;
 	struct slist_entry pool_entry;
 	struct sock_rx_ctx *rx_ctx;
+
+	/* position in the matching index, see sock_rx_entry.c */
+	uint64_t seq;
+	struct dlist_entry match_entry;
 };
 
 struct sock_rx_ctx {
@@ -653,6 +658,13 @@ struct sock_rx_ctx {
 	struct dlist_entry ep_list;
 	ofi_mutex_t lock;
 
+	/* index over rx_entry_list and rx_buffered_list by (source, tag) */
+	struct dlist_entry rx_entry_hash[SOCK_RX_HASH_SIZE];
+	struct dlist_entry rx_entry_wildcard;
+	struct dlist_entry rx_buffered_hash[SOCK_RX_HASH_SIZE];
+	uint64_t rx_entry_seq;
+	uint64_t rx_buffered_seq;
+
 	struct dlist_entry *progress_start;
 
 	struct fi_rx_attr attr;
@@ -1117,6 +1129,7 @@ int sock_av_open(struct fid_domain *domain, struct fi_av_attr *attr,
 		 struct fid_av **av, void *context);
 int sock_av_compare_addr(struct sock_av *av, fi_addr_t addr1, fi_addr_t addr2);
 int sock_av_get_addr_index(struct sock_av *av, union ofi_sock_ip *addr);
+uint64_t sock_av_addr_key(struct sock_av *av, fi_addr_t addr);
 
 struct sock_conn *sock_ep_lookup_conn(struct sock_ep_attr *attr, fi_addr_t index,
 				      union ofi_sock_ip *addr);
@@ -1154,7 +1167,11 @@ void sock_pe_finalize(struct sock_pe *pe);
 
 struct sock_rx_entry *sock_rx_new_entry(struct sock_rx_ctx *rx_ctx);
 struct sock_rx_entry *sock_rx_new_buffered_entry(struct sock_rx_ctx *rx_ctx,
-						 size_t len);
+						 size_t len, uint64_t addr,
+						 uint64_t tag, uint8_t is_tagged);
+void sock_rx_enqueue_entry(struct sock_rx_ctx *rx_ctx,
+			   struct sock_rx_entry *rx_entry);
+void sock_rx_dequeue_entry(struct sock_rx_entry *rx_entry);
 struct sock_rx_entry *sock_rx_get_entry(struct sock_rx_ctx *rx_ctx,
 					uint64_t addr, uint64_t tag,
 					uint8_t is_tagged);
@@ -54,6 +54,7 @@
 
 #include "ofi_osd.h"
 #include "ofi_util.h"
+#include "fasthash.h"
 
 #define SOCK_LOG_DBG(...) _SOCK_LOG_DBG(FI_LOG_AV, __VA_ARGS__)
 #define SOCK_LOG_ERROR(...) _SOCK_LOG_ERROR(FI_LOG_AV, __VA_ARGS__)
@@ -112,6 +113,28 @@ int sock_av_compare_addr(struct sock_av *av,
 	return ret;
 }
 
+/* Equal for any two fi_addr_t sock_av_compare_addr() reports as matching */
+uint64_t sock_av_addr_key(struct sock_av *av, fi_addr_t addr)
+{
+	int64_t index;
+	struct sock_av_addr *av_addr;
+	uint64_t key = addr;
+	void *ipaddr;
+
+	index = addr & av->mask;
+
+	ofi_mutex_lock(&av->table_lock);
+	if (index < av->table_hdr->size && index >= 0) {
+		av_addr = &av->table[index];
+		ipaddr = ofi_get_ipaddr(&av_addr->addr.sa);
+		if (ipaddr)
+			key = fasthash64(ipaddr, ofi_sizeofip(&av_addr->addr.sa),
+					 ofi_addr_get_port(&av_addr->addr.sa));
+	}
+	ofi_mutex_unlock(&av->table_lock);
+	return key;
+}
+
 static inline void sock_av_report_success(struct sock_av *av, void *context,
 					  int num_done, uint64_t flags)
 {
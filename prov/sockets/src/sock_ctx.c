@@ -45,6 +45,8 @@ struct sock_rx_ctx *sock_rx_ctx_alloc(const struct fi_rx_attr *attr,
 				      void *context, int use_shared)
 {
 	struct sock_rx_ctx *rx_ctx;
+	int i;
+
 	rx_ctx = calloc(1, sizeof(*rx_ctx));
 	if (!rx_ctx)
 		return NULL;
@@ -55,6 +57,11 @@ struct sock_rx_ctx *sock_rx_ctx_alloc(const struct fi_rx_attr *attr,
 	dlist_init(&rx_ctx->pe_entry_list);
 	dlist_init(&rx_ctx->rx_entry_list);
 	dlist_init(&rx_ctx->rx_buffered_list);
+	dlist_init(&rx_ctx->rx_entry_wildcard);
+	for (i = 0; i < SOCK_RX_HASH_SIZE; i++) {
+		dlist_init(&rx_ctx->rx_entry_hash[i]);
+		dlist_init(&rx_ctx->rx_buffered_hash[i]);
+	}
 	dlist_init(&rx_ctx->ep_list);
 
 	rx_ctx->progress_start = &rx_ctx->rx_buffered_list;
@@ -134,7 +134,7 @@ ssize_t sock_ep_recvmsg(struct fid_ep *ep, const struct fi_msg *msg,
 
 	SOCK_LOG_DBG("New rx_entry: %p (ctx: %p)\n", rx_entry, rx_ctx);
 	ofi_mutex_lock(&rx_ctx->lock);
-	dlist_insert_tail(&rx_entry->entry, &rx_ctx->rx_entry_list);
+	sock_rx_enqueue_entry(rx_ctx, rx_entry);
 	rx_ctx->progress_start = &rx_ctx->rx_buffered_list;
 	ofi_mutex_unlock(&rx_ctx->lock);
 	return 0;
@@ -479,7 +479,7 @@ ssize_t sock_ep_trecvmsg(struct fid_ep *ep,
 
 	ofi_mutex_lock(&rx_ctx->lock);
 	SOCK_LOG_DBG("New rx_entry: %p (ctx: %p)\n", rx_entry, rx_ctx);
-	dlist_insert_tail(&rx_entry->entry, &rx_ctx->rx_entry_list);
+	sock_rx_enqueue_entry(rx_ctx, rx_entry);
 	rx_ctx->progress_start = &rx_ctx->rx_buffered_list;
 	ofi_mutex_unlock(&rx_ctx->lock);
 	return 0;
@@ -1037,7 +1037,8 @@ sock_pe_process_rx_tatomic(struct sock_pe *pe, struct sock_rx_ctx *rx_ctx,
 	pe_entry->data_len = entry_len;
 
 	ofi_mutex_lock(&rx_ctx->lock);
-	rx_entry = sock_rx_new_buffered_entry(rx_ctx, entry_len);
+	rx_entry = sock_rx_new_buffered_entry(rx_ctx, entry_len,
+					      pe_entry->addr, pe_entry->tag, 1);
 	if (!rx_entry) {
 		ofi_mutex_unlock(&rx_ctx->lock);
 		return -FI_ENOMEM;
@@ -1046,8 +1047,6 @@ sock_pe_process_rx_tatomic(struct sock_pe *pe, struct sock_rx_ctx *rx_ctx,
 	rx_entry->rx_op = pe_entry->pe.rx.rx_op;
 	memcpy((void *) (uintptr_t) rx_entry->iov[0].ioc.addr,
 		pe_entry->pe.rx.atomic_src, entry_len);
-	rx_entry->addr = pe_entry->addr;
-	rx_entry->tag = pe_entry->tag;
 	rx_entry->data = pe_entry->data;
 	rx_entry->ignore = 0;
 	rx_entry->comp = pe_entry->comp;
@@ -1056,7 +1055,6 @@ sock_pe_process_rx_tatomic(struct sock_pe *pe, struct sock_rx_ctx *rx_ctx,
 	if (pe_entry->msg_hdr.flags & FI_REMOTE_CQ_DATA)
 		rx_entry->flags |= FI_REMOTE_CQ_DATA;
 	rx_entry->flags |= FI_TAGGED | FI_ATOMIC;
-	rx_entry->is_tagged = 1;
 
 	pe_entry->pe.rx.rx_entry = rx_entry;
 
@@ -1099,7 +1097,7 @@ ssize_t sock_rx_peek_recv(struct sock_rx_ctx *rx_ctx, fi_addr_t addr,
 			rx_buffered->is_claimed = 1;
 
 		if (flags & FI_DISCARD) {
-			dlist_remove(&rx_buffered->entry);
+			sock_rx_dequeue_entry(rx_buffered);
 			sock_rx_release_entry(rx_buffered);
 		}
 		sock_pe_report_recv_completion(&pe_entry);
@@ -1168,7 +1166,7 @@ ssize_t sock_rx_claim_recv(struct sock_rx_ctx *rx_ctx, void *context,
 			sock_pe_report_recv_completion(&pe_entry);
 		}
 
-		dlist_remove(&rx_buffered->entry);
+		sock_rx_dequeue_entry(rx_buffered);
 		sock_rx_release_entry(rx_buffered);
 		if (rx_ctx->progress_start == entry)
 			rx_ctx->progress_start = &rx_ctx->rx_buffered_list;
@@ -1284,10 +1282,10 @@ static int sock_pe_progress_buffered_rx(struct sock_rx_ctx *rx_ctx,
 		if (rx_posted->flags & FI_MULTI_RECV) {
 			if (sock_rx_avail_len(rx_posted) < rx_ctx->min_multi_recv) {
 				pe_entry.flags |= FI_MULTI_RECV;
-				dlist_remove(&rx_posted->entry);
+				sock_rx_dequeue_entry(rx_posted);
 			}
 		} else {
-			dlist_remove(&rx_posted->entry);
+			sock_rx_dequeue_entry(rx_posted);
 		}
 
 		if (rem) {
@@ -1302,7 +1300,7 @@ static int sock_pe_progress_buffered_rx(struct sock_rx_ctx *rx_ctx,
 		 * sock_rx_get_entry() */
 		rx_posted->is_busy = 0;
 
-		dlist_remove(&rx_buffered->entry);
+		sock_rx_dequeue_entry(rx_buffered);
 		sock_rx_release_entry(rx_buffered);
 
 		if ((!(rx_posted->flags & FI_MULTI_RECV) ||
@@ -1368,23 +1366,20 @@ static int sock_pe_process_rx_send(struct sock_pe *pe,
 			SOCK_LOG_DBG("%p: No matching recv, buffering recv (len = %llu)\n",
 				      pe_entry, (long long unsigned int)data_len);
 
-			rx_entry = sock_rx_new_buffered_entry(rx_ctx, data_len);
+			rx_entry = sock_rx_new_buffered_entry(rx_ctx, data_len,
+					pe_entry->addr, pe_entry->tag,
+					pe_entry->msg_hdr.op_type == SOCK_OP_TSEND);
 			if (!rx_entry) {
 				ofi_mutex_unlock(&rx_ctx->lock);
 				return -FI_ENOMEM;
 			}
 
-			rx_entry->addr = pe_entry->addr;
-			rx_entry->tag = pe_entry->tag;
 			rx_entry->data = pe_entry->data;
 			rx_entry->ignore = 0;
 			rx_entry->comp = pe_entry->comp;
 
 			if (pe_entry->msg_hdr.flags & FI_REMOTE_CQ_DATA)
 				rx_entry->flags |= FI_REMOTE_CQ_DATA;
-
-			if (pe_entry->msg_hdr.op_type == SOCK_OP_TSEND)
-				rx_entry->is_tagged = 1;
 		}
 		ofi_mutex_unlock(&rx_ctx->lock);
 		pe_entry->context = rx_entry->context;
@@ -1439,11 +1434,11 @@ static int sock_pe_process_rx_send(struct sock_pe *pe,
 	if (rx_entry->flags & FI_MULTI_RECV) {
 		if (sock_rx_avail_len(rx_entry) < rx_ctx->min_multi_recv) {
 			pe_entry->flags |= FI_MULTI_RECV;
-			dlist_remove(&rx_entry->entry);
+			sock_rx_dequeue_entry(rx_entry);
 		}
 	} else {
 		if (!rx_entry->is_buffered)
-			dlist_remove(&rx_entry->entry);
+			sock_rx_dequeue_entry(rx_entry);
 	}
 	rx_entry->is_busy = 0;
 	ofi_mutex_unlock(&rx_ctx->lock);
@@ -43,6 +43,7 @@
 
 #include "sock.h"
 #include "sock_util.h"
+#include "fasthash.h"
 
 #define SOCK_LOG_DBG(...) _SOCK_LOG_DBG(FI_LOG_EP_DATA, __VA_ARGS__)
 #define SOCK_LOG_ERROR(...) _SOCK_LOG_ERROR(FI_LOG_EP_DATA, __VA_ARGS__)
@@ -81,6 +82,7 @@ struct sock_rx_entry *sock_rx_new_entry(struct sock_rx_ctx *rx_ctx)
 	rx_entry->is_tagged = 0;
 	SOCK_LOG_DBG("New rx_entry: %p, ctx: %p\n", rx_entry, rx_ctx);
 	dlist_init(&rx_entry->entry);
+	dlist_init(&rx_entry->match_entry);
 	rx_ctx->num_left--;
 	return rx_entry;
 }
@@ -100,8 +102,90 @@ void sock_rx_release_entry(struct sock_rx_entry *rx_entry)
 	}
 }
 
+/*
+ * Besides the ordered rx_entry_list and rx_buffered_list, entries are kept
+ * in hash buckets keyed by (source, tag).  Entries posted for any source
+ * hash with FI_ADDR_UNSPEC as the source, and posted tagged entries with
+ * ignore bits set go to rx_entry_wildcard.  Every list is in posting or
+ * arrival order, so the first match of each candidate list is compared by
+ * sequence number to find the oldest.  A lookup for any source falls back
+ * to walking the ordered list.
+ */
+static uint64_t sock_rx_addr_key(struct sock_rx_ctx *rx_ctx, uint64_t addr)
+{
+	if (addr == FI_ADDR_UNSPEC || !rx_ctx->av)
+		return addr;
+
+	return sock_av_addr_key(rx_ctx->av, addr);
+}
+
+static struct dlist_entry *sock_rx_bucket(struct dlist_entry *hash,
+					  uint64_t addr_key, uint64_t tag,
+					  uint8_t is_tagged)
+{
+	uint64_t key[2];
+
+	key[0] = addr_key;
+	key[1] = is_tagged ? tag : 0;
+	return &hash[fasthash64(key, sizeof(key), is_tagged) %
+		     SOCK_RX_HASH_SIZE];
+}
+
+static int sock_rx_match_addr(struct sock_rx_ctx *rx_ctx, uint64_t addr1,
+			      uint64_t addr2)
+{
+	return addr1 == FI_ADDR_UNSPEC || addr2 == FI_ADDR_UNSPEC ||
+	       addr1 == addr2 ||
+	       (rx_ctx->av && !sock_av_compare_addr(rx_ctx->av, addr1, addr2));
+}
+
+static int sock_rx_match_posted(struct sock_rx_ctx *rx_ctx,
+				struct sock_rx_entry *rx_entry, uint64_t addr,
+				uint64_t tag, uint8_t is_tagged)
+{
+	return !rx_entry->is_busy && is_tagged == rx_entry->is_tagged &&
+	       (rx_entry->tag & ~rx_entry->ignore) ==
+	       (tag & ~rx_entry->ignore) &&
+	       sock_rx_match_addr(rx_ctx, rx_entry->addr, addr);
+}
+
+static int sock_rx_match_buffered(struct sock_rx_ctx *rx_ctx,
+				  struct sock_rx_entry *rx_entry, uint64_t addr,
+				  uint64_t tag, uint64_t ignore,
+				  uint8_t is_tagged)
+{
+	return !rx_entry->is_busy && is_tagged == rx_entry->is_tagged &&
+	       !rx_entry->is_claimed &&
+	       (rx_entry->tag & ~ignore) == (tag & ~ignore) &&
+	       sock_rx_match_addr(rx_ctx, rx_entry->addr, addr);
+}
+
+void sock_rx_enqueue_entry(struct sock_rx_ctx *rx_ctx,
+			   struct sock_rx_entry *rx_entry)
+{
+	struct dlist_entry *list;
+
+	rx_entry->seq = rx_ctx->rx_entry_seq++;
+	dlist_insert_tail(&rx_entry->entry, &rx_ctx->rx_entry_list);
+
+	if (rx_entry->is_tagged && rx_entry->ignore)
+		list = &rx_ctx->rx_entry_wildcard;
+	else
+		list = sock_rx_bucket(rx_ctx->rx_entry_hash,
+				      sock_rx_addr_key(rx_ctx, rx_entry->addr),
+				      rx_entry->tag, rx_entry->is_tagged);
+	dlist_insert_tail(&rx_entry->match_entry, list);
+}
+
+void sock_rx_dequeue_entry(struct sock_rx_entry *rx_entry)
+{
+	dlist_remove(&rx_entry->entry);
+	dlist_remove_init(&rx_entry->match_entry);
+}
+
 struct sock_rx_entry *sock_rx_new_buffered_entry(struct sock_rx_ctx *rx_ctx,
-						 size_t len)
+						 size_t len, uint64_t addr,
+						 uint64_t tag, uint8_t is_tagged)
 {
 	struct sock_rx_entry *rx_entry;
 
@@ -118,38 +202,92 @@ struct sock_rx_entry *sock_rx_new_buffered_entry(struct sock_rx_ctx *rx_ctx,
 	rx_entry->iov[0].iov.len = len;
 	rx_entry->iov[0].iov.addr = (uintptr_t) (rx_entry + 1);
 	rx_entry->total_len = len;
+	rx_entry->addr = addr;
+	rx_entry->tag = tag;
+	rx_entry->is_tagged = is_tagged;
 
 	rx_ctx->buffered_len += len;
+	rx_entry->seq = rx_ctx->rx_buffered_seq++;
 	dlist_insert_tail(&rx_entry->entry, &rx_ctx->rx_buffered_list);
+	dlist_insert_tail(&rx_entry->match_entry,
+			  sock_rx_bucket(rx_ctx->rx_buffered_hash,
+					 sock_rx_addr_key(rx_ctx, addr),
+					 tag, is_tagged));
 	rx_ctx->progress_start = &rx_ctx->rx_buffered_list;
 
 	return rx_entry;
 }
 
+static struct sock_rx_entry *
+sock_rx_first_posted(struct sock_rx_ctx *rx_ctx, struct dlist_entry *list,
+		     struct sock_rx_entry *best, uint64_t addr, uint64_t tag,
+		     uint8_t is_tagged)
+{
+	struct sock_rx_entry *rx_entry;
+
+	dlist_foreach_container(list, struct sock_rx_entry, rx_entry,
+				match_entry) {
+		if (best && rx_entry->seq > best->seq)
+			break;
+		if (sock_rx_match_posted(rx_ctx, rx_entry, addr, tag,
+					 is_tagged))
+			return rx_entry;
+	}
+	return best;
+}
+
 struct sock_rx_entry *sock_rx_get_entry(struct sock_rx_ctx *rx_ctx,
 					uint64_t addr, uint64_t tag,
 					uint8_t is_tagged)
 {
-	struct dlist_entry *entry;
-	struct sock_rx_entry *rx_entry;
+	struct sock_rx_entry *rx_entry = NULL;
+
+	if (addr == FI_ADDR_UNSPEC) {
+		dlist_foreach_container(&rx_ctx->rx_entry_list,
+					struct sock_rx_entry, rx_entry, entry) {
+			if (sock_rx_match_posted(rx_ctx, rx_entry, addr, tag,
+						 is_tagged))
+				goto found;
+		}
+		return NULL;
+	}
 
-	for (entry = rx_ctx->rx_entry_list.next;
-	     entry != &rx_ctx->rx_entry_list; entry = entry->next) {
+	rx_entry = sock_rx_first_posted(rx_ctx,
+				sock_rx_bucket(rx_ctx->rx_entry_hash,
+					       sock_rx_addr_key(rx_ctx, addr),
+					       tag, is_tagged),
+				NULL, addr, tag, is_tagged);
+	rx_entry = sock_rx_first_posted(rx_ctx,
+				sock_rx_bucket(rx_ctx->rx_entry_hash,
+					       FI_ADDR_UNSPEC, tag, is_tagged),
+				rx_entry, addr, tag, is_tagged);
+	if (is_tagged)
+		rx_entry = sock_rx_first_posted(rx_ctx,
+						&rx_ctx->rx_entry_wildcard,
+						rx_entry, addr, tag, is_tagged);
+	if (!rx_entry)
+		return NULL;
+found:
+	rx_entry->is_busy = 1;
+	return rx_entry;
+}
 
-		rx_entry = container_of(entry, struct sock_rx_entry, entry);
-		if (rx_entry->is_busy || (is_tagged != rx_entry->is_tagged))
-			continue;
+static struct sock_rx_entry *
+sock_rx_first_buffered(struct sock_rx_ctx *rx_ctx, struct dlist_entry *list,
+		       struct sock_rx_entry *best, uint64_t addr, uint64_t tag,
+		       uint8_t is_tagged)
+{
+	struct sock_rx_entry *rx_entry;
 
-		if (((rx_entry->tag & ~rx_entry->ignore) == (tag & ~rx_entry->ignore)) &&
-		    (rx_entry->addr == FI_ADDR_UNSPEC || addr == FI_ADDR_UNSPEC ||
-		     rx_entry->addr == addr ||
-		     (rx_ctx->av &&
-		      !sock_av_compare_addr(rx_ctx->av, addr, rx_entry->addr)))) {
-			rx_entry->is_busy = 1;
+	dlist_foreach_container(list, struct sock_rx_entry, rx_entry,
+				match_entry) {
+		if (best && rx_entry->seq > best->seq)
+			break;
+		if (sock_rx_match_buffered(rx_ctx, rx_entry, addr, tag, 0,
+					   is_tagged))
 			return rx_entry;
-		}
 	}
-	return NULL;
+	return best;
 }
 
 struct sock_rx_entry *sock_rx_get_buffered_entry(struct sock_rx_ctx *rx_ctx,
@@ -157,24 +295,25 @@ struct sock_rx_entry *sock_rx_get_buffered_entry(struct sock_rx_ctx *rx_ctx,
 						uint64_t ignore,
 						uint8_t is_tagged)
 {
-	struct dlist_entry *entry;
 	struct sock_rx_entry *rx_entry;
 
-	for (entry = rx_ctx->rx_buffered_list.next;
-	     entry != &rx_ctx->rx_buffered_list; entry = entry->next) {
-
-		rx_entry = container_of(entry, struct sock_rx_entry, entry);
-		if (rx_entry->is_busy || (is_tagged != rx_entry->is_tagged) ||
-		    rx_entry->is_claimed)
-			continue;
-
-		if (((rx_entry->tag & ~ignore) == (tag & ~ignore)) &&
-		    (rx_entry->addr == FI_ADDR_UNSPEC || addr == FI_ADDR_UNSPEC ||
-		     rx_entry->addr == addr ||
-		     (rx_ctx->av &&
-		      !sock_av_compare_addr(rx_ctx->av, addr, rx_entry->addr)))) {
-			return rx_entry;
+	if (addr == FI_ADDR_UNSPEC || (is_tagged && ignore)) {
+		dlist_foreach_container(&rx_ctx->rx_buffered_list,
+					struct sock_rx_entry, rx_entry, entry) {
+			if (sock_rx_match_buffered(rx_ctx, rx_entry, addr, tag,
+						   ignore, is_tagged))
+				return rx_entry;
 		}
+		return NULL;
 	}
-	return NULL;
+
+	rx_entry = sock_rx_first_buffered(rx_ctx,
+				sock_rx_bucket(rx_ctx->rx_buffered_hash,
+					       sock_rx_addr_key(rx_ctx, addr),
+					       tag, is_tagged),
+				NULL, addr, tag, is_tagged);
+	return sock_rx_first_buffered(rx_ctx,
+				sock_rx_bucket(rx_ctx->rx_buffered_hash,
+					       FI_ADDR_UNSPEC, tag, is_tagged),
+				rx_entry, addr, tag, is_tagged);
 }
@@ -115,6 +115,7 @@ extern size_t xnet_zerocopy_size;
 extern int xnet_trace_msg;
 extern int xnet_disable_autoprog;
 extern int xnet_io_uring;
+extern int xnet_compact_hdr;
 extern int xnet_max_saved;
 extern size_t xnet_max_saved_size;
 extern size_t xnet_max_inject;
@@ -152,6 +153,7 @@ struct xnet_conn_handle {
 	struct xnet_pep		*pep;
 	SOCKET			sock;
 	bool			endian_match;
+	uint8_t			hdr_version;
 	struct ofi_sockapi	*sockapi;
 	struct ofi_sockctx	rx_sockctx;
 };
@@ -165,6 +167,22 @@ struct xnet_pep {
 	struct ofi_sockctx	pollin_sockctx;
 };
 
+/* Compact headers are received in several small reads, which is only
+ * cheap when they are served from the prefetch buffer.
+ */
+static inline uint8_t xnet_local_hdr_version(void)
+{
+	return (xnet_compact_hdr && xnet_prefetch_rbuf_size > 0 &&
+		!xnet_io_uring) ? XNET_HDR_VERSION_COMPACT : XNET_HDR_VERSION;
+}
+
+/* peer_version is ofi_ctrl_hdr::seg_no, which is 0 from older peers */
+static inline uint8_t xnet_agree_hdr_version(uint32_t peer_version)
+{
+	peer_version = MAX(ntohl(peer_version), XNET_HDR_VERSION);
+	return (uint8_t) MIN(peer_version, xnet_local_hdr_version());
+}
+
 int xnet_listen(struct xnet_pep *pep, struct xnet_progress *progress);
 void xnet_accept_sock(struct xnet_pep *pep);
 void xnet_connect_done(struct xnet_ep *ep);
@@ -262,12 +280,18 @@ struct xnet_ep {
 	struct sockaddr		*addr;
 
 	void (*hdr_bswap)(struct xnet_ep *ep, struct xnet_base_hdr *hdr);
+	uint8_t			hdr_version;
 
 	short			pollflags;
 
 	xnet_profile_t *profile;
 };
 
+static inline bool xnet_use_compact_hdr(struct xnet_ep *ep)
+{
+	return ep->hdr_version >= XNET_HDR_VERSION_COMPACT;
+}
+
 struct xnet_event {
 	struct slist_entry list_entry;
 	struct xnet_rdm *rdm;
@@ -157,6 +157,9 @@ static int xnet_req_done_internal(struct xnet_ep *ep)
 				xnet_hdr_none : xnet_hdr_bswap;
 	}
 
+	ep->hdr_version = xnet_agree_hdr_version(ep->cm_msg->hdr.seg_no);
+	xnet_reset_rx(ep);
+
 	len = ntohs(ep->cm_msg->hdr.seg_size);
 	cm_entry.fid = &ep->util_ep.ep_fid.fid;
 	cm_entry.info = NULL;
@@ -301,6 +304,7 @@ void xnet_handle_conn(struct xnet_conn_handle *conn, bool error)
 	ofi_straddr_dbg(&xnet_prov, FI_LOG_EP_CTRL, "conn req for src",
 				    cm_entry.info->src_addr);
 	conn->endian_match = (msg.hdr.conn_data == 1);
+	conn->hdr_version = xnet_agree_hdr_version(msg.hdr.seg_no);
 	cm_entry.info->handle = &conn->fid;
 	datalen = ntohs(msg.hdr.seg_size);
 	if (datalen)
@@ -222,6 +222,7 @@ static int xnet_ep_connect(struct fid_ep *ep_fid, const void *addr,
 	ep->cm_msg->hdr.version = XNET_CTRL_HDR_VERSION;
 	ep->cm_msg->hdr.type = ofi_ctrl_connreq;
 	ep->cm_msg->hdr.conn_data = 1; /* tests endianess mismatch at peer */
+	ep->cm_msg->hdr.seg_no = htonl(xnet_local_hdr_version());
 	if (paramlen) {
 		memcpy(ep->cm_msg->data, param, paramlen);
 		ep->cm_msg->hdr.seg_size = htons((uint16_t) paramlen);
@@ -289,6 +290,7 @@ xnet_ep_accept(struct fid_ep *ep_fid, const void *param, size_t paramlen)
 	ep->cm_msg->hdr.version = XNET_CTRL_HDR_VERSION;
 	ep->cm_msg->hdr.type = ofi_ctrl_connresp;
 	ep->cm_msg->hdr.conn_data = 1; /* tests endianess mismatch at peer */
+	ep->cm_msg->hdr.seg_no = htonl(conn->hdr_version);
 	if (paramlen) {
 		memcpy(ep->cm_msg->data, param, paramlen);
 		ep->cm_msg->hdr.seg_size = htons((uint16_t) paramlen);
@@ -302,6 +304,8 @@ xnet_ep_accept(struct fid_ep *ep_fid, const void *param, size_t paramlen)
 	ep->cm_msg = NULL;
 	ep->state = XNET_CONNECTED;
 	assert(!ofi_bsock_readable(&ep->bsock) && !ep->cur_rx.handler);
+	ep->hdr_version = conn->hdr_version;
+	xnet_reset_rx(ep);
 
 	progress = xnet_ep2_progress(ep);
 	ofi_genlock_lock(&progress->ep_lock);
@@ -529,7 +533,9 @@ void xnet_reset_rx(struct xnet_ep *ep)
 	ep->cur_rx.handler = NULL;
 	ep->cur_rx.entry = NULL;
 	ep->cur_rx.hdr_done = 0;
-	ep->cur_rx.hdr_len = sizeof(ep->cur_rx.hdr.base_hdr);
+	/* A compact header may be shorter than the base header */
+	ep->cur_rx.hdr_len = xnet_use_compact_hdr(ep) ?
+			     1 : sizeof(ep->cur_rx.hdr.base_hdr);
 	ep->cur_rx.claim_ctx = NULL;
 	OFI_DBG_SET(ep->cur_rx.hdr.base_hdr.version, 0);
 }
@@ -817,6 +823,7 @@ int xnet_endpoint(struct fid_domain *domain, struct fi_info *info,
 	if (info->ep_attr->rx_ctx_cnt != FI_SHARED_CONTEXT)
 		ep->rx_avail = (int) info->rx_attr->size;
 
+	ep->hdr_version = XNET_HDR_VERSION;
 	ep->cur_rx.hdr_done = 0;
 	ep->cur_rx.hdr_len = sizeof(ep->cur_rx.hdr.base_hdr);
 	xnet_config_bsock(&ep->bsock);
@@ -81,6 +81,36 @@ static ssize_t xnet_eq_read(struct fid_eq *eq_fid, uint32_t *event,
 	return ofi_eq_read(eq_fid, event, buf, len, flags);
 }
 
+static ssize_t xnet_eq_read_batch(struct fid_eq *eq_fid, struct slist *batch,
+				  size_t count)
+{
+	struct xnet_eq *eq;
+
+	eq = container_of(eq_fid, struct xnet_eq, util_eq.eq_fid);
+	xnet_progress_all(eq);
+	return ofi_eq_read_batch(eq_fid, batch, count);
+}
+
+static struct ofi_ops_eq_batch xnet_eq_batch_ops = {
+	.size = sizeof(struct ofi_ops_eq_batch),
+	.read = xnet_eq_read_batch,
+	.release = ofi_eq_release_batch,
+};
+
+static int xnet_eq_ops_open(struct fid *fid, const char *name,
+			    uint64_t flags, void **ops, void *context)
+{
+	if (flags)
+		return -FI_EBADFLAGS;
+
+	if (!strcasecmp(name, OFI_OPS_EQ_BATCH)) {
+		*ops = &xnet_eq_batch_ops;
+		return 0;
+	}
+
+	return -FI_ENOSYS;
+}
+
 static int xnet_eq_close(struct fid *fid)
 {
 	struct xnet_eq *eq;
@@ -125,7 +155,7 @@ static struct fi_ops xnet_eq_fi_ops = {
 	.close = xnet_eq_close,
 	.bind = fi_no_bind,
 	.control = ofi_eq_control,
-	.ops_open = fi_no_ops_open,
+	.ops_open = xnet_eq_ops_open,
 };
 
 static int xnet_eq_wait_try_func(void *arg)
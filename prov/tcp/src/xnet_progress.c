@@ -513,6 +513,106 @@ static void xnet_need_cts(struct xnet_ep *ep, struct xnet_xfer_entry *tx_entry)
 	       ofi_total_iov_len(tx_entry->iov, tx_entry->iov_cnt));
 }
 
+static uint8_t *xnet_put_varint(uint8_t *pos, uint64_t val)
+{
+	while (val >= 0x80) {
+		*pos++ = (uint8_t) val | 0x80;
+		val >>= 7;
+	}
+	*pos++ = (uint8_t) val;
+	return pos;
+}
+
+/* Rewrites a msg, tag, or ack header into the compact format, placed
+ * directly in front of the payload.  This overwrites part of the full
+ * header, which is no longer referenced once the transfer starts.
+ * Returns the number of bytes removed from the transfer, 0 if the
+ * header cannot be compacted.
+ */
+static size_t
+xnet_compact_tx(struct xnet_ep *ep, struct xnet_xfer_entry *tx_entry)
+{
+	struct xnet_base_hdr *hdr = &tx_entry->hdr.base_hdr;
+	uint8_t buf[XNET_COMPACT_MAX_HDR], *pos;
+	uint64_t cq_data = 0, tag = 0;
+	size_t hdr_size, len;
+
+	if (hdr->flags & ~(XNET_REMOTE_CQ_DATA | XNET_DELIVERY_COMPLETE |
+			   XNET_COMMIT_COMPLETE))
+		return 0;
+
+	if (hdr->op == xnet_op_msg && hdr->op_data == XNET_OP_ACK) {
+		buf[0] = xnet_compact_ack << XNET_COMPACT_OP_SHIFT;
+		hdr_size = sizeof(*hdr);
+	} else if (hdr->op == xnet_op_msg && !hdr->op_data) {
+		buf[0] = xnet_compact_msg << XNET_COMPACT_OP_SHIFT;
+		hdr_size = sizeof(*hdr);
+	} else if (hdr->op == xnet_op_tag && !hdr->op_data) {
+		buf[0] = xnet_compact_tag << XNET_COMPACT_OP_SHIFT;
+		hdr_size = sizeof(tx_entry->hdr.tag_hdr);
+		tag = (hdr->flags & XNET_REMOTE_CQ_DATA) ?
+		      tx_entry->hdr.tag_data_hdr.tag : tx_entry->hdr.tag_hdr.tag;
+	} else {
+		return 0;
+	}
+
+	if (hdr->flags & XNET_REMOTE_CQ_DATA) {
+		buf[0] |= XNET_COMPACT_REMOTE_CQ_DATA;
+		cq_data = tx_entry->hdr.cq_data_hdr.cq_data;
+		hdr_size += sizeof(cq_data);
+	}
+
+	if (hdr->hdr_size != hdr_size ||
+	    tx_entry->iov[0].iov_base != (void *) hdr ||
+	    tx_entry->iov[0].iov_len < hdr_size)
+		return 0;
+
+	if (xnet_trace_msg)
+		xnet_hdr_trace(ep, hdr);
+
+	buf[0] |= XNET_COMPACT_HDR;
+	if (hdr->flags & XNET_DELIVERY_COMPLETE)
+		buf[0] |= XNET_COMPACT_DELIVERY_COMPLETE;
+	if (hdr->flags & XNET_COMMIT_COMPLETE)
+		buf[0] |= XNET_COMPACT_COMMIT_COMPLETE;
+
+	pos = xnet_put_varint(&buf[1], hdr->size - hdr_size);
+	if (cq_data) {
+		buf[0] |= XNET_COMPACT_CQ_DATA;
+		pos = xnet_put_varint(pos, cq_data);
+	}
+	if (tag) {
+		buf[0] |= XNET_COMPACT_TAG;
+		pos = xnet_put_varint(pos, tag);
+	}
+
+	len = pos - buf;
+	assert(len <= hdr_size);
+	memcpy((uint8_t *) hdr + hdr_size - len, buf, len);
+	tx_entry->iov[0].iov_base = (uint8_t *) hdr + hdr_size - len;
+	tx_entry->iov[0].iov_len -= hdr_size - len;
+	return hdr_size - len;
+}
+
+static void xnet_start_tx(struct xnet_ep *ep, struct xnet_xfer_entry *tx_entry)
+{
+	size_t saved;
+
+	ep->cur_tx.entry = tx_entry;
+	ep->cur_tx.data_left = tx_entry->hdr.base_hdr.size;
+	OFI_DBG_SET(tx_entry->hdr.base_hdr.id, ep->tx_id++);
+
+	/* The compact format is byte order independent */
+	if (xnet_use_compact_hdr(ep)) {
+		saved = xnet_compact_tx(ep, tx_entry);
+		if (saved) {
+			ep->cur_tx.data_left -= saved;
+			return;
+		}
+	}
+	ep->hdr_bswap(ep, &tx_entry->hdr.base_hdr);
+}
+
 static void xnet_complete_tx(struct xnet_ep *ep, int ret)
 {
 	struct xnet_xfer_entry *tx_entry;
@@ -548,23 +648,19 @@ static void xnet_complete_tx(struct xnet_ep *ep, int ret)
 	}
 
 	if (!slist_empty(&ep->priority_queue)) {
-		ep->cur_tx.entry = container_of(slist_remove_head(
-						&ep->priority_queue),
-				     struct xnet_xfer_entry, entry);
-		assert(ep->cur_tx.entry->ctrl_flags & XNET_INTERNAL_XFER);
+		tx_entry = container_of(slist_remove_head(&ep->priority_queue),
+					struct xnet_xfer_entry, entry);
+		assert(tx_entry->ctrl_flags & XNET_INTERNAL_XFER);
 	} else if (!slist_empty(&ep->tx_queue)) {
-		ep->cur_tx.entry = container_of(slist_remove_head(
-						&ep->tx_queue),
-				     struct xnet_xfer_entry, entry);
-		assert(!(ep->cur_tx.entry->ctrl_flags & XNET_INTERNAL_XFER));
+		tx_entry = container_of(slist_remove_head(&ep->tx_queue),
+					struct xnet_xfer_entry, entry);
+		assert(!(tx_entry->ctrl_flags & XNET_INTERNAL_XFER));
 	} else {
 		ep->cur_tx.entry = NULL;
 		return;
 	}
 
-	ep->cur_tx.data_left = ep->cur_tx.entry->hdr.base_hdr.size;
-	OFI_DBG_SET(ep->cur_tx.entry->hdr.base_hdr.id, ep->tx_id++);
-	ep->hdr_bswap(ep, &ep->cur_tx.entry->hdr.base_hdr);
+	xnet_start_tx(ep, tx_entry);
 }
 
 static void xnet_progress_tx(struct xnet_ep *ep)
@@ -1008,24 +1104,39 @@ static int xnet_handle_read_rsp(struct xnet_ep *ep)
 	return xnet_recv_msg_data(ep);
 }
 
-static int xnet_progress_hdr(struct xnet_ep *ep)
+static const uint8_t *xnet_get_varint(const uint8_t *pos, uint64_t *val)
 {
-	if (ep->cur_rx.hdr_done == sizeof(ep->cur_rx.hdr.base_hdr)) {
-		assert(ep->cur_rx.hdr_len == sizeof(ep->cur_rx.hdr.base_hdr));
+	int i;
 
-		if (ep->cur_rx.hdr.base_hdr.hdr_size > XNET_MAX_HDR) {
-			FI_WARN(&xnet_prov, FI_LOG_EP_DATA,
-				"Payload offset is too large\n");
-			return -FI_EIO;
-		}
-		ep->cur_rx.hdr_len = (size_t) ep->cur_rx.hdr.base_hdr.hdr_size;
+	*val = 0;
+	for (i = 0; i < XNET_VARINT_MAX; i++) {
+		*val |= (uint64_t) (pos[i] & 0x7f) << (7 * i);
+		if (!(pos[i] & 0x80))
+			return &pos[i + 1];
 	}
+	return NULL;
+}
 
-	if (ep->cur_rx.hdr_done < ep->cur_rx.hdr_len)
-		return -FI_EAGAIN;
+/* Returns the length of the compact header given the bytes received so
+ * far, or the minimum length if some of its fields are still missing.
+ */
+static size_t xnet_compact_hdr_len(const uint8_t *buf, size_t done)
+{
+	size_t pos = 1, cnt;
 
-	ep->hdr_bswap(ep, &ep->cur_rx.hdr.base_hdr);
+	cnt = 1 + !!(buf[0] & XNET_COMPACT_CQ_DATA) +
+	      !!(buf[0] & XNET_COMPACT_TAG);
+	while (cnt) {
+		if (pos >= done)
+			return pos + cnt;
+		if (!(buf[pos++] & 0x80))
+			cnt--;
+	}
+	return pos;
+}
 
+static int xnet_start_rx_op(struct xnet_ep *ep)
+{
 #ifndef NDEBUG
 	if (ep->cur_rx.hdr.base_hdr.id != ep->rx_id++) {
 		FI_WARN(&xnet_prov, FI_LOG_EP_DATA,
@@ -1046,9 +1157,131 @@ static int xnet_progress_hdr(struct xnet_ep *ep)
 	return FI_SUCCESS;
 }
 
-static int xnet_recv_hdr(struct xnet_ep *ep)
+/* Expands a compact header in place into the matching full header, so
+ * that the op handlers only deal with one format.
+ */
+static int xnet_progress_compact_hdr(struct xnet_ep *ep)
 {
+	struct xnet_active_rx *rx = &ep->cur_rx;
+	struct xnet_base_hdr *hdr = &rx->hdr.base_hdr;
+	uint64_t size, cq_data = 0, tag = 0;
+	const uint8_t *pos;
+	uint8_t ctrl, op;
 	size_t len;
+
+	len = xnet_compact_hdr_len(rx->hdr.max_hdr, rx->hdr_done);
+	if (len > rx->hdr_done) {
+		if (len > XNET_COMPACT_MAX_HDR)
+			goto err;
+		rx->hdr_len = len;
+		return -FI_EAGAIN;
+	}
+
+	ctrl = rx->hdr.max_hdr[0];
+	pos = xnet_get_varint(&rx->hdr.max_hdr[1], &size);
+	if (pos && (ctrl & XNET_COMPACT_CQ_DATA))
+		pos = xnet_get_varint(pos, &cq_data);
+	if (pos && (ctrl & XNET_COMPACT_TAG))
+		pos = xnet_get_varint(pos, &tag);
+	if (!pos)
+		goto err;
+
+	op = (ctrl & XNET_COMPACT_OP_MASK) >> XNET_COMPACT_OP_SHIFT;
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->version = XNET_HDR_VERSION;
+	hdr->hdr_size = sizeof(*hdr);
+	switch (op) {
+	case xnet_compact_msg:
+		hdr->op = xnet_op_msg;
+		break;
+	case xnet_compact_tag:
+		hdr->op = xnet_op_tag;
+		break;
+	case xnet_compact_ack:
+		if (size || (ctrl & ~(XNET_COMPACT_HDR | XNET_COMPACT_OP_MASK)))
+			goto err;
+		hdr->op = xnet_op_msg;
+		hdr->op_data = XNET_OP_ACK;
+		break;
+	default:
+		goto err;
+	}
+
+	if (ctrl & XNET_COMPACT_REMOTE_CQ_DATA) {
+		hdr->flags |= XNET_REMOTE_CQ_DATA;
+		rx->hdr.cq_data_hdr.cq_data = cq_data;
+		hdr->hdr_size += sizeof(cq_data);
+	} else if (ctrl & XNET_COMPACT_CQ_DATA) {
+		goto err;
+	}
+
+	if (hdr->op == xnet_op_tag) {
+		if (hdr->flags & XNET_REMOTE_CQ_DATA)
+			rx->hdr.tag_data_hdr.tag = tag;
+		else
+			rx->hdr.tag_hdr.tag = tag;
+		hdr->hdr_size += sizeof(tag);
+	} else if (ctrl & XNET_COMPACT_TAG) {
+		goto err;
+	}
+
+	if (ctrl & XNET_COMPACT_DELIVERY_COMPLETE)
+		hdr->flags |= XNET_DELIVERY_COMPLETE;
+	if (ctrl & XNET_COMPACT_COMMIT_COMPLETE)
+		hdr->flags |= XNET_COMMIT_COMPLETE;
+
+	if (size > UINT64_MAX - hdr->hdr_size)
+		goto err;
+	hdr->size = hdr->hdr_size + size;
+
+	OFI_DBG_SET(hdr->id, ep->rx_id);
+	if (xnet_trace_msg)
+		xnet_hdr_trace(ep, hdr);
+	return xnet_start_rx_op(ep);
+
+err:
+	FI_WARN(&xnet_prov, FI_LOG_EP_DATA, "Received invalid compact header\n");
+	return -FI_EIO;
+}
+
+static int xnet_progress_hdr(struct xnet_ep *ep)
+{
+	if (ep->cur_rx.hdr_done < ep->cur_rx.hdr_len)
+		return -FI_EAGAIN;
+
+	if (ep->cur_rx.hdr.max_hdr[0] & XNET_COMPACT_HDR) {
+		if (!xnet_use_compact_hdr(ep)) {
+			FI_WARN(&xnet_prov, FI_LOG_EP_DATA,
+				"Compact header was not negotiated\n");
+			return -FI_EIO;
+		}
+		return xnet_progress_compact_hdr(ep);
+	}
+
+	/* Only the first byte was read to check for a compact header */
+	if (ep->cur_rx.hdr_done < sizeof(ep->cur_rx.hdr.base_hdr)) {
+		ep->cur_rx.hdr_len = sizeof(ep->cur_rx.hdr.base_hdr);
+		return -FI_EAGAIN;
+	}
+
+	if (ep->cur_rx.hdr_done == sizeof(ep->cur_rx.hdr.base_hdr)) {
+		if (ep->cur_rx.hdr.base_hdr.hdr_size > XNET_MAX_HDR) {
+			FI_WARN(&xnet_prov, FI_LOG_EP_DATA,
+				"Payload offset is too large\n");
+			return -FI_EIO;
+		}
+		ep->cur_rx.hdr_len = (size_t) ep->cur_rx.hdr.base_hdr.hdr_size;
+		if (ep->cur_rx.hdr_done < ep->cur_rx.hdr_len)
+			return -FI_EAGAIN;
+	}
+
+	ep->hdr_bswap(ep, &ep->cur_rx.hdr.base_hdr);
+	return xnet_start_rx_op(ep);
+}
+
+static int xnet_recv_hdr(struct xnet_ep *ep)
+{
+	size_t len, want;
 	void *buf;
 	int ret;
 
@@ -1057,7 +1290,7 @@ static int xnet_recv_hdr(struct xnet_ep *ep)
 
 next_hdr:
 	buf = (uint8_t *) &ep->cur_rx.hdr + ep->cur_rx.hdr_done;
-	len = ep->cur_rx.hdr_len - ep->cur_rx.hdr_done;
+	want = len = ep->cur_rx.hdr_len - ep->cur_rx.hdr_done;
 	ret = ofi_bsock_recv(&ep->bsock, buf, &len);
 	if (ret < 0) {
 		if (ret == -OFI_EINPROGRESS_URING)
@@ -1069,10 +1302,9 @@ next_hdr:
 
 	ret = xnet_progress_hdr(ep);
 	if (ret) {
-		if (ret == -FI_EAGAIN &&
-		    ep->cur_rx.hdr_done == sizeof(ep->cur_rx.hdr.base_hdr)) {
+		/* The header turned out to be longer than what was read */
+		if (ret == -FI_EAGAIN && len == want)
 			goto next_hdr;
-		}
 
 		return ret;
 	}
@@ -1424,10 +1656,7 @@ void xnet_tx_queue_insert(struct xnet_ep *ep,
 	assert(xnet_progress_locked(progress));
 
 	if (!ep->cur_tx.entry) {
-		ep->cur_tx.entry = tx_entry;
-		ep->cur_tx.data_left = tx_entry->hdr.base_hdr.size;
-		OFI_DBG_SET(tx_entry->hdr.base_hdr.id, ep->tx_id++);
-		ep->hdr_bswap(ep, &tx_entry->hdr.base_hdr);
+		xnet_start_tx(ep, tx_entry);
 		xnet_progress_tx(ep);
 		if (xnet_io_uring)
 			xnet_submit_uring(&progress->tx_uring);
@@ -146,6 +146,37 @@ struct xnet_tag_rts_data_hdr {
 	uint64_t		size;
 };
 
+/* Header version 4 adds the compact header used for small messages.
+ * The highest version each side supports is exchanged in
+ * ofi_ctrl_hdr::seg_no of the connect request and response, which older
+ * peers leave zero.  Full headers keep carrying XNET_HDR_VERSION.
+ */
+#define XNET_HDR_VERSION_COMPACT 4
+
+/* Compact header: one byte holding XNET_COMPACT_HDR, the compact op and
+ * flags, followed by LEB128 encoded fields: the payload size, then cq_data
+ * and tag when they are present and non-zero.  Full headers start with
+ * base_hdr::version, which never has XNET_COMPACT_HDR set.  Only msg,
+ * tag and ack messages are sent using the compact format.
+ */
+#define XNET_COMPACT_HDR		(1 << 7)
+#define XNET_COMPACT_OP_SHIFT		5
+#define XNET_COMPACT_OP_MASK		(3 << XNET_COMPACT_OP_SHIFT)
+#define XNET_COMPACT_REMOTE_CQ_DATA	(1 << 4)
+#define XNET_COMPACT_CQ_DATA		(1 << 3)
+#define XNET_COMPACT_TAG		(1 << 2)
+#define XNET_COMPACT_DELIVERY_COMPLETE	(1 << 1)
+#define XNET_COMPACT_COMMIT_COMPLETE	(1 << 0)
+
+enum {
+	xnet_compact_msg,
+	xnet_compact_tag,
+	xnet_compact_ack,
+};
+
+#define XNET_VARINT_MAX		10
+#define XNET_COMPACT_MAX_HDR	(1 + 3 * XNET_VARINT_MAX)
+
 /* Maximum header is scatter RMA with CQ data */
 #define XNET_MAX_HDR (sizeof(struct xnet_cq_data_hdr) + \
 		     sizeof(struct ofi_rma_iov) * XNET_IOV_LIMIT)
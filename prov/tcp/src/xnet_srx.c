@@ -762,11 +762,60 @@ unlock:
 	return 0;
 }
 
+static int xnet_srx_getopt(fid_t fid, int level, int optname, void *optval,
+			   size_t *optlen)
+{
+	struct xnet_srx *srx;
+
+	srx = container_of(fid, struct xnet_srx, rx_fid.fid);
+	if (level != FI_OPT_ENDPOINT)
+		return -FI_ENOPROTOOPT;
+
+	switch (optname) {
+	case FI_OPT_MIN_MULTI_RECV:
+		if (*optlen < sizeof(size_t)) {
+			*optlen = sizeof(size_t);
+			return -FI_ETOOSMALL;
+		}
+		*((size_t *) optval) = srx->min_multi_recv_size;
+		*optlen = sizeof(size_t);
+		break;
+	default:
+		return -FI_ENOPROTOOPT;
+	}
+	return FI_SUCCESS;
+}
+
+static int xnet_srx_setopt(fid_t fid, int level, int optname,
+			   const void *optval, size_t optlen)
+{
+	struct xnet_srx *srx;
+
+	srx = container_of(fid, struct xnet_srx, rx_fid.fid);
+	if (level != FI_OPT_ENDPOINT)
+		return -FI_ENOPROTOOPT;
+
+	switch (optname) {
+	case FI_OPT_MIN_MULTI_RECV:
+		if (optlen != sizeof(size_t))
+			return -FI_EINVAL;
+
+		srx->min_multi_recv_size = *(size_t *) optval;
+		FI_INFO(&xnet_prov, FI_LOG_EP_CTRL,
+			"FI_OPT_MIN_MULTI_RECV set to %zu\n",
+			srx->min_multi_recv_size);
+		break;
+	default:
+		return -FI_ENOPROTOOPT;
+	}
+	return FI_SUCCESS;
+}
+
 static struct fi_ops_ep xnet_srx_ops = {
 	.size = sizeof(struct fi_ops_ep),
 	.cancel = xnet_srx_cancel,
-	.getopt = fi_no_getopt,
-	.setopt = fi_no_setopt,
+	.getopt = xnet_srx_getopt,
+	.setopt = xnet_srx_setopt,
 	.tx_ctx = fi_no_tx_ctx,
 	.rx_ctx = fi_no_rx_ctx,
 	.rx_size_left = fi_no_rx_size_left,
@@ -20,10 +20,23 @@ AC_DEFUN([FI_UCX_CONFIGURE],[
                     [$ucx_LIBDIR],
                     [ucx_happy=1],
                     [ucx_happy=0])
+	       ucx_save_CPPFLAGS=$CPPFLAGS
+	       CPPFLAGS="$CPPFLAGS $ucx_CPPFLAGS"
 	       AC_CHECK_DECLS([UCP_WORKER_FLAG_IGNORE_REQUEST_LEAK],
 		    [],
 		    [],
 		    [#include <ucp/api/ucp.h>])
+	       dnl The nbx API (UCX 1.9 and later) is used when available,
+	       dnl older versions fall back to the _nb calls
+	       AC_CHECK_DECLS([ucp_tag_send_nbx],
+		    [],
+		    [],
+		    [#include <ucp/api/ucp.h>])
+	       AC_CHECK_DECLS([UCP_OP_ATTR_FIELD_MEMH],
+		    [],
+		    [],
+		    [#include <ucp/api/ucp.h>])
+	       CPPFLAGS=$ucx_save_CPPFLAGS
          ])
     AS_IF([test $ucx_happy -eq 1], [$1], [$2])
 ])
@@ -141,6 +141,7 @@ struct ucx_domain {
 	struct util_domain u_domain;
 	ucp_context_h context;
 	struct ucx_mr_rkey *remote_keys;
+	size_t req_size;
 };
 
 struct ucx_ep {
@@ -156,6 +157,16 @@ struct ucx_ep {
 	} ep_opts;
 	struct dlist_entry mctx_freelist;
 	struct dlist_entry mctx_repost;
+	struct ofi_bufpool *inject_pool;
+	size_t inject_size;
+	struct ofi_bufpool *req_pool;
+	size_t req_offset;
+	struct dlist_entry deferred_list;
+	struct ofi_bufpool *deferred_pool;
+	/* fd based waits the worker's event fd was added to */
+	int efd;
+	struct util_wait *efd_waits[CNTR_CNT + 2];
+	int efd_wait_cnt;
 };
 
 struct ucx_ave {
@@ -212,6 +223,7 @@ struct ucx_mrecv_request {
 	enum ucx_req_type type;
 	struct util_cq* cq;
 	struct ucx_ep* ep;
+	void *pool_buf;
 
 	/* completion status*/
 	ssize_t last_recvd;
@@ -224,6 +236,7 @@ struct ucx_request {
 	enum ucx_req_type type;
 	struct util_cq* cq;
 	struct ucx_ep* ep;
+	void *pool_buf;
 
 	/* completion status*/
 	ssize_t posted_size;
@@ -232,10 +245,96 @@ struct ucx_request {
 	struct fi_cq_tagged_entry completion;
 };
 
+/*
+ * Bounce buffer holding an injected payload until UCX is done with it.
+ * The pool regions are mapped with ucp_mem_map, the memh is kept as the
+ * region context.  cq is only set when a completion was requested, and
+ * cntr is CNTR_CNT when a later flush updates the counter instead.
+ */
+struct ucx_inject_buf {
+	struct ucx_ep *ep;
+	struct util_cq *cq;
+	enum ofi_cntr_index cntr;
+	struct fi_cq_tagged_entry completion;
+	char data[];
+};
+
+#if HAVE_DECL_UCP_TAG_SEND_NBX
+/*
+ * Requests posted through the nbx calls live in the endpoint's req_pool,
+ * with UCX's own request area in the req_offset bytes in front of them.
+ * pool_buf is NULL for requests allocated by UCX.
+ */
+static inline struct ucx_request *
+ucx_req_alloc(struct ucx_ep *u_ep, ucp_request_param_t *param)
+{
+	struct ucx_request *req;
+	char *buf;
+
+	buf = ofi_buf_alloc(u_ep->req_pool);
+	if (!buf)
+		return NULL;
+
+	req = (struct ucx_request *) (buf + u_ep->req_offset);
+	req->type = UCX_REQ_UNSPEC;
+	req->cq = NULL;
+	req->ep = u_ep;
+	req->pool_buf = buf;
+
+	param->op_attr_mask |= UCP_OP_ATTR_FIELD_REQUEST;
+	param->request = req;
+	return req;
+}
+#endif
+
+#define FI_UCX_DEFERRED_IOV_LIMIT 4
+
+/*
+ * Send held back by FI_FENCE, or queued behind one to keep FI_ORDER_SAS.
+ * FI_FENCE is cleared from flags once the worker flush completes.  Inject
+ * payloads are copied to data.
+ */
+struct ucx_deferred_send {
+	struct dlist_entry entry;
+	struct fi_msg_tagged msg;
+	struct iovec iov[FI_UCX_DEFERRED_IOV_LIMIT];
+	uint64_t flags;
+	enum ucx_comm_mode mode;
+	int flush_posted;
+	char data[];
+};
+
+/*
+ * While an nbx request is pending, the application's context points at it
+ * so that fi_cancel can find it.  This is set up before the operation is
+ * posted, and the callbacks clear it before releasing the request, so the
+ * posting path never needs to look at the request once UCX owns it.
+ */
+static inline void ucx_req_track(struct ucx_request *req)
+{
+	struct fi_context *ctx = req->completion.op_context;
+
+	if (ctx) {
+		ctx->internal[0] = req;
+		ctx->internal[1] = NULL;
+	}
+}
+
+static inline void ucx_req_untrack(struct ucx_request *req)
+{
+	struct fi_context *ctx = req->completion.op_context;
+
+	if (ctx)
+		ctx->internal[0] = NULL;
+}
+
 static inline void ucx_req_release(struct ucx_request *req)
 {
 	req->type = UCX_REQ_UNSPEC;
-	ucp_request_free(req);
+	if (req->pool_buf)
+		ofi_buf_free(req->pool_buf);
+	else
+		ucp_request_free(req);
 }
 
 #define UCX_EP_MSG_TAG (~0ULL)
@@ -279,6 +378,7 @@ int ucx_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
 
 ssize_t ucx_mrecv_repost(struct ucx_ep *ep,
 			 struct ucx_mrecv_ctx *mctx);
+void ucx_progress_deferred(struct ucx_ep *u_ep);
 
 void ucx_send_callback_no_compl(void *request, ucs_status_t status);
 void ucx_send_callback(void *request, ucs_status_t status);
@@ -289,6 +389,20 @@ void ucx_recv_callback(void *request, ucs_status_t status,
 void ucx_multi_recv_callback(void *request,
 			     ucs_status_t ustatus,
 			     ucp_tag_recv_info_t *info);
+void ucx_inject_complete(struct ucx_inject_buf *ibuf, ucs_status_t status);
+void ucx_inject_callback(void *request, ucs_status_t status, void *user_data);
+void ucx_send_nbx_callback(void *request, ucs_status_t status,
+			   void *user_data);
+void ucx_send_nbx_callback_no_compl(void *request, ucs_status_t status,
+				    void *user_data);
+void ucx_release_nbx_callback(void *request, ucs_status_t status,
+			      void *user_data);
+void ucx_fence_callback(void *request, ucs_status_t status, void *user_data);
+void ucx_recv_nbx_callback(void *request, ucs_status_t status,
+			   const ucp_tag_recv_info_t *info, void *user_data);
+void ucx_recv_nbx_callback_no_compl(void *request, ucs_status_t status,
+				    const ucp_tag_recv_info_t *info,
+				    void *user_data);
 
 static inline
 int ucx_write_error_completion(struct util_cq *cq, void *context,
@@ -114,6 +114,66 @@ void ucx_recv_callback(void *request, ucs_status_t status,
 	ucx_req_release(request);
 }
 
+void ucx_send_nbx_callback(void *request, ucs_status_t status,
+			   void *user_data)
+{
+	ucx_req_untrack(request);
+	ucx_send_callback(request, status);
+}
+
+void ucx_send_nbx_callback_no_compl(void *request, ucs_status_t status,
+				    void *user_data)
+{
+	ucx_send_callback_no_compl(request, status);
+}
+
+void ucx_release_nbx_callback(void *request, ucs_status_t status,
+			      void *user_data)
+{
+	if (status != UCS_OK)
+		FI_WARN(&ucx_prov, FI_LOG_EP_DATA,
+			"Send operation failed: %s\n",
+			ucs_status_string(status));
+
+	ucx_req_release(request);
+}
+
+void ucx_fence_callback(void *request, ucs_status_t status, void *user_data)
+{
+	struct ucx_deferred_send *def = user_data;
+
+	if (status != UCS_OK)
+		FI_WARN(&ucx_prov, FI_LOG_EP_DATA,
+			"Fence flush failed: %s\n",
+			ucs_status_string(status));
+
+	def->flags &= ~FI_FENCE;
+	ucx_req_release(request);
+}
+
+void ucx_recv_nbx_callback(void *request, ucs_status_t status,
+			   const ucp_tag_recv_info_t *info, void *user_data)
+{
+	struct ucx_request *ucx_req = request;
+
+	/* FI_CLAIM | FI_DISCARD receives into an empty buffer */
+	if (status == UCS_ERR_MESSAGE_TRUNCATED && !ucx_req->posted_size &&
+	    !ucx_req->completion.buf)
+		status = UCS_OK;
+
+	ucx_req_untrack(ucx_req);
+	ucx_recv_callback(request, status, (ucp_tag_recv_info_t *) info);
+}
+
+void ucx_recv_nbx_callback_no_compl(void *request, ucs_status_t status,
+				    const ucp_tag_recv_info_t *info,
+				    void *user_data)
+{
+	ucx_req_untrack(request);
+	ucx_recv_callback_no_compl(request, status,
+				   (ucp_tag_recv_info_t *) info);
+}
+
 void ucx_multi_recv_callback(void *request, ucs_status_t ustatus,
 			     ucp_tag_recv_info_t *info)
 {
@@ -149,3 +209,32 @@ void ucx_multi_recv_callback(void *request, ucs_status_t ustatus,
 		dlist_insert_tail(&mctx->list, &ep->mctx_repost);
 }
 
+void ucx_inject_complete(struct ucx_inject_buf *ibuf, ucs_status_t status)
+{
+	struct fi_cq_tagged_entry *tc = &ibuf->completion;
+
+	if (status != UCS_OK) {
+		FI_WARN(&ucx_prov, FI_LOG_EP_DATA,
+			"Inject operation failed: %s\n",
+			ucs_status_string(status));
+		if (ibuf->cq)
+			ucx_write_error_completion(ibuf->cq, tc->op_context,
+						   tc->flags, (int) status,
+						   -ucx_translate_errcode(status),
+						   0, tc->tag);
+	} else {
+		if (ibuf->cq)
+			ofi_cq_write(ibuf->cq, tc->op_context, tc->flags,
+				     tc->len, tc->buf, 0, tc->tag);
+		if (ibuf->cntr != CNTR_CNT)
+			ofi_ep_cntr_inc(&ibuf->ep->ep, ibuf->cntr);
+	}
+	ofi_buf_free(ibuf);
+}
+
+void ucx_inject_callback(void *request, ucs_status_t status, void *user_data)
+{
+	ucx_inject_complete(user_data, status);
+	ucx_req_release(request);
+}
+
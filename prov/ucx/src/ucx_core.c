@@ -30,9 +30,471 @@
  * SOFTWARE.
  */
 
+#include "ofi_iov.h"
 #include "ucx.h"
 #include "ucx_core.h"
 
+#if HAVE_DECL_UCP_TAG_SEND_NBX
+
+static ssize_t ucx_inject_sendmsg(struct ucx_ep *u_ep, ucp_ep_h dst_ep,
+				  const struct fi_msg_tagged *msg,
+				  uint64_t flags, struct util_cq *cq,
+				  enum ofi_cntr_index cntr,
+				  const enum ucx_comm_mode mode)
+{
+	struct ucx_inject_buf *ibuf;
+	ucp_request_param_t param;
+	ucs_status_ptr_t status;
+	size_t len;
+
+	len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
+	if (len > u_ep->inject_size)
+		return -FI_EMSGSIZE;
+
+	ibuf = ucx_inject_buf_get(u_ep, cntr, &param);
+	if (!ibuf)
+		return -FI_EAGAIN;
+
+	ofi_copy_from_iov(ibuf->data, len, msg->msg_iov, msg->iov_count, 0);
+	if (cq) {
+		ibuf->cq = cq;
+		ibuf->completion.op_context = msg->context;
+		ibuf->completion.flags = FI_SEND |
+					 (mode == UCX_MSG ? FI_MSG : FI_TAGGED);
+		ibuf->completion.len = len;
+		ibuf->completion.buf = msg->msg_iov[0].iov_base;
+		ibuf->completion.tag = msg->tag;
+	}
+
+	if (OFI_UNLIKELY(flags & FI_MATCH_COMPLETE))
+		status = ucp_tag_send_sync_nbx(dst_ep, ibuf->data, len,
+					       msg->tag, &param);
+	else
+		status = ucp_tag_send_nbx(dst_ep, ibuf->data, len, msg->tag,
+					  &param);
+
+	return ucx_inject_buf_post(ibuf, status);
+}
+
+static void ucx_req_init_send(struct ucx_request *req, struct util_cq *cq,
+			      const struct fi_msg_tagged *msg,
+			      const enum ucx_comm_mode mode)
+{
+	req->cq = cq;
+	req->completion.op_context = msg->context;
+	req->completion.flags = FI_SEND |
+				(mode == UCX_MSG ? FI_MSG : FI_TAGGED);
+	req->completion.len = msg->msg_iov[0].iov_len;
+	req->completion.buf = msg->msg_iov[0].iov_base;
+	req->completion.data = 0;
+	req->completion.tag = msg->tag;
+}
+
+/*
+ * FI_TRANSMIT_COMPLETE: the send itself completes silently and its CQ
+ * entry and counter update come from a flush of the peer's ucp_ep posted
+ * right behind it.  Other peers and the rest of the worker are not
+ * waited for.
+ */
+static void ucx_post_ep_flush(struct ucx_request *req, ucp_ep_h dst_ep,
+			      int no_completion)
+{
+	ucp_request_param_t param = {
+		.op_attr_mask = UCP_OP_ATTR_FIELD_CALLBACK |
+				UCP_OP_ATTR_FIELD_REQUEST,
+		.request = req,
+	};
+	ucs_status_ptr_t status;
+
+	param.cb.send = no_completion ? ucx_send_nbx_callback_no_compl :
+					ucx_send_nbx_callback;
+
+	status = ucp_ep_flush_nbx(dst_ep, &param);
+	if (!status)
+		param.cb.send(req, UCS_OK, NULL);
+	else if (UCS_PTR_IS_ERR(status))
+		param.cb.send(req, UCS_PTR_STATUS(status), NULL);
+}
+
+/*
+ * Requests come from the endpoint's req_pool and are filled in before the
+ * operation is posted, so the callbacks never see a partial request.  A
+ * send that UCX finishes inline returns NULL and is written to the CQ here.
+ */
+static ssize_t ucx_post_sendmsg(struct ucx_ep *u_ep,
+				const struct fi_msg_tagged *msg,
+				uint64_t flags, const enum ucx_comm_mode mode)
+{
+	ucp_ep_h dst_ep;
+	ucs_status_ptr_t status;
+	struct ucx_request *req, *flush_req = NULL;
+	struct util_cq *cq;
+	ucp_request_param_t param = {
+		.op_attr_mask = UCP_OP_ATTR_FIELD_CALLBACK |
+				UCP_OP_ATTR_FIELD_DATATYPE,
+	};
+	ucp_request_param_t flush_param = { 0 };
+	const void *send_buf;
+	size_t send_cnt;
+	int no_completion;
+	ssize_t ret;
+
+	dst_ep = UCX_GET_UCP_EP(u_ep, msg->addr);
+	cq = u_ep->ep.tx_cq;
+
+	no_completion = (u_ep->ep.tx_op_flags & FI_SELECTIVE_COMPLETION) &&
+			!(flags & FI_COMPLETION);
+
+	if (OFI_UNLIKELY(flags & FI_TRANSMIT_COMPLETE)) {
+		flush_req = ucx_req_alloc(u_ep, &flush_param);
+		if (!flush_req)
+			return -FI_EAGAIN;
+
+		ucx_req_init_send(flush_req, cq, msg, mode);
+		if (!no_completion && msg->context) {
+			struct fi_context *ctx = msg->context;
+
+			ctx->internal[0] = NULL;
+			ctx->internal[1] = NULL;
+		}
+	}
+
+	if (flags & FI_INJECT) {
+		if (flush_req)
+			ret = ucx_inject_sendmsg(u_ep, dst_ep, msg, flags, NULL,
+						 CNTR_CNT, mode);
+		else
+			ret = ucx_inject_sendmsg(u_ep, dst_ep, msg, flags,
+						 no_completion ? NULL : cq,
+						 CNTR_TX, mode);
+		goto flush;
+	}
+
+	req = ucx_req_alloc(u_ep, &param);
+	if (!req) {
+		ret = -FI_EAGAIN;
+		goto flush;
+	}
+
+	ucx_req_init_send(req, cq, msg, mode);
+
+	if (flush_req) {
+		param.cb.send = ucx_release_nbx_callback;
+	} else if (no_completion) {
+		param.cb.send = ucx_send_nbx_callback_no_compl;
+	} else {
+		param.cb.send = ucx_send_nbx_callback;
+		ucx_req_track(req);
+	}
+
+	if (msg->iov_count < 2) {
+		param.datatype = ucp_dt_make_contig(1);
+		send_buf = msg->msg_iov[0].iov_base;
+		send_cnt = msg->msg_iov[0].iov_len;
+	} else {
+		param.datatype = ucp_dt_make_iov();
+		send_buf = msg->msg_iov;
+		send_cnt = msg->iov_count;
+	}
+
+	if (OFI_UNLIKELY(flags & FI_MATCH_COMPLETE))
+		status = ucp_tag_send_sync_nbx(dst_ep, send_buf, send_cnt,
+					       msg->tag, &param);
+	else
+		status = ucp_tag_send_nbx(dst_ep, send_buf, send_cnt,
+					  msg->tag, &param);
+
+	if (UCS_PTR_IS_ERR(status)) {
+		FI_DBG(&ucx_prov,FI_LOG_CORE,
+		       "Send operation returns error: %s",
+		       ucs_status_string(UCS_PTR_STATUS(status)));
+		if (!no_completion && !flush_req)
+			ucx_req_untrack(req);
+		ucx_req_release(req);
+		ret = ucx_translate_errcode(UCS_PTR_STATUS(status));
+		goto flush;
+	}
+
+	/*
+	 * A returned request is owned by UCX until its callback runs, which
+	 * may happen at any time from now on, so req must not be touched.
+	 */
+	if (status) {
+		ret = FI_SUCCESS;
+		goto flush;
+	}
+
+	/* Done inline, the callback is not called. */
+	if (!no_completion && !flush_req)
+		ucx_req_untrack(req);
+	ucx_req_release(req);
+	if (flush_req) {
+		ret = FI_SUCCESS;
+		goto flush;
+	}
+
+	if (!no_completion) {
+		ofi_cq_write(cq,  msg->context,
+			     FI_SEND | ((mode == UCX_MSG) ? FI_MSG : FI_TAGGED),
+			     msg->msg_iov[0].iov_len, msg->msg_iov[0].iov_base,
+			     0, msg->tag);
+	}
+
+	ofi_ep_cntr_inc(&u_ep->ep, CNTR_TX);
+	return FI_SUCCESS;
+
+flush:
+	if (flush_req) {
+		if (ret)
+			ucx_req_release(flush_req);
+		else
+			ucx_post_ep_flush(flush_req, dst_ep, no_completion);
+	}
+	return ret;
+}
+
+/*
+ * The fenced send may only start once everything posted before it on the
+ * endpoint has completed.  The endpoint owns its worker, so this is a
+ * non-blocking flush of the worker.  Returns 0 once the fence is clear.
+ */
+static int ucx_post_fence(struct ucx_ep *u_ep, struct ucx_deferred_send *def)
+{
+	ucp_request_param_t param = {
+		.op_attr_mask = UCP_OP_ATTR_FIELD_CALLBACK |
+				UCP_OP_ATTR_FIELD_USER_DATA,
+		.cb.send = ucx_fence_callback,
+		.user_data = def,
+	};
+	struct ucx_request *req;
+	ucs_status_ptr_t status;
+
+	req = ucx_req_alloc(u_ep, &param);
+	if (!req)
+		return -FI_EAGAIN;
+
+	def->flush_posted = 1;
+	status = ucp_worker_flush_nbx(u_ep->worker, &param);
+	if (status && !UCS_PTR_IS_ERR(status))
+		return -FI_EAGAIN;
+
+	if (status)
+		FI_WARN(&ucx_prov, FI_LOG_EP_DATA, "Fence flush failed: %s\n",
+			ucs_status_string(UCS_PTR_STATUS(status)));
+
+	ucx_req_release(req);
+	def->flags &= ~FI_FENCE;
+	return 0;
+}
+
+void ucx_progress_deferred(struct ucx_ep *u_ep)
+{
+	struct ucx_deferred_send *def;
+	ssize_t ret;
+
+	while (!dlist_empty(&u_ep->deferred_list)) {
+		def = container_of(u_ep->deferred_list.next,
+				   struct ucx_deferred_send, entry);
+		if ((def->flags & FI_FENCE) &&
+		    (def->flush_posted || ucx_post_fence(u_ep, def)))
+			return;
+
+		ret = ucx_post_sendmsg(u_ep, &def->msg, def->flags, def->mode);
+		if (ret == -FI_EAGAIN)
+			return;
+
+		if (ret) {
+			FI_WARN(&ucx_prov, FI_LOG_EP_DATA,
+				"Deferred send failed: %s\n", fi_strerror(-ret));
+			if (!(u_ep->ep.tx_op_flags & FI_SELECTIVE_COMPLETION) ||
+			    (def->flags & FI_COMPLETION))
+				ucx_write_error_completion(u_ep->ep.tx_cq,
+					def->msg.context,
+					FI_SEND | (def->mode == UCX_MSG ?
+						   FI_MSG : FI_TAGGED),
+					(int) ret, (int) -ret, 0,
+					def->msg.tag);
+		}
+
+		dlist_remove(&def->entry);
+		ofi_buf_free(def);
+	}
+}
+
+static ssize_t ucx_defer_sendmsg(struct ucx_ep *u_ep,
+				 const struct fi_msg_tagged *msg,
+				 uint64_t flags, const enum ucx_comm_mode mode)
+{
+	struct ucx_deferred_send *def;
+	size_t len;
+
+	if (msg->iov_count > FI_UCX_DEFERRED_IOV_LIMIT)
+		return -FI_EINVAL;
+
+	def = ofi_buf_alloc(u_ep->deferred_pool);
+	if (!def)
+		return -FI_EAGAIN;
+
+	def->msg = *msg;
+	def->msg.desc = NULL;
+	def->msg.msg_iov = def->iov;
+	if (flags & FI_INJECT) {
+		len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
+		if (len > u_ep->inject_size) {
+			ofi_buf_free(def);
+			return -FI_EMSGSIZE;
+		}
+		ofi_copy_from_iov(def->data, len, msg->msg_iov,
+				  msg->iov_count, 0);
+		def->iov[0].iov_base = def->data;
+		def->iov[0].iov_len = len;
+		def->msg.iov_count = 1;
+	} else {
+		memcpy(def->iov, msg->msg_iov,
+		       sizeof(*msg->msg_iov) * msg->iov_count);
+	}
+	def->flags = flags;
+	def->mode = mode;
+	def->flush_posted = 0;
+
+	if (msg->context && (!(u_ep->ep.tx_op_flags & FI_SELECTIVE_COMPLETION) ||
+			     (flags & FI_COMPLETION))) {
+		struct fi_context *ctx = msg->context;
+
+		ctx->internal[0] = NULL;
+		ctx->internal[1] = NULL;
+	}
+
+	dlist_insert_tail(&def->entry, &u_ep->deferred_list);
+	ucx_progress_deferred(u_ep);
+	return FI_SUCCESS;
+}
+
+/*
+ * A fenced send waits in deferred_list for the worker flush, and sends
+ * issued after it queue up behind it to preserve FI_ORDER_SAS.
+ */
+ssize_t ucx_do_sendmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
+		       uint64_t flags, const enum ucx_comm_mode mode)
+{
+	struct ucx_ep *u_ep;
+
+	u_ep = container_of(ep, struct ucx_ep, ep.ep_fid);
+	if (OFI_UNLIKELY((flags & FI_FENCE) ||
+			 !dlist_empty(&u_ep->deferred_list)))
+		return ucx_defer_sendmsg(u_ep, msg, flags, mode);
+
+	return ucx_post_sendmsg(u_ep, msg, flags, mode);
+}
+
+/*
+ * Receives are posted with UCP_OP_ATTR_FLAG_NO_IMM_CMPL: a receive that
+ * matches an unexpected message could otherwise only report a truncation
+ * through the return value, where it can't be told apart from a failure
+ * to post.  Instead UCX calls the callback before returning, which writes
+ * the completion straight to the CQ and gives the request back to the
+ * pool.
+ */
+ssize_t ucx_do_recvmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
+		       const uint64_t flags, const enum ucx_comm_mode mode)
+{
+	ucs_status_ptr_t status;
+	struct ucx_ep *u_ep;
+	struct ucx_request *req;
+	struct ucx_claimed_msg *cmsg = NULL;
+	ucp_request_param_t param = {
+		.op_attr_mask = UCP_OP_ATTR_FIELD_CALLBACK |
+				UCP_OP_ATTR_FIELD_DATATYPE |
+				UCP_OP_ATTR_FLAG_NO_IMM_CMPL,
+	};
+	size_t recv_cnt;
+	void *recv_buf;
+	ssize_t posted_size = 0;
+	int completion;
+	int claim_discard = (flags & FI_CLAIM) && (flags & FI_DISCARD);
+	int i;
+
+	u_ep = container_of(ep, struct ucx_ep, ep.ep_fid);
+
+	if (claim_discard) {
+		param.datatype = ucp_dt_make_contig(1);
+		recv_buf = NULL;
+		recv_cnt = 0;
+		posted_size = recv_cnt;
+	} else if (msg->iov_count < 2) {
+		param.datatype = ucp_dt_make_contig(1);
+		recv_buf = msg->msg_iov[0].iov_base;
+		recv_cnt = msg->msg_iov[0].iov_len;
+		posted_size = recv_cnt;
+	} else {
+		param.datatype = ucp_dt_make_iov();
+		recv_buf = (void*) msg->msg_iov;
+		recv_cnt = msg->iov_count;
+		for (i=0; i < msg->iov_count; ++i )
+			posted_size += msg->msg_iov[i].iov_len;
+	}
+
+	completion = !(u_ep->ep.rx_op_flags & FI_SELECTIVE_COMPLETION) ||
+		     (flags & FI_COMPLETION) || claim_discard;
+
+	if (flags & FI_CLAIM) {
+		cmsg = ucx_dequeue_claimed(u_ep, msg);
+		if (!cmsg)
+			return -FI_EINVAL;
+	}
+
+	req = ucx_req_alloc(u_ep, &param);
+	if (!req) {
+		free(cmsg);
+		return -FI_EAGAIN;
+	}
+
+	req->type = UCX_REQ_REGULAR;
+	req->cq = u_ep->ep.rx_cq;
+	req->posted_size = posted_size;
+	req->completion.op_context = msg->context;
+	req->completion.flags = FI_RECV |
+				(mode == UCX_MSG ? FI_MSG : FI_TAGGED);
+	req->completion.len = msg->msg_iov[0].iov_len;
+	req->completion.buf = claim_discard ? NULL : msg->msg_iov[0].iov_base;
+	req->completion.data = 0;
+	req->completion.tag = msg->tag;
+	ucx_req_track(req);
+
+	param.cb.recv = completion ? ucx_recv_nbx_callback :
+				     ucx_recv_nbx_callback_no_compl;
+
+	if (cmsg) {
+		status = ucp_tag_msg_recv_nbx(u_ep->worker, recv_buf, recv_cnt,
+					      cmsg->ucp_msg, &param);
+		free(cmsg);
+	} else {
+		status = ucp_tag_recv_nbx(u_ep->worker, recv_buf, recv_cnt,
+					  msg->tag, ~msg->ignore, &param);
+	}
+
+	if (UCS_PTR_IS_ERR(status)) {
+		FI_DBG(&ucx_prov,FI_LOG_CORE,
+		       "Recv operation returns error: %s",
+		       ucs_status_string(UCS_PTR_STATUS(status)));
+		ucx_req_untrack(req);
+		ucx_req_release(req);
+		return ucx_translate_errcode(UCS_PTR_STATUS(status));
+	}
+
+	/*
+	 * The callback may already have run and released req if the receive
+	 * matched an unexpected message, so req is not looked at again.
+	 */
+	return FI_SUCCESS;
+}
+
+#else /* HAVE_DECL_UCP_TAG_SEND_NBX */
+
+/*
+ * UCX releases before 1.9 only provide the _nb calls.  Requests are
+ * allocated by UCX, injects and fences block until the operation is done.
+ */
 ssize_t ucx_do_sendmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 		       uint64_t flags, const enum ucx_comm_mode mode)
 {
@@ -280,3 +742,5 @@ ssize_t ucx_do_recvmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 	ucx_req_release(req);
 	return ret;
 }
+
+#endif /* HAVE_DECL_UCP_TAG_SEND_NBX */
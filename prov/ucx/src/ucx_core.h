@@ -102,6 +102,82 @@ static inline ssize_t ucx_gen_mrecv_completion(struct ucx_mrecv_request *req)
 	return ret;
 }
 
+#if HAVE_DECL_UCP_TAG_SEND_NBX
+/*
+ * Injected data is copied to a bounce buffer from the endpoint's pool and
+ * the operation returns as soon as it is posted.  The buffer goes back to
+ * the pool from ucx_inject_callback, or right away if UCX completes the
+ * operation inline.
+ */
+static inline struct ucx_inject_buf *
+ucx_inject_buf_get(struct ucx_ep *u_ep, enum ofi_cntr_index cntr,
+		   ucp_request_param_t *param)
+{
+	struct ucx_inject_buf *ibuf;
+
+	ibuf = ofi_buf_alloc(u_ep->inject_pool);
+	if (!ibuf)
+		return NULL;
+
+	ibuf->ep = u_ep;
+	ibuf->cq = NULL;
+	ibuf->cntr = cntr;
+
+	param->op_attr_mask = UCP_OP_ATTR_FIELD_CALLBACK |
+			      UCP_OP_ATTR_FIELD_USER_DATA |
+			      UCP_OP_ATTR_FIELD_DATATYPE;
+	param->cb.send = ucx_inject_callback;
+	param->user_data = ibuf;
+	param->datatype = ucp_dt_make_contig(1);
+#if HAVE_DECL_UCP_OP_ATTR_FIELD_MEMH
+	param->op_attr_mask |= UCP_OP_ATTR_FIELD_MEMH;
+	param->memh = ofi_buf_region(ibuf)->context;
+#endif
+	return ibuf;
+}
+
+static inline ssize_t ucx_inject_buf_post(struct ucx_inject_buf *ibuf,
+					  ucs_status_ptr_t status)
+{
+	if (status == NULL) {
+		ucx_inject_complete(ibuf, UCS_OK);
+		return FI_SUCCESS;
+	}
+
+	if (UCS_PTR_IS_ERR(status)) {
+		FI_DBG(&ucx_prov,FI_LOG_CORE,
+		       "Inject operation returns error: %s",
+		       ucs_status_string(UCS_PTR_STATUS(status)));
+		ofi_buf_free(ibuf);
+		return ucx_translate_errcode(UCS_PTR_STATUS(status));
+	}
+
+	return FI_SUCCESS;
+}
+
+static inline ssize_t ucx_do_inject(struct fid_ep *ep, const void *buf,
+				    size_t len, fi_addr_t dest_addr,
+				    uint64_t tag)
+{
+	struct ucx_ep *u_ep;
+	struct ucx_inject_buf *ibuf;
+	ucp_request_param_t param;
+	ucs_status_ptr_t status;
+
+	u_ep = container_of(ep, struct ucx_ep, ep.ep_fid);
+	if (len > u_ep->inject_size)
+		return -FI_EMSGSIZE;
+
+	ibuf = ucx_inject_buf_get(u_ep, CNTR_TX, &param);
+	if (!ibuf)
+		return -FI_EAGAIN;
+
+	memcpy(ibuf->data, buf, len);
+	status = ucp_tag_send_nbx(UCX_GET_UCP_EP(u_ep, dest_addr), ibuf->data,
+				  len, tag, &param);
+	return ucx_inject_buf_post(ibuf, status);
+}
+#else
 static inline ssize_t ucx_do_inject(struct fid_ep *ep, const void *buf,
 				    size_t len, fi_addr_t dest_addr,
 				    uint64_t tag)
@@ -135,6 +211,7 @@ static inline ssize_t ucx_do_inject(struct fid_ep *ep, const void *buf,
 
 	return -ucx_translate_errcode(ret);
 }
+#endif
 
 ssize_t ucx_do_sendmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 		       uint64_t flags, const enum ucx_comm_mode mode);
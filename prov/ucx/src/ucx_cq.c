@@ -42,6 +42,17 @@ static ssize_t ucx_cq_sreadfrom(struct fid_cq *cq_fid, void *buf, size_t count,
 	ssize_t ret;
 
 	cq = container_of(cq_fid, struct util_cq, cq_fid);
+
+	/*
+	 * The event fd of every worker bound to the CQ is part of an fd
+	 * based wait, so the thread can sleep until UCX has work for it.
+	 */
+	if (cq->wait && cq->internal_wait &&
+	    (cq->wait->wait_obj == FI_WAIT_FD ||
+	     cq->wait->wait_obj == FI_WAIT_POLLFD))
+		return ofi_cq_sreadfrom(cq_fid, buf, count, src_addr, cond,
+					timeout);
+
 	endtime = ofi_timeout_time(timeout);
 
 	while (1) {
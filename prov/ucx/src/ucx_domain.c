@@ -335,6 +335,7 @@ static void ucx_req_reset(void *request)
 	mreq->type = UCX_REQ_UNSPEC;
 	mreq->cq = NULL;
 	mreq->ep = NULL;
+	mreq->pool_buf = NULL;
 }
 
 int ucx_domain_open(struct fid_fabric *fabric, struct fi_info *info,
@@ -344,8 +345,12 @@ int ucx_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 	int ofi_status;
 	struct ucx_domain* domain;
 	size_t univ_size;
+	ucp_context_attr_t attr = {
+		.field_mask = UCP_ATTR_FIELD_REQUEST_SIZE,
+	};
 	ucp_params_t params = {
-		.features = UCP_FEATURE_TAG | UCP_FEATURE_RMA,
+		.features = UCP_FEATURE_TAG | UCP_FEATURE_RMA |
+			    UCP_FEATURE_WAKEUP,
 		.request_size = sizeof(struct ucx_request),
 		.request_init = ucx_req_reset,
 		.field_mask = UCP_PARAM_FIELD_FEATURES |
@@ -386,6 +391,14 @@ int ucx_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 		goto destroy_domain;
 	}
 
+	/* room UCX needs in front of requests passed in by the provider */
+	status = ucp_context_query(domain->context, &attr);
+	if (status != UCS_OK) {
+		ofi_status = ucx_translate_errcode(status);
+		goto cleanup_context;
+	}
+	domain->req_size = ofi_get_aligned_size(attr.request_size, 16);
+
 	domain->u_domain.domain_fid.fid.ops = &ucx_fi_ops;
 	domain->u_domain.domain_fid.ops = &ucx_domain_ops;
 	domain->u_domain.domain_fid.mr = &ucx_mr_ops;
@@ -393,6 +406,9 @@ int ucx_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 	*fid = &(domain->u_domain.domain_fid);
 	return FI_SUCCESS;
 
+cleanup_context:
+	ucp_cleanup(domain->context);
+
 destroy_domain:
 	ofi_domain_close(&(domain->u_domain));
 
@@ -51,6 +51,11 @@ static void ucx_ep_progress( struct util_ep *util_ep)
 			ucx_mrecv_repost(ep, mctx);
 		}
 	}
+
+#if HAVE_DECL_UCP_TAG_SEND_NBX
+	if (!dlist_empty(&ep->deferred_list))
+		ucx_progress_deferred(ep);
+#endif
 }
 
 
@@ -112,6 +117,125 @@ static int ucx_ep_setopt(fid_t fid, int level, int optname,
 	return -FI_EINVAL;
 }
 
+static int ucx_inject_region_map(struct ofi_bufpool_region *region)
+{
+	struct ucx_ep *ep = region->pool->attr.context;
+	struct ucx_domain *domain;
+	ucs_status_t status;
+	ucp_mem_map_params_t params = {
+		.field_mask = UCP_MEM_MAP_PARAM_FIELD_ADDRESS |
+			      UCP_MEM_MAP_PARAM_FIELD_LENGTH,
+		.address = region->mem_region,
+		.length = region->pool->region_size,
+	};
+
+	domain = container_of(ep->ep.domain, struct ucx_domain, u_domain);
+	status = ucp_mem_map(domain->context, &params,
+			     (ucp_mem_h *) &region->context);
+	return ucx_translate_errcode(status);
+}
+
+static void ucx_inject_region_unmap(struct ofi_bufpool_region *region)
+{
+	struct ucx_ep *ep = region->pool->attr.context;
+	struct ucx_domain *domain;
+
+	domain = container_of(ep->ep.domain, struct ucx_domain, u_domain);
+	ucp_mem_unmap(domain->context, region->context);
+}
+
+/*
+ * Bounded by the tx size, inject returns -FI_EAGAIN once that many are
+ * outstanding, until the application progresses the endpoint.
+ */
+static int ucx_ep_create_inject_pool(struct ucx_ep *ep, struct fi_info *info)
+{
+	struct ofi_bufpool_attr attr = {
+		.size = sizeof(struct ucx_inject_buf) + ep->inject_size,
+		.alignment = 16,
+		.max_cnt = info->tx_attr->size,
+		.chunk_cnt = MIN(64, info->tx_attr->size),
+		.alloc_fn = ucx_inject_region_map,
+		.free_fn = ucx_inject_region_unmap,
+		.context = ep,
+		.flags = OFI_BUFPOOL_NO_TRACK,
+	};
+
+	return ofi_bufpool_create_attr(&attr, &ep->inject_pool);
+}
+
+static int ucx_ep_create_req_pool(struct ucx_ep *ep,
+				  struct ucx_domain *domain)
+{
+	ep->req_offset = domain->req_size;
+	return ofi_bufpool_create(&ep->req_pool,
+				  ep->req_offset + sizeof(struct ucx_request),
+				  64, 0, 256, OFI_BUFPOOL_NO_TRACK);
+}
+
+static int ucx_ep_create_deferred_pool(struct ucx_ep *ep, struct fi_info *info)
+{
+	return ofi_bufpool_create(&ep->deferred_pool,
+				  sizeof(struct ucx_deferred_send) +
+				  ep->inject_size, 16, info->tx_attr->size,
+				  16, OFI_BUFPOOL_NO_TRACK);
+}
+
+/*
+ * Called before blocking on an fd wait the worker's event fd was added
+ * to.  The fd is only safe to wait on once ucp_worker_arm succeeds, which
+ * fails with UCS_ERR_BUSY while the worker has events to progress.
+ */
+static int ucx_ep_trywait(void *arg)
+{
+	struct ucx_ep *ep = arg;
+	struct ucx_deferred_send *def;
+	ucs_status_t status;
+
+	if (!dlist_empty(&ep->mctx_repost))
+		return -FI_EAGAIN;
+
+	if (!dlist_empty(&ep->deferred_list)) {
+		def = container_of(ep->deferred_list.next,
+				   struct ucx_deferred_send, entry);
+		if (!(def->flags & FI_FENCE) || !def->flush_posted)
+			return -FI_EAGAIN;
+	}
+
+	status = ucp_worker_arm(ep->worker);
+	if (status == UCS_ERR_BUSY)
+		return -FI_EAGAIN;
+
+	return ucx_translate_errcode(status);
+}
+
+static int ucx_ep_add_wait(struct ucx_ep *ep, struct util_wait *wait)
+{
+	int i, ret;
+
+	if (!wait || (wait->wait_obj != FI_WAIT_FD &&
+		      wait->wait_obj != FI_WAIT_POLLFD))
+		return FI_SUCCESS;
+
+	for (i = 0; i < ep->efd_wait_cnt; i++) {
+		if (ep->efd_waits[i] == wait)
+			return FI_SUCCESS;
+	}
+
+	assert((size_t) ep->efd_wait_cnt < ARRAY_SIZE(ep->efd_waits));
+	ret = ofi_wait_add_fd(wait, ep->efd, POLLIN, ucx_ep_trywait, ep,
+			      &ep->ep.ep_fid.fid);
+	if (ret) {
+		FI_WARN(&ucx_prov, FI_LOG_EP_CTRL,
+			"Unable to add worker fd to wait: %s\n",
+			fi_strerror(-ret));
+		return ret;
+	}
+
+	ep->efd_waits[ep->efd_wait_cnt++] = wait;
+	return FI_SUCCESS;
+}
+
 static int ucx_ep_close(fid_t fid)
 {
 	struct ucx_ep *ep;
@@ -137,7 +261,13 @@ static int ucx_ep_close(fid_t fid)
 	if (ucx_descriptor.ep_flush)
 		ucp_worker_flush(ep->worker);
 
+	while (ep->efd_wait_cnt)
+		ofi_wait_del_fd(ep->efd_waits[--ep->efd_wait_cnt], ep->efd);
+
 	ucp_worker_destroy(ep->worker);
+	ofi_bufpool_destroy(ep->inject_pool);
+	ofi_bufpool_destroy(ep->req_pool);
+	ofi_bufpool_destroy(ep->deferred_pool);
 	while(!dlist_empty(&ep->mctx_freelist)) {
 		dlist_pop_front(&ep->mctx_freelist, struct ucx_mrecv_ctx,
 				mrecv_ctx, list);
@@ -168,10 +298,14 @@ static int ucx_ep_bind(struct fid *fid, struct fid *bfid, uint64_t flags)
 	case FI_CLASS_CQ:
 		cq = container_of(bfid, struct util_cq, cq_fid.fid);
 		status = ofi_ep_bind_cq(&ep->ep, cq, flags);
+		if (!status)
+			status = ucx_ep_add_wait(ep, cq->wait);
 		break;
 	case FI_CLASS_CNTR:
 		cntr = container_of(bfid, struct util_cntr, cntr_fid.fid);
 		status = ofi_ep_bind_cntr(&ep->ep, cntr, flags);
+		if (!status)
+			status = ucx_ep_add_wait(ep, cntr->wait);
 		break;
 	case FI_CLASS_AV:
 		if (ep->av) {
@@ -271,6 +405,39 @@ int ucx_ep_open(struct fid_domain *domain, struct fi_info *info,
 		goto free_ep;
 	}
 
+	status = ucp_worker_get_efd(ep->worker, &ep->efd);
+	if (status != UCS_OK) {
+		ofi_status = ucx_translate_errcode(status);
+		ucp_worker_destroy(ep->worker);
+		ofi_atomic_dec32(&(u_domain->u_domain.ref));
+		goto free_ep;
+	}
+
+	ep->inject_size = info->tx_attr->inject_size;
+	ofi_status = ucx_ep_create_inject_pool(ep, info);
+	if (ofi_status) {
+		ucp_worker_destroy(ep->worker);
+		ofi_atomic_dec32(&(u_domain->u_domain.ref));
+		goto free_ep;
+	}
+
+	ofi_status = ucx_ep_create_req_pool(ep, u_domain);
+	if (ofi_status) {
+		ofi_bufpool_destroy(ep->inject_pool);
+		ucp_worker_destroy(ep->worker);
+		ofi_atomic_dec32(&(u_domain->u_domain.ref));
+		goto free_ep;
+	}
+
+	ofi_status = ucx_ep_create_deferred_pool(ep, info);
+	if (ofi_status) {
+		ofi_bufpool_destroy(ep->req_pool);
+		ofi_bufpool_destroy(ep->inject_pool);
+		ucp_worker_destroy(ep->worker);
+		ofi_atomic_dec32(&(u_domain->u_domain.ref));
+		goto free_ep;
+	}
+
 	if (ucx_descriptor.use_ns) {
 		char tmpb [FI_UCX_MAX_NAME_LEN]={0};
 
@@ -304,6 +471,7 @@ int ucx_ep_open(struct fid_domain *domain, struct fi_info *info,
 	dlist_init(&(ep->claimed_list));
 	dlist_init(&(ep->mctx_freelist));
 	dlist_init(&(ep->mctx_repost));
+	dlist_init(&ep->deferred_list);
 	*fid = &(ep->ep.ep_fid);
 	ep->ep_opts.mrecv_min_size = 0;
 
@@ -31,6 +31,7 @@
  */
 
 #include "ucx.h"
+#include "ucx_core.h"
 #include "ofi_util.h"
 
 #define UCX_DO_READ 0
@@ -322,6 +323,34 @@ static ssize_t ucx_proc_rma_msg(struct fid_ep *ep,
 	return FI_SUCCESS;
 }
 
+#if HAVE_DECL_UCP_TAG_SEND_NBX
+ssize_t ucx_inject_write(struct fid_ep *ep, const void *buf, size_t len,
+			 fi_addr_t dest_addr, uint64_t addr, uint64_t key)
+{
+	struct ucx_ep* u_ep;
+	struct ucx_inject_buf *ibuf;
+	ucp_request_param_t param;
+	ucs_status_ptr_t status;
+	struct ucx_mr_rkey *rkey;
+
+	u_ep = container_of(ep, struct ucx_ep, ep.ep_fid);
+	if (len > u_ep->inject_size)
+		return -FI_EMSGSIZE;
+
+	rkey = ucx_get_rkey(u_ep, dest_addr, key);
+	if (!rkey)
+		return -FI_EINVAL;
+
+	ibuf = ucx_inject_buf_get(u_ep, CNTR_WR, &param);
+	if (!ibuf)
+		return -FI_EAGAIN;
+
+	memcpy(ibuf->data, buf, len);
+	status = ucp_put_nbx(UCX_GET_UCP_EP(u_ep, dest_addr), ibuf->data, len,
+			     addr, rkey->rkey, &param);
+	return ucx_inject_buf_post(ibuf, status);
+}
+#else
 ssize_t ucx_inject_write(struct fid_ep *ep, const void *buf, size_t len,
 			 fi_addr_t dest_addr, uint64_t addr, uint64_t key)
 {
@@ -354,6 +383,7 @@ ssize_t ucx_inject_write(struct fid_ep *ep, const void *buf, size_t len,
 
 	return ucx_translate_errcode(ret);
 }
+#endif
 
 struct fi_ops_rma ucx_rma_ops = {
 	.size = sizeof(struct fi_ops_rma),
@@ -98,6 +98,15 @@ int udpx_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 		return ret;
 	}
 
+	if (info->domain_attr->data_progress == FI_PROGRESS_AUTO) {
+		ret = ofi_domain_start_progress(util_domain);
+		if (ret) {
+			(void) ofi_domain_close(util_domain);
+			free(util_domain);
+			return ret;
+		}
+	}
+
 	*domain = &util_domain->domain_fid;
 	(*domain)->fid.ops = &udpx_domain_fi_ops;
 	(*domain)->ops = &udpx_domain_ops;
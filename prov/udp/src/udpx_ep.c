@@ -270,15 +270,15 @@ static void udpx_rx_src_comp_signal(struct udpx_ep *ep, void *context,
 	ep->util_ep.rx_cq->wait->signal(ep->util_ep.rx_cq->wait);
 }
 
-static void udpx_ep_progress(struct util_ep *util_ep)
+/* Returns 1 if a posted receive was completed. */
+static int udpx_ep_progress_rx(struct udpx_ep *ep)
 {
-	struct udpx_ep *ep;
 	struct udpx_ep_entry *entry;
 	struct msghdr hdr;
 	struct sockaddr_in6 addr;
 	ssize_t ret;
+	int cnt = 0;
 
-	ep = container_of(util_ep, struct udpx_ep, util_ep);
 	hdr.msg_name = &addr;
 	hdr.msg_namelen = sizeof(addr);
 	hdr.msg_control = NULL;
@@ -297,9 +297,36 @@ static void udpx_ep_progress(struct util_ep *util_ep)
 	if (ret >= 0) {
 		ep->rx_comp(ep, entry->context, 0, ret, NULL, &addr);
 		ofi_cirque_discard(ep->rxq);
+		cnt = 1;
 	}
 out:
 	ofi_genlock_unlock(&ep->util_ep.rx_cq->cq_lock);
+	return cnt;
+}
+
+static void udpx_ep_progress(struct util_ep *util_ep)
+{
+	(void) udpx_ep_progress_rx(container_of(util_ep, struct udpx_ep,
+						util_ep));
+}
+
+/* Called by the domain progress thread when the socket is readable */
+static int udpx_ep_auto_progress(struct fid *fid)
+{
+	struct udpx_ep *ep;
+	int ret, cnt = 0;
+
+	ep = container_of(fid, struct udpx_ep, util_ep.ep_fid.fid);
+	while ((ret = udpx_ep_progress_rx(ep)) > 0)
+		cnt += ret;
+	return cnt;
+}
+
+/* A new receive may match data that is already queued on the socket */
+static void udpx_ep_signal_progress(struct udpx_ep *ep)
+{
+	if (ep->util_ep.domain->progress)
+		ofi_progress_signal(ep->util_ep.domain->progress);
 }
 
 static ssize_t udpx_recvmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
@@ -328,6 +355,8 @@ static ssize_t udpx_recvmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 	ret = 0;
 out:
 	ofi_genlock_unlock(&ep->util_ep.rx_cq->cq_lock);
+	if (!ret)
+		udpx_ep_signal_progress(ep);
 	return ret;
 }
 
@@ -368,6 +397,8 @@ static ssize_t udpx_recv(struct fid_ep *ep_fid, void *buf, size_t len,
 	ret = 0;
 out:
 	ofi_genlock_unlock(&ep->util_ep.rx_cq->cq_lock);
+	if (!ret)
+		udpx_ep_signal_progress(ep);
 	return ret;
 }
 
@@ -557,12 +588,17 @@ static int udpx_ep_close(struct fid *fid)
 		return -FI_EBUSY;
 	}
 
+	if (ep->util_ep.domain->progress)
+		ofi_progress_del(ep->util_ep.domain->progress,
+				 &ep->util_ep.ep_fid.fid);
+
 	if (ep->util_ep.rx_cq) {
 		if (ep->util_ep.rx_cq->wait) {
 			wait = container_of(ep->util_ep.rx_cq->wait,
 					    struct util_wait_fd, util_wait);
 			ofi_epoll_del(wait->epoll_fd, (int)ep->sock);
 		}
+		ofi_cq_del_progress_fd(ep->util_ep.rx_cq, (int)ep->sock);
 		fid_list_remove2(&ep->util_ep.rx_cq->ep_list,
 				&ep->util_ep.rx_cq->ep_list_lock,
 				&ep->util_ep.ep_fid.fid);
@@ -614,6 +650,11 @@ static int udpx_ep_bind_cq(struct udpx_ep *ep, struct util_cq *cq,
 				udpx_rx_src_comp : udpx_rx_comp;
 		}
 
+		/* Data arriving on the socket makes the endpoint active */
+		ret = ofi_cq_add_progress_fd(cq, (int)ep->sock, &ep->util_ep);
+		if (ret)
+			return ret;
+
 		ret = fid_list_insert2(&cq->ep_list,
 				      &cq->ep_list_lock,
 				      &ep->util_ep.ep_fid.fid);
@@ -706,6 +747,12 @@ static int udpx_ep_ctrl(struct fid *fid, int command, void *arg)
 
 		if (!ep->is_bound)
 			udpx_bind_src_addr(ep);
+
+		if (ep->util_ep.domain->progress && ep->util_ep.rx_cq)
+			return ofi_progress_add(ep->util_ep.domain->progress,
+						&ep->util_ep.ep_fid.fid, NULL,
+						udpx_ep_auto_progress,
+						(int) ep->sock, NULL, NULL);
 		break;
 	default:
 		return -FI_ENOSYS;
@@ -779,6 +826,7 @@ int udpx_endpoint(struct fid_domain *domain, struct fi_info *info,
 	if (ret)
 		goto err2;
 
+	ofi_ep_progress_hint(&ep->util_ep);
 	*ep_fid = &ep->util_ep.ep_fid;
 	(*ep_fid)->fid.ops = &udpx_ep_fi_ops;
 	(*ep_fid)->ops = &udpx_ep_ops;
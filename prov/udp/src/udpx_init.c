@@ -42,8 +42,23 @@ static int udpx_getinfo(uint32_t version, const char *node, const char *service,
 			uint64_t flags, const struct fi_info *hints,
 			struct fi_info **info)
 {
-	return ofi_ip_getinfo(&udpx_util_prov, version, node, service, flags,
-			      hints, info);
+	struct fi_info *cur;
+	int ret;
+
+	ret = ofi_ip_getinfo(&udpx_util_prov, version, node, service, flags,
+			     hints, info);
+	if (ret)
+		return ret;
+
+	for (cur = *info; cur; cur = cur->next) {
+		/* Auto progress runs a progress thread and must be requested */
+		if (!hints || !hints->domain_attr ||
+		    hints->domain_attr->data_progress != FI_PROGRESS_AUTO)
+			cur->domain_attr->data_progress = FI_PROGRESS_MANUAL;
+		else
+			cur->domain_attr->threading = FI_THREAD_SAFE;
+	}
+	return 0;
 }
 
 static void udpx_fini(void)
@@ -37,6 +37,7 @@
 #include <ofi_util.h>
 
 #define UTIL_DEF_CQ_SIZE (1024)
+#define OFI_CQ_PROGRESS_FD_CNT 64
 
 
 /* While the CQ is full, we continue to add new entries to the auxiliary
@@ -448,6 +449,9 @@ int ofi_cq_cleanup(struct util_cq *cq)
 		cq->err_data = NULL;
 	}
 
+	if (cq->progress_fds != OFI_EPOLL_INVALID)
+		ofi_epoll_close(cq->progress_fds);
+
 	ofi_genlock_destroy(&cq->cq_lock);
 	ofi_genlock_destroy(&cq->ep_list_lock);
 	ofi_atomic_dec32(&cq->domain->ref);
@@ -513,18 +517,83 @@ int ofi_check_bind_cq_flags(struct util_ep *ep, struct util_cq *cq,
 	return FI_SUCCESS;
 }
 
+int ofi_cq_add_progress_fd(struct util_cq *cq, int fd, struct util_ep *ep)
+{
+	int ret = 0;
+
+	ofi_genlock_lock(&cq->ep_list_lock);
+	if (cq->progress_fds == OFI_EPOLL_INVALID) {
+		ret = ofi_epoll_create(&cq->progress_fds);
+		if (ret) {
+			cq->progress_fds = OFI_EPOLL_INVALID;
+			goto out;
+		}
+	}
+
+	ret = ofi_epoll_add(cq->progress_fds, fd, OFI_EPOLL_IN, ep);
+out:
+	ofi_genlock_unlock(&cq->ep_list_lock);
+	return ret;
+}
+
+void ofi_cq_del_progress_fd(struct util_cq *cq, int fd)
+{
+	ofi_genlock_lock(&cq->ep_list_lock);
+	if (cq->progress_fds != OFI_EPOLL_INVALID)
+		(void) ofi_epoll_del(cq->progress_fds, fd);
+	ofi_genlock_unlock(&cq->ep_list_lock);
+}
+
+/* Called with the ep_list_lock held, which keeps the endpoints from being
+ * freed while they are marked.  Readable fds beyond the first
+ * OFI_CQ_PROGRESS_FD_CNT are reported by the next reads, as epoll rotates
+ * its ready list.
+ */
+static void ofi_cq_poll_progress_fds(struct util_cq *cq)
+{
+	struct ofi_epollfds_event events[OFI_CQ_PROGRESS_FD_CNT];
+	int i, ret;
+
+	ret = ofi_epoll_wait(cq->progress_fds, events, OFI_CQ_PROGRESS_FD_CNT,
+			     0);
+	for (i = 0; i < ret; i++)
+		ofi_ep_set_active(events[i].data.ptr);
+}
+
 void ofi_cq_progress(struct util_cq *cq)
 {
 	struct util_ep *ep;
 	struct fid_list_entry *fid_entry;
-	struct dlist_entry *item;
+	struct dlist_entry *item, *next;
+	size_t budget = ofi_cq_progress_budget;
+	bool sweep;
 
 	ofi_genlock_lock(&cq->ep_list_lock);
-	dlist_foreach(&cq->ep_list, item) {
+	sweep = !ofi_cq_progress_sweep ||
+		!(++cq->progress_cnt % ofi_cq_progress_sweep);
+	if (!sweep && cq->progress_fds != OFI_EPOLL_INVALID)
+		ofi_cq_poll_progress_fds(cq);
+
+	dlist_foreach_safe(&cq->ep_list, item, next) {
 		fid_entry = container_of(item, struct fid_list_entry, entry);
 		ep = container_of(fid_entry->fid, struct util_ep, ep_fid.fid);
+		if (ep->flags & OFI_EP_PROGRESS_HINT) {
+			if (!sweep && !ofi_atomic_get32(&ep->active))
+				continue;
+			ofi_atomic_set32(&ep->active, 0);
+		}
 		ep->progress(ep);
 
+		if (budget && !--budget) {
+			/* Rotate the list so that the next call starts with
+			 * the first endpoint that was not progressed.
+			 */
+			if (next != &cq->ep_list) {
+				dlist_remove(&cq->ep_list);
+				dlist_insert_before(&cq->ep_list, next);
+			}
+			break;
+		}
 	}
 	ofi_genlock_unlock(&cq->ep_list_lock);
 }
@@ -720,6 +789,8 @@ int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
 	cq->cq_fid.fid.ops = &util_cq_fi_ops;
 	cq->cq_fid.ops = &util_cq_ops;
 	cq->progress = progress;
+	cq->progress_cnt = 0;
+	cq->progress_fds = OFI_EPOLL_INVALID;
 	cq->err_data = NULL;
 
 	cq->domain = container_of(domain, struct util_domain, domain_fid);
@@ -76,6 +76,7 @@ int ofi_domain_close(struct util_domain *domain)
 	if (ofi_atomic_get32(&domain->ref))
 		return -FI_EBUSY;
 
+	ofi_domain_stop_progress(domain);
 	if (domain->eq)
 		ofi_atomic_dec32(&domain->eq->ref);
 	if (domain->mr_map.rbtree)
@@ -230,6 +230,7 @@ int ofi_endpoint_init(struct fid_domain *domain, const struct util_prov *util_pr
 	ep->caps = info->caps;
 	ep->flags = 0;
 	ep->progress = progress;
+	ofi_atomic_initialize32(&ep->active, 0);
 	ep->tx_op_flags = info->tx_attr->op_flags;
 	ep->rx_op_flags = info->rx_attr->op_flags;
 	ep->tx_msg_flags = 0;
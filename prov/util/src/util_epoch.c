@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <sched.h>
+
+#include <ofi_epoch.h>
+
+int ofi_epoch_init(struct ofi_epoch *epoch)
+{
+	int i;
+
+	ofi_atomic_initialize64(&epoch->global, 0);
+	dlist_init(&epoch->records);
+	for (i = 0; i < OFI_EPOCH_LIMBO_CNT; i++) {
+		slist_init(&epoch->limbo[i]);
+		slist_init(&epoch->buf_limbo[i]);
+		epoch->limbo_cnt[i] = 0;
+	}
+	return ofi_mutex_init(&epoch->lock);
+}
+
+static void ofi_epoch_release(struct slist *defers, struct slist *bufs)
+{
+	struct ofi_epoch_defer *defer;
+	struct ofi_bufpool_hdr *buf_hdr;
+	struct slist_entry *entry;
+	void *buf;
+
+	while (!slist_empty(defers)) {
+		entry = slist_remove_head(defers);
+		defer = container_of(entry, struct ofi_epoch_defer, entry);
+		defer->free_fn(defer);
+	}
+
+	while (!slist_empty(bufs)) {
+		entry = slist_remove_head(bufs);
+		buf_hdr = container_of(entry, struct ofi_bufpool_hdr,
+				       entry.slist);
+		/* restore the allocated marker checked by ofi_buf_is_valid */
+		buf_hdr->entry.slist.next = &buf_hdr->entry.slist;
+		buf = ofi_buf_data(buf_hdr);
+		if (ofi_buf_pool(buf)->attr.flags & OFI_BUFPOOL_INDEXED)
+			ofi_ibuf_free(buf);
+		else
+			ofi_buf_free(buf);
+	}
+}
+
+void ofi_epoch_close(struct ofi_epoch *epoch)
+{
+	int i;
+
+	assert(dlist_empty(&epoch->records));
+	for (i = 0; i < OFI_EPOCH_LIMBO_CNT; i++) {
+		ofi_epoch_release(&epoch->limbo[i], &epoch->buf_limbo[i]);
+		epoch->limbo_cnt[i] = 0;
+	}
+	ofi_mutex_destroy(&epoch->lock);
+}
+
+void ofi_epoch_register(struct ofi_epoch *epoch,
+			struct ofi_epoch_record *record)
+{
+	ofi_atomic_initialize64(&record->state, 0);
+	record->nest = 0;
+
+	ofi_mutex_lock(&epoch->lock);
+	dlist_insert_tail(&record->entry, &epoch->records);
+	ofi_mutex_unlock(&epoch->lock);
+}
+
+void ofi_epoch_deregister(struct ofi_epoch *epoch,
+			  struct ofi_epoch_record *record)
+{
+	assert(!record->nest);
+
+	ofi_mutex_lock(&epoch->lock);
+	dlist_remove(&record->entry);
+	ofi_mutex_unlock(&epoch->lock);
+}
+
+/*
+ * Called with the lock held.  If every active reader has seen the current
+ * epoch, advance it and move the objects retired two epochs ago, which
+ * share a limbo slot with the new epoch's successor, to the caller's lists.
+ */
+static bool ofi_epoch_advance(struct ofi_epoch *epoch, struct slist *defers,
+			      struct slist *bufs)
+{
+	struct ofi_epoch_record *record;
+	int64_t global, state;
+	int slot;
+
+	/* order the writers' unlinks before reading the reader states */
+	ofi_mb();
+	global = ofi_atomic_load_explicit64(&epoch->global,
+					    memory_order_relaxed);
+	dlist_foreach_container(&epoch->records, struct ofi_epoch_record,
+				record, entry) {
+		state = ofi_atomic_load_explicit64(&record->state,
+						   memory_order_acquire);
+		if ((state & 1) && (state >> 1) != global)
+			return false;
+	}
+
+	global++;
+	ofi_atomic_store_explicit64(&epoch->global, global,
+				    memory_order_release);
+
+	slot = (int) ((global + 1) % OFI_EPOCH_LIMBO_CNT);
+	*defers = epoch->limbo[slot];
+	*bufs = epoch->buf_limbo[slot];
+	slist_init(&epoch->limbo[slot]);
+	slist_init(&epoch->buf_limbo[slot]);
+	epoch->limbo_cnt[slot] = 0;
+	return true;
+}
+
+static size_t ofi_epoch_pending(struct ofi_epoch *epoch)
+{
+	return epoch->limbo_cnt[0] + epoch->limbo_cnt[1] +
+	       epoch->limbo_cnt[2];
+}
+
+size_t ofi_epoch_reclaim(struct ofi_epoch *epoch)
+{
+	struct slist defers, bufs;
+	size_t remaining;
+	bool advanced;
+
+	ofi_mutex_lock(&epoch->lock);
+	advanced = ofi_epoch_advance(epoch, &defers, &bufs);
+	remaining = ofi_epoch_pending(epoch);
+	ofi_mutex_unlock(&epoch->lock);
+
+	if (advanced)
+		ofi_epoch_release(&defers, &bufs);
+	return remaining;
+}
+
+void ofi_epoch_synchronize(struct ofi_epoch *epoch)
+{
+	int64_t target;
+
+	/* objects retired in the current epoch are freed two epochs later */
+	target = ofi_atomic_load_explicit64(&epoch->global,
+					    memory_order_acquire) + 2;
+	while (ofi_atomic_load_explicit64(&epoch->global,
+					  memory_order_acquire) < target) {
+		ofi_epoch_reclaim(epoch);
+		sched_yield();
+	}
+}
+
+static void ofi_epoch_retire_entry(struct ofi_epoch *epoch,
+				   struct slist_entry *entry, bool buf)
+{
+	int64_t global;
+	bool reclaim;
+	int slot;
+
+	ofi_mutex_lock(&epoch->lock);
+	global = ofi_atomic_load_explicit64(&epoch->global,
+					    memory_order_relaxed);
+	slot = (int) (global % OFI_EPOCH_LIMBO_CNT);
+	slist_insert_tail(entry, buf ? &epoch->buf_limbo[slot] :
+			  &epoch->limbo[slot]);
+	epoch->limbo_cnt[slot]++;
+	reclaim = ofi_epoch_pending(epoch) >= OFI_EPOCH_RECLAIM_THRESHOLD;
+	ofi_mutex_unlock(&epoch->lock);
+
+	if (reclaim)
+		ofi_epoch_reclaim(epoch);
+}
+
+void ofi_epoch_retire(struct ofi_epoch *epoch, struct ofi_epoch_defer *defer,
+		      ofi_epoch_free_fn free_fn)
+{
+	defer->free_fn = free_fn;
+	ofi_epoch_retire_entry(epoch, &defer->entry, false);
+}
+
+void ofi_epoch_retire_buf(struct ofi_epoch *epoch, void *buf)
+{
+	assert(ofi_buf_is_valid(buf));
+	ofi_epoch_retire_entry(epoch, &ofi_buf_hdr(buf)->entry.slist, true);
+}
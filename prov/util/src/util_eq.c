@@ -68,6 +68,17 @@ void ofi_eq_handle_err_entry(uint32_t api_version, uint64_t flags,
 	}
 }
 
+#define OFI_EQ_EVENT_SIZE (sizeof(struct util_event) + OFI_EQ_INLINE_SIZE)
+
+/* Caller must hold eq->lock */
+static void util_eq_free_event(struct util_eq *eq, struct util_event *event)
+{
+	if (event->prealloc)
+		slist_insert_head(&event->entry, &eq->free_events);
+	else
+		free(event);
+}
+
 /*
  * fi_eq_read and fi_eq_readerr share this common code path.
  * If flags contains UTIL_FLAG_ERROR, then we are processing
@@ -128,7 +139,7 @@ ssize_t ofi_eq_read(struct fid_eq *eq_fid, uint32_t *event,
 
 	if (!(flags & FI_PEEK)) {
 		slist_remove_head(&eq->list);
-		free(entry);
+		util_eq_free_event(eq, entry);
 	}
 out:
 	ofi_mutex_unlock(&eq->lock);
@@ -142,23 +153,83 @@ ssize_t ofi_eq_readerr(struct fid_eq *eq_fid, struct fi_eq_err_entry *buf,
 			  flags | UTIL_FLAG_ERROR);
 }
 
+ssize_t ofi_eq_read_batch(struct fid_eq *eq_fid, struct slist *batch,
+			  size_t count)
+{
+	struct util_eq *eq;
+	struct util_event *entry;
+	ssize_t ret = 0;
+
+	eq = container_of(eq_fid, struct util_eq, eq_fid);
+
+	ofi_mutex_lock(&eq->lock);
+	if (eq->batch || slist_empty(&eq->list)) {
+		ret = -FI_EAGAIN;
+		goto out;
+	}
+
+	while (ret < (ssize_t) count && !slist_empty(&eq->list)) {
+		entry = container_of(eq->list.head, struct util_event, entry);
+		if (entry->err)
+			break;
+
+		slist_remove_head(&eq->list);
+		slist_insert_tail(&entry->entry, batch);
+		ret++;
+	}
+
+	if (ret)
+		eq->batch = batch;
+	else if (count)
+		ret = -FI_EAVAIL;
+out:
+	ofi_mutex_unlock(&eq->lock);
+	return ret;
+}
+
+void ofi_eq_release_batch(struct fid_eq *eq_fid, struct slist *batch)
+{
+	struct util_eq *eq;
+	struct slist_entry *entry;
+
+	eq = container_of(eq_fid, struct util_eq, eq_fid);
+
+	ofi_mutex_lock(&eq->lock);
+	assert(!eq->batch || eq->batch == batch);
+	while (!slist_empty(batch)) {
+		entry = slist_remove_head(batch);
+		util_eq_free_event(eq, container_of(entry, struct util_event,
+						    entry));
+	}
+	eq->batch = NULL;
+	ofi_mutex_unlock(&eq->lock);
+}
+
 ssize_t ofi_eq_write(struct fid_eq *eq_fid, uint32_t event,
 		     const void *buf, size_t len, uint64_t flags)
 {
 	struct util_eq *eq;
-	struct util_event *entry;
+	struct util_event *entry = NULL;
 
 	eq = container_of(eq_fid, struct util_eq, eq_fid);
-	entry = calloc(1, sizeof(*entry) + len);
-	if (!entry)
-		return -FI_ENOMEM;
+
+	ofi_mutex_lock(&eq->lock);
+	if (len <= OFI_EQ_INLINE_SIZE && !slist_empty(&eq->free_events)) {
+		entry = container_of(slist_remove_head(&eq->free_events),
+				     struct util_event, entry);
+	} else {
+		ofi_mutex_unlock(&eq->lock);
+		entry = calloc(1, sizeof(*entry) + len);
+		if (!entry)
+			return -FI_ENOMEM;
+		ofi_mutex_lock(&eq->lock);
+	}
 
 	entry->size = len;
 	entry->event = event;
 	entry->err = !!(flags & UTIL_FLAG_ERROR);
+	entry->removed = 0;
 	memcpy(entry->data, buf, len);
-
-	ofi_mutex_lock(&eq->lock);
 	slist_insert_tail(&entry->entry, &eq->list);
 	ofi_mutex_unlock(&eq->lock);
 
@@ -233,11 +304,14 @@ int ofi_eq_cleanup(struct fid *fid)
 	if (ofi_atomic_get32(&eq->ref))
 		return -FI_EBUSY;
 
+	assert(!eq->batch);
 	while (!slist_empty(&eq->list)) {
 		entry = slist_remove_head(&eq->list);
 		event = container_of(entry, struct util_event, entry);
-		free(event);
+		if (!event->prealloc)
+			free(event);
 	}
+	free(eq->event_buf);
 
 	if (eq->wait) {
 		ofi_poll_del(&eq->wait->pollset->poll_fid,
@@ -281,9 +355,50 @@ static struct fi_ops util_eq_fi_ops = {
 	.close = util_eq_close,
 	.bind = fi_no_bind,
 	.control = ofi_eq_control,
-	.ops_open = fi_no_ops_open,
+	.ops_open = ofi_eq_ops_open,
 };
 
+static struct ofi_ops_eq_batch util_eq_batch_ops = {
+	.size = sizeof(struct ofi_ops_eq_batch),
+	.read = ofi_eq_read_batch,
+	.release = ofi_eq_release_batch,
+};
+
+int ofi_eq_ops_open(struct fid *fid, const char *name, uint64_t flags,
+		    void **ops, void *context)
+{
+	if (flags)
+		return -FI_EBADFLAGS;
+
+	if (!strcasecmp(name, OFI_OPS_EQ_BATCH)) {
+		*ops = &util_eq_batch_ops;
+		return 0;
+	}
+
+	return -FI_ENOSYS;
+}
+
+static int util_eq_alloc_events(struct util_eq *eq,
+				const struct fi_eq_attr *attr)
+{
+	struct util_event *event;
+	size_t i, cnt;
+
+	cnt = attr->size ? MIN(attr->size, OFI_EQ_MAX_PREALLOC) :
+	      OFI_EQ_DEF_PREALLOC;
+	eq->event_buf = calloc(cnt, OFI_EQ_EVENT_SIZE);
+	if (!eq->event_buf)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < cnt; i++) {
+		event = (struct util_event *)
+			((char *) eq->event_buf + i * OFI_EQ_EVENT_SIZE);
+		event->prealloc = 1;
+		slist_insert_tail(&event->entry, &eq->free_events);
+	}
+	return 0;
+}
+
 static int util_eq_init(struct fid_fabric *fabric, struct util_eq *eq,
 			const struct fi_eq_attr *attr)
 {
@@ -293,6 +408,12 @@ static int util_eq_init(struct fid_fabric *fabric, struct util_eq *eq,
 
 	ofi_atomic_initialize32(&eq->ref, 0);
 	slist_init(&eq->list);
+	slist_init(&eq->free_events);
+	eq->batch = NULL;
+	ret = util_eq_alloc_events(eq, attr);
+	if (ret)
+		return ret;
+
 	ofi_mutex_init(&eq->lock);
 
 	switch (attr->wait_obj) {
@@ -307,8 +428,10 @@ static int util_eq_init(struct fid_fabric *fabric, struct util_eq *eq,
 		wait_attr.wait_obj = attr->wait_obj;
 		eq->internal_wait = 1;
 		ret = ofi_wait_open(fabric, &wait_attr, &wait);
-		if (ret)
+		if (ret) {
+			free(eq->event_buf);
 			return ret;
+		}
 		eq->wait = container_of(wait, struct util_wait, wait_fid);
 		break;
 	case FI_WAIT_SET:
@@ -317,6 +440,7 @@ static int util_eq_init(struct fid_fabric *fabric, struct util_eq *eq,
 		break;
 	default:
 		assert(0);
+		free(eq->event_buf);
 		return -FI_EINVAL;
 	}
 
@@ -341,29 +465,48 @@ static int ofi_eq_match_fid_event(struct slist_entry *entry, const void *arg)
 	return (fid == cq_entry->fid);
 }
 
-void ofi_eq_remove_fid_events(struct util_eq *eq, fid_t fid)
+static void ofi_eq_release_event_data(struct util_event *event)
 {
 	struct fi_eq_err_entry *err_entry;
+	struct fi_eq_cm_entry *cm_entry;
+
+	if (event->err) {
+		err_entry = (struct fi_eq_err_entry *) event->data;
+		if (err_entry->err_data)
+			free(err_entry->err_data);
+
+	} else if (event->event == FI_CONNREQ) {
+		cm_entry = (struct fi_eq_cm_entry *) event->data;
+		assert(cm_entry->info);
+		fi_freeinfo(cm_entry->info);
+	}
+}
+
+void ofi_eq_remove_fid_events(struct util_eq *eq, fid_t fid)
+{
 	struct slist_entry *entry;
 	struct util_event *event;
-	struct fi_eq_cm_entry *cm_entry;
 
 	ofi_mutex_lock(&eq->lock);
 	while((entry =
 	      slist_remove_first_match(&eq->list, ofi_eq_match_fid_event,
 				       fid))) {
 		event = container_of(entry, struct util_event, entry);
-		if (event->err) {
-			err_entry = (struct fi_eq_err_entry *) event->data;
-			if (err_entry->err_data)
-				free(err_entry->err_data);
-
-		} else if (event->event == FI_CONNREQ) {
-			cm_entry = (struct fi_eq_cm_entry *) event->data;
-			assert(cm_entry->info);
-			fi_freeinfo(cm_entry->info);
+		ofi_eq_release_event_data(event);
+		util_eq_free_event(eq, event);
+	}
+
+	/* Events in a batch are freed when the batch is released */
+	if (eq->batch) {
+		for (entry = eq->batch->head; entry; entry = entry->next) {
+			event = container_of(entry, struct util_event, entry);
+			if (event->removed ||
+			    !ofi_eq_match_fid_event(entry, fid))
+				continue;
+
+			ofi_eq_release_event_data(event);
+			event->removed = 1;
 		}
-		free(event);
 	}
 	ofi_mutex_unlock(&eq->lock);
 }
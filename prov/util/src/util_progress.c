@@ -0,0 +1,582 @@
+/*
+ * Copyright (c) Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <sched.h>
+
+#include <ofi_util.h>
+#include <ofi_topo.h>
+
+#define OFI_PROGRESS_EVENT_CNT 16
+
+struct ofi_progress_params ofi_progress_params = {
+	.thread_cnt = 1,
+	.spin_cnt = 1000,
+	.yield_cnt = 100,
+	.timeout = 10,
+	.affinity = NULL,
+};
+
+void ofi_progress_init_params(void)
+{
+	fi_param_define(NULL, "progress_thread_count", FI_PARAM_SIZE_T,
+			"Number of threads started by utility providers "
+			"that implement FI_PROGRESS_AUTO through the common "
+			"progress service (default: 1)");
+	fi_param_define(NULL, "progress_spin_count", FI_PARAM_SIZE_T,
+			"Number of idle polling passes a progress thread "
+			"makes before it starts yielding the CPU "
+			"(default: 1000)");
+	fi_param_define(NULL, "progress_yield_count", FI_PARAM_SIZE_T,
+			"Number of idle passes during which a progress thread "
+			"yields the CPU before it blocks (default: 100)");
+	fi_param_define(NULL, "progress_timeout", FI_PARAM_INT,
+			"Maximum time in milliseconds that an idle progress "
+			"thread blocks before polling again (default: 10)");
+	fi_param_define(NULL, "progress_affinity", FI_PARAM_STRING,
+			"CPU set that progress threads are bound to, given as "
+			"a list of ranges with optional stride, for example "
+			"0-3,8-15:2, or 'numa' to place each thread on the "
+			"least used CPU of the NUMA node of the thread that "
+			"started it (default: none)");
+
+	fi_param_get_size_t(NULL, "progress_thread_count",
+			    &ofi_progress_params.thread_cnt);
+	fi_param_get_size_t(NULL, "progress_spin_count",
+			    &ofi_progress_params.spin_cnt);
+	fi_param_get_size_t(NULL, "progress_yield_count",
+			    &ofi_progress_params.yield_cnt);
+	fi_param_get_int(NULL, "progress_timeout",
+			 &ofi_progress_params.timeout);
+	fi_param_get_str(NULL, "progress_affinity",
+			 &ofi_progress_params.affinity);
+
+	if (!ofi_progress_params.thread_cnt)
+		ofi_progress_params.thread_cnt = 1;
+	if (ofi_progress_params.timeout < 0)
+		ofi_progress_params.timeout = 0;
+}
+
+/*
+ * A wait fd without a wait_try function reports readiness only, such as
+ * data queued on a socket.  If it wakes the thread but the progress
+ * function finds nothing to do, the data is waiting on the application,
+ * so the fd stops waking the thread until the doorbell rings.
+ */
+static void util_progress_disarm(struct util_progress_thread *thread,
+				 struct util_progress_entry *prog_entry)
+{
+	if (prog_entry->wait_try)
+		return;
+
+	if (!ofi_epoll_mod(thread->epoll, prog_entry->fd, 0, prog_entry))
+		prog_entry->armed = false;
+}
+
+static void util_progress_arm(struct util_progress_thread *thread)
+{
+	struct util_progress_entry *prog_entry;
+
+	assert(ofi_mutex_held(&thread->lock));
+	dlist_foreach_container(&thread->entry_list, struct util_progress_entry,
+				prog_entry, entry) {
+		if (prog_entry->armed)
+			continue;
+
+		if (!ofi_epoll_mod(thread->epoll, prog_entry->fd,
+				   OFI_EPOLL_IN, prog_entry))
+			prog_entry->armed = true;
+	}
+}
+
+/* Returns the number of events reported by the progress functions. */
+static int util_progress_run(struct util_progress_thread *thread)
+{
+	struct util_progress_entry *prog_entry;
+	int ret, cnt = 0;
+
+	assert(ofi_mutex_held(&thread->lock));
+	dlist_foreach_container(&thread->entry_list, struct util_progress_entry,
+				prog_entry, entry) {
+		if (!prog_entry->lock) {
+			ret = prog_entry->progress(prog_entry->fid);
+		} else if (!ofi_genlock_trylock(prog_entry->lock)) {
+			ret = prog_entry->progress(prog_entry->fid);
+			ofi_genlock_unlock(prog_entry->lock);
+		} else {
+			continue;
+		}
+
+		if (prog_entry->woken) {
+			prog_entry->woken = false;
+			if (ret <= 0)
+				util_progress_disarm(thread, prog_entry);
+		}
+		if (ret > 0)
+			cnt += ret;
+	}
+	return cnt;
+}
+
+/*
+ * The entries are looked up rather than dereferenced, since they may have
+ * been removed while the thread was blocked without its lock.
+ */
+static void util_progress_wakeup(struct util_progress_thread *thread,
+				 struct ofi_epollfds_event *events, int cnt)
+{
+	struct util_progress_entry *prog_entry;
+	int i;
+
+	assert(ofi_mutex_held(&thread->lock));
+	for (i = 0; i < cnt; i++) {
+		if (events[i].data.ptr != &thread->signal)
+			continue;
+
+		fd_signal_reset(&thread->signal);
+		util_progress_arm(thread);
+		break;
+	}
+
+	dlist_foreach_container(&thread->entry_list, struct util_progress_entry,
+				prog_entry, entry) {
+		for (i = 0; i < cnt; i++) {
+			if (events[i].data.ptr == prog_entry)
+				prog_entry->woken = true;
+		}
+	}
+}
+
+/*
+ * Blocking is only safe if every entry agrees to it.  An entry that an
+ * application thread is using may be queueing work, so it is treated as
+ * busy rather than waited on.
+ */
+static int util_progress_trywait(struct util_progress_thread *thread)
+{
+	struct util_progress_entry *prog_entry;
+	int ret;
+
+	assert(ofi_mutex_held(&thread->lock));
+	dlist_foreach_container(&thread->entry_list, struct util_progress_entry,
+				prog_entry, entry) {
+		if (!prog_entry->wait_try)
+			continue;
+
+		if (!prog_entry->lock) {
+			ret = prog_entry->wait_try(prog_entry->arg);
+		} else if (!ofi_genlock_trylock(prog_entry->lock)) {
+			ret = prog_entry->wait_try(prog_entry->arg);
+			ofi_genlock_unlock(prog_entry->lock);
+		} else {
+			ret = -FI_EAGAIN;
+		}
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static bool util_progress_numa_affinity(void)
+{
+	return ofi_progress_params.affinity &&
+	       !strcasecmp(ofi_progress_params.affinity, "numa");
+}
+
+static void *util_progress_func(void *arg)
+{
+	struct util_progress_thread *thread = arg;
+	const struct fi_provider *prov = thread->progress->prov;
+	struct ofi_epollfds_event events[OFI_PROGRESS_EVENT_CNT];
+	size_t idle = 0;
+	int timeout, ret;
+
+	if (thread->cpu >= 0) {
+		ret = ofi_topo_bind_cpu(thread->cpu);
+		if (ret)
+			FI_WARN(prov, FI_LOG_DOMAIN,
+				"unable to bind progress thread to cpu %d: %s\n",
+				thread->cpu, fi_strerror(-ret));
+	} else if (ofi_progress_params.affinity &&
+		   !util_progress_numa_affinity()) {
+		ret = ofi_set_thread_affinity(ofi_progress_params.affinity);
+		if (ret)
+			FI_WARN(prov, FI_LOG_DOMAIN,
+				"unable to set progress thread affinity: %s\n",
+				fi_strerror(-ret));
+	}
+
+	FI_INFO(prov, FI_LOG_DOMAIN, "progress thread starting\n");
+	ofi_mutex_lock(&thread->lock);
+	while (thread->running) {
+		if (util_progress_run(thread)) {
+			idle = 0;
+		} else {
+			idle++;
+		}
+
+		if (idle <= ofi_progress_params.spin_cnt) {
+			ofi_mutex_unlock(&thread->lock);
+		} else if (idle <= ofi_progress_params.spin_cnt +
+				   ofi_progress_params.yield_cnt) {
+			ofi_mutex_unlock(&thread->lock);
+			sched_yield();
+		} else {
+			timeout = util_progress_trywait(thread) ?
+				  0 : ofi_progress_params.timeout;
+			ofi_mutex_unlock(&thread->lock);
+
+			ret = ofi_epoll_wait(thread->epoll, events,
+					     OFI_PROGRESS_EVENT_CNT, timeout);
+			ofi_mutex_lock(&thread->lock);
+			if (ret > 0) {
+				util_progress_wakeup(thread, events, ret);
+				idle = 0;
+			}
+			continue;
+		}
+		ofi_mutex_lock(&thread->lock);
+	}
+	ofi_mutex_unlock(&thread->lock);
+	FI_INFO(prov, FI_LOG_DOMAIN, "progress thread exiting\n");
+	return NULL;
+}
+
+static int util_progress_thread_init(struct util_progress *progress,
+				     struct util_progress_thread *thread)
+{
+	int ret;
+
+	thread->progress = progress;
+	thread->running = false;
+	thread->cpu = -1;
+	thread->entry_cnt = 0;
+	dlist_init(&thread->entry_list);
+
+	ret = ofi_mutex_init(&thread->lock);
+	if (ret)
+		return ret;
+
+	ret = fd_signal_init(&thread->signal);
+	if (ret)
+		goto err1;
+
+	ret = ofi_epoll_create(&thread->epoll);
+	if (ret)
+		goto err2;
+
+	ret = ofi_epoll_add(thread->epoll, thread->signal.fd[FI_READ_FD],
+			    OFI_EPOLL_IN, &thread->signal);
+	if (ret)
+		goto err3;
+
+	return 0;
+err3:
+	ofi_epoll_close(thread->epoll);
+err2:
+	fd_signal_free(&thread->signal);
+err1:
+	ofi_mutex_destroy(&thread->lock);
+	return ret;
+}
+
+static void util_progress_thread_close(struct util_progress_thread *thread)
+{
+	assert(dlist_empty(&thread->entry_list));
+	ofi_epoll_close(thread->epoll);
+	fd_signal_free(&thread->signal);
+	ofi_mutex_destroy(&thread->lock);
+}
+
+int ofi_progress_init(struct util_progress *progress,
+		      const struct fi_provider *prov)
+{
+	size_t i;
+	int ret;
+
+	progress->prov = prov;
+	progress->started = false;
+	progress->thread_cnt = ofi_progress_params.thread_cnt;
+	progress->threads = calloc(progress->thread_cnt,
+				   sizeof(*progress->threads));
+	if (!progress->threads)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < progress->thread_cnt; i++) {
+		ret = util_progress_thread_init(progress,
+						&progress->threads[i]);
+		if (ret)
+			goto err;
+	}
+	return 0;
+
+err:
+	while (i--)
+		util_progress_thread_close(&progress->threads[i]);
+	free(progress->threads);
+	return ret;
+}
+
+void ofi_progress_close(struct util_progress *progress)
+{
+	size_t i;
+
+	ofi_progress_stop(progress);
+	for (i = 0; i < progress->thread_cnt; i++)
+		util_progress_thread_close(&progress->threads[i]);
+	free(progress->threads);
+}
+
+int ofi_progress_start(struct util_progress *progress)
+{
+	struct util_progress_thread *thread;
+	size_t i;
+	int ret, node = -1;
+
+	if (progress->started)
+		return 0;
+
+	/* Keep the threads next to the memory the starting thread uses */
+	if (util_progress_numa_affinity())
+		node = ofi_topo_current_node();
+
+	for (i = 0; i < progress->thread_cnt; i++) {
+		thread = &progress->threads[i];
+		if (node >= 0) {
+			thread->cpu = ofi_topo_alloc_cpu(node);
+			if (thread->cpu >= 0)
+				FI_INFO(progress->prov, FI_LOG_DOMAIN,
+					"progress thread %zu placed on cpu %d "
+					"(numa node %d)\n", i, thread->cpu,
+					ofi_topo_cpu_node(thread->cpu));
+		}
+		thread->running = true;
+		ret = pthread_create(&thread->thread, NULL,
+				     util_progress_func, thread);
+		if (ret) {
+			FI_WARN(progress->prov, FI_LOG_DOMAIN,
+				"unable to start progress thread\n");
+			thread->running = false;
+			goto err;
+		}
+	}
+	progress->started = true;
+	return 0;
+
+err:
+	progress->started = true;
+	ofi_progress_stop(progress);
+	return -ret;
+}
+
+void ofi_progress_stop(struct util_progress *progress)
+{
+	struct util_progress_thread *thread;
+	size_t i;
+
+	if (!progress->started)
+		return;
+
+	for (i = 0; i < progress->thread_cnt; i++) {
+		thread = &progress->threads[i];
+		ofi_mutex_lock(&thread->lock);
+		if (!thread->running) {
+			ofi_mutex_unlock(&thread->lock);
+			continue;
+		}
+		thread->running = false;
+		fd_signal_set(&thread->signal);
+		ofi_mutex_unlock(&thread->lock);
+		(void) pthread_join(thread->thread, NULL);
+	}
+
+	for (i = 0; i < progress->thread_cnt; i++) {
+		thread = &progress->threads[i];
+		if (thread->cpu >= 0) {
+			ofi_topo_free_cpu(thread->cpu);
+			thread->cpu = -1;
+		}
+	}
+	progress->started = false;
+}
+
+static struct util_progress_thread *
+util_progress_select(struct util_progress *progress)
+{
+	struct util_progress_thread *thread;
+	size_t i;
+
+	thread = &progress->threads[0];
+	for (i = 1; i < progress->thread_cnt; i++) {
+		if (progress->threads[i].entry_cnt < thread->entry_cnt)
+			thread = &progress->threads[i];
+	}
+	return thread;
+}
+
+/*
+ * The lock must serialize the progress function against application
+ * calls that drive progress on the same object, so no-op locks selected
+ * for single threaded access cannot be used.  Objects whose progress
+ * function serializes itself pass a NULL lock.
+ */
+int ofi_progress_add(struct util_progress *progress, struct fid *fid,
+		     struct ofi_genlock *lock, ofi_progress_func func,
+		     int fd, ofi_wait_try_func wait_try, void *arg)
+{
+	struct util_progress_thread *thread;
+	struct util_progress_entry *prog_entry;
+	int ret;
+
+	if (lock && (lock->lock_type == OFI_LOCK_NOOP ||
+		     lock->lock_type == OFI_LOCK_NONE)) {
+		FI_WARN(progress->prov, FI_LOG_DOMAIN,
+			"auto progress requires a thread safe lock\n");
+		return -FI_EINVAL;
+	}
+
+	prog_entry = calloc(1, sizeof(*prog_entry));
+	if (!prog_entry)
+		return -FI_ENOMEM;
+
+	prog_entry->fid = fid;
+	prog_entry->lock = lock;
+	prog_entry->progress = func;
+	prog_entry->fd = fd;
+	prog_entry->wait_try = wait_try;
+	prog_entry->arg = arg;
+	prog_entry->armed = true;
+
+	thread = util_progress_select(progress);
+	ofi_mutex_lock(&thread->lock);
+	if (fd >= 0) {
+		ret = ofi_epoll_add(thread->epoll, fd, OFI_EPOLL_IN, prog_entry);
+		if (ret) {
+			ofi_mutex_unlock(&thread->lock);
+			free(prog_entry);
+			return ret;
+		}
+	}
+	dlist_insert_tail(&prog_entry->entry, &thread->entry_list);
+	thread->entry_cnt++;
+	fd_signal_set(&thread->signal);
+	ofi_mutex_unlock(&thread->lock);
+	return 0;
+}
+
+static int util_progress_match(struct dlist_entry *item, const void *arg)
+{
+	struct util_progress_entry *prog_entry;
+
+	prog_entry = container_of(item, struct util_progress_entry, entry);
+	return prog_entry->fid == arg;
+}
+
+/* Once this returns, the progress function will not be called again. */
+void ofi_progress_del(struct util_progress *progress, struct fid *fid)
+{
+	struct util_progress_thread *thread;
+	struct util_progress_entry *prog_entry;
+	struct dlist_entry *item;
+	size_t i;
+
+	for (i = 0; i < progress->thread_cnt; i++) {
+		thread = &progress->threads[i];
+		ofi_mutex_lock(&thread->lock);
+		item = dlist_remove_first_match(&thread->entry_list,
+						util_progress_match, fid);
+		if (item) {
+			prog_entry = container_of(item,
+					struct util_progress_entry, entry);
+			if (prog_entry->fd >= 0)
+				(void) ofi_epoll_del(thread->epoll,
+						     prog_entry->fd);
+			thread->entry_cnt--;
+		}
+		ofi_mutex_unlock(&thread->lock);
+
+		if (item) {
+			free(prog_entry);
+			return;
+		}
+	}
+}
+
+/*
+ * Doorbell for work that is queued without an event on a registered fd,
+ * such as operations deferred by the application thread.  Signals are
+ * coalesced until a thread wakes up, so ringing it from a busy data path
+ * only costs a lock and a flag check.
+ */
+void ofi_progress_signal(struct util_progress *progress)
+{
+	size_t i;
+
+	for (i = 0; i < progress->thread_cnt; i++)
+		fd_signal_set(&progress->threads[i].signal);
+}
+
+int ofi_domain_start_progress(struct util_domain *domain)
+{
+	int ret;
+
+	domain->progress = calloc(1, sizeof(*domain->progress));
+	if (!domain->progress)
+		return -FI_ENOMEM;
+
+	ret = ofi_progress_init(domain->progress, domain->prov);
+	if (ret)
+		goto err;
+
+	ret = ofi_progress_start(domain->progress);
+	if (ret) {
+		ofi_progress_close(domain->progress);
+		goto err;
+	}
+	return 0;
+err:
+	free(domain->progress);
+	domain->progress = NULL;
+	return ret;
+}
+
+void ofi_domain_stop_progress(struct util_domain *domain)
+{
+	if (!domain->progress)
+		return;
+
+	ofi_progress_close(domain->progress);
+	free(domain->progress);
+	domain->progress = NULL;
+}
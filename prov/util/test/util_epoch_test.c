@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Stress test for the epoch based reclamation in util_epoch.c.
+ *
+ * Writers repeatedly replace the objects in a table of slots and retire
+ * the old ones, alternating between a deferred callback and the buffer
+ * pool path.  Readers look objects up without a lock and check that an
+ * object stays unchanged for the whole read section.  An object that is
+ * freed or reused too early is caught by the check, or by a memory or
+ * thread sanitizer when built with one.
+ */
+
+#include "config.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <ofi_epoch.h>
+
+#define SLOT_CNT	64
+#define READER_CNT	4
+#define WRITER_CNT	2
+#define WRITER_ITERS	200000
+
+#define NODE_LIVE	0x11feULL
+#define NODE_DEAD	0xdeadULL
+
+struct node {
+	ofi_atomic64_t		magic;
+	ofi_atomic64_t		gen;
+	struct ofi_epoch_defer	defer;
+};
+
+static struct ofi_epoch epoch;
+static ofi_mutex_t writer_lock;
+static struct ofi_bufpool *node_pool;
+static ofi_atomic64_t slots[SLOT_CNT];
+static ofi_atomic64_t next_gen;
+static ofi_atomic32_t writers_done;
+static ofi_atomic64_t retired;
+static ofi_atomic64_t freed;
+static ofi_atomic64_t errors;
+
+static struct node *node_alloc(void)
+{
+	struct node *node;
+
+	node = ofi_buf_alloc(node_pool);
+	if (!node) {
+		fprintf(stderr, "node allocation failed\n");
+		exit(EXIT_FAILURE);
+	}
+	ofi_atomic_initialize64(&node->gen, ofi_atomic_inc64(&next_gen));
+	ofi_atomic_initialize64(&node->magic, NODE_LIVE);
+	return node;
+}
+
+/* called with writer_lock held, from ofi_epoch_retire/reclaim */
+static void node_free(struct ofi_epoch_defer *defer)
+{
+	struct node *node = container_of(defer, struct node, defer);
+
+	ofi_atomic_store_explicit64(&node->magic, NODE_DEAD,
+				    memory_order_relaxed);
+	ofi_atomic_inc64(&freed);
+	ofi_buf_free(node);
+}
+
+static void *reader(void *arg)
+{
+	struct ofi_epoch_record record;
+	struct node *node;
+	int64_t gen;
+	unsigned int i = (unsigned int) (uintptr_t) arg;
+	int spin;
+
+	ofi_epoch_register(&epoch, &record);
+	while (!ofi_atomic_get32(&writers_done)) {
+		ofi_epoch_enter(&epoch, &record);
+		node = (struct node *) (uintptr_t)
+			ofi_atomic_load_explicit64(&slots[i++ % SLOT_CNT],
+						   memory_order_acquire);
+		gen = ofi_atomic_load_explicit64(&node->gen,
+						 memory_order_relaxed);
+
+		/* nested sections must not end the outer one */
+		ofi_epoch_enter(&epoch, &record);
+		ofi_epoch_exit(&epoch, &record);
+
+		for (spin = 0; spin < 16; spin++) {
+			if (ofi_atomic_load_explicit64(&node->magic,
+					memory_order_relaxed) != NODE_LIVE ||
+			    ofi_atomic_load_explicit64(&node->gen,
+					memory_order_relaxed) != gen) {
+				ofi_atomic_inc64(&errors);
+				break;
+			}
+		}
+		ofi_epoch_exit(&epoch, &record);
+	}
+	ofi_epoch_deregister(&epoch, &record);
+	return NULL;
+}
+
+static void *writer(void *arg)
+{
+	struct node *node, *old;
+	unsigned int i = (unsigned int) (uintptr_t) arg;
+	int iter;
+
+	for (iter = 0; iter < WRITER_ITERS; iter++, i += 7) {
+		ofi_mutex_lock(&writer_lock);
+		node = node_alloc();
+		old = (struct node *) (uintptr_t)
+			ofi_atomic_load_explicit64(&slots[i % SLOT_CNT],
+						   memory_order_relaxed);
+		ofi_atomic_store_explicit64(&slots[i % SLOT_CNT],
+					    (uintptr_t) node,
+					    memory_order_release);
+		ofi_atomic_inc64(&retired);
+		if (iter & 1) {
+			ofi_epoch_retire(&epoch, &old->defer, node_free);
+		} else {
+			/* counted here, since nothing is called back */
+			ofi_atomic_inc64(&freed);
+			ofi_epoch_retire_buf(&epoch, old);
+		}
+		ofi_mutex_unlock(&writer_lock);
+	}
+	return NULL;
+}
+
+int main(void)
+{
+	pthread_t readers[READER_CNT], writers[WRITER_CNT];
+	struct node *node;
+	int i, ret;
+
+	ret = ofi_bufpool_create(&node_pool, sizeof(struct node), 16, 0,
+				 SLOT_CNT, 0);
+	if (ret || ofi_epoch_init(&epoch) || ofi_mutex_init(&writer_lock)) {
+		fprintf(stderr, "initialization failed\n");
+		return EXIT_FAILURE;
+	}
+
+	ofi_atomic_initialize64(&next_gen, 0);
+	ofi_atomic_initialize32(&writers_done, 0);
+	ofi_atomic_initialize64(&retired, 0);
+	ofi_atomic_initialize64(&freed, 0);
+	ofi_atomic_initialize64(&errors, 0);
+	for (i = 0; i < SLOT_CNT; i++)
+		ofi_atomic_initialize64(&slots[i], (uintptr_t) node_alloc());
+
+	for (i = 0; i < READER_CNT; i++)
+		pthread_create(&readers[i], NULL, reader,
+			       (void *) (uintptr_t) (i * 13));
+	for (i = 0; i < WRITER_CNT; i++)
+		pthread_create(&writers[i], NULL, writer,
+			       (void *) (uintptr_t) i);
+
+	for (i = 0; i < WRITER_CNT; i++)
+		pthread_join(writers[i], NULL);
+	ofi_atomic_set32(&writers_done, 1);
+	for (i = 0; i < READER_CNT; i++)
+		pthread_join(readers[i], NULL);
+
+	ofi_mutex_lock(&writer_lock);
+	ofi_epoch_synchronize(&epoch);
+	ofi_mutex_unlock(&writer_lock);
+	if (ofi_epoch_reclaim(&epoch)) {
+		fprintf(stderr, "objects left after synchronize\n");
+		ofi_atomic_inc64(&errors);
+	}
+
+	printf("retired %" PRId64 " freed %" PRId64 " errors %" PRId64 "\n",
+	       ofi_atomic_get64(&retired), ofi_atomic_get64(&freed),
+	       ofi_atomic_get64(&errors));
+	if (ofi_atomic_get64(&retired) != ofi_atomic_get64(&freed))
+		ofi_atomic_inc64(&errors);
+
+	ofi_epoch_close(&epoch);
+	for (i = 0; i < SLOT_CNT; i++) {
+		node = (struct node *) (uintptr_t) ofi_atomic_get64(&slots[i]);
+		ofi_buf_free(node);
+	}
+	ofi_bufpool_destroy(node_pool);
+	ofi_mutex_destroy(&writer_lock);
+
+	return ofi_atomic_get64(&errors) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -86,6 +86,8 @@ struct ofi_common_locks common_locks = {
 
 size_t ofi_universe_size = 1024;
 int ofi_av_remove_cleanup;
+size_t ofi_cq_progress_budget;
+size_t ofi_cq_progress_sweep = 64;
 char *ofi_offload_coll_prov_name = NULL;
 
 
@@ -101,12 +103,14 @@ int ofi_genlock_init(struct ofi_genlock *lock,
 		lock->lock = (ofi_genlock_lockop_t) ofi_spin_lock_op;
 		lock->unlock = (ofi_genlock_lockop_t) ofi_spin_unlock_op;
 		lock->held = (ofi_genlock_lockheld_t) ofi_spin_held_op;
+		lock->trylock = (ofi_genlock_trylock_t) ofi_spin_trylock_op;
 		break;
 	case OFI_LOCK_MUTEX:
 		ret = ofi_mutex_init(&lock->base.mutex);
 		lock->lock = (ofi_genlock_lockop_t) ofi_mutex_lock_op;
 		lock->unlock = (ofi_genlock_lockop_t) ofi_mutex_unlock_op;
 		lock->held = (ofi_genlock_lockheld_t) ofi_mutex_held_op;
+		lock->trylock = (ofi_genlock_trylock_t) ofi_mutex_trylock_op;
 		break;
 	case OFI_LOCK_NOOP:
 		/* Use mutex for debug no-op support */
@@ -114,6 +118,7 @@ int ofi_genlock_init(struct ofi_genlock *lock,
 		lock->lock = (ofi_genlock_lockop_t) ofi_mutex_lock_noop;
 		lock->unlock = (ofi_genlock_lockop_t) ofi_mutex_unlock_noop;
 		lock->held = (ofi_genlock_lockheld_t) ofi_mutex_held_op;
+		lock->trylock = (ofi_genlock_trylock_t) ofi_mutex_trylock_noop;
 		break;
 	case OFI_LOCK_NONE:
 		ret = 0;
@@ -121,6 +126,7 @@ int ofi_genlock_init(struct ofi_genlock *lock,
 		lock->lock = (ofi_genlock_lockop_t) ofi_nolock_lock_op;
 		lock->unlock = (ofi_genlock_lockop_t) ofi_nolock_unlock_op;
 		lock->held = (ofi_genlock_lockheld_t) ofi_nolock_held_op;
+		lock->trylock = (ofi_genlock_trylock_t) ofi_nolock_trylock_op;
 		break;
 	default:
 		ret = -FI_EINVAL;
@@ -51,6 +51,7 @@
 #include "ofi_perf.h"
 #include "ofi_hmem.h"
 #include "ofi_mr.h"
+#include "ofi_topo.h"
 #include <ofi_shm_p2p.h>
 #include <rdma/fi_ext.h>
 
@@ -933,6 +934,8 @@ void fi_ini(void)
 	ofi_hmem_init();
 	ofi_monitors_init();
 	ofi_shm_p2p_init();
+	ofi_topo_init();
+	ofi_progress_init_params();
 
 	fi_param_define(NULL, "provider", FI_PARAM_STRING,
 			"Only use specified provider (default: all available)");
@@ -962,6 +965,22 @@ void fi_ini(void)
 			"(default: false)");
 	fi_param_get_bool(NULL, "av_remove_cleanup", &ofi_av_remove_cleanup);
 
+	fi_param_define(NULL, "cq_progress_budget", FI_PARAM_SIZE_T,
+			"Maximum number of endpoints progressed by a single "
+			"CQ read for utility based providers.  Remaining "
+			"endpoints are progressed first on the next read.  "
+			"(default: 0 - no limit)");
+	fi_param_get_size_t(NULL, "cq_progress_budget",
+			    &ofi_cq_progress_budget);
+
+	fi_param_define(NULL, "cq_progress_sweep", FI_PARAM_SIZE_T,
+			"For providers that track endpoint activity, the "
+			"number of CQ reads between progressing every bound "
+			"endpoint, including idle ones.  A value of 0 "
+			"progresses all endpoints on every read.  "
+			"(default: 64)");
+	fi_param_get_size_t(NULL, "cq_progress_sweep", &ofi_cq_progress_sweep);
+
 	fi_param_define(NULL, "offload_coll_provider", FI_PARAM_STRING,
 			"The name of a colective offload provider (default: \
 			empty - no provider)");
@@ -1025,6 +1044,7 @@ FI_DESTRUCTOR(fi_fini(void))
 	ofi_monitors_cleanup();
 	ofi_hmem_cleanup();
 	ofi_shm_p2p_cleanup();
+	ofi_topo_fini();
 	ofi_hook_fini();
 	ofi_mem_fini();
 	fi_log_fini();
@@ -0,0 +1,566 @@
+/*
+ * Copyright (c) Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ofi.h"
+#include "ofi_file.h"
+#include "ofi_list.h"
+#include "ofi_topo.h"
+
+#ifdef __linux__
+
+#include <sched.h>
+
+#define OFI_TOPO_CPU_DIR	"/sys/devices/system/cpu"
+#define OFI_TOPO_NODE_DIR	"/sys/devices/system/node"
+#define OFI_TOPO_BUF_SIZE	4096
+#define OFI_TOPO_MAX_CACHE_IDX	16
+
+struct ofi_topo_iface {
+	struct dlist_entry	entry;
+	int			node;
+	char			name[];
+};
+
+static struct {
+	pthread_mutex_t		lock;
+	ofi_atomic32_t		ready;
+	int			cpu_cnt;
+	int			node_cnt;
+	int			*cpu_node;
+	int			*cpu_l3;
+	int			*cpu_users;
+	uint8_t			*cpu_usable;
+	struct dlist_entry	ifaces;
+} ofi_topo = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static int ofi_topo_read(const char *dir, const char *file, char *buf)
+{
+	int len;
+
+	len = fi_read_file(dir, file, buf, OFI_TOPO_BUF_SIZE - 1);
+	if (len < 0)
+		return -FI_ENOENT;
+
+	buf[len] = '\0';
+	return len;
+}
+
+/* Calls fn for every id of a sysfs list such as "0-3,8,10-11" */
+static int ofi_topo_parse_list(char *str, void (*fn)(int id, void *arg),
+			       void *arg)
+{
+	char *tok, *end, *saveptr = NULL;
+	long first, last;
+
+	for (tok = strtok_r(str, ",", &saveptr); tok;
+	     tok = strtok_r(NULL, ",", &saveptr)) {
+		first = strtol(tok, &end, 10);
+		last = (*end == '-') ? strtol(end + 1, NULL, 10) : first;
+		if (first < 0 || last < first || last >= INT_MAX)
+			return -FI_EINVAL;
+		for (; first <= last; first++)
+			fn((int) first, arg);
+	}
+	return 0;
+}
+
+static void ofi_topo_max_id(int id, void *arg)
+{
+	int *max = arg;
+
+	if (id > *max)
+		*max = id;
+}
+
+static void ofi_topo_set_usable(int cpu, void *arg)
+{
+	if (cpu < ofi_topo.cpu_cnt)
+		ofi_topo.cpu_usable[cpu] = 1;
+}
+
+static void ofi_topo_set_node(int cpu, void *arg)
+{
+	if (cpu < ofi_topo.cpu_cnt)
+		ofi_topo.cpu_node[cpu] = *(int *) arg;
+}
+
+static void ofi_topo_set_l3(int cpu, void *arg)
+{
+	int *l3 = arg;
+
+	if (cpu >= ofi_topo.cpu_cnt)
+		return;
+
+	/* lists are in increasing order, so the first cpu names the domain */
+	if (*l3 < 0)
+		*l3 = cpu;
+	ofi_topo.cpu_l3[cpu] = *l3;
+}
+
+/* Usable CPUs are those the process was allowed to run on at startup */
+static void ofi_topo_load_usable(char *buf)
+{
+	const char *tag = "Cpus_allowed_list:";
+	char *line, *saveptr = NULL;
+	FILE *file;
+
+	file = fopen("/proc/self/status", "r");
+	if (file) {
+		while (fgets(buf, OFI_TOPO_BUF_SIZE, file)) {
+			if (strncmp(buf, tag, strlen(tag)))
+				continue;
+			line = strtok_r(buf + strlen(tag), " \t\n", &saveptr);
+			if (line && !ofi_topo_parse_list(line,
+						ofi_topo_set_usable, NULL)) {
+				fclose(file);
+				return;
+			}
+			break;
+		}
+		fclose(file);
+	}
+
+	if (ofi_topo_read(OFI_TOPO_CPU_DIR, "online", buf) > 0 &&
+	    !ofi_topo_parse_list(buf, ofi_topo_set_usable, NULL))
+		return;
+
+	memset(ofi_topo.cpu_usable, 1, ofi_topo.cpu_cnt);
+}
+
+static void ofi_topo_load_nodes(char *buf)
+{
+	char dir[64];
+	int node, max_node = -1;
+
+	if (ofi_topo_read(OFI_TOPO_NODE_DIR, "possible", buf) <= 0 ||
+	    ofi_topo_parse_list(buf, ofi_topo_max_id, &max_node) ||
+	    max_node < 0) {
+		/* no NUMA support in the kernel, treat as a single node */
+		for (node = 0; node < ofi_topo.cpu_cnt; node++)
+			ofi_topo.cpu_node[node] = 0;
+		ofi_topo.node_cnt = 1;
+		return;
+	}
+
+	ofi_topo.node_cnt = max_node + 1;
+	for (node = 0; node <= max_node; node++) {
+		snprintf(dir, sizeof(dir), "%s/node%d", OFI_TOPO_NODE_DIR,
+			 node);
+		if (ofi_topo_read(dir, "cpulist", buf) > 0)
+			ofi_topo_parse_list(buf, ofi_topo_set_node, &node);
+	}
+}
+
+static void ofi_topo_load_l3(char *buf)
+{
+	char dir[96];
+	int cpu, idx, l3;
+
+	for (cpu = 0; cpu < ofi_topo.cpu_cnt; cpu++) {
+		if (ofi_topo.cpu_l3[cpu] >= 0)
+			continue;
+
+		for (idx = 0; idx < OFI_TOPO_MAX_CACHE_IDX; idx++) {
+			snprintf(dir, sizeof(dir), "%s/cpu%d/cache/index%d",
+				 OFI_TOPO_CPU_DIR, cpu, idx);
+			if (ofi_topo_read(dir, "level", buf) <= 0)
+				break;
+			if (strcmp(buf, "3"))
+				continue;
+
+			if (ofi_topo_read(dir, "shared_cpu_list", buf) > 0) {
+				l3 = -1;
+				ofi_topo_parse_list(buf, ofi_topo_set_l3, &l3);
+			}
+			break;
+		}
+	}
+}
+
+static int ofi_topo_load(void)
+{
+	char *buf;
+	int max_cpu = -1, i;
+
+	buf = malloc(OFI_TOPO_BUF_SIZE);
+	if (!buf)
+		return -FI_ENOMEM;
+
+	if (ofi_topo_read(OFI_TOPO_CPU_DIR, "possible", buf) <= 0 ||
+	    ofi_topo_parse_list(buf, ofi_topo_max_id, &max_cpu) ||
+	    max_cpu < 0)
+		max_cpu = (int) ofi_sysconf(_SC_NPROCESSORS_CONF) - 1;
+	if (max_cpu < 0) {
+		free(buf);
+		return -FI_ENODATA;
+	}
+
+	ofi_topo.cpu_cnt = max_cpu + 1;
+	ofi_topo.cpu_node = malloc(sizeof(int) * ofi_topo.cpu_cnt);
+	ofi_topo.cpu_l3 = malloc(sizeof(int) * ofi_topo.cpu_cnt);
+	ofi_topo.cpu_users = calloc(ofi_topo.cpu_cnt, sizeof(int));
+	ofi_topo.cpu_usable = calloc(ofi_topo.cpu_cnt, 1);
+	if (!ofi_topo.cpu_node || !ofi_topo.cpu_l3 || !ofi_topo.cpu_users ||
+	    !ofi_topo.cpu_usable) {
+		free(buf);
+		return -FI_ENOMEM;
+	}
+
+	for (i = 0; i < ofi_topo.cpu_cnt; i++) {
+		ofi_topo.cpu_node[i] = -1;
+		ofi_topo.cpu_l3[i] = -1;
+	}
+
+	ofi_topo_load_usable(buf);
+	ofi_topo_load_nodes(buf);
+	ofi_topo_load_l3(buf);
+	free(buf);
+
+	FI_INFO(&core_prov, FI_LOG_CORE,
+		"topology: %d cpus, %d numa nodes\n",
+		ofi_topo.cpu_cnt, ofi_topo.node_cnt);
+	return 0;
+}
+
+static void ofi_topo_free(void)
+{
+	struct ofi_topo_iface *iface;
+
+	free(ofi_topo.cpu_node);
+	free(ofi_topo.cpu_l3);
+	free(ofi_topo.cpu_users);
+	free(ofi_topo.cpu_usable);
+	ofi_topo.cpu_node = NULL;
+	ofi_topo.cpu_l3 = NULL;
+	ofi_topo.cpu_users = NULL;
+	ofi_topo.cpu_usable = NULL;
+	ofi_topo.cpu_cnt = 0;
+	ofi_topo.node_cnt = 0;
+
+	while (!dlist_empty(&ofi_topo.ifaces)) {
+		dlist_pop_front(&ofi_topo.ifaces, struct ofi_topo_iface,
+				iface, entry);
+		free(iface);
+	}
+}
+
+void ofi_topo_init(void)
+{
+	ofi_atomic_initialize32(&ofi_topo.ready, 0);
+	dlist_init(&ofi_topo.ifaces);
+}
+
+void ofi_topo_fini(void)
+{
+	pthread_mutex_lock(&ofi_topo.lock);
+	ofi_topo_free();
+	ofi_atomic_set32(&ofi_topo.ready, 0);
+	pthread_mutex_unlock(&ofi_topo.lock);
+}
+
+/* Returns true once the topology is loaded; failures are not retried */
+static bool ofi_topo_get(void)
+{
+	int ret;
+
+	if (ofi_atomic_load_explicit32(&ofi_topo.ready, memory_order_acquire))
+		return ofi_topo.cpu_cnt > 0;
+
+	pthread_mutex_lock(&ofi_topo.lock);
+	if (!ofi_atomic_get32(&ofi_topo.ready)) {
+		ret = ofi_topo_load();
+		if (ret) {
+			FI_WARN(&core_prov, FI_LOG_CORE,
+				"unable to read the hardware topology: %s\n",
+				fi_strerror(-ret));
+			ofi_topo_free();
+		}
+		ofi_atomic_store_explicit32(&ofi_topo.ready, 1,
+					    memory_order_release);
+	}
+	pthread_mutex_unlock(&ofi_topo.lock);
+	return ofi_topo.cpu_cnt > 0;
+}
+
+int ofi_topo_cpu_cnt(void)
+{
+	return ofi_topo_get() ? ofi_topo.cpu_cnt : -FI_ENODATA;
+}
+
+int ofi_topo_node_cnt(void)
+{
+	return ofi_topo_get() ? ofi_topo.node_cnt : -FI_ENODATA;
+}
+
+int ofi_topo_cpu_node(int cpu)
+{
+	if (!ofi_topo_get() || cpu < 0 || cpu >= ofi_topo.cpu_cnt)
+		return -FI_ENODATA;
+	return ofi_topo.cpu_node[cpu];
+}
+
+int ofi_topo_cpu_l3(int cpu)
+{
+	if (!ofi_topo_get() || cpu < 0 || cpu >= ofi_topo.cpu_cnt)
+		return -FI_ENODATA;
+	return ofi_topo.cpu_l3[cpu];
+}
+
+int ofi_topo_current_cpu(void)
+{
+	int cpu = sched_getcpu();
+
+	return cpu < 0 ? -FI_ENODATA : cpu;
+}
+
+int ofi_topo_current_node(void)
+{
+	return ofi_topo_cpu_node(ofi_topo_current_cpu());
+}
+
+int ofi_topo_current_l3(void)
+{
+	return ofi_topo_cpu_l3(ofi_topo_current_cpu());
+}
+
+static int ofi_topo_read_iface_node(const char *name)
+{
+	static const char * const classes[] = {
+		"/sys/class/net", "/sys/class/infiniband"
+	};
+	char dir[256], buf[32];
+	int i, len;
+
+	for (i = 0; i < ARRAY_SIZE(classes); i++) {
+		snprintf(dir, sizeof(dir), "%s/%s/device", classes[i], name);
+		len = fi_read_file(dir, "numa_node", buf, sizeof(buf) - 1);
+		if (len > 0) {
+			buf[len] = '\0';
+			return atoi(buf);
+		}
+	}
+	return -1;
+}
+
+int ofi_topo_iface_node(const char *name)
+{
+	struct ofi_topo_iface *iface;
+	int node;
+
+	if (!ofi_topo_get())
+		return -FI_ENODATA;
+
+	pthread_mutex_lock(&ofi_topo.lock);
+	dlist_foreach_container(&ofi_topo.ifaces, struct ofi_topo_iface,
+				iface, entry) {
+		if (!strcmp(iface->name, name)) {
+			node = iface->node;
+			goto out;
+		}
+	}
+
+	/* numa_node is -1 for devices without affinity */
+	node = ofi_topo_read_iface_node(name);
+	if (node < 0 || node >= ofi_topo.node_cnt)
+		node = -FI_ENODATA;
+
+	iface = malloc(sizeof(*iface) + strlen(name) + 1);
+	if (iface) {
+		iface->node = node;
+		strcpy(iface->name, name);
+		dlist_insert_tail(&iface->entry, &ofi_topo.ifaces);
+	}
+out:
+	pthread_mutex_unlock(&ofi_topo.lock);
+	return node;
+}
+
+int ofi_topo_nearest_iface(const char * const *names, int cnt)
+{
+	int node, i;
+
+	if (cnt <= 0)
+		return -FI_EINVAL;
+
+	node = ofi_topo_current_node();
+	if (node < 0)
+		return 0;
+
+	for (i = 0; i < cnt; i++) {
+		if (ofi_topo_iface_node(names[i]) == node)
+			return i;
+	}
+	return 0;
+}
+
+static int ofi_topo_find_cpu(int node)
+{
+	int cpu, best = -1;
+
+	for (cpu = ofi_topo.cpu_cnt - 1; cpu >= 0; cpu--) {
+		if (!ofi_topo.cpu_usable[cpu] ||
+		    (node >= 0 && ofi_topo.cpu_node[cpu] != node))
+			continue;
+		if (best < 0 || ofi_topo.cpu_users[cpu] <
+				ofi_topo.cpu_users[best])
+			best = cpu;
+	}
+	return best;
+}
+
+int ofi_topo_alloc_cpu(int node)
+{
+	int cpu;
+
+	if (!ofi_topo_get())
+		return -FI_ENODATA;
+
+	pthread_mutex_lock(&ofi_topo.lock);
+	cpu = ofi_topo_find_cpu(node);
+	if (cpu < 0 && node >= 0)
+		cpu = ofi_topo_find_cpu(-1);
+	if (cpu >= 0)
+		ofi_topo.cpu_users[cpu]++;
+	pthread_mutex_unlock(&ofi_topo.lock);
+
+	return cpu < 0 ? -FI_ENODEV : cpu;
+}
+
+void ofi_topo_free_cpu(int cpu)
+{
+	pthread_mutex_lock(&ofi_topo.lock);
+	if (cpu >= 0 && cpu < ofi_topo.cpu_cnt) {
+		assert(ofi_topo.cpu_users[cpu] > 0);
+		ofi_topo.cpu_users[cpu]--;
+	}
+	pthread_mutex_unlock(&ofi_topo.lock);
+}
+
+int ofi_topo_bind_cpu(int cpu)
+{
+	cpu_set_t *set;
+	size_t size;
+	int ret;
+
+	if (cpu < 0)
+		return -FI_EINVAL;
+
+	set = CPU_ALLOC(cpu + 1);
+	if (!set)
+		return -FI_ENOMEM;
+
+	size = CPU_ALLOC_SIZE(cpu + 1);
+	CPU_ZERO_S(size, set);
+	CPU_SET_S(cpu, size, set);
+	ret = pthread_setaffinity_np(pthread_self(), size, set);
+	CPU_FREE(set);
+	return -ret;
+}
+
+#else /* __linux__ */
+
+void ofi_topo_init(void)
+{
+}
+
+void ofi_topo_fini(void)
+{
+}
+
+int ofi_topo_cpu_cnt(void)
+{
+	return -FI_ENOSYS;
+}
+
+int ofi_topo_node_cnt(void)
+{
+	return -FI_ENOSYS;
+}
+
+int ofi_topo_cpu_node(int cpu)
+{
+	return -FI_ENOSYS;
+}
+
+int ofi_topo_cpu_l3(int cpu)
+{
+	return -FI_ENOSYS;
+}
+
+int ofi_topo_current_cpu(void)
+{
+	return -FI_ENOSYS;
+}
+
+int ofi_topo_current_node(void)
+{
+	return -FI_ENOSYS;
+}
+
+int ofi_topo_current_l3(void)
+{
+	return -FI_ENOSYS;
+}
+
+int ofi_topo_iface_node(const char *name)
+{
+	return -FI_ENOSYS;
+}
+
+int ofi_topo_nearest_iface(const char * const *names, int cnt)
+{
+	return cnt > 0 ? 0 : -FI_EINVAL;
+}
+
+int ofi_topo_alloc_cpu(int node)
+{
+	return -FI_ENOSYS;
+}
+
+void ofi_topo_free_cpu(int cpu)
+{
+}
+
+int ofi_topo_bind_cpu(int cpu)
+{
+	return -FI_ENOSYS;
+}
+
+#endif /* __linux__ */